@@ -16,10 +16,23 @@ CREDITS:
 */
 
 #include <random>
+#include <algorithm>
+#include <functional>
+#include <thread>
 
 #include <benchmark/benchmark.h>
 #include <omm.h>
 #include <shared/bird.h>
+#include <shared/bit_tricks.h>
+#include <shared/radix_sort.h>
+
+struct Options
+{
+	uint32_t subdivisionLevel = 7;
+	uint32_t primitiveCount = 0; // 0 = all primitives.
+	float dynamicSubdivisionScale = 2.f;
+	bool enableDuplicateDetection = false;
+};
 
 class OMMBake : public benchmark::Fixture {
 protected:
@@ -74,11 +87,11 @@ protected:
 		omm::DestroyOpacityMicromapBaker(_baker);
 	}
 
-	void RunVmBake(benchmark::State& st, bool parallel, omm::TextureFilterMode filter) {
+	void RunVmBake(benchmark::State& st, bool parallel, omm::TextureFilterMode filter, const Options opt = {}) {
 
 		st.PauseTiming();
 		float alphaCutoff = 0.4f;
-		uint32_t subdivisionLevel = 7;
+		uint32_t subdivisionLevel = opt.subdivisionLevel;
 
 		omm::Cpu::BakeInputDesc desc;
 		desc.texture = _texture;
@@ -89,11 +102,13 @@ protected:
 		desc.indexBuffer = _indices.data();
 		desc.texCoords = _texCoords.data();
 		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
-		desc.indexCount = (uint32_t)_indices.size();
+		desc.indexCount = opt.primitiveCount == 0 ? (uint32_t)_indices.size() : std::min(3 * opt.primitiveCount, (uint32_t)_indices.size());
+		desc.dynamicSubdivisionScale = opt.dynamicSubdivisionScale;
 		desc.maxSubdivisionLevel = subdivisionLevel;
 		desc.alphaCutoff = alphaCutoff;
 		(uint32_t&)desc.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::DisableSpecialIndices;
-		(uint32_t&)desc.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::DisableDuplicateDetection;
+		if (!opt.enableDuplicateDetection)
+			(uint32_t&)desc.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::DisableDuplicateDetection;
 		(uint32_t&)desc.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::Force32BitIndices;
 		(uint32_t&)desc.bakeFlags |= (uint32_t)_extraBakeFlags;
 		if (parallel)
@@ -139,6 +154,13 @@ BENCHMARK_DEFINE_F(OMMBake, BakeParallel)(benchmark::State& st) {
 	}
 }
 
+BENCHMARK_DEFINE_F(OMMBake, BakeHighSubdivisionDedup)(benchmark::State& st) {
+	for (auto s : st)
+	{
+		RunVmBake(st, true, omm::TextureFilterMode::Nearest, { .subdivisionLevel = (uint32_t)st.range(2), .primitiveCount = 4, .dynamicSubdivisionScale = 0.f, .enableDuplicateDetection = true });
+	}
+}
+
 BENCHMARK_DEFINE_F(OMMBake, BakeParallelLinear)(benchmark::State& st) {
 	for (auto s : st)
 	{
@@ -170,5 +192,256 @@ BENCHMARK_REGISTER_F(OMMBake, BakeParallel)->Iterations(2)->Unit(benchmark::kSec
 ->Args({ (uint32_t)omm::Cpu::TextureFlags::DisableZOrder, (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection });
 BENCHMARK_REGISTER_F(OMMBake, BakeParallel)->Iterations(2)->Unit(benchmark::kSecond)->Name("EnableNearDuplicateDetectionBruteForce")
 ->Args({ (uint32_t)omm::Cpu::TextureFlags::DisableZOrder, (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection | (uint32_t) EnableNearDuplicateDetectionBruteForce });
+static constexpr omm::Cpu::BakeFlags EnableNearDuplicateDetectionMultiIndex = (omm::Cpu::BakeFlags)(1u << 11);
+BENCHMARK_REGISTER_F(OMMBake, BakeParallel)->Iterations(2)->Unit(benchmark::kSecond)->Name("EnableNearDuplicateDetectionMultiIndex")
+->Args({ (uint32_t)omm::Cpu::TextureFlags::DisableZOrder, (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection | (uint32_t) EnableNearDuplicateDetectionMultiIndex });
+
+// Exact deduplication at high subdivision levels, with the state digest computed during resampling (default)
+// or in a separate pass over the states.
+static constexpr omm::Cpu::BakeFlags DisableFusedResampleDigest = (omm::Cpu::BakeFlags)(1u << 10);
+BENCHMARK_REGISTER_F(OMMBake, BakeHighSubdivisionDedup)->Iterations(1)->Unit(benchmark::kSecond)->Name("FusedResampleDigest")
+->ArgsProduct({ { (uint32_t)omm::Cpu::TextureFlags::None }, { (uint32_t)omm::Cpu::BakeFlags::None }, { 10, 11, 12 } });
+BENCHMARK_REGISTER_F(OMMBake, BakeHighSubdivisionDedup)->Iterations(1)->Unit(benchmark::kSecond)->Name("SeparateDigestPass")
+->ArgsProduct({ { (uint32_t)omm::Cpu::TextureFlags::None }, { (uint32_t)DisableFusedResampleDigest }, { 10, 11, 12 } });
+
+enum class SortMode
+{
+	StdSort,
+	RadixSerial,
+	RadixParallel,
+};
+
+// Spatial sort keys as produced by MicromapSpatialSort: subdivision level in bits 60+, 26-bit morton code,
+// special index micromaps flagged by bit 63.
+static void GenerateSpatialSortKeys(uint32_t keyCount, std::vector<std::pair<uint64_t, uint32_t>>& keys)
+{
+	std::default_random_engine eng(32);
+	std::uniform_int_distribution<uint32_t> subdivLvl(0, 12);
+	std::uniform_int_distribution<uint32_t> uv(0, (1u << 13) - 1);
+	std::uniform_int_distribution<uint32_t> special(0, 15);
+
+	keys.resize(keyCount);
+	for (uint32_t i = 0; i < keyCount; ++i)
+	{
+		uint64_t key = 0;
+		if (special(eng) == 0)
+			key = (1ull << 63) | (uint64_t)i;
+		else
+			key = ((uint64_t)subdivLvl(eng) << 60) | omm::xy_to_morton(uv(eng), uv(eng));
+		keys[keyCount - 1 - i] = std::make_pair(key, i);
+	}
+}
+
+static void SpatialSort(benchmark::State& st)
+{
+	const uint32_t keyCount = (uint32_t)st.range(0);
+	const SortMode mode = (SortMode)st.range(1);
+
+	std::vector<std::pair<uint64_t, uint32_t>> input;
+	GenerateSpatialSortKeys(keyCount, input);
+
+	std::vector<std::pair<uint64_t, uint32_t>> keys(keyCount);
+	std::vector<std::pair<uint64_t, uint32_t>> scratch(keyCount);
+	std::vector<uint32_t> histograms(omm::radix::kHistogramCount);
+
+	for (auto s : st)
+	{
+		st.PauseTiming();
+		std::copy(input.begin(), input.end(), keys.begin());
+		st.ResumeTiming();
+
+		if (mode == SortMode::StdSort)
+			std::sort(keys.begin(), keys.end(), std::greater<std::pair<uint64_t, uint32_t>>());
+		else
+			omm::radix::SortDescending(keys.data(), scratch.data(), histograms.data(), keyCount, mode == SortMode::RadixParallel);
+
+		benchmark::DoNotOptimize(keys.data());
+	}
+}
+
+BENCHMARK(SpatialSort)->Unit(benchmark::kMillisecond)->ArgNames({ "keys", "mode" })
+->ArgsProduct({ { 10'000, 1'000'000, 10'000'000 }, { (int64_t)SortMode::StdSort, (int64_t)SortMode::RadixSerial, (int64_t)SortMode::RadixParallel } });
+
+// Placement of a 256MB texture: creation cost and the parallel bake sampling from it, with the pages first touched
+// by the calling thread (default) or the internal threads, on regular or huge pages.
+static constexpr uint32_t kLargeTextureSize = 8192;
+
+static void GenerateLargeTexture(std::vector<float>& texture, std::vector<uint32_t>& indices, std::vector<float2>& texCoords)
+{
+	std::default_random_engine eng(32);
+	std::uniform_real_distribution<float> distr(0.f, 1.f);
+
+	texture.resize(size_t(kLargeTextureSize) * kLargeTextureSize);
+	for (float& texel : texture)
+		texel = distr(eng);
+
+	const uint32_t idxCount = 3 * 16384;
+	indices.resize(idxCount);
+	texCoords.resize(idxCount);
+	for (uint32_t i = 0; i < idxCount; ++i)
+	{
+		indices[i] = i;
+		texCoords[i] = float2(distr(eng), distr(eng));
+	}
+}
+
+static omm::Cpu::TextureDesc GetLargeTextureDesc(const std::vector<float>& texture, omm::Cpu::TextureMipDesc& mip, omm::Cpu::TextureFlags flags)
+{
+	mip.width = kLargeTextureSize;
+	mip.height = kLargeTextureSize;
+	mip.textureData = texture.data();
+
+	omm::Cpu::TextureDesc desc;
+	desc.format = omm::Cpu::TextureFormat::FP32;
+	desc.mipCount = 1;
+	desc.mips = &mip;
+	desc.flags = flags;
+	return desc;
+}
+
+static void LargeTextureCreate(benchmark::State& st)
+{
+	const omm::LargeBufferFlags largeBufferFlags = (omm::LargeBufferFlags)st.range(0);
+	const omm::Cpu::TextureFlags textureFlags = (omm::Cpu::TextureFlags)st.range(1);
+
+	std::vector<float> texture;
+	std::vector<uint32_t> indices;
+	std::vector<float2> texCoords;
+	GenerateLargeTexture(texture, indices, texCoords);
+
+	omm::Baker baker = 0;
+	omm::CreateOpacityMicromapBaker({ .type = omm::BakerType::CPU, .largeBufferFlags = largeBufferFlags }, &baker);
+
+	omm::Cpu::TextureMipDesc mip;
+	const omm::Cpu::TextureDesc desc = GetLargeTextureDesc(texture, mip, textureFlags);
+
+	for (auto s : st)
+	{
+		omm::Cpu::Texture tex = 0;
+		omm::Cpu::CreateTexture(baker, desc, &tex);
+
+		st.PauseTiming();
+		omm::Cpu::DestroyTexture(baker, tex);
+		st.ResumeTiming();
+	}
+
+	omm::DestroyOpacityMicromapBaker(baker);
+}
+
+static void LargeTextureBake(benchmark::State& st)
+{
+	const omm::LargeBufferFlags largeBufferFlags = (omm::LargeBufferFlags)st.range(0);
+	const omm::Cpu::TextureFlags textureFlags = (omm::Cpu::TextureFlags)st.range(1);
+
+	std::vector<float> texture;
+	std::vector<uint32_t> indices;
+	std::vector<float2> texCoords;
+	GenerateLargeTexture(texture, indices, texCoords);
+
+	omm::Baker baker = 0;
+	omm::CreateOpacityMicromapBaker({ .type = omm::BakerType::CPU, .largeBufferFlags = largeBufferFlags }, &baker);
+
+	omm::Cpu::TextureMipDesc mip;
+	omm::Cpu::Texture tex = 0;
+	omm::Cpu::CreateTexture(baker, GetLargeTextureDesc(texture, mip, textureFlags), &tex);
+
+	omm::Cpu::BakeInputDesc desc;
+	desc.texture = tex;
+	desc.alphaMode = omm::AlphaMode::Test;
+	desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+	desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+	desc.indexFormat = omm::IndexFormat::I32_UINT;
+	desc.indexBuffer = indices.data();
+	desc.indexCount = (uint32_t)indices.size();
+	desc.texCoords = texCoords.data();
+	desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+	desc.maxSubdivisionLevel = 6;
+	desc.dynamicSubdivisionScale = 0.f;
+	desc.alphaCutoff = 0.4f;
+	desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads | (uint32_t)omm::Cpu::BakeFlags::DisableDuplicateDetection);
+
+	for (auto s : st)
+	{
+		omm::Cpu::BakeResult res = 0;
+		omm::Cpu::BakeOpacityMicromap(baker, desc, &res);
+
+		st.PauseTiming();
+		omm::Cpu::DestroyBakeResult(res);
+		st.ResumeTiming();
+	}
+
+	omm::Cpu::DestroyTexture(baker, tex);
+	omm::DestroyOpacityMicromapBaker(baker);
+}
+
+static constexpr int64_t kParallelFirstTouch = (int64_t)omm::LargeBufferFlags::ParallelFirstTouch;
+static constexpr int64_t kHugePages = (int64_t)omm::LargeBufferFlags::HugePages;
+BENCHMARK(LargeTextureCreate)->Unit(benchmark::kMillisecond)->ArgNames({ "largeBufferFlags", "textureFlags" })
+->ArgsProduct({ { 0, kParallelFirstTouch, kHugePages, kParallelFirstTouch | kHugePages }, { (int64_t)omm::Cpu::TextureFlags::None, (int64_t)omm::Cpu::TextureFlags::DisableZOrder } });
+BENCHMARK(LargeTextureBake)->Unit(benchmark::kMillisecond)->ArgNames({ "largeBufferFlags", "textureFlags" })
+->ArgsProduct({ { 0, kParallelFirstTouch, kHugePages, kParallelFirstTouch | kHugePages }, { (int64_t)omm::Cpu::TextureFlags::None, (int64_t)omm::Cpu::TextureFlags::DisableZOrder } });
+
+// Many small bakes on one baker and texture from application threads, e.g. one bake per mesh from a job system.
+// Bakes per second should scale with the thread count.
+static void ConcurrentBakes(benchmark::State& st)
+{
+	const uint32_t threadCount = (uint32_t)st.range(0);
+	const uint32_t kBakesPerThread = 32;
+
+	std::vector<float> texture;
+	std::vector<uint32_t> indices;
+	std::vector<float2> texCoords;
+	GenerateLargeTexture(texture, indices, texCoords);
+
+	omm::Baker baker = 0;
+	omm::CreateOpacityMicromapBaker({ .type = omm::BakerType::CPU }, &baker);
+
+	omm::Cpu::TextureMipDesc mip;
+	omm::Cpu::Texture tex = 0;
+	omm::Cpu::CreateTexture(baker, GetLargeTextureDesc(texture, mip, omm::Cpu::TextureFlags::None), &tex);
+
+	omm::Cpu::BakeInputDesc desc;
+	desc.texture = tex;
+	desc.alphaMode = omm::AlphaMode::Test;
+	desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+	desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+	desc.indexFormat = omm::IndexFormat::I32_UINT;
+	desc.indexCount = 3 * 64;
+	desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+	desc.maxSubdivisionLevel = 5;
+	desc.dynamicSubdivisionScale = 0.f;
+	desc.alphaCutoff = 0.4f;
+
+	for (auto s : st)
+	{
+		std::vector<std::thread> threads;
+		for (uint32_t threadIt = 0; threadIt < threadCount; ++threadIt)
+		{
+			threads.emplace_back([&, threadIt]() {
+				for (uint32_t bakeIt = 0; bakeIt < kBakesPerThread; ++bakeIt)
+				{
+					// Each bake reads its own range of the shared geometry.
+					const uint32_t meshIt = (threadIt * kBakesPerThread + bakeIt) % (uint32_t)(indices.size() / desc.indexCount);
+					omm::Cpu::BakeInputDesc meshDesc = desc;
+					meshDesc.indexBuffer = indices.data();
+					meshDesc.indexOffset = meshIt * desc.indexCount;
+					meshDesc.texCoords = texCoords.data();
+
+					omm::Cpu::BakeResult res = 0;
+					omm::Cpu::BakeOpacityMicromap(baker, meshDesc, &res);
+					omm::Cpu::DestroyBakeResult(res);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+	st.SetItemsProcessed(st.iterations() * threadCount * kBakesPerThread);
+
+	omm::Cpu::DestroyTexture(baker, tex);
+	omm::DestroyOpacityMicromapBaker(baker);
+}
+
+BENCHMARK(ConcurrentBakes)->Unit(benchmark::kMillisecond)->UseRealTime()->ArgNames({ "threads" })->RangeMultiplier(2)->Range(1, 32);
 
 BENCHMARK_MAIN();
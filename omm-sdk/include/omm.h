@@ -83,6 +83,18 @@ namespace omm
         MAX_NUM     = 3,
     };
 
+    enum class DMMFormat : uint16_t
+    {
+        INVALID                             = 0,
+        // 64 micro-triangles (subdivision levels [0, 3]) in a 64 byte block, uncompressed 11-bit displacement per micro-vertex,
+        // in the SDK's micro-vertex order (see BakeDisplacementResultDesc). The block size matches the DX (NVAPI) / VK
+        // DC1_64_TRIANGLES_64_BYTES format but the micro-vertex order is not the spec's, so the value deliberately doesn't
+        // map to the spec. BakeDisplacementInputDesc::outputLayout writes the blocks in the API's order and format value.
+        DC1_64_Triangles_64_Bytes_SdkOrder  = 0x8001,
+
+        MAX_NUM                             = 0x8002,
+    };
+
     // Determines how to promote mixed states to either UT or UO
     enum class UnknownStatePromotion : uint8_t
     {
@@ -156,6 +168,14 @@ namespace omm
         TextureAddressMode  addressingMode  = TextureAddressMode::MAX_NUM;
         TextureFilterMode   filter          = TextureFilterMode::MAX_NUM;
         float               borderAlpha     = 0;
+        // [CPU only] LOD range the runtime may sample, after LOD bias and clamping. Trilinear filtering blends the two
+        // mips around the LOD, so only mips [floor(minLod), ceil(maxLod)] are resampled. The default covers all mips.
+        float               minLod          = 0.f;
+        float               maxLod          = 1000.f;
+        // [CPU only] Max anisotropy of the runtime sampler, must be in range [1, 16]. Anisotropic filtering spreads its
+        // taps over up to maxAnisotropy texels of the sampled mip along the major axis of the footprint, micro-triangles
+        // are grown by half of that in all directions as the axis is only known at runtime.
+        uint32_t            maxAnisotropy   = 1;
     };
 
     struct MemoryAllocatorInterface
@@ -173,11 +193,39 @@ namespace omm
         uint8_t versionBuild;
     };
 
+    // Placement of the large internal buffers of the CPU baker: the texture data and the per work item opacity states
+    // written during resampling.
+    enum class LargeBufferFlags : uint32_t
+    {
+        None                    = 0,
+
+        // Buffers are initialized in page sized chunks by the internal (OpenMP) threads instead of the calling thread, the
+        // opacity states of a work item by the thread resampling it.
+        // With the first-touch policy of Linux and Windows the pages end up spread over the NUMA nodes the threads run
+        // on, rather than all on the node of the calling thread, balancing memory bandwidth for bakes using
+        // BakeFlags::EnableInternalThreads on multi socket machines. Has no effect without OpenMP.
+        ParallelFirstTouch      = 1u << 0,
+
+        // Buffers of 2MB or more are 2MB aligned and, on Linux, advised as transparent huge pages before first touch.
+        // Reduces TLB misses when sampling multi gigabyte textures and writing the states of subdivision level 10 and
+        // above. Has no effect on other platforms or when THP is disabled system wide.
+        HugePages               = 1u << 1,
+    };
+    OMM_DEFINE_ENUM_FLAG_OPERATORS(LargeBufferFlags);
+
     struct BakerCreationDesc
     {
         BakerType                   type                        = BakerType::MAX_NUM;
         bool                        enableValidation            = false;
         MemoryAllocatorInterface    memoryAllocatorInterface;
+        // [optional] CPU only. Cpu::CreateTexture calls with identical texel data, sizes and flags share one preprocessed
+        // texture, the handle stays valid until every call has been matched by a Cpu::DestroyTexture. Textures are
+        // identified by a TextureContentKey, a 128 bit hash of their content along with the format, flags and size. Up to
+        // textureCacheSizeInBytes of textures no longer referenced are kept for reuse, least recently used are freed first.
+        // Meant for long running processes re-creating the same textures for many bakes. 0 => disabled
+        size_t                      textureCacheSizeInBytes     = 0;
+        // [optional] CPU only. See LargeBufferFlags.
+        LargeBufferFlags            largeBufferFlags            = LargeBufferFlags::None;
     };
 
     using Handle = uintptr_t;
@@ -234,7 +282,16 @@ namespace omm
 
             // Workload validation is a safety mechanism that will let the SDK reject workloads that become unreasonably large, which may lead to long baking times
             // When this flag is set the bake operation may return error WORKLOAD_TOO_BIG
-            EnableWorkloadValidation                = 1u << 5
+            EnableWorkloadValidation                = 1u << 5,
+
+            // Outputs BakeResultDesc::primitiveCoverage, a summary of the result per primitive.
+            EnablePrimitiveCoverage                 = 1u << 12,
+
+            // BakeDisplacementMicromap only. DMMs with a uniform displacement are stored at the lowest subdivision level
+            // that keeps them within one level of their neighbours, level 0 when the neighbours are uniform as well.
+            // A uniform displacement is represented exactly at any level and deduplicates across primitives of that level.
+            // The neighbours decimate their edges to the demoted primitive, see BakeDisplacementResultDesc::dmmEdgeFlags.
+            EnableDisplacementLevelDemotion         = 1u << 13,
         };
         OMM_DEFINE_ENUM_FLAG_OPERATORS(BakeFlags);
 
@@ -269,11 +326,90 @@ namespace omm
             uint32_t                mipCount    = 0;
         };
 
+        // Identity of a texture in the texture cache, see BakerCreationDesc::textureCacheSizeInBytes.
+        struct TextureContentKey
+        {
+            // 128 bit hash of the desc and the texels of every mip, the row pitch is not part of the content.
+            uint64_t                hash[2]     = { 0, 0 };
+            TextureFormat           format      = TextureFormat::MAX_NUM;
+            TextureFlags            flags       = TextureFlags::None;
+            uint32_t                mipCount    = 0;
+            // Size of mip 0.
+            uint32_t                width       = 0;
+            uint32_t                height      = 0;
+        };
+
+        // Affine 2x3 transform applied to texture coordinates, row-major:
+        // u' = m[0][0] * u + m[0][1] * v + m[0][2]
+        // v' = m[1][0] * u + m[1][1] * v + m[1][2]
+        struct TexCoordTransform
+        {
+            float                   m[2][3]                     = { { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } };
+        };
+
+        // Procedural alpha source, replaces the texture when the alpha is defined by a function (noise dissolve, 
+        // parametric grilles...). Micro-triangles are classified by recursive interval refinement, the cost scales with 
+        // the complexity of the alpha boundary rather than with a texture resolution.
+        // The callbacks may be invoked concurrently when BakeFlags::EnableInternalThreads is set.
+        struct ProceduralAlphaDesc
+        {
+            // Must write a conservative [min, max] range of alpha over the UV triangle
+            // (uv[0], uv[1]), (uv[2], uv[3]), (uv[4], uv[5]), i.e every point in the triangle is within the range.
+            void (*EvaluateBounds)(void* userArg, const float uv[6], float* outMin, float* outMax) = nullptr;
+            // [optional] Alpha at a single point. Used to pick UnknownOpaque / UnknownTransparent for regions
+            // still ambiguous after maxRefinementDepth when running UnknownStatePromotion::Nearest.
+            float (*EvaluatePoint)(void* userArg, float u, float v) = nullptr;
+            void* userArg = nullptr;
+            // Number of times an ambiguous micro-triangle may be split in four before it's classified as unknown.
+            // Must be in range [0, 12]
+            uint32_t maxRefinementDepth = 6;
+        };
+
+        enum class FillRule : uint32_t
+        {
+            NonZero,
+            EvenOdd,
+            MAX_NUM,
+        };
+
+        // Vector cutout mask, replaces the texture when the opacity comes from vector art (fences, logos, leaf silhouettes).
+        // The filled area of the contours is opaque, everything else is transparent. alphaCutoff does not apply.
+        // Micro-triangles are classified against the contour edges, independent of any texture resolution. A micro-triangle
+        // touched by an edge is conservatively unknown, even if the fill does not change across that edge.
+        struct PolygonMaskDesc
+        {
+            // UV pairs of all contours back to back. Contours are implicitly closed.
+            const float*            vertices                    = nullptr;
+            // Number of vertices of each contour, must be >= 3.
+            const uint32_t*         contourVertexCounts         = nullptr;
+            uint32_t                contourCount                = 0;
+            FillRule                fillRule                    = FillRule::NonZero;
+        };
+
+        // One tile of a UDIM texture set. Tile 1001 + u + 10 * v covers uv [u, u + 1) x [v, v + 1) and is sampled with
+        // uv - (u, v). Must be in range [1001, 2000]
+        struct UdimTileDesc
+        {
+            uint32_t                tile                        = 0;
+            Texture                 texture                     = kInvalidHandle;
+        };
+
         struct BakeInputDesc
         {
             BakeFlags               bakeFlags                   = BakeFlags::None;
 
+            // Exactly one of texture, udimTiles, proceduralAlpha or polygonMask must be set.
             Texture                 texture                     = kInvalidHandle;
+            // [optional] Used when texture is kInvalidHandle. Every primitive is resampled against the tiles it overlaps, in a
+            // single bake. Micro-triangles straddling tiles take all of them into account, regions without a tile read
+            // runtimeSamplerDesc.borderAlpha. Tiles must be unique and share the TextureFlags::DisableZOrder setting.
+            const UdimTileDesc*     udimTiles                   = nullptr;
+            uint32_t                udimTileCount               = 0;
+            // [optional] Used when texture is kInvalidHandle. runtimeSamplerDesc is ignored and dynamicSubdivisionScale
+            // is unsupported, maxSubdivisionLevel (or subdivisionLevels) is applied instead.
+            ProceduralAlphaDesc     proceduralAlpha;
+            // [optional] Used when texture is kInvalidHandle, same restrictions as proceduralAlpha.
+            PolygonMaskDesc         polygonMask;
             // RuntimeSamplerDesc should match the sampler type used at runtime
             SamplerDesc             runtimeSamplerDesc;         
             AlphaMode               alphaMode                   = AlphaMode::MAX_NUM;
@@ -281,9 +417,27 @@ namespace omm
             const void*             texCoords                   = nullptr;
             // texCoordStrideInBytes: If zero, packed aligment is assumed
             uint32_t                texCoordStrideInBytes       = 0;
+            // indexBuffer may be nullptr for non-indexed triangle lists, indexFormat is ignored then.
             IndexFormat             indexFormat                 = IndexFormat::MAX_NUM;
             const void*             indexBuffer                 = nullptr;
+            // Number of indices (vertices when non-indexed) read, 3 per primitive.
             uint32_t                indexCount                  = 0;
+            // [optional] First index read from indexBuffer, or the first vertex when non-indexed. Primitive 0 of the bake
+            // (and of per primitive inputs like ommFormats and subdivisionLevels) starts at indexOffset.
+            uint32_t                indexOffset                 = 0;
+            // [optional] Added to each index before fetching texCoords, same as the base vertex of an indexed draw.
+            // Allows baking a submesh of shared vertex and index pools in place.
+            int32_t                 baseVertex                  = 0;
+
+            // [optional] Transform applied to all texCoords, e.g. the material UV scale/offset/rotation.
+            const TexCoordTransform* texCoordTransform          = nullptr;
+
+            // [optional] Per-frame transforms applied after texCoordTransform, e.g. the atlas sub-rectangles of a flipbook.
+            // When frameCount > 0 one OMM index buffer is produced per frame, laid out frame after frame in ommIndexBuffer
+            // (ommIndexCount = frameCount * indexCount / 3). The OMM array is shared by all frames, frames that resolve
+            // to the same OMM data reference the same OMMs.
+            const TexCoordTransform* frameTexCoordTransforms    = nullptr;
+            uint32_t                frameCount                  = 0;
 
             // Configure the target resolution when running dynamic subdivision level.
             // <= 0: disabled.
@@ -295,9 +449,20 @@ namespace omm
             // states OMMs will be discarded for the primitive. Use this to weed out "poor" OMMs.
             float                   rejectionThreshold          = 0.0f;
 
+            // Used with BakeFlags::EnableNearDuplicateDetection.
+            // <= 0: near-duplicates under a fixed similarity threshold are merged.
+            // > 0: near-duplicates are merged cheapest first (bytes saved per error) until the total error reaches the budget.
+            // The error is the micro-triangle area downgraded to unknown, in units of whole triangles, counted for every
+            // primitive referencing the OMM. E.g. 1.0 allows the equivalent of one fully unknown triangle.
+            float                   nearDuplicateErrorBudget    = 0.0f;
+
             // The alpha cutoff value. texture > alphaCutoff ? Opaque : Transparent 
             float                   alphaCutoff                 = 0.5f;
 
+            // [optional] Per triangle alpha cutoff, overrides alphaCutoff. E.g. for meshes mixing materials.
+            // Triangles with identical texture coordinates but different cutoffs don't share OMMs.
+            const float*            alphaCutoffs                = nullptr;
+
             // Determines how to promote mixed states
             UnknownStatePromotion   unknownStatePromotion       = UnknownStatePromotion::ForceOpaque;
 
@@ -319,6 +484,12 @@ namespace omm
             // val:13      - use global value specified in 'subdivisionLevel'
             // val:0-12    - per triangle subdivision level
             uint8_t*                subdivisionLevels           = nullptr; 
+
+            // [optional] Per triangle special index, skips baking of the triangle.
+            // val:0       - baked as usual
+            // val:-1..-4  - not resampled, the triangle references the SpecialIndex, e.g. SpecialIndex::FullyOpaque for opaque materials
+            // Other values are invalid.
+            const int32_t*          specialIndices              = nullptr;
         };
 
         struct OpacityMicromapDesc
@@ -341,6 +512,33 @@ namespace omm
             uint16_t format             = 0;
         };
 
+        // Why a primitive references a special index rather than an OMM.
+        enum class SpecialIndexReason : uint8_t
+        {
+            // The primitive references an OMM.
+            None,
+            // All micro-triangles resolved to the same state.
+            Uniform,
+            // The known fraction was below BakeInputDesc::rejectionThreshold.
+            Rejected,
+            // Zero area or non-finite texture coordinates.
+            Degenerate,
+            // Disabled by its subdivision level.
+            Disabled,
+            // Set by BakeInputDesc::specialIndices.
+            Forced,
+        };
+
+        struct PrimitiveCoverage
+        {
+            // Fraction of the micro-triangles with a known state in the output, as referenced by ommIndexBuffer.
+            // Near-duplicate merging is taken into account. 0 for rejected OMMs.
+            float                   knownFraction               = 0.f;
+            // Subdivision level the primitive was resampled at, 0 when it wasn't resampled.
+            uint8_t                 subdivisionLevel            = 0;
+            SpecialIndexReason      specialIndexReason          = SpecialIndexReason::None;
+        };
+
         struct BakeResultDesc
         {
             // Below is used as OMM array build input DX/VK.
@@ -353,19 +551,193 @@ namespace omm
             uint32_t                            ommDescArrayHistogramCount      = 0;
 
             // Below is used for BLAS build input in DX/VK
+            // When BakeInputDesc::frameCount > 0 this holds frameCount consecutive index buffers of indexCount / 3 entries each.
             const void*                         ommIndexBuffer                  = nullptr;
             uint32_t                            ommIndexCount                   = 0;
             IndexFormat                         ommIndexFormat                  = IndexFormat::MAX_NUM;
             // Same as ommDescArrayHistogram but usage count equals the number of references by ommIndexBuffer. Can be used as 'pOMMUsageCounts' for the BLAS OMM attachment in D3D12
             const OpacityMicromapUsageCount*    ommIndexHistogram               = 0;
             uint32_t                            ommIndexHistogramCount          = 0;
+
+            // [optional] Written with BakeFlags::EnablePrimitiveCoverage, one entry per ommIndexBuffer entry.
+            const PrimitiveCoverage*            primitiveCoverage               = nullptr;
+            uint32_t                            primitiveCoverageCount          = 0;
+        };
+
+        // Estimated cost of a bake, see GetPreBakeEstimate.
+        struct PreBakeEstimate
+        {
+            // Texels in the bounding boxes of the unique work items at mip 0, proportional to the resampling time of
+            // texture inputs. BakeFlags::EnableWorkloadValidation fails bakes above 2^27. 0 without a texture.
+            uint64_t                workloadSize                = 0;
+            // Micro-triangles resampled, summed over the unique work items. Proportional to the resampling time of
+            // procedural and polygon mask inputs.
+            uint64_t                microTriangleCount          = 0;
+            // Primitives with a unique texture space triangle, subdivision level, format and alpha cutoff. Each is resampled once.
+            uint32_t                workItemCount               = 0;
+            // Estimated peak of the memory allocated through the baker during the bake, including the result.
+            // The texture is not included.
+            size_t                  peakMemoryInBytes           = 0;
+            // Upper bound of the memory held by the BakeResult.
+            size_t                  maxResultSizeInBytes        = 0;
+            // Upper bound of BakeResultDesc::ommArrayDataSize.
+            size_t                  maxOmmArrayDataSizeInBytes  = 0;
+        };
+
+        // Micro-vertex of a level N displacement micromap in barycentric grid coordinates: u and v are the weights of the
+        // primitive's vertices 1 and 2 in units of 2^-N, u + v <= 2^N.
+        struct DisplacementMicroVertex
+        {
+            uint8_t u = 0;
+            uint8_t v = 0;
+        };
+
+        // Layout of the displacement blocks written by BakeDisplacementMicromap, e.g. the micro-vertex order and format
+        // value of the DX (NVAPI) / VK DC1_64_TRIANGLES_64_BYTES format as given by the API's specification.
+        struct DisplacementMicromapLayoutDesc
+        {
+            // Per subdivision level N in [0, 3], the micro-vertex stored as value i of a level N block. Each table holds
+            // (2^N + 1) * (2^N + 2) / 2 entries covering every micro-vertex of the level once.
+            const DisplacementMicroVertex*  microVertexOrder[4]     = {};
+            // Written to DisplacementMicromapDesc::format and the usage histograms.
+            uint16_t                        format                  = 0;
+        };
+
+        // Displacement micromap input. The height texture is sampled at the micro-vertices of each primitive, the
+        // runtime displaces a micro-vertex by bias + scale * value along the interpolated direction, value in [0, 1].
+        struct BakeDisplacementInputDesc
+        {
+            // EnableInternalThreads, Force32BitIndices and DisableDuplicateDetection apply as for opacity micromaps,
+            // see EnableDisplacementLevelDemotion for the displacement specific flag. Other flags are ignored.
+            BakeFlags               bakeFlags                   = BakeFlags::None;
+            // Single channel heights, only mip 0 is sampled.
+            Texture                 heightTexture               = kInvalidHandle;
+            // Sampler used to fetch the heights, borderAlpha is the height outside of the texture in Border mode.
+            SamplerDesc             heightSamplerDesc;
+            TexCoordFormat          texCoordFormat              = TexCoordFormat::MAX_NUM;
+            const void*             texCoords                   = nullptr;
+            // texCoordStrideInBytes: If zero, packed aligment is assumed
+            uint32_t                texCoordStrideInBytes       = 0;
+            // indexBuffer, indexCount, indexOffset and baseVertex as in BakeInputDesc.
+            IndexFormat             indexFormat                 = IndexFormat::MAX_NUM;
+            const void*             indexBuffer                 = nullptr;
+            uint32_t                indexCount                  = 0;
+            uint32_t                indexOffset                 = 0;
+            int32_t                 baseVertex                  = 0;
+
+            // [optional] Transform applied to all texCoords.
+            const TexCoordTransform* texCoordTransform          = nullptr;
+
+            // Heights are stored as saturate((height - heightBias) / heightScale), quantized to the format's precision.
+            // Should match the bias and scale used at runtime. heightScale must be non-zero.
+            float                   heightBias                  = 0.f;
+            float                   heightScale                 = 1.f;
+
+            // Block encoding of the DMMs.
+            DMMFormat               dmmFormat                   = DMMFormat::DC1_64_Triangles_64_Bytes_SdkOrder;
+
+            // [optional] Micro-vertex order and format value of the output blocks, the SDK's order and dmmFormat when null.
+            const DisplacementMicromapLayoutDesc* outputLayout  = nullptr;
+
+            // Micro triangle count is 4^N, where N is the subdivision level. Must be in range [0, 3].
+            uint8_t                 subdivisionLevel            = 3;
+
+            // [optional] Per triangle subdivision level, values outside of [0, 3] use subdivisionLevel.
+            // Primitives sharing an edge (the same two vertex indices) end up at most one level apart, the most the runtime
+            // can decimate an edge for. Levels are lowered where needed, e.g. a level 3 primitive next to a level 0 one is
+            // baked at level 1. Primitives connected only through duplicated vertices, e.g. at UV seams, aren't adjusted.
+            const uint8_t*          subdivisionLevels           = nullptr;
         };
 
+        struct DisplacementMicromapDesc
+        {
+            // Byte offset into the displacement micromap array
+            uint32_t offset             = 0;
+            // Micro triangle count is 4^N, where N is the subdivision level.
+            uint16_t subdivisionLevel   = 0;
+            // DMM input format.
+            uint16_t format             = 0;
+        };
+
+        struct DisplacementMicromapUsageCount
+        {
+            // Number of DMMs with the specified subdivision level and format.
+            uint32_t count              = 0;
+            // Micro triangle count is 4^N, where N is the subdivision level.
+            uint16_t subdivisionLevel   = 0;
+            // DMM input format.
+            uint16_t format             = 0;
+        };
+
+        // Per primitive edge decimation flags. Edge i is (v_i, v_(i + 1) % 3) of the primitive, its flag is set when a primitive
+        // sharing the edge has a subdivision level one lower, the runtime then uses every other micro-vertex along the edge
+        // so that both sides line up. Map the bits to the API's per-primitive flags when building the BLAS.
+        enum class DisplacementEdgeFlags : uint8_t
+        {
+            None                = 0,
+            DecimateEdge01      = 1u << 0,
+            DecimateEdge12      = 1u << 1,
+            DecimateEdge20      = 1u << 2,
+        };
+        OMM_DEFINE_ENUM_FLAG_OPERATORS(DisplacementEdgeFlags);
+
+        // DC1_64_Triangles_64_Bytes_SdkOrder blocks hold one 11-bit unorm value per micro-vertex, value i at bits
+        // [11 * i, 11 * i + 11) of the block (little endian), unused bits are zero. A level N DMM holds
+        // (2^N + 1) * (2^N + 2) / 2 values in hierarchical order: the primitive's vertices 0, 1, 2, then for each level
+        // 1..N the vertices added by splitting the micro-triangles of the previous level, visited in bird curve order,
+        // each adding the midpoints of its edges (v0 v1), (v1 v2), (v2 v0) not visited before. See bird::GetMicroVertexOrder.
+        // This is not the DX (NVAPI) / VK micro-vertex order, bake with BakeDisplacementInputDesc::outputLayout to get blocks
+        // that can be used as DMM array build input directly. With an outputLayout value i is its microVertexOrder[N][i].
+        struct BakeDisplacementResultDesc
+        {
+            // Below is used as DMM array build input.
+            const void*                             dmmArrayData                    = nullptr;
+            uint32_t                                dmmArrayDataSize                = 0;
+            const DisplacementMicromapDesc*         dmmDescArray                    = nullptr;
+            uint32_t                                dmmDescArrayCount               = 0;
+            // The histogram of all dmm data referenced by 'dmmDescArray'.
+            const DisplacementMicromapUsageCount*   dmmDescArrayHistogram           = nullptr;
+            uint32_t                                dmmDescArrayHistogramCount      = 0;
+
+            // Below is used for BLAS build input, one DMM index per primitive.
+            const void*                             dmmIndexBuffer                  = nullptr;
+            uint32_t                                dmmIndexCount                   = 0;
+            IndexFormat                             dmmIndexFormat                  = IndexFormat::MAX_NUM;
+            // Same as dmmDescArrayHistogram but usage count equals the number of references by dmmIndexBuffer.
+            const DisplacementMicromapUsageCount*   dmmIndexHistogram               = nullptr;
+            uint32_t                                dmmIndexHistogramCount          = 0;
+            // One per primitive, same count as dmmIndexCount.
+            const DisplacementEdgeFlags*            dmmEdgeFlags                    = nullptr;
+            uint32_t                                dmmEdgeFlagsCount               = 0;
+        };
+
+        using DisplacementBakeResult = Handle;
+
+        // All functions below may be called concurrently on the same baker, e.g. one bake per mesh from a job system.
+        // Textures are read-only once created and can be shared by concurrent bakes, but must outlive the bakes using
+        // them. The memoryAllocatorInterface callbacks of the baker must be thread-safe in that case.
         OMM_API Result OMM_CALL CreateTexture(Baker baker, const TextureDesc& desc, Texture* outTexture);
         OMM_API Result OMM_CALL DestroyTexture(Baker baker, Texture texture);
+        // Size in bytes of the texture's internal representation, including any padding of the memory layout.
+        OMM_API Result OMM_CALL GetTextureMemoryFootprint(Baker baker, Texture texture, size_t& byteSize);
+        // Key of the texture cache (see BakerCreationDesc::textureCacheSizeInBytes) for desc, computed from the texels
+        // without creating a texture. Lets a process check a remote cache before sending the texels.
+        OMM_API Result OMM_CALL GetTextureContentKey(const TextureDesc& desc, TextureContentKey* outContentKey);
+        // New reference to the cached texture with the given key, same as CreateTexture with the texels that produced
+        // it. outTexture is kInvalidHandle when no such texture is cached.
+        OMM_API Result OMM_CALL AcquireCachedTexture(Baker baker, const TextureContentKey& contentKey, Texture* outTexture);
         OMM_API Result OMM_CALL BakeOpacityMicromap(Baker baker, const BakeInputDesc& bakeInputDesc, BakeResult* outBakeResult);
         OMM_API Result OMM_CALL DestroyBakeResult(BakeResult bakeResult);
         OMM_API Result OMM_CALL GetBakeResultDesc(BakeResult bakeResult, const BakeResultDesc*& desc);
+        // Estimates the cost of BakeOpacityMicromap with the same input without resampling, e.g. to schedule bake jobs.
+        // Runs the primitive setup of the bake, the cost is linear in the primitive count.
+        OMM_API Result OMM_CALL GetPreBakeEstimate(Baker baker, const BakeInputDesc& bakeInputDesc, PreBakeEstimate* outPreBakeEstimate);
+
+        // Bakes displacement micromaps. Primitives with identical texture coordinates and subdivision level, and
+        // primitives ending up with identical displacement blocks share a DMM.
+        OMM_API Result OMM_CALL BakeDisplacementMicromap(Baker baker, const BakeDisplacementInputDesc& bakeInputDesc, DisplacementBakeResult* outBakeResult);
+        OMM_API Result OMM_CALL DestroyDisplacementBakeResult(DisplacementBakeResult bakeResult);
+        OMM_API Result OMM_CALL GetDisplacementBakeResultDesc(DisplacementBakeResult bakeResult, const BakeDisplacementResultDesc*& desc);
     }
 
     namespace Gpu 
@@ -903,6 +1275,54 @@ namespace omm
         OMM_API Result OMM_CALL Bake(Pipeline pipeline, const BakeDispatchConfigDesc& config, const BakeDispatchChain*& outDispatchDesc);
     }
 
+    namespace Cpu
+    {
+        using DispatchBakeResult = Handle;
+
+        // CPU side contents of the Gpu::ResourceType::IN_* resources of a Gpu::BakeDispatchConfigDesc.
+        struct BakeDispatchInputDesc
+        {
+            // IN_ALPHA_TEXTURE, alphaTextureWidth x alphaTextureHeight texels of alphaTextureChannelCount channels.
+            TextureFormat           alphaTextureFormat          = TextureFormat::FP32;
+            uint32_t                alphaTextureChannelCount    = 4;
+            // If zero, packed aligment is assumed
+            uint32_t                alphaTextureRowPitch        = 0;
+            const void*             alphaTexture                = nullptr;
+            // IN_TEXCOORD_BUFFER, read from texCoordOffsetInBytes
+            const void*             texCoordBuffer              = nullptr;
+            // IN_INDEX_BUFFER
+            const void*             indexBuffer                 = nullptr;
+            // Added to the flags derived from the dispatch config, e.g. BakeFlags::EnableInternalThreads.
+            BakeFlags               bakeFlags                   = BakeFlags::None;
+        };
+
+        // Contents of the Gpu::ResourceType::OUT_* resources, in the layout the GPU baker writes them.
+        struct BakeDispatchResultDesc
+        {
+            // Only the used part, as reported by postBakeInfo.
+            const void*             ommArrayData                = nullptr;
+            uint32_t                ommArrayDataSizeInBytes     = 0;
+            const void*             ommDescArray                = nullptr;
+            uint32_t                ommDescArraySizeInBytes     = 0;
+            // Sized as returned by Gpu::GetPreBakeInfo, one slot per subdivision level and format up to maxSubdivisionLevel.
+            const void*             ommDescArrayHistogram       = nullptr;
+            uint32_t                ommDescArrayHistogramSizeInBytes = 0;
+            const void*             ommIndexBuffer              = nullptr;
+            uint32_t                ommIndexBufferSizeInBytes   = 0;
+            IndexFormat             ommIndexFormat              = IndexFormat::MAX_NUM;
+            uint32_t                ommIndexCount               = 0;
+            const void*             ommIndexHistogram           = nullptr;
+            uint32_t                ommIndexHistogramSizeInBytes = 0;
+            Gpu::PostBakeInfo       postBakeInfo                = {};
+        };
+
+        // Runs a Gpu::BakeDispatchConfigDesc on the CPU baker, e.g. for platforms or tools without a GPU, and returns
+        // the GPU output buffers. States follow the CPU baker, the OMM order within the array may differ from a GPU bake.
+        OMM_API Result OMM_CALL BakeOpacityMicromapDispatch(Baker baker, const Gpu::BakeDispatchConfigDesc& config, const BakeDispatchInputDesc& inputDesc, DispatchBakeResult* outBakeResult);
+        OMM_API Result OMM_CALL DestroyDispatchBakeResult(DispatchBakeResult bakeResult);
+        OMM_API Result OMM_CALL GetDispatchBakeResultDesc(DispatchBakeResult bakeResult, const BakeDispatchResultDesc*& desc);
+    }
+
     namespace Debug
     {
         struct SaveImagesDesc
@@ -923,6 +1343,28 @@ namespace omm
         // Walk each primitive and dumps the corresponding OMM overlay to the alpha textures.
         OMM_API Result OMM_CALL SaveAsImages(Baker baker, const Cpu::BakeInputDesc& bakeInputDesc, const Cpu::BakeResultDesc* res, const SaveImagesDesc& desc);
 
+        // In-memory version of SaveAsImages, restricted to a region of interest. The image is rendered in tiles in parallel,
+        // each tile only visits the primitives overlapping it. Only mip 0 and the first frame are drawn.
+        struct RenderImageDesc
+        {
+            // UV region of interest, the image spans [uvMin, uvMax] with row 0 at uvMin.y.
+            float               uvMin[2]                    = { 0.f, 0.f };
+            float               uvMax[2]                    = { 1.f, 1.f };
+            // [optional] If set, the region of interest is the UV bounding box of this primitive scaled by
+            // neighbourhoodScale around its center, uvMin and uvMax are ignored. 0xFFFFFFFF => disabled
+            uint32_t            primitiveIndex              = 0xFFFFFFFF;
+            float               neighbourhoodScale          = 2.f;
+            uint32_t            width                       = 0;
+            uint32_t            height                      = 0;
+            // RGBA8 output, height rows of width pixels.
+            uint8_t*            outRGBA                     = nullptr;
+            uint32_t            rowPitch                    = 0; // If 0 => assumed to be equal to width * 4
+            // Will draw unknown transparent and unknown opaque in the same color.
+            bool                monochromeUnknowns          = false;
+        };
+
+        OMM_API Result OMM_CALL RenderImage(Baker baker, const Cpu::BakeInputDesc& bakeInputDesc, const Cpu::BakeResultDesc* res, const RenderImageDesc& desc);
+
         struct Stats 
         {
             uint64_t totalOpaque = 0;
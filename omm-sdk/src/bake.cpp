@@ -10,6 +10,7 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include "omm.h"
 #include "bake_cpu_impl.h"
+#include "bake_cpu_dispatch_impl.h"
 #include "bake_gpu_impl.h"
 #include "debug_impl.h"
 #include "texture_impl.h"
@@ -61,19 +62,7 @@ namespace Cpu
             return Result::INVALID_ARGUMENT;
 
         Cpu::BakerImpl* impl = GetBakerImpl<Cpu::BakerImpl>(baker);
-        StdAllocator<uint8_t>& memoryAllocator = (*impl).GetStdAllocator();
-
-        TextureImpl* implementation = Allocate<TextureImpl>(memoryAllocator, memoryAllocator);
-        const Result result = implementation->Create(desc);
-
-        if (result == Result::SUCCESS)
-        {
-            *outTexture = (Texture)implementation;
-            return Result::SUCCESS;
-        }
-
-        Deallocate(memoryAllocator, implementation);
-        return result;
+        return (*impl).CreateTexture(desc, outTexture);
     }
 
     OMM_API Result OMM_CALL DestroyTexture(Baker baker, Texture texture)
@@ -84,13 +73,41 @@ namespace Cpu
             return Result::INVALID_ARGUMENT;
 
         Cpu::BakerImpl* impl = GetBakerImpl<Cpu::BakerImpl>(baker);
-        StdAllocator<uint8_t>& memoryAllocator = (*impl).GetStdAllocator();
+        return (*impl).DestroyTexture(texture);
+    }
 
-        Deallocate(memoryAllocator, (TextureImpl*)texture);
+    OMM_API Result OMM_CALL GetTextureMemoryFootprint(Baker baker, Texture texture, size_t& byteSize)
+    {
+        if (texture == 0)
+            return Result::INVALID_ARGUMENT;
+        if (GetBakerType(baker) != BakerType::CPU)
+            return Result::INVALID_ARGUMENT;
 
+        byteSize = ((const TextureImpl*)texture)->GetMemoryFootprint();
         return Result::SUCCESS;
     }
 
+    OMM_API Result OMM_CALL GetTextureContentKey(const TextureDesc& desc, TextureContentKey* outContentKey)
+    {
+        if (outContentKey == nullptr)
+            return Result::INVALID_ARGUMENT;
+
+        RETURN_STATUS_IF_FAILED(TextureImpl::Validate(desc));
+        *outContentKey = TextureImpl::GetContentKey(desc);
+        return Result::SUCCESS;
+    }
+
+    OMM_API Result OMM_CALL AcquireCachedTexture(Baker baker, const TextureContentKey& contentKey, Texture* outTexture)
+    {
+        if (baker == 0)
+            return Result::INVALID_ARGUMENT;
+        if (GetBakerType(baker) != BakerType::CPU)
+            return Result::INVALID_ARGUMENT;
+
+        Cpu::BakerImpl* impl = GetBakerImpl<Cpu::BakerImpl>(baker);
+        return (*impl).AcquireCachedTexture(contentKey, outTexture);
+    }
+
     OMM_API Result OMM_CALL BakeOpacityMicromap(Baker baker, const BakeInputDesc& bakeInputDesc, BakeResult* bakeResult)
     {
         if (baker == 0)
@@ -120,6 +137,81 @@ namespace Cpu
 
         return (*(BakeOutputImpl*)bakeResult).GetBakeResultDesc(desc);
     }
+
+    OMM_API Result OMM_CALL GetPreBakeEstimate(Baker baker, const BakeInputDesc& bakeInputDesc, PreBakeEstimate* outPreBakeEstimate)
+    {
+        if (baker == 0)
+            return Result::INVALID_ARGUMENT;
+        if (GetBakerType(baker) != BakerType::CPU)
+            return Result::INVALID_ARGUMENT;
+        if (outPreBakeEstimate == nullptr)
+            return Result::INVALID_ARGUMENT;
+
+        Cpu::BakerImpl* impl = GetBakerImpl<Cpu::BakerImpl>(baker);
+        return (*impl).GetPreBakeEstimate(bakeInputDesc, outPreBakeEstimate);
+    }
+
+    OMM_API Result OMM_CALL BakeOpacityMicromapDispatch(Baker baker, const Gpu::BakeDispatchConfigDesc& config, const BakeDispatchInputDesc& inputDesc, DispatchBakeResult* bakeResult)
+    {
+        if (baker == 0)
+            return Result::INVALID_ARGUMENT;
+        if (GetBakerType(baker) != BakerType::CPU)
+            return Result::INVALID_ARGUMENT;
+        if (bakeResult == nullptr)
+            return Result::INVALID_ARGUMENT;
+
+        Cpu::BakerImpl* impl = GetBakerImpl<Cpu::BakerImpl>(baker);
+        return (*impl).BakeOpacityMicromapDispatch(config, inputDesc, bakeResult);
+    }
+
+    OMM_API Result OMM_CALL DestroyDispatchBakeResult(DispatchBakeResult bakeResult)
+    {
+        if (bakeResult == 0)
+            return Result::INVALID_ARGUMENT;
+
+        StdAllocator<uint8_t>& memoryAllocator = (*(DispatchBakeOutputImpl*)bakeResult).GetStdAllocator();
+        Deallocate(memoryAllocator, (DispatchBakeOutputImpl*)bakeResult);
+
+        return Result::SUCCESS;
+    }
+
+    OMM_API Result OMM_CALL GetDispatchBakeResultDesc(DispatchBakeResult bakeResult, const Cpu::BakeDispatchResultDesc*& desc)
+    {
+        if (bakeResult == 0)
+            return Result::INVALID_ARGUMENT;
+
+        return (*(DispatchBakeOutputImpl*)bakeResult).GetBakeResultDesc(desc);
+    }
+
+    OMM_API Result OMM_CALL BakeDisplacementMicromap(Baker baker, const BakeDisplacementInputDesc& bakeInputDesc, DisplacementBakeResult* bakeResult)
+    {
+        if (baker == 0)
+            return Result::INVALID_ARGUMENT;
+        if (GetBakerType(baker) != BakerType::CPU)
+            return Result::INVALID_ARGUMENT;
+
+        Cpu::BakerImpl* impl = GetBakerImpl<Cpu::BakerImpl>(baker);
+        return (*impl).BakeDisplacementMicromap(bakeInputDesc, bakeResult);
+    }
+
+    OMM_API Result OMM_CALL DestroyDisplacementBakeResult(DisplacementBakeResult bakeResult)
+    {
+        if (bakeResult == 0)
+            return Result::INVALID_ARGUMENT;
+
+        StdAllocator<uint8_t>& memoryAllocator = (*(DisplacementBakeOutputImpl*)bakeResult).GetStdAllocator();
+        Deallocate(memoryAllocator, (DisplacementBakeOutputImpl*)bakeResult);
+
+        return Result::SUCCESS;
+    }
+
+    OMM_API Result OMM_CALL GetDisplacementBakeResultDesc(DisplacementBakeResult bakeResult, const Cpu::BakeDisplacementResultDesc*& desc)
+    {
+        if (bakeResult == 0)
+            return Result::INVALID_ARGUMENT;
+
+        return (*(DisplacementBakeOutputImpl*)bakeResult).GetBakeResultDesc(desc);
+    }
 } // namespace Cpu
 
 namespace Gpu
@@ -206,6 +298,27 @@ namespace Debug
             return Result::INVALID_ARGUMENT;
     }
 
+    OMM_API Result OMM_CALL RenderImage(Baker baker, const Cpu::BakeInputDesc& bakeInputDesc, const Cpu::BakeResultDesc* res, const Debug::RenderImageDesc& desc)
+    {
+        if (baker == 0)
+            return Result::INVALID_ARGUMENT;
+
+        if (GetBakerType(baker) == BakerType::CPU)
+        {
+            Cpu::BakerImpl* impl = GetBakerImpl<Cpu::BakerImpl>(baker);
+            StdAllocator<uint8_t>& memoryAllocator = (*impl).GetStdAllocator();
+            return RenderImageImpl(memoryAllocator, bakeInputDesc, res, desc);
+        }
+        else if (GetBakerType(baker) == BakerType::GPU)
+        {
+            Gpu::BakerImpl* impl = GetBakerImpl<Gpu::BakerImpl>(baker);
+            StdAllocator<uint8_t>& memoryAllocator = (*impl).GetStdAllocator();
+            return RenderImageImpl(memoryAllocator, bakeInputDesc, res, desc);
+        }
+        else
+            return Result::INVALID_ARGUMENT;
+    }
+
     OMM_API Result OMM_CALL GetStats(Baker baker, const Cpu::BakeResultDesc* res, Stats* out)
     {
         if (baker == 0)
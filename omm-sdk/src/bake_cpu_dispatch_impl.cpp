@@ -0,0 +1,218 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "bake_cpu_dispatch_impl.h"
+#include "bake_cpu_impl.h"
+#include "bake_gpu_impl.h"
+#include "texture_impl.h"
+
+#include <cstring>
+
+namespace omm
+{
+namespace Cpu
+{
+    static uint32_t GetIndexFormatSize(IndexFormat format)
+    {
+        return format == IndexFormat::I16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    static bool IsSet(Gpu::BakeFlags flags, Gpu::BakeFlags flag)
+    {
+        return ((uint32_t)flags & (uint32_t)flag) == (uint32_t)flag;
+    }
+
+    DispatchBakeOutputImpl::DispatchBakeOutputImpl(const StdAllocator<uint8_t>& stdAllocator) :
+        m_stdAllocator(stdAllocator),
+        m_resultDesc({}),
+        m_ommArrayData(stdAllocator),
+        m_ommDescArray(stdAllocator),
+        m_ommDescArrayHistogram(stdAllocator),
+        m_ommIndexBuffer(stdAllocator),
+        m_ommIndexHistogram(stdAllocator)
+    {
+    }
+
+    Result DispatchBakeOutputImpl::ValidateDesc(const Gpu::BakeDispatchConfigDesc& config, const BakeDispatchInputDesc& inputDesc)
+    {
+        RETURN_STATUS_IF_FAILED(Gpu::PipelineImpl::Validate(config));
+
+        if (inputDesc.alphaTexture == nullptr || inputDesc.texCoordBuffer == nullptr || inputDesc.indexBuffer == nullptr)
+            return Result::INVALID_ARGUMENT;
+        if (inputDesc.alphaTextureFormat != TextureFormat::FP32)
+            return Result::INVALID_ARGUMENT;
+        if (inputDesc.alphaTextureChannelCount == 0 || inputDesc.alphaTextureChannelCount > 4)
+            return Result::INVALID_ARGUMENT;
+        if (config.alphaTextureChannel >= inputDesc.alphaTextureChannelCount)
+            return Result::INVALID_ARGUMENT;
+        if (config.alphaTextureWidth == 0 || config.alphaTextureHeight == 0)
+            return Result::INVALID_ARGUMENT;
+        if (inputDesc.alphaTextureRowPitch != 0 && inputDesc.alphaTextureRowPitch < config.alphaTextureWidth * inputDesc.alphaTextureChannelCount * sizeof(float))
+            return Result::INVALID_ARGUMENT;
+        if (config.indexFormat != IndexFormat::I16_UINT && config.indexFormat != IndexFormat::I32_UINT)
+            return Result::INVALID_ARGUMENT;
+        if (config.indexStrideInBytes != 0 && config.indexStrideInBytes < GetIndexFormatSize(config.indexFormat))
+            return Result::INVALID_ARGUMENT;
+        return Result::SUCCESS;
+    }
+
+    Result DispatchBakeOutputImpl::Bake(const Gpu::BakeDispatchConfigDesc& config, const BakeDispatchInputDesc& inputDesc, LargeBufferFlags largeBufferFlags)
+    {
+        RETURN_STATUS_IF_FAILED(ValidateDesc(config, inputDesc));
+
+        // IN_ALPHA_TEXTURE holds alpha in one of up to four channels, the CPU texture takes alpha only.
+        vector<float> alpha(size_t(config.alphaTextureWidth) * config.alphaTextureHeight, m_stdAllocator);
+        {
+            const uint32_t texelSize = inputDesc.alphaTextureChannelCount * sizeof(float);
+            const uint32_t rowPitch = inputDesc.alphaTextureRowPitch == 0 ? config.alphaTextureWidth * texelSize : inputDesc.alphaTextureRowPitch;
+            for (uint32_t j = 0; j < config.alphaTextureHeight; ++j)
+            {
+                const uint8_t* row = (const uint8_t*)inputDesc.alphaTexture + size_t(j) * rowPitch;
+                for (uint32_t i = 0; i < config.alphaTextureWidth; ++i)
+                    memcpy(&alpha[size_t(j) * config.alphaTextureWidth + i], row + size_t(i) * texelSize + config.alphaTextureChannel * sizeof(float), sizeof(float));
+            }
+        }
+
+        TextureMipDesc mip;
+        mip.width = config.alphaTextureWidth;
+        mip.height = config.alphaTextureHeight;
+        mip.textureData = alpha.data();
+
+        TextureDesc textureDesc;
+        textureDesc.format = TextureFormat::FP32;
+        textureDesc.mips = &mip;
+        textureDesc.mipCount = 1;
+
+        TextureImpl texture(m_stdAllocator);
+        RETURN_STATUS_IF_FAILED(texture.Create(textureDesc, largeBufferFlags));
+
+        // The CPU baker reads packed indices only.
+        const uint32_t indexSize = GetIndexFormatSize(config.indexFormat);
+        vector<uint32_t> indices(m_stdAllocator);
+        if (config.indexStrideInBytes != 0 && config.indexStrideInBytes != indexSize)
+        {
+            indices.resize(config.indexCount);
+            for (uint32_t i = 0; i < config.indexCount; ++i)
+            {
+                const uint8_t* src = (const uint8_t*)inputDesc.indexBuffer + size_t(i) * config.indexStrideInBytes;
+                if (config.indexFormat == IndexFormat::I16_UINT)
+                {
+                    uint16_t index16;
+                    memcpy(&index16, src, sizeof(uint16_t));
+                    indices[i] = index16;
+                }
+                else
+                    memcpy(&indices[i], src, sizeof(uint32_t));
+            }
+        }
+
+        const bool enableDynamicSubdivisionLevel = config.dynamicSubdivisionScale > 0.f;
+
+        uint32_t bakeFlags = (uint32_t)inputDesc.bakeFlags | (uint32_t)BakeFlags::Force32BitIndices;
+        if (IsSet(config.bakeFlags, Gpu::BakeFlags::DisableSpecialIndices))
+            bakeFlags |= (uint32_t)BakeFlags::DisableSpecialIndices;
+        if (IsSet(config.bakeFlags, Gpu::BakeFlags::DisableTexCoordDeduplication))
+            bakeFlags |= (uint32_t)BakeFlags::DisableDuplicateDetection;
+
+        BakeInputDesc desc;
+        desc.bakeFlags = (BakeFlags)bakeFlags;
+        desc.texture = (Texture)&texture;
+        desc.runtimeSamplerDesc = config.runtimeSamplerDesc;
+        desc.alphaMode = config.alphaMode;
+        desc.alphaCutoff = config.alphaCutoff;
+        desc.texCoordFormat = config.texCoordFormat;
+        desc.texCoords = (const uint8_t*)inputDesc.texCoordBuffer + config.texCoordOffsetInBytes;
+        desc.texCoordStrideInBytes = config.texCoordStrideInBytes;
+        desc.indexFormat = indices.empty() ? config.indexFormat : IndexFormat::I32_UINT;
+        desc.indexBuffer = indices.empty() ? inputDesc.indexBuffer : indices.data();
+        desc.indexCount = config.indexCount;
+        desc.ommFormat = config.globalOMMFormat;
+        // Mixed states resolve to the majority, as GetOpacityState does on the GPU.
+        desc.unknownStatePromotion = UnknownStatePromotion::Nearest;
+        desc.dynamicSubdivisionScale = enableDynamicSubdivisionLevel ? config.dynamicSubdivisionScale : 0.f;
+        desc.maxSubdivisionLevel = enableDynamicSubdivisionLevel ? config.maxSubdivisionLevel : config.globalSubdivisionLevel;
+
+        BakeOutputImpl output(m_stdAllocator);
+        RETURN_STATUS_IF_FAILED(output.Bake(desc, largeBufferFlags));
+
+        return ConvertResult(config, output.GetBakeOutputDesc());
+    }
+
+    Result DispatchBakeOutputImpl::ConvertResult(const Gpu::BakeDispatchConfigDesc& config, const BakeResultDesc& result)
+    {
+        Gpu::PreBakeInfo info;
+        RETURN_STATUS_IF_FAILED(Gpu::PipelineImpl::GetOutputBufferInfo(config, &info));
+
+        if (result.ommArrayDataSize > info.outOmmArraySizeInBytes || result.ommDescArrayCount * sizeof(OpacityMicromapDesc) > info.outOmmDescSizeInBytes)
+            return Result::FAILURE;
+
+        const uint8_t* ommArrayData = (const uint8_t*)result.ommArrayData;
+        m_ommArrayData.assign(ommArrayData, ommArrayData + result.ommArrayDataSize);
+        m_ommDescArray.assign(result.ommDescArray, result.ommDescArray + result.ommDescArrayCount);
+
+        // One slot per subdivision level and format, [OC1_2_State, OC1_4_State] x (maxSubdivisionLevel + 1).
+        const uint32_t kOMMFormatNum = 2;
+        const uint32_t histogramSlotCount = info.outOmmArrayHistogramSizeInBytes / sizeof(OpacityMicromapUsageCount);
+        auto ScatterHistogram = [&](const OpacityMicromapUsageCount* histogram, uint32_t count, vector<OpacityMicromapUsageCount>& outHistogram) -> Result
+        {
+            outHistogram.resize(histogramSlotCount);
+            for (uint32_t slotIt = 0; slotIt < histogramSlotCount; ++slotIt)
+            {
+                outHistogram[slotIt].count = 0;
+                outHistogram[slotIt].subdivisionLevel = uint16_t(slotIt / kOMMFormatNum);
+                outHistogram[slotIt].format = uint16_t(slotIt % kOMMFormatNum + 1);
+            }
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const uint32_t slot = kOMMFormatNum * histogram[i].subdivisionLevel + histogram[i].format - 1;
+                if (slot >= histogramSlotCount)
+                    return Result::FAILURE;
+                outHistogram[slot].count += histogram[i].count;
+            }
+            return Result::SUCCESS;
+        };
+        RETURN_STATUS_IF_FAILED(ScatterHistogram(result.ommDescArrayHistogram, result.ommDescArrayHistogramCount, m_ommDescArrayHistogram));
+        RETURN_STATUS_IF_FAILED(ScatterHistogram(result.ommIndexHistogram, result.ommIndexHistogramCount, m_ommIndexHistogram));
+
+        // Baked with Force32BitIndices, narrowed to the format GetPreBakeInfo picks.
+        OMM_ASSERT(result.ommIndexFormat == IndexFormat::I32_UINT);
+        OMM_ASSERT(result.ommIndexCount == info.outOmmIndexCount);
+        const int32_t* ommIndexBuffer = (const int32_t*)result.ommIndexBuffer;
+        m_ommIndexBuffer.resize(info.outOmmIndexBufferSizeInBytes, 0);
+        for (uint32_t i = 0; i < result.ommIndexCount; ++i)
+        {
+            if (info.outOmmIndexBufferFormat == IndexFormat::I16_UINT)
+            {
+                const int16_t index16 = (int16_t)ommIndexBuffer[i];
+                memcpy(m_ommIndexBuffer.data() + i * sizeof(int16_t), &index16, sizeof(int16_t));
+            }
+            else
+                memcpy(m_ommIndexBuffer.data() + i * sizeof(int32_t), &ommIndexBuffer[i], sizeof(int32_t));
+        }
+
+        m_resultDesc.ommArrayData                       = m_ommArrayData.data();
+        m_resultDesc.ommArrayDataSizeInBytes            = (uint32_t)m_ommArrayData.size();
+        m_resultDesc.ommDescArray                       = m_ommDescArray.data();
+        m_resultDesc.ommDescArraySizeInBytes            = (uint32_t)(m_ommDescArray.size() * sizeof(OpacityMicromapDesc));
+        m_resultDesc.ommDescArrayHistogram              = m_ommDescArrayHistogram.data();
+        m_resultDesc.ommDescArrayHistogramSizeInBytes   = (uint32_t)(m_ommDescArrayHistogram.size() * sizeof(OpacityMicromapUsageCount));
+        m_resultDesc.ommIndexBuffer                     = m_ommIndexBuffer.data();
+        m_resultDesc.ommIndexBufferSizeInBytes          = (uint32_t)m_ommIndexBuffer.size();
+        m_resultDesc.ommIndexFormat                     = info.outOmmIndexBufferFormat;
+        m_resultDesc.ommIndexCount                      = result.ommIndexCount;
+        m_resultDesc.ommIndexHistogram                  = m_ommIndexHistogram.data();
+        m_resultDesc.ommIndexHistogramSizeInBytes       = (uint32_t)(m_ommIndexHistogram.size() * sizeof(OpacityMicromapUsageCount));
+        m_resultDesc.postBakeInfo.outOmmArraySizeInBytes = m_resultDesc.ommArrayDataSizeInBytes;
+        m_resultDesc.postBakeInfo.outOmmDescSizeInBytes = m_resultDesc.ommDescArraySizeInBytes;
+        return Result::SUCCESS;
+    }
+} // namespace Cpu
+} // namespace omm
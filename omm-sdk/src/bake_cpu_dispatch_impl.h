@@ -0,0 +1,54 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "omm.h"
+#include "defines.h"
+#include "std_containers.h"
+#include "std_allocator.h"
+
+namespace omm
+{
+namespace Cpu
+{
+    // Bakes a Gpu::BakeDispatchConfigDesc with the CPU baker and converts the result to the GPU output buffers.
+    class DispatchBakeOutputImpl
+    {
+    public:
+        DispatchBakeOutputImpl(const StdAllocator<uint8_t>& stdAllocator);
+
+        inline StdAllocator<uint8_t>& GetStdAllocator()
+        {
+            return m_stdAllocator;
+        }
+
+        inline Result GetBakeResultDesc(const Cpu::BakeDispatchResultDesc*& desc)
+        {
+            desc = &m_resultDesc;
+            return Result::SUCCESS;
+        }
+
+        Result Bake(const Gpu::BakeDispatchConfigDesc& config, const Cpu::BakeDispatchInputDesc& inputDesc, LargeBufferFlags largeBufferFlags);
+
+    private:
+        static Result ValidateDesc(const Gpu::BakeDispatchConfigDesc& config, const Cpu::BakeDispatchInputDesc& inputDesc);
+        Result ConvertResult(const Gpu::BakeDispatchConfigDesc& config, const Cpu::BakeResultDesc& result);
+    private:
+        StdAllocator<uint8_t> m_stdAllocator;
+        Cpu::BakeDispatchResultDesc m_resultDesc;
+        vector<uint8_t> m_ommArrayData;
+        vector<OpacityMicromapDesc> m_ommDescArray;
+        vector<OpacityMicromapUsageCount> m_ommDescArrayHistogram;
+        vector<uint8_t> m_ommIndexBuffer;
+        vector<OpacityMicromapUsageCount> m_ommIndexHistogram;
+    };
+} // namespace Cpu
+} // namespace omm
@@ -10,13 +10,18 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include "defines.h"
 #include "bake_cpu_impl.h"
+#include "bake_cpu_dispatch_impl.h"
 #include "bake_kernels_cpu.h"
 #include "texture_impl.h"
+#include "polygon_mask_impl.h"
+#include "large_buffer.h"
 
 #include <shared/math.h>
 #include <shared/bird.h>
 #include <shared/cpu_raster.h>
+#include <shared/radix_sort.h>
 
+#define XXH_STATIC_LINKING_ONLY
 #include <xxhash.h>
 
 #include <random>
@@ -25,6 +30,9 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include <atomic>
 #include <cmath>
 #include <cstring>
+#include <limits>
+#include <numeric>
+#include <thread>
 
 namespace omm
 {
@@ -39,12 +47,16 @@ namespace Cpu
         DisableDuplicateDetection       = 1u << 3,
         EnableNearDuplicateDetection    = 1u << 4,
         EnableWorkloadValidation        = 1u << 5,
+        EnablePrimitiveCoverage         = 1u << 12,
+        EnableDisplacementLevelDemotion = 1u << 13,
 
         // Internal / not publicly exposed options.
         EnableAABBTesting               = 1u << 6,
         DisableRemovePoorQualityOMM     = 1u << 7,
         DisableLevelLineIntersection    = 1u << 8,
         EnableNearDuplicateDetectionBruteForce = 1u << 9,
+        DisableFusedResampleDigest      = 1u << 10,
+        EnableNearDuplicateDetectionMultiIndex = 1u << 11,
     };
 
     constexpr void ValidateInternalBakeFlags()
@@ -55,18 +67,220 @@ namespace Cpu
         static_assert((uint32_t)BakeFlagsInternal::DisableDuplicateDetection == (uint32_t)BakeFlags::DisableDuplicateDetection);
         static_assert((uint32_t)BakeFlagsInternal::EnableNearDuplicateDetection == (uint32_t)BakeFlags::EnableNearDuplicateDetection);
         static_assert((uint32_t)BakeFlagsInternal::EnableWorkloadValidation == (uint32_t)BakeFlags::EnableWorkloadValidation);
+        static_assert((uint32_t)BakeFlagsInternal::EnablePrimitiveCoverage == (uint32_t)BakeFlags::EnablePrimitiveCoverage);
+        static_assert((uint32_t)BakeFlagsInternal::EnableDisplacementLevelDemotion == (uint32_t)BakeFlags::EnableDisplacementLevelDemotion);
     }
 
     BakerImpl::~BakerImpl()
-    {}
+    {
+        for (auto& [contentKey, entry] : m_textureCache)
+            Deallocate(m_stdAllocator, entry.texture);
+    }
 
     Result BakerImpl::Create(const BakerCreationDesc& vmBakeCreationDesc)
     {
+        m_textureCacheSizeInBytes = vmBakeCreationDesc.textureCacheSizeInBytes;
+        m_largeBufferFlags = vmBakeCreationDesc.largeBufferFlags;
+        return Result::SUCCESS;
+    }
+
+    Result BakerImpl::CreateTexture(const TextureDesc& desc, Texture* outTexture)
+    {
+        if (outTexture == nullptr)
+            return Result::INVALID_ARGUMENT;
+
+        const bool enableCache = m_textureCacheSizeInBytes != 0;
+        TextureContentKey contentKey;
+        if (enableCache)
+        {
+            RETURN_STATUS_IF_FAILED(TextureImpl::Validate(desc));
+            contentKey = TextureImpl::GetContentKey(desc);
+
+            RETURN_STATUS_IF_FAILED(AcquireCachedTexture(contentKey, outTexture));
+            if (*outTexture != kInvalidHandle)
+                return Result::SUCCESS;
+        }
+
+        // The preprocessing runs outside of the lock.
+        TextureImpl* implementation = Allocate<TextureImpl>(m_stdAllocator, m_stdAllocator);
+        const Result result = implementation->Create(desc, m_largeBufferFlags);
+        if (result != Result::SUCCESS)
+        {
+            Deallocate(m_stdAllocator, implementation);
+            return result;
+        }
+
+        if (enableCache)
+        {
+            std::lock_guard<std::mutex> lock(m_textureCacheMutex);
+            auto [it, inserted] = m_textureCache.insert({ contentKey, CachedTexture{ contentKey, implementation, 0, nullptr, nullptr } });
+            if (!inserted)
+            {
+                // A concurrent miss on the same content got there first.
+                Deallocate(m_stdAllocator, implementation);
+                if (it->second.refCount == 0)
+                    RemoveFromLru(&it->second);
+            }
+            else
+                m_cachedTextures.insert({ implementation, &it->second });
+            it->second.refCount++;
+            implementation = it->second.texture;
+        }
+
+        *outTexture = (Texture)implementation;
+        return Result::SUCCESS;
+    }
+
+    Result BakerImpl::AcquireCachedTexture(const TextureContentKey& contentKey, Texture* outTexture)
+    {
+        if (outTexture == nullptr)
+            return Result::INVALID_ARGUMENT;
+
+        *outTexture = kInvalidHandle;
+        if (m_textureCacheSizeInBytes == 0)
+            return Result::SUCCESS;
+
+        std::lock_guard<std::mutex> lock(m_textureCacheMutex);
+        auto it = m_textureCache.find(contentKey);
+        if (it == m_textureCache.end())
+            return Result::SUCCESS;
+
+        if (it->second.refCount++ == 0)
+            RemoveFromLru(&it->second);
+        *outTexture = (Texture)it->second.texture;
+        return Result::SUCCESS;
+    }
+
+    Result BakerImpl::DestroyTexture(Texture texture)
+    {
+        TextureImpl* implementation = (TextureImpl*)texture;
+        if (m_textureCacheSizeInBytes == 0)
+        {
+            Deallocate(m_stdAllocator, implementation);
+            return Result::SUCCESS;
+        }
+
+        std::lock_guard<std::mutex> lock(m_textureCacheMutex);
+        auto it = m_cachedTextures.find(implementation);
+        if (it == m_cachedTextures.end() || it->second->refCount == 0)
+            return Result::INVALID_ARGUMENT;
+
+        CachedTexture* entry = it->second;
+        if (--entry->refCount == 0)
+        {
+            AddToLru(entry);
+            EvictUnreferencedTextures();
+        }
+        return Result::SUCCESS;
+    }
+
+    // The LRU functions must be called with m_textureCacheMutex held.
+    void BakerImpl::AddToLru(CachedTexture* entry)
+    {
+        entry->lruPrev = m_lruTail;
+        entry->lruNext = nullptr;
+        if (m_lruTail)
+            m_lruTail->lruNext = entry;
+        else
+            m_lruHead = entry;
+        m_lruTail = entry;
+        m_unreferencedTextureSize += entry->texture->GetMemoryFootprint();
+    }
+
+    void BakerImpl::RemoveFromLru(CachedTexture* entry)
+    {
+        if (entry->lruPrev)
+            entry->lruPrev->lruNext = entry->lruNext;
+        else
+            m_lruHead = entry->lruNext;
+        if (entry->lruNext)
+            entry->lruNext->lruPrev = entry->lruPrev;
+        else
+            m_lruTail = entry->lruPrev;
+        entry->lruPrev = nullptr;
+        entry->lruNext = nullptr;
+        m_unreferencedTextureSize -= entry->texture->GetMemoryFootprint();
+    }
+
+    void BakerImpl::EvictUnreferencedTextures()
+    {
+        while (m_unreferencedTextureSize > m_textureCacheSizeInBytes)
+        {
+            CachedTexture* lru = m_lruHead;
+            OMM_ASSERT(lru != nullptr && lru->refCount == 0);
+
+            TextureImpl* texture = lru->texture;
+            RemoveFromLru(lru);
+            m_cachedTextures.erase(texture);
+            const TextureContentKey contentKey = lru->contentKey;
+            m_textureCache.erase(contentKey);
+            Deallocate(m_stdAllocator, texture);
+        }
+    }
+
+    static bool IsProcedural(const BakeInputDesc& desc)
+    {
+        return desc.texture == 0 && desc.proceduralAlpha.EvaluateBounds != nullptr;
+    }
+
+    static bool IsPolygonMask(const BakeInputDesc& desc)
+    {
+        return desc.texture == 0 && desc.polygonMask.contourCount != 0;
+    }
+
+    static bool IsUdim(const BakeInputDesc& desc)
+    {
+        return desc.texture == 0 && desc.udimTileCount != 0;
+    }
+
+    // UDIM tile 1001 + u + 10 * v covers uv [u, u + 1) x [v, v + 1).
+    static constexpr uint32_t kUdimFirstTile = 1001;
+    static constexpr uint32_t kUdimGridWidth = 10;
+    static constexpr uint32_t kUdimGridHeight = 100;
+
+    static Result ValidateUdimTiles(const BakeInputDesc& desc)
+    {
+        std::array<bool, kUdimGridWidth * kUdimGridHeight> isTileSet = {};
+        const TilingMode tilingMode = ((const TextureImpl*)desc.udimTiles[0].texture)->GetTilingMode();
+        for (uint32_t tileIt = 0; tileIt < desc.udimTileCount; ++tileIt)
+        {
+            const UdimTileDesc& tile = desc.udimTiles[tileIt];
+            if (tile.tile < kUdimFirstTile || tile.tile >= kUdimFirstTile + kUdimGridWidth * kUdimGridHeight)
+                return Result::INVALID_ARGUMENT;
+            if (isTileSet[tile.tile - kUdimFirstTile])
+                return Result::INVALID_ARGUMENT;
+            // The bake is dispatched once for all tiles.
+            if (((const TextureImpl*)tile.texture)->GetTilingMode() != tilingMode)
+                return Result::INVALID_ARGUMENT;
+            isTileSet[tile.tile - kUdimFirstTile] = true;
+        }
         return Result::SUCCESS;
     }
 
+    // Procedural and polygon mask inputs define the alpha without a texture.
+    static bool UsesTexture(const BakeInputDesc& desc)
+    {
+        return !IsProcedural(desc) && !IsPolygonMask(desc);
+    }
+
+    static bool UsesNearDuplicateErrorBudget(const BakeInputDesc& desc)
+    {
+        return desc.nearDuplicateErrorBudget > 0.f;
+    }
+
     Result BakerImpl::Validate(const BakeInputDesc& desc) {
-        if (desc.texture == 0)
+        if (IsUdim(desc))
+        {
+            if (desc.udimTiles == nullptr)
+                return Result::INVALID_ARGUMENT;
+            for (uint32_t tileIt = 0; tileIt < desc.udimTileCount; ++tileIt)
+            {
+                if (desc.udimTiles[tileIt].texture == 0)
+                    return Result::INVALID_ARGUMENT;
+            }
+            return Result::SUCCESS;
+        }
+        if (desc.texture == 0 && UsesTexture(desc))
             return Result::INVALID_ARGUMENT;
         return Result::SUCCESS;
     }
@@ -75,7 +289,7 @@ namespace Cpu
     {
         RETURN_STATUS_IF_FAILED(Validate(bakeInputDesc));
         BakeOutputImpl* implementation = Allocate<BakeOutputImpl>(m_stdAllocator, m_stdAllocator);
-        Result result = implementation->Bake(bakeInputDesc);
+        Result result = implementation->Bake(bakeInputDesc, m_largeBufferFlags);
 
         if (result == Result::SUCCESS)
         {
@@ -87,41 +301,87 @@ namespace Cpu
         return result;
     }
 
+    Result BakerImpl::GetPreBakeEstimate(const BakeInputDesc& bakeInputDesc, PreBakeEstimate* outPreBakeEstimate)
+    {
+        RETURN_STATUS_IF_FAILED(Validate(bakeInputDesc));
+        return BakeOutputImpl::GetPreBakeEstimate(m_stdAllocator, bakeInputDesc, outPreBakeEstimate);
+    }
+
+    Result BakerImpl::BakeOpacityMicromapDispatch(const Gpu::BakeDispatchConfigDesc& config, const BakeDispatchInputDesc& inputDesc, DispatchBakeResult* outBakeResult)
+    {
+        DispatchBakeOutputImpl* implementation = Allocate<DispatchBakeOutputImpl>(m_stdAllocator, m_stdAllocator);
+        Result result = implementation->Bake(config, inputDesc, m_largeBufferFlags);
+
+        if (result == Result::SUCCESS)
+        {
+            *outBakeResult = (DispatchBakeResult)implementation;
+            return Result::SUCCESS;
+        }
+
+        Deallocate(m_stdAllocator, implementation);
+        return result;
+    }
+
+    Result BakerImpl::BakeDisplacementMicromap(const BakeDisplacementInputDesc& bakeInputDesc, DisplacementBakeResult* outBakeResult)
+    {
+        DisplacementBakeOutputImpl* implementation = Allocate<DisplacementBakeOutputImpl>(m_stdAllocator, m_stdAllocator);
+        Result result = implementation->Bake(bakeInputDesc);
+
+        if (result == Result::SUCCESS)
+        {
+            *outBakeResult = (DisplacementBakeResult)implementation;
+            return Result::SUCCESS;
+        }
+
+        Deallocate(m_stdAllocator, implementation);
+        return result;
+    }
+
     BakeOutputImpl::BakeOutputImpl(const StdAllocator<uint8_t>& stdAllocator) :
         m_stdAllocator(stdAllocator),
         m_bakeInputDesc({}),
         m_bakeResult(stdAllocator),
-        bakeDispatchTable(stdAllocator.GetInterface())
+        m_largeBufferFlags(LargeBufferFlags::None)
     {
-        #define REGISTER_DISPATCH(x, y, z)                                                                              \
-        RegisterDispatch<decltype(x), decltype(y), decltype(z)>(x, y, z, [&](const BakeInputDesc& desc)->Result {  \
-            return BakeImpl<x, y, z>(desc);                                                                             \
-        });                                                                                                             \
-
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Wrap, TextureFilterMode::Linear);
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Mirror, TextureFilterMode::Linear);
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Clamp, TextureFilterMode::Linear);
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Border, TextureFilterMode::Linear);
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::MirrorOnce, TextureFilterMode::Linear);
-
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Wrap, TextureFilterMode::Linear);
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Mirror, TextureFilterMode::Linear);
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Clamp, TextureFilterMode::Linear);
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Border, TextureFilterMode::Linear);
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::MirrorOnce, TextureFilterMode::Linear);
-
-        // Iterative on
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Wrap, TextureFilterMode::Nearest);
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Mirror, TextureFilterMode::Nearest);
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Clamp, TextureFilterMode::Nearest);
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Border, TextureFilterMode::Nearest);
-        REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::MirrorOnce, TextureFilterMode::Nearest);
-
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Wrap, TextureFilterMode::Nearest);
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Mirror, TextureFilterMode::Nearest);
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Clamp, TextureFilterMode::Nearest);
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Border, TextureFilterMode::Nearest);
-        REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::MirrorOnce, TextureFilterMode::Nearest);
+    }
+
+    const BakeOutputImpl::DispatchTable& BakeOutputImpl::GetDispatchTable()
+    {
+        static const DispatchTable table = []() {
+            DispatchTable t;
+
+            #define REGISTER_DISPATCH(x, y, z)                                                                          \
+            t.bake[(uint32_t)x][(uint32_t)y][(uint32_t)z] = &BakeOutputImpl::BakeImpl<x, y, z>;                     \
+
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Wrap, TextureFilterMode::Linear);
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Mirror, TextureFilterMode::Linear);
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Clamp, TextureFilterMode::Linear);
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Border, TextureFilterMode::Linear);
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::MirrorOnce, TextureFilterMode::Linear);
+
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Wrap, TextureFilterMode::Linear);
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Mirror, TextureFilterMode::Linear);
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Clamp, TextureFilterMode::Linear);
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Border, TextureFilterMode::Linear);
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::MirrorOnce, TextureFilterMode::Linear);
+
+            // Iterative on
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Wrap, TextureFilterMode::Nearest);
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Mirror, TextureFilterMode::Nearest);
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Clamp, TextureFilterMode::Nearest);
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::Border, TextureFilterMode::Nearest);
+            REGISTER_DISPATCH(TilingMode::Linear, TextureAddressMode::MirrorOnce, TextureFilterMode::Nearest);
+
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Wrap, TextureFilterMode::Nearest);
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Mirror, TextureFilterMode::Nearest);
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Clamp, TextureFilterMode::Nearest);
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::Border, TextureFilterMode::Nearest);
+            REGISTER_DISPATCH(TilingMode::MortonZ, TextureAddressMode::MirrorOnce, TextureFilterMode::Nearest);
+
+            #undef REGISTER_DISPATCH
+            return t;
+        }();
+        return table;
     }
 
     BakeOutputImpl::~BakeOutputImpl()
@@ -129,44 +389,62 @@ namespace Cpu
     }
 
     Result BakeOutputImpl::ValidateDesc(const BakeInputDesc& desc) {
-        if (desc.texture == 0)
+        const uint32_t alphaSourceCount = (desc.texture != 0) + (desc.udimTileCount != 0) + (desc.proceduralAlpha.EvaluateBounds != nullptr) + (desc.polygonMask.contourCount != 0);
+        if (alphaSourceCount != 1)
+            return Result::INVALID_ARGUMENT;
+        if (IsUdim(desc))
+            RETURN_STATUS_IF_FAILED(ValidateUdimTiles(desc));
+        if (IsProcedural(desc) && desc.proceduralAlpha.maxRefinementDepth > kMaxSubdivLevel)
             return Result::INVALID_ARGUMENT;
+        if (IsPolygonMask(desc))
+            RETURN_STATUS_IF_FAILED(PolygonMaskImpl::Validate(desc.polygonMask));
         if (desc.alphaMode == AlphaMode::MAX_NUM)
             return Result::INVALID_ARGUMENT;
-        if (desc.runtimeSamplerDesc.addressingMode == TextureAddressMode::MAX_NUM)
+        if (UsesTexture(desc) && desc.runtimeSamplerDesc.addressingMode == TextureAddressMode::MAX_NUM)
             return Result::INVALID_ARGUMENT;
-        if (desc.runtimeSamplerDesc.filter == TextureFilterMode::MAX_NUM)
+        if (UsesTexture(desc) && desc.runtimeSamplerDesc.filter == TextureFilterMode::MAX_NUM)
+            return Result::INVALID_ARGUMENT;
+        if (UsesTexture(desc) && !(desc.runtimeSamplerDesc.minLod <= desc.runtimeSamplerDesc.maxLod)) // NaN -> invalid
+            return Result::INVALID_ARGUMENT;
+        if (UsesTexture(desc) && (desc.runtimeSamplerDesc.maxAnisotropy < 1 || desc.runtimeSamplerDesc.maxAnisotropy > 16))
             return Result::INVALID_ARGUMENT;
         if (desc.texCoordFormat == TexCoordFormat::MAX_NUM)
             return Result::INVALID_ARGUMENT;
         if (desc.texCoords == nullptr)
             return Result::INVALID_ARGUMENT;
-        if (desc.indexFormat == IndexFormat::MAX_NUM)
-            return Result::INVALID_ARGUMENT;
-        if (desc.indexBuffer == nullptr)
+        if (desc.indexBuffer != nullptr && desc.indexFormat == IndexFormat::MAX_NUM)
             return Result::INVALID_ARGUMENT;
         if (desc.indexCount == 0)
             return Result::INVALID_ARGUMENT;
         if (desc.maxSubdivisionLevel > kMaxSubdivLevel)
             return Result::INVALID_ARGUMENT;
+        if (desc.frameCount != 0 && desc.frameTexCoordTransforms == nullptr)
+            return Result::INVALID_ARGUMENT;
         return Result::SUCCESS;
     }
 
-    template<class... TArgs>
-    void BakeOutputImpl::RegisterDispatch(TArgs... args, std::function < Result(const BakeInputDesc& desc)> fn) {
-        bakeDispatchTable[std::make_tuple(args...)] = fn;
-    }
-
     Result BakeOutputImpl::InvokeDispatch(const BakeInputDesc& desc) {
-        TextureImpl* texture = ((TextureImpl*)desc.texture);
-        auto it = bakeDispatchTable.find(std::make_tuple(texture->GetTilingMode(), desc.runtimeSamplerDesc.addressingMode, desc.runtimeSamplerDesc.filter));
-        if (it == bakeDispatchTable.end())
+        // The dispatch only selects how the texture is sampled, which procedural and polygon mask inputs bypass.
+        if (!UsesTexture(desc))
+            return BakeImpl<TilingMode::Linear, TextureAddressMode::Clamp, TextureFilterMode::Linear>(desc);
+
+        // All UDIM tiles share the tiling mode, see ValidateUdimTiles.
+        TextureImpl* texture = IsUdim(desc) ? ((TextureImpl*)desc.udimTiles[0].texture) : ((TextureImpl*)desc.texture);
+        const TilingMode tilingMode = texture->GetTilingMode();
+        const TextureAddressMode addressMode = desc.runtimeSamplerDesc.addressingMode;
+        const TextureFilterMode filterMode = desc.runtimeSamplerDesc.filter;
+        if (tilingMode >= TilingMode::MAX_NUM || addressMode >= TextureAddressMode::MAX_NUM || filterMode >= TextureFilterMode::MAX_NUM)
+            return Result::FAILURE;
+
+        const BakeFn fn = GetDispatchTable().bake[(uint32_t)tilingMode][(uint32_t)addressMode][(uint32_t)filterMode];
+        if (fn == nullptr)
             return Result::FAILURE;
-        return it->second(desc);
+        return (this->*fn)(desc);
     }
 
-    Result BakeOutputImpl::Bake(const BakeInputDesc& desc)
+    Result BakeOutputImpl::Bake(const BakeInputDesc& desc, LargeBufferFlags largeBufferFlags)
     {
+        m_largeBufferFlags = largeBufferFlags;
         return InvokeDispatch(desc);
     }
 
@@ -256,40 +534,84 @@ namespace Cpu
         size_t _ommArrayDataSize;
     };
 
+    // Owns the 4/2-state and 3-state data of a work item in a single allocation, placed according to LargeBufferFlags.
+    // With ParallelFirstTouch the states are zeroed by FirstTouch on the thread resampling the work item.
     class OmmArrayDataVector final : public OmmArrayDataView
     {
+        static constexpr size_t kAlignment = 64;
     public:
         OmmArrayDataVector() = delete;
-        OmmArrayDataVector(StdAllocator<uint8_t>& stdAllocator, OMMFormat format, uint32_t _subdivisionLevel)
+        OmmArrayDataVector(StdAllocator<uint8_t>& stdAllocator, OMMFormat format, uint32_t _subdivisionLevel, LargeBufferFlags largeBufferFlags)
             : OmmArrayDataView(format, nullptr, nullptr, 0)
-            , data(stdAllocator.GetInterface())
-            , data3state(stdAllocator.GetInterface())
+            , _stdAllocator(stdAllocator)
         {
             const size_t maxSizeInBytes = (size_t)omm::bird::GetNumMicroTriangles(_subdivisionLevel);
-            data.resize(maxSizeInBytes);
-            data3state.resize(maxSizeInBytes);
-            OmmArrayDataView::SetData((uint8_t*)data.data(), data3state.data(), maxSizeInBytes);
+            const bool enableHugePages = UseHugePages(largeBufferFlags, 2 * maxSizeInBytes);
+
+            _dataSize = enableHugePages ? math::Align(2 * maxSizeInBytes, kHugePageSize) : 2 * maxSizeInBytes;
+            _data = _stdAllocator.allocate(_dataSize, enableHugePages ? kHugePageSize : kAlignment);
+            if (enableHugePages)
+                AdviseHugePages(_data, _dataSize);
+
+            _needsFirstTouch = true;
+            if (!UseParallelFirstTouch(largeBufferFlags))
+                FirstTouch();
+
+            OmmArrayDataView::SetData(_data, _data + maxSizeInBytes, maxSizeInBytes);
+        }
+
+        OmmArrayDataVector(const OmmArrayDataVector&) = delete;
+        OmmArrayDataVector& operator=(const OmmArrayDataVector&) = delete;
+
+        OmmArrayDataVector(OmmArrayDataVector&& other) noexcept
+            : OmmArrayDataView(other)
+            , _stdAllocator(other._stdAllocator)
+            , _data(other._data)
+            , _dataSize(other._dataSize)
+            , _needsFirstTouch(other._needsFirstTouch)
+        {
+            other._data = nullptr;
+            other._dataSize = 0;
+        }
+
+        ~OmmArrayDataVector()
+        {
+            if (_data)
+                _stdAllocator.deallocate(_data, _dataSize);
+        }
+
+        // Must be called before the states are accessed, the first call zeroes them.
+        void FirstTouch()
+        {
+            if (!_needsFirstTouch)
+                return;
+            std::memset(_data, 0, _dataSize);
+            _needsFirstTouch = false;
         }
 
     private:
-        vector<uint8_t> data;
-        vector<uint8_t> data3state;
+        StdAllocator<uint8_t> _stdAllocator;
+        uint8_t* _data = nullptr;
+        size_t _dataSize = 0;
+        bool _needsFirstTouch = false;
     };
 
     struct OmmWorkItem {
         uint32_t subdivisionLevel;
         OMMFormat vmFormat;
+        float alphaCutoff;
         Triangle uvTri;
         vector<uint32_t> primitiveIndices; // source primitive and identical indices
 
         OmmWorkItem() = delete;
 
-        OmmWorkItem(StdAllocator<uint8_t>& stdAllocator, OMMFormat _vmFormat, uint32_t _subdivisionLevel, uint32_t primitiveIndex, const Triangle& _uvTri)
-            : primitiveIndices(stdAllocator)
-            , subdivisionLevel(_subdivisionLevel)
+        OmmWorkItem(StdAllocator<uint8_t>& stdAllocator, OMMFormat _vmFormat, uint32_t _subdivisionLevel, float _alphaCutoff, uint32_t primitiveIndex, const Triangle& _uvTri, LargeBufferFlags largeBufferFlags)
+            : subdivisionLevel(_subdivisionLevel)
             , vmFormat(_vmFormat)
+            , alphaCutoff(_alphaCutoff)
             , uvTri(_uvTri)
-            , vmStates(stdAllocator, _vmFormat, _subdivisionLevel)
+            , primitiveIndices(stdAllocator)
+            , vmStates(stdAllocator, _vmFormat, _subdivisionLevel, largeBufferFlags)
         {
             primitiveIndices.push_back(primitiveIndex);
         }
@@ -302,6 +624,56 @@ namespace Cpu
         uint32_t vmDescOffset = 0xFFFFFFFF;
         uint32_t vmSpecialIndex = kNoSpecialIndex;
         OmmArrayDataVector vmStates;
+
+        // Reported in BakeResultDesc::primitiveCoverage, written by PromoteToSpecialIndices.
+        float knownFraction = 0.f;
+        SpecialIndexReason specialIndexReason = SpecialIndexReason::None;
+
+        // XXH64 of the 3-state data, written by Resample. Must be invalidated when vmStates are modified.
+        uint64_t vmStatesDigest = 0;
+        bool hasVmStatesDigest = false;
+    };
+
+    static constexpr uint64_t kOmmStateDigestSeed = 42;
+
+    // Hashes the 3-state data of a work item while Resample writes it. Each block is hashed as soon as
+    // it's complete, while still in cache, so DeduplicateExact doesn't need a second pass over the states.
+    // The final digest is identical to XXH64 over the full 3-state buffer.
+    class OmmStateDigest
+    {
+        static constexpr uint32_t kBlockSize = 4096;
+    public:
+        OmmStateDigest(const OmmArrayDataView& states, bool enabled)
+            : _states(states)
+            , _enabled(enabled)
+        {
+            if (_enabled)
+                XXH64_reset(&_state, kOmmStateDigestSeed);
+        }
+
+        void Update(uint32_t numStatesWritten) {
+            if (_enabled && numStatesWritten - _numStatesHashed >= kBlockSize)
+                Consume(numStatesWritten);
+        }
+
+        void Finalize(OmmWorkItem& workItem) {
+            if (!_enabled)
+                return;
+            Consume((uint32_t)_states.GetOmm3StateDataSize());
+            workItem.vmStatesDigest = XXH64_digest(&_state);
+            workItem.hasVmStatesDigest = true;
+        }
+
+    private:
+        void Consume(uint32_t numStatesWritten) {
+            XXH64_update(&_state, _states.GetOmm3StateData() + _numStatesHashed, numStatesWritten - _numStatesHashed);
+            _numStatesHashed = numStatesWritten;
+        }
+
+        const OmmArrayDataView& _states;
+        const bool _enabled;
+        uint32_t _numStatesHashed = 0;
+        XXH64_state_t _state;
     };
 
     static bool IsUnknown(OpacityState state) {
@@ -318,10 +690,6 @@ namespace Cpu
         return 0.5f * length(cross(float3(v0, 0), float3(v1, 0)));
     };
 
-    static float GetArea2D(const Triangle& uvTri) {
-        return GetArea2D(uvTri.p0, uvTri.p1, uvTri.p2);
-    };
-
     static const uint32_t CalculateSuitableSubdivisionLevel(const BakeInputDesc& desc, const Triangle& uvTri, uint2 texSize)
     {
         auto GetNextPow2 = [](uint v)->uint
@@ -384,7 +752,8 @@ namespace Cpu
             return desc.subdivisionLevels[i];
         }
 
-        const bool enableDynamicSubdivisionLevel = desc.dynamicSubdivisionScale > 0;
+        // There's no texel size to derive the subdivision level from without a texture.
+        const bool enableDynamicSubdivisionLevel = desc.dynamicSubdivisionScale > 0 && UsesTexture(desc);
 
         if (enableDynamicSubdivisionLevel)
         {
@@ -407,7 +776,11 @@ namespace Cpu
             enableWorkloadValidation(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnableWorkloadValidation) == (uint32_t)BakeFlagsInternal::EnableWorkloadValidation),
             enableAABBTesting(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnableAABBTesting) == (uint32_t)BakeFlagsInternal::EnableAABBTesting),
             disableRemovePoorQualityOMM(((uint32_t)flags& (uint32_t)BakeFlagsInternal::DisableRemovePoorQualityOMM) == (uint32_t)BakeFlagsInternal::DisableRemovePoorQualityOMM),
-            disableLevelLineIntersection(((uint32_t)flags& (uint32_t)BakeFlagsInternal::DisableLevelLineIntersection) == (uint32_t)BakeFlagsInternal::DisableLevelLineIntersection)
+            disableLevelLineIntersection(((uint32_t)flags& (uint32_t)BakeFlagsInternal::DisableLevelLineIntersection) == (uint32_t)BakeFlagsInternal::DisableLevelLineIntersection),
+            disableFusedResampleDigest(((uint32_t)flags& (uint32_t)BakeFlagsInternal::DisableFusedResampleDigest) == (uint32_t)BakeFlagsInternal::DisableFusedResampleDigest),
+            enableNearDuplicateDetectionMultiIndex(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnableNearDuplicateDetectionMultiIndex) == (uint32_t)BakeFlagsInternal::EnableNearDuplicateDetectionMultiIndex),
+            enablePrimitiveCoverage(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnablePrimitiveCoverage) == (uint32_t)BakeFlagsInternal::EnablePrimitiveCoverage),
+            enableDisplacementLevelDemotion(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnableDisplacementLevelDemotion) == (uint32_t)BakeFlagsInternal::EnableDisplacementLevelDemotion)
         { }
         const bool enableInternalThreads;
         const bool disableSpecialIndices;
@@ -418,133 +791,453 @@ namespace Cpu
         const bool enableAABBTesting;
         const bool disableRemovePoorQualityOMM;
         const bool disableLevelLineIntersection;
+        const bool disableFusedResampleDigest;
+        const bool enableNearDuplicateDetectionMultiIndex;
+        const bool enablePrimitiveCoverage;
+        const bool enableDisplacementLevelDemotion;
     };
 
-    namespace impl
+    static uint32_t GetFrameCount(const BakeInputDesc& desc)
     {
-        static Result SetupWorkItems(
-            StdAllocator<uint8_t>& allocator, const BakeInputDesc& desc, const Options& options, 
-            vector<OmmWorkItem>& vmWorkItems)
-        {
-            const TextureImpl* texture = ((const TextureImpl*)desc.texture);
-
-            const int32_t triangleCount = desc.indexCount / 3u;
+        return std::max(desc.frameCount, 1u);
+    }
 
+    // The textures a texture bake samples: the single texture, or the tiles of a UDIM set in a dense grid.
+    class AlphaTextureSet
+    {
+    public:
+        AlphaTextureSet(const BakeInputDesc& desc) :
+            m_texture((const TextureImpl*)desc.texture),
+            m_isUdim(IsUdim(desc))
+        {
+            m_tiles.fill(nullptr);
+            for (uint32_t tileIt = 0; m_isUdim && tileIt < desc.udimTileCount; ++tileIt)
+                m_tiles[desc.udimTiles[tileIt].tile - kUdimFirstTile] = (const TextureImpl*)desc.udimTiles[tileIt].texture;
+        }
 
-            // 1. Reserve memory.
-            hash_map<size_t, uint32_t> triangleIDToWorkItem(allocator.GetInterface());
-            vmWorkItems.reserve(triangleCount);
+        // Calls fn(texture, tileTri) for every texture t overlaps, tileTri is t in the UV space of that texture.
+        // The part of t outside of all tiles is reported once, last, with a null texture. Stops when fn returns false.
+        template<class TFn>
+        void ForEachTexture(const Triangle& t, TFn fn) const
+        {
+            if (!m_isUdim)
+            {
+                fn(m_texture, t);
+                return;
+            }
 
-            const int32_t kDisabledPrimitive = 0xE;
+            // A triangle ending exactly on a tile boundary stays in the lower tile.
+            // Tiles beyond the grid are clamped to the first row / column outside of it.
+            const float2 gridMin = float2(-1.f);
+            const float2 gridMax = float2(kUdimGridWidth, kUdimGridHeight);
+            const int2 tileBegin = int2(glm::clamp(glm::floor(t.aabb_s), gridMin, gridMax));
+            const int2 tileEnd = glm::max(tileBegin, int2(glm::clamp(glm::ceil(t.aabb_e), gridMin, gridMax + 1.f)) - 1);
 
-            // 2. Reduce uv.
+            bool isOutside = false;
+            for (int32_t y = tileBegin.y; y <= tileEnd.y; ++y)
             {
-                const uint32_t texCoordStrideInBytes = desc.texCoordStrideInBytes == 0 ? GetTexCoordFormatSize(desc.texCoordFormat) : desc.texCoordStrideInBytes;
-
-                for (int32_t i = 0; i < triangleCount; ++i)
+                for (int32_t x = tileBegin.x; x <= tileEnd.x; ++x)
                 {
-                    uint32_t triangleIndices[3];
-                    GetUInt32Indices(desc.indexFormat, desc.indexBuffer, 3ull * i, triangleIndices);
-
-                    const Triangle uvTri = FetchUVTriangle(desc.texCoords, texCoordStrideInBytes, desc.texCoordFormat, triangleIndices);
-
-                    const int32_t subdivisionLevel = GetSubdivisionLevelForPrimitive(desc, i, uvTri, texture->GetSize(0 /*always based on mip 0*/));
-
-                    const bool bIsDisabled = subdivisionLevel == kDisabledPrimitive;
-                    const bool bIsDegenerate = IsDegenerate(uvTri);
-
-                    if (bIsDisabled || bIsDegenerate)
+                    const TextureImpl* tile = GetTile(x, y);
+                    if (tile == nullptr)
                     {
-                        continue; // These indices will be set to special index unknown later.
+                        isOutside = true;
+                        continue;
                     }
 
-                    const OMMFormat ommFormat = !desc.ommFormats || desc.ommFormats[i] == OMMFormat::INVALID ? desc.ommFormat : desc.ommFormats[i];
+                    const float2 origin = float2(x, y);
+                    if (!fn(tile, Triangle(t.p0 - origin, t.p1 - origin, t.p2 - origin)))
+                        return;
+                }
+            }
+
+            if (isOutside)
+                fn(nullptr, t);
+        }
 
-                    // This is an early check to test for VM reuse.
-                    // If subdivision level or format differs we can't reuse the VM.
-                    std::size_t seed = 42;
-                    hash_combine(seed, uvTri.p0);
-                    hash_combine(seed, uvTri.p1);
-                    hash_combine(seed, uvTri.p2);
-                    hash_combine(seed, subdivisionLevel);
-                    hash_combine(seed, ommFormat);
+        // Largest mip 0 size of the textures t overlaps, zero without a texture.
+        int2 GetMaxSize(const Triangle& t) const
+        {
+            int2 size = int2(0);
+            ForEachTexture(t, [&size](const TextureImpl* texture, const Triangle&) {
+                if (texture != nullptr)
+                    size = glm::max(size, texture->GetSize(0 /*mip*/));
+                return true;
+            });
+            return size;
+        }
 
-                    const uint64_t vmId = seed;
+    private:
+        const TextureImpl* GetTile(int32_t x, int32_t y) const
+        {
+            if (x < 0 || y < 0 || x >= (int32_t)kUdimGridWidth || y >= (int32_t)kUdimGridHeight)
+                return nullptr;
+            return m_tiles[y * kUdimGridWidth + x];
+        }
 
-                    auto it = triangleIDToWorkItem.find(vmId);
-                    if ((it == triangleIDToWorkItem.end() || options.disableDuplicateDetection))
-                    {
-                        if (kMaxSubdivLevel < subdivisionLevel)
-                            return Result::INVALID_ARGUMENT;
+        const TextureImpl* m_texture;
+        const bool m_isUdim;
+        std::array<const TextureImpl*, kUdimGridWidth * kUdimGridHeight> m_tiles;
+    };
 
-                        uint32_t workItemIdx = (uint32_t)vmWorkItems.size();
-                        // Temporarily set the triangle->vm desc mapping like this.
-                        triangleIDToWorkItem.insert(std::make_pair(vmId, workItemIdx));
-                        vmWorkItems.emplace_back(allocator, ommFormat, subdivisionLevel, i, uvTri);
-                    }
-                    else {
-                        vmWorkItems[it->second].primitiveIndices.push_back(i);
-                    }
+    namespace impl
+    {
+        // Exact identity of a work item in SetupWorkItems. Compared bit for bit and hashed with XXH64, so the
+        // assignment of primitives to work items doesn't depend on the std::hash implementation.
+        struct WorkItemKey
+        {
+            uint32_t uvBits[6];
+            uint32_t subdivisionLevel;
+            uint32_t format;
+            uint32_t alphaCutoffBits;
+
+            WorkItemKey(const Triangle& uvTri, uint32_t _subdivisionLevel, uint32_t _format, float alphaCutoff)
+                : subdivisionLevel(_subdivisionLevel)
+                , format(_format)
+            {
+                const float uv[6] = { uvTri.p0.x, uvTri.p0.y, uvTri.p1.x, uvTri.p1.y, uvTri.p2.x, uvTri.p2.y };
+                for (uint32_t i = 0; i < 6; ++i)
+                {
+                    const float v = uv[i] + 0.f; // -0 -> +0
+                    std::memcpy(&uvBits[i], &v, sizeof(float));
                 }
+                const float cutoff = alphaCutoff + 0.f;
+                std::memcpy(&alphaCutoffBits, &cutoff, sizeof(float));
             }
-            return Result::SUCCESS;
-        }
 
-        static Result ValidateWorkloadSize(
-            StdAllocator<uint8_t>& allocator, const BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+            bool operator==(const WorkItemKey& other) const = default;
+        };
+
+        struct WorkItemKeyHash
         {
-            // Check if the baking will complete in "finite" amount of time...
-            if (!options.enableWorkloadValidation)
-                return Result::SUCCESS;
+            size_t operator()(const WorkItemKey& key) const {
+                return (size_t)XXH64(&key, sizeof(WorkItemKey), 42 /*seed*/);
+            }
+        };
 
-            const TextureImpl* texture = ((const TextureImpl*)desc.texture);
+        // Widens the index buffer and converts every texcoord it references to float2, in bulk and ahead of the
+        // serial work item setup, rather than per primitive (and frame) through FetchUVTriangle.
+        // Only the referenced vertex range is decoded, outIndices are relative to its first vertex. This keeps
+        // sub-ranges of large shared vertex pools cheap.
+        static Result DecodeGeometry(
+            IndexFormat indexFormat, const void* indexBuffer, uint32_t indexOffset, uint32_t indexCount, int32_t baseVertex,
+            TexCoordFormat texCoordFormat, const void* texCoords, uint32_t texCoordStrideInBytes,
+            bool enableInternalThreads, vector<uint32_t>& outIndices, vector<float2>& outTexCoords)
+        {
+            static constexpr uint32_t kChunkSize = 64 * 1024;
 
-            // Approximate the workload size. 
-            // The workload metric is the accumulated count of the number of texels in total that needs to be processed.
-            // So where is the cutoff point? Hard to say. But if the workload 
-            const uint64_t texelCount = (uint64_t)texture->GetSize(0 /*mip*/).x * (uint64_t)texture->GetSize(0 /*mip*/).y;
-            const float2 sizef = (float2)texture->GetSize(0 /*mip*/);
-            uint64_t workloadSize = 0;
+            outIndices.resize(indexCount);
+            outTexCoords.clear();
+            if (indexCount == 0)
+                return Result::SUCCESS;
+            if (!indexBuffer && uint64_t(indexOffset) + indexCount > (uint64_t)std::numeric_limits<uint32_t>::max() + 1)
+                return Result::INVALID_ARGUMENT;
 
-            for (const OmmWorkItem& workItem : vmWorkItems)
+            const int32_t indexChunkCount = (int32_t)math::DivUp(indexCount, kChunkSize);
+            vector<uint32_t> chunkMinIndex(indexChunkCount, 0, outIndices.get_allocator());
+            vector<uint32_t> chunkMaxIndex(indexChunkCount, 0, outIndices.get_allocator());
+
+            #pragma omp parallel for if(enableInternalThreads)
+            for (int32_t chunkIt = 0; chunkIt < indexChunkCount; ++chunkIt)
             {
-                const int2 aabb = int2((workItem.uvTri.aabb_e - workItem.uvTri.aabb_s) * sizef);
-                workloadSize += uint64_t(aabb.x * aabb.y);
+                const size_t first = size_t(chunkIt) * kChunkSize;
+                const size_t count = std::min<size_t>(kChunkSize, indexCount - first);
+                uint32_t* indices = outIndices.data() + first;
+                if (indexBuffer)
+                {
+                    GetUInt32IndicesBulk(indexFormat, indexBuffer, indexOffset + first, count, indices, chunkMinIndex[chunkIt], chunkMaxIndex[chunkIt]);
+                }
+                else
+                {
+                    std::iota(indices, indices + count, uint32_t(indexOffset + first));
+                    chunkMinIndex[chunkIt] = indices[0];
+                    chunkMaxIndex[chunkIt] = indices[count - 1];
+                }
             }
 
-            const uint64_t kMaxWorkloadSize = 1 << 27; // 128 * 1024x1024 texels. 
-            if (workloadSize > kMaxWorkloadSize)
+            // The base vertex must not move any index out of the 32 bit range.
+            const int64_t minVertex = (int64_t)*std::min_element(chunkMinIndex.begin(), chunkMinIndex.end()) + baseVertex;
+            const int64_t maxVertex = (int64_t)*std::max_element(chunkMaxIndex.begin(), chunkMaxIndex.end()) + baseVertex;
+            if (minVertex < 0 || maxVertex > (int64_t)std::numeric_limits<uint32_t>::max())
+                return Result::INVALID_ARGUMENT;
+
+            // index + baseVertex - minVertex, wrapping arithmetic is exact here.
+            const uint32_t rebase = uint32_t(int64_t(baseVertex) - minVertex);
+            if (rebase != 0)
             {
-                return Result::WORKLOAD_TOO_BIG;
+                #pragma omp parallel for if(enableInternalThreads)
+                for (int32_t chunkIt = 0; chunkIt < indexChunkCount; ++chunkIt)
+                {
+                    const size_t first = size_t(chunkIt) * kChunkSize;
+                    const size_t count = std::min<size_t>(kChunkSize, indexCount - first);
+                    uint32_t* indices = outIndices.data() + first;
+                    for (size_t i = 0; i < count; ++i)
+                        indices[i] += rebase;
+                }
             }
 
+            const size_t vertexCount = size_t(maxVertex - minVertex) + 1;
+            outTexCoords.resize(vertexCount);
+            const int32_t vertexChunkCount = (int32_t)math::DivUp<size_t>(vertexCount, kChunkSize);
+
+            #pragma omp parallel for if(enableInternalThreads)
+            for (int32_t chunkIt = 0; chunkIt < vertexChunkCount; ++chunkIt)
+            {
+                const size_t first = size_t(chunkIt) * kChunkSize;
+                const size_t count = std::min<size_t>(kChunkSize, vertexCount - first);
+                FetchUVBulk(texCoords, texCoordStrideInBytes, texCoordFormat, size_t(minVertex) + first, count, outTexCoords.data() + first);
+            }
             return Result::SUCCESS;
         }
 
-        template<TilingMode eTilingMode, TextureAddressMode eTextureAddressMode, TextureFilterMode eFilterMode>
-        static Result Resample(const BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        // Resolves every primitive of every frame the way the bake sees it. onResample(primitiveIndex, uvTri, subdivisionLevel,
+        // ommFormat, alphaCutoff) is called for the primitives to resample, onSkip(primitiveIndex, reason) for the others.
+        // primitiveIndex includes the frame offset. Shared by SetupWorkItems and GetPreBakeEstimate.
+        template<class TResampleFn, class TSkipFn>
+        static Result ForEachPrimitive(
+            StdAllocator<uint8_t>& allocator, const BakeInputDesc& desc, const Options& options,
+            TResampleFn onResample, TSkipFn onSkip, size_t& outDecodedGeometrySize)
         {
-            if (options.enableAABBTesting && !options.disableLevelLineIntersection)
-                return Result::INVALID_ARGUMENT;
+            const AlphaTextureSet textures(desc);
+
+            const int32_t triangleCount = desc.indexCount / 3u;
+            const uint32_t frameCount = GetFrameCount(desc);
+
+            const int32_t kDisabledPrimitive = 0xE;
 
-            const TextureImpl* texture = ((const TextureImpl*)desc.texture);
+            const uint32_t texCoordStrideInBytes = desc.texCoordStrideInBytes == 0 ? GetTexCoordFormatSize(desc.texCoordFormat) : desc.texCoordStrideInBytes;
+            vector<uint32_t> indices(allocator);
+            vector<float2> texCoords(allocator);
+            RETURN_STATUS_IF_FAILED(DecodeGeometry(desc.indexFormat, desc.indexBuffer, desc.indexOffset, 3 * triangleCount, desc.baseVertex,
+                desc.texCoordFormat, desc.texCoords, texCoordStrideInBytes, options.enableInternalThreads, indices, texCoords));
+            outDecodedGeometrySize = indices.size() * sizeof(uint32_t) + texCoords.size() * sizeof(float2);
 
-            // 3. Process the queue of unique triangles...
+            // Each frame gets its own range of primitive indices.
+            for (uint32_t frameIt = 0; frameIt < frameCount; ++frameIt)
             {
-                const int32_t numWorkItems = (int32_t)vmWorkItems.size();
+                const TexCoordTransform* frameTransform = desc.frameCount == 0 ? nullptr : &desc.frameTexCoordTransforms[frameIt];
+                const uint32_t primitiveOffset = frameIt * (uint32_t)triangleCount;
 
-                // 3.1 Rasterize...
+                for (int32_t i = 0; i < triangleCount; ++i)
                 {
-                    #pragma omp parallel for if(options.enableInternalThreads)
+                    // Forced special indices are written by Serialize, nothing to bake.
+                    if (desc.specialIndices && desc.specialIndices[i] != 0)
+                    {
+                        if (desc.specialIndices[i] < (int32_t)SpecialIndex::FullyUnknownOpaque || desc.specialIndices[i] > (int32_t)SpecialIndex::FullyTransparent)
+                            return Result::INVALID_ARGUMENT;
+                        onSkip(primitiveOffset + i, SpecialIndexReason::Forced);
+                        continue;
+                    }
+
+                    const uint32_t* triangleIndices = &indices[3ull * i];
+                    const Triangle uvTri = TransformUVTriangle(
+                        Triangle(texCoords[triangleIndices[0]], texCoords[triangleIndices[1]], texCoords[triangleIndices[2]]), desc.texCoordTransform, frameTransform);
+
+                    const int32_t subdivisionLevel = GetSubdivisionLevelForPrimitive(desc, i, uvTri, textures.GetMaxSize(uvTri) /*always based on mip 0*/);
+
+                    const bool bIsDisabled = subdivisionLevel == kDisabledPrimitive;
+                    const bool bIsDegenerate = IsDegenerate(uvTri);
+
+                    if (bIsDisabled || bIsDegenerate)
+                    {
+                        onSkip(primitiveOffset + i, bIsDisabled ? SpecialIndexReason::Disabled : SpecialIndexReason::Degenerate);
+                        continue; // These indices will be set to special index unknown later.
+                    }
+
+                    if (kMaxSubdivLevel < subdivisionLevel)
+                        return Result::INVALID_ARGUMENT;
+
+                    const OMMFormat ommFormat = !desc.ommFormats || desc.ommFormats[i] == OMMFormat::INVALID ? desc.ommFormat : desc.ommFormats[i];
+                    const float alphaCutoff = desc.alphaCutoffs ? desc.alphaCutoffs[i] : desc.alphaCutoff;
+
+                    onResample(primitiveOffset + i, uvTri, (uint32_t)subdivisionLevel, ommFormat, alphaCutoff);
+                }
+            }
+            return Result::SUCCESS;
+        }
+
+        static Result SetupWorkItems(
+            StdAllocator<uint8_t>& allocator, const BakeInputDesc& desc, const Options& options, LargeBufferFlags largeBufferFlags,
+            vector<OmmWorkItem>& vmWorkItems, vector<PrimitiveCoverage>& primitiveCoverage)
+        {
+            const uint32_t triangleCount = desc.indexCount / 3u;
+
+            // 1. Reserve memory.
+            // Work items are created in order of their first primitive (frame major), this order is the canonical
+            // work item index used by all later passes. It doesn't depend on threading or hashing.
+            hash_map<WorkItemKey, uint32_t, WorkItemKeyHash> triangleIDToWorkItem(allocator.GetInterface());
+            vmWorkItems.reserve(triangleCount);
+
+            // Primitives that don't end up in a work item are reported here, the rest by Serialize.
+            if (options.enablePrimitiveCoverage)
+                primitiveCoverage.resize(size_t(triangleCount) * GetFrameCount(desc));
+
+            // 2. Reduce uv.
+            // Identical transformed triangles across frames end up in the same work item.
+            auto onResample = [&](uint32_t primitiveIndex, const Triangle& uvTri, uint32_t subdivisionLevel, OMMFormat ommFormat, float alphaCutoff) {
+                // This is an early check to test for VM reuse.
+                // If subdivision level, format or alpha cutoff differs we can't reuse the VM.
+                const WorkItemKey vmId(uvTri, subdivisionLevel, (uint32_t)ommFormat, alphaCutoff);
+
+                auto it = triangleIDToWorkItem.find(vmId);
+                if ((it == triangleIDToWorkItem.end() || options.disableDuplicateDetection))
+                {
+                    uint32_t workItemIdx = (uint32_t)vmWorkItems.size();
+                    // Temporarily set the triangle->vm desc mapping like this.
+                    triangleIDToWorkItem.insert(std::make_pair(vmId, workItemIdx));
+                    vmWorkItems.emplace_back(allocator, ommFormat, subdivisionLevel, alphaCutoff, primitiveIndex, uvTri, largeBufferFlags);
+                }
+                else {
+                    vmWorkItems[it->second].primitiveIndices.push_back(primitiveIndex);
+                }
+            };
+
+            auto onSkip = [&](uint32_t primitiveIndex, SpecialIndexReason reason) {
+                if (!options.enablePrimitiveCoverage)
+                    return;
+                PrimitiveCoverage& coverage = primitiveCoverage[primitiveIndex];
+                coverage.specialIndexReason = reason;
+                if (reason == SpecialIndexReason::Forced)
+                    coverage.knownFraction = desc.specialIndices[primitiveIndex % triangleCount] >= (int32_t)SpecialIndex::FullyOpaque ? 1.f : 0.f;
+            };
+
+            size_t decodedGeometrySize = 0;
+            return ForEachPrimitive(allocator, desc, options, onResample, onSkip, decodedGeometrySize);
+        }
+
+        static constexpr uint64_t kMaxWorkloadSize = 1 << 27; // 128 * 1024x1024 texels. 
+
+        // Texels in the texture space bounding box of the triangle at mip 0, the workload metric of EnableWorkloadValidation
+        // and GetPreBakeEstimate.
+        static uint64_t GetWorkloadSize(const TextureImpl* texture, const Triangle& uvTri)
+        {
+            const float2 sizef = (float2)texture->GetSize(0 /*mip*/);
+            const int2 aabb = int2((uvTri.aabb_e - uvTri.aabb_s) * sizef);
+            return uint64_t(aabb.x * aabb.y);
+        }
+
+        // A triangle straddling UDIM tiles is resampled against each of them.
+        static uint64_t GetWorkloadSize(const AlphaTextureSet& textures, const Triangle& uvTri)
+        {
+            uint64_t workloadSize = 0;
+            textures.ForEachTexture(uvTri, [&workloadSize](const TextureImpl* texture, const Triangle& tileTri) {
+                workloadSize += texture ? GetWorkloadSize(texture, tileTri) : 0;
+                return true;
+            });
+            return workloadSize;
+        }
+
+        static Result ValidateWorkloadSize(
+            StdAllocator<uint8_t>& allocator, const BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        {
+            // Check if the baking will complete in "finite" amount of time...
+            // Procedural alpha and polygon masks have no texel workload to measure.
+            if (!options.enableWorkloadValidation || !UsesTexture(desc))
+                return Result::SUCCESS;
+
+            const AlphaTextureSet textures(desc);
+
+            // Approximate the workload size. 
+            // The workload metric is the accumulated count of the number of texels in total that needs to be processed.
+            // So where is the cutoff point? Hard to say. But if the workload 
+            uint64_t workloadSize = 0;
+
+            for (const OmmWorkItem& workItem : vmWorkItems)
+            {
+                workloadSize += GetWorkloadSize(textures, workItem.uvTri);
+            }
+
+            if (workloadSize > kMaxWorkloadSize)
+            {
+                return Result::WORKLOAD_TOO_BIG;
+            }
+
+            return Result::SUCCESS;
+        }
+
+        // Mips the runtime sampler may read within its LOD range, inclusive.
+        static void GetSampledMips(const TextureImpl* texture, const SamplerDesc& sampler, uint32_t& outMipBegin, uint32_t& outMipEnd)
+        {
+            const float maxMip = float(texture->GetMipCount() - 1);
+            outMipBegin = (uint32_t)std::floor(std::clamp(sampler.minLod, 0.f, maxMip));
+            outMipEnd = (uint32_t)std::ceil(std::clamp(sampler.maxLod, 0.f, maxMip));
+        }
+
+        // Region an anisotropic sampler may read at the given mip for lookups inside t: t grown by the footprint radius.
+        // Either the edges are offset, or for slivers whose offset triangle explodes, a triangle around the grown
+        // bounding box is used, whichever is smaller.
+        static Triangle GetSampledTriangle(const Triangle& t, const TextureImpl* texture, const SamplerDesc& sampler, uint32_t mip)
+        {
+            if (sampler.maxAnisotropy <= 1)
+                return t;
+
+            // In units of the footprint radius.
+            const float2 radius = 0.5f * float(sampler.maxAnisotropy) * texture->GetRcpSize(mip);
+            const double2 p[3] = { double2(t.p0 / radius), double2(t.p1 / radius), double2(t.p2 / radius) };
+
+            // The grown bounding box is enclosed by the right triangle with twice its extents.
+            const double2 boxMin = glm::min(glm::min(p[0], p[1]), p[2]) - 1.0;
+            const double2 boxSize = glm::max(glm::max(p[0], p[1]), p[2]) + 1.0 - boxMin;
+
+            // Offsetting the edges by 1 scales the triangle about its incenter by (inradius + 1) / inradius.
+            const double a = glm::length(p[1] - p[2]);
+            const double b = glm::length(p[2] - p[0]);
+            const double c = glm::length(p[0] - p[1]);
+            const double perimeter = a + b + c;
+            const double area = 0.5 * std::abs((p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y));
+            const double inradius = perimeter > 0.0 ? 2.0 * area / perimeter : 0.0;
+            if (inradius > 0.0)
+            {
+                const double scale = (inradius + 1.0) / inradius;
+                if (area * scale * scale < 2.0 * boxSize.x * boxSize.y)
+                {
+                    const double2 incenter = (a * p[0] + b * p[1] + c * p[2]) / perimeter;
+                    auto Offset = [&](const double2& v) { return float2(incenter + scale * (v - incenter)) * radius; };
+                    return Triangle(Offset(p[0]), Offset(p[1]), Offset(p[2]));
+                }
+            }
+            return Triangle(float2(boxMin) * radius, float2(boxMin.x + 2.0 * boxSize.x, boxMin.y) * radius, float2(boxMin.x, boxMin.y + 2.0 * boxSize.y) * radius);
+        }
+
+        template<TilingMode eTilingMode, TextureAddressMode eTextureAddressMode, TextureFilterMode eFilterMode>
+        static Result Resample(const BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        {
+            if (options.enableAABBTesting && !options.disableLevelLineIntersection)
+                return Result::INVALID_ARGUMENT;
+
+            const AlphaTextureSet textures(desc);
+            const SamplerDesc& sampler = desc.runtimeSamplerDesc;
+
+            // UV regions without a UDIM tile read the border alpha.
+            auto AddMissingTileCoverage = [&sampler](OmmCoverage& vmCoverage, float alphaCutoff) {
+                if (alphaCutoff < sampler.borderAlpha)
+                    vmCoverage.opaque++;
+                else
+                    vmCoverage.trans++;
+            };
+
+            // The exact-duplicate digest is only needed when DeduplicateExact runs.
+            const bool computeDigest = !options.disableDuplicateDetection && !options.disableFusedResampleDigest;
+
+            // 3. Process the queue of unique triangles...
+            {
+                const int32_t numWorkItems = (int32_t)vmWorkItems.size();
+
+                // 3.1 Rasterize...
+                {
+                    #pragma omp parallel for if(options.enableInternalThreads)
                     for (int32_t workItemIt = 0; workItemIt < numWorkItems; ++workItemIt) {
 
                         // 3.2 figure out the sub-states via rasterization...
                         {
                             // Subdivide the input triangle in to smaller triangles. They will be "bird-curve" ordered.
                             OmmWorkItem& workItem = vmWorkItems[workItemIt];
+                            workItem.vmStates.FirstTouch();
 
                             const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItem.subdivisionLevel);
 
+                            OmmStateDigest stateDigest(workItem.vmStates, computeDigest);
+
                             // Perform rasterization of each individual VM.
                             if (eFilterMode == TextureFilterMode::Linear)
                             {
@@ -557,89 +1250,135 @@ namespace Cpu
                                     if (!options.disableLevelLineIntersection) 
                                     {
                                         OmmCoverage vmCoverage = { 0, };
-                                        for (uint32_t mipIt = 0; mipIt < texture->GetMipCount(); ++mipIt)
-                                        {
-                                            // Linear interpolation requires a conservative raster and checking all four interpolants.
-                                            // The size of the raster grid must (at least) match the input alpha texture size
-                                            // this way we get a single pixel kernel execution per alpha texture texel.
-                                            const int2 rasterSize = texture->GetSize(mipIt);
+                                        textures.ForEachTexture(subTri, [&](const TextureImpl* texture, const Triangle& tileTri) {
+                                            if (texture == nullptr)
+                                            {
+                                                AddMissingTileCoverage(vmCoverage, workItem.alphaCutoff);
+                                                return true;
+                                            }
 
+                                            uint32_t mipBegin = 0;
+                                            uint32_t mipEnd = 0;
+                                            GetSampledMips(texture, sampler, mipBegin, mipEnd);
 
-                                            LevelLineIntersectionKernel::Params params = { &vmCoverage,  &subTri, texture->GetRcpSize(mipIt), rasterSize, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mipIt };
+                                            for (uint32_t mipIt = mipBegin; mipIt <= mipEnd; ++mipIt)
+                                            {
+                                                const Triangle sampledTri = GetSampledTriangle(tileTri, texture, sampler, mipIt);
 
-                                            // This offset (in pixel units) will be applied to the triangle,
-                                            // the effect is that the raster grid is being mapped such that bilinear interpolation region defined by
-                                            // the interior of 4 alpha interpolants is being mapped to match raster grid.
-                                            // This is only correct for bilinear version, nearest sampling should map exactly to the source alpha texture.
-                                            float2 pixelOffset = -float2(0.5, 0.5);
+                                                // Linear interpolation requires a conservative raster and checking all four interpolants.
+                                                // The size of the raster grid must (at least) match the input alpha texture size
+                                                // this way we get a single pixel kernel execution per alpha texture texel.
+                                                const int2 rasterSize = texture->GetSize(mipIt);
 
-                                            if (desc.alphaCutoff < texture->Bilinear(eTextureAddressMode, subTri.p0, mipIt))
-                                                vmCoverage.opaque++;
-                                            else
-                                                vmCoverage.trans++;
 
-                                            auto kernel = &LevelLineIntersectionKernel::run<eTextureAddressMode, eTilingMode>;
-                                            RasterizeConservativeSerialWithOffsetCoverage(subTri, rasterSize, pixelOffset, kernel, &params);
+                                                LevelLineIntersectionKernel::Params params = { &vmCoverage,  &sampledTri, texture->GetRcpSize(mipIt), rasterSize, texture, workItem.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mipIt };
 
-                                            OMM_ASSERT(vmCoverage.opaque != 0 || vmCoverage.trans != 0);
-                                            const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
+                                                // This offset (in pixel units) will be applied to the triangle,
+                                                // the effect is that the raster grid is being mapped such that bilinear interpolation region defined by
+                                                // the interior of 4 alpha interpolants is being mapped to match raster grid.
+                                                // This is only correct for bilinear version, nearest sampling should map exactly to the source alpha texture.
+                                                float2 pixelOffset = -float2(0.5, 0.5);
 
-                                            if (IsUnknown(state))
-                                                break;
-                                        }
+                                                if (workItem.alphaCutoff < texture->Bilinear(eTextureAddressMode, sampledTri.p0, mipIt, desc.runtimeSamplerDesc.borderAlpha))
+                                                    vmCoverage.opaque++;
+                                                else
+                                                    vmCoverage.trans++;
+
+                                                auto kernel = &LevelLineIntersectionKernel::run<eTextureAddressMode, eTilingMode>;
+                                                RasterizeConservativeSerialWithOffsetCoverage(sampledTri, rasterSize, pixelOffset, kernel, &params);
+
+                                                OMM_ASSERT(vmCoverage.opaque != 0 || vmCoverage.trans != 0);
+                                                const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
+
+                                                if (IsUnknown(state))
+                                                    return false;
+                                            }
+                                            return true;
+                                        });
                                         const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
                                         workItem.vmStates.SetState(uTriIt, state);
+                                        stateDigest.Update(uTriIt + 1);
                                     }
                                     else if (options.enableAABBTesting)
                                     {
-                                        // This offset (in pixel units) will be applied to the triangle,
-                                        // the effect is that the raster grid is being mapped such that bilinear interpolation region defined by
-                                        // the interior of 4 alpha interpolants is being mapped to match raster grid.
-                                        // This is only correct for bilinear version, nearest sampling should map exactly to the source alpha texture.
+                                        OmmCoverage vmCoverage = { 0, };
+                                        textures.ForEachTexture(subTri, [&](const TextureImpl* texture, const Triangle& tileTri) {
+                                            if (texture == nullptr)
+                                            {
+                                                AddMissingTileCoverage(vmCoverage, workItem.alphaCutoff);
+                                                return true;
+                                            }
 
-                                        uint32_t mip = 0;
-                                        OMM_ASSERT(texture->GetMipCount() == 0);
-                                        const int2 rasterSize = texture->GetSize(mip);
-                                        float2 pixelOffset = -float2(0.5, 0.5);
+                                            // This offset (in pixel units) will be applied to the triangle,
+                                            // the effect is that the raster grid is being mapped such that bilinear interpolation region defined by
+                                            // the interior of 4 alpha interpolants is being mapped to match raster grid.
+                                            // This is only correct for bilinear version, nearest sampling should map exactly to the source alpha texture.
 
-                                        OmmCoverage vmCoverage = { 0, };
-                                        ConservativeBilinearKernel::Params params = { &vmCoverage,  texture->GetRcpSize(mip), rasterSize, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mip };
+                                            uint32_t mipBegin = 0;
+                                            uint32_t mipEnd = 0;
+                                            GetSampledMips(texture, sampler, mipBegin, mipEnd);
+
+                                            const uint32_t mip = mipBegin;
+                                            OMM_ASSERT(mipBegin == mipEnd); // Only a single mip is resampled.
+                                            const int2 rasterSize = texture->GetSize(mip);
+                                            const Triangle sampledTri = GetSampledTriangle(tileTri, texture, sampler, mip);
+                                            float2 pixelOffset = -float2(0.5, 0.5);
+
+                                            ConservativeBilinearKernel::Params params = { &vmCoverage,  texture->GetRcpSize(mip), rasterSize, texture, workItem.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mip };
 
-                                        Triangle subTri0 = Triangle(subTri.aabb_s, float2(subTri.aabb_e.x, subTri.aabb_s.y), float2(subTri.aabb_s.x, subTri.aabb_e.y));
-                                        Triangle subTri1 = Triangle(subTri.aabb_e, float2(subTri.aabb_e.x, subTri.aabb_s.y), float2(subTri.aabb_s.x, subTri.aabb_e.y));
-                                        auto kernel = &ConservativeBilinearKernel::run<eTextureAddressMode, eTilingMode>;
-                                        RasterizeConservativeSerialWithOffsetCoverage(subTri0, rasterSize, pixelOffset, kernel, &params);
-                                        RasterizeConservativeSerialWithOffsetCoverage(subTri1, rasterSize, pixelOffset, kernel, &params);
+                                            Triangle subTri0 = Triangle(sampledTri.aabb_s, float2(sampledTri.aabb_e.x, sampledTri.aabb_s.y), float2(sampledTri.aabb_s.x, sampledTri.aabb_e.y));
+                                            Triangle subTri1 = Triangle(sampledTri.aabb_e, float2(sampledTri.aabb_e.x, sampledTri.aabb_s.y), float2(sampledTri.aabb_s.x, sampledTri.aabb_e.y));
+                                            auto kernel = &ConservativeBilinearKernel::run<eTextureAddressMode, eTilingMode>;
+                                            RasterizeConservativeSerialWithOffsetCoverage(subTri0, rasterSize, pixelOffset, kernel, &params);
+                                            RasterizeConservativeSerialWithOffsetCoverage(subTri1, rasterSize, pixelOffset, kernel, &params);
+                                            return true;
+                                        });
 
                                         OMM_ASSERT(vmCoverage.opaque != 0 || vmCoverage.trans != 0);
 
                                         const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
                                         workItem.vmStates.SetState(uTriIt, state);
+                                        stateDigest.Update(uTriIt + 1);
                                     }
                                     else
                                     {
-                                        // This offset (in pixel units) will be applied to the triangle,
-                                        // the effect is that the raster grid is being mapped such that bilinear interpolation region defined by
-                                        // the interior of 4 alpha interpolants is being mapped to match raster grid.
-                                        // This is only correct for bilinear version, nearest sampling should map exactly to the source alpha texture.
+                                        OmmCoverage vmCoverage = { 0, };
+                                        textures.ForEachTexture(subTri, [&](const TextureImpl* texture, const Triangle& tileTri) {
+                                            if (texture == nullptr)
+                                            {
+                                                AddMissingTileCoverage(vmCoverage, workItem.alphaCutoff);
+                                                return true;
+                                            }
+
+                                            // This offset (in pixel units) will be applied to the triangle,
+                                            // the effect is that the raster grid is being mapped such that bilinear interpolation region defined by
+                                            // the interior of 4 alpha interpolants is being mapped to match raster grid.
+                                            // This is only correct for bilinear version, nearest sampling should map exactly to the source alpha texture.
 
-                                        uint32_t mip = 0;
-                                        OMM_ASSERT(texture->GetMipCount() == 0);
-                                        const int2 rasterSize = texture->GetSize(mip);
+                                            uint32_t mipBegin = 0;
+                                            uint32_t mipEnd = 0;
+                                            GetSampledMips(texture, sampler, mipBegin, mipEnd);
 
-                                        float2 pixelOffset = -float2(0.5, 0.5);
+                                            const uint32_t mip = mipBegin;
+                                            OMM_ASSERT(mipBegin == mipEnd); // Only a single mip is resampled.
+                                            const int2 rasterSize = texture->GetSize(mip);
+                                            const Triangle sampledTri = GetSampledTriangle(tileTri, texture, sampler, mip);
 
-                                        OmmCoverage vmCoverage = { 0, };
-                                        ConservativeBilinearKernel::Params params = { &vmCoverage,  texture->GetRcpSize(mip), rasterSize, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mip };
+                                            float2 pixelOffset = -float2(0.5, 0.5);
+
+                                            ConservativeBilinearKernel::Params params = { &vmCoverage,  texture->GetRcpSize(mip), rasterSize, texture, workItem.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mip };
 
-                                        auto kernel = &ConservativeBilinearKernel::run<eTextureAddressMode, eTilingMode>;
-                                        RasterizeConservativeSerialWithOffsetCoverage(subTri, rasterSize, pixelOffset, kernel, &params);
+                                            auto kernel = &ConservativeBilinearKernel::run<eTextureAddressMode, eTilingMode>;
+                                            RasterizeConservativeSerialWithOffsetCoverage(sampledTri, rasterSize, pixelOffset, kernel, &params);
+                                            return true;
+                                        });
 
                                         OMM_ASSERT(vmCoverage.opaque != 0 || vmCoverage.trans != 0);
 
                                         const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
 
                                         workItem.vmStates.SetState(uTriIt, state);
+                                        stateDigest.Update(uTriIt + 1);
                                     }
                                 }
                             }
@@ -658,51 +1397,217 @@ namespace Cpu
 
                                 for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
                                 {
+                                    const Triangle subTri = omm::bird::GetMicroTriangle(workItem.uvTri, uTriIt, workItem.subdivisionLevel);
+
                                     OmmCoverage vmCoverage = { 0, };
-                                    for (uint32_t mipIt = 0; mipIt < texture->GetMipCount(); ++mipIt)
-                                    {
-                                        const int2 rasterSize = texture->GetSize(mipIt);
-                                        KernelParams params = { nullptr, texture->GetRcpSize(mipIt), rasterSize, desc.runtimeSamplerDesc, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mipIt };
+                                    textures.ForEachTexture(subTri, [&](const TextureImpl* texture, const Triangle& tileTri) {
+                                        if (texture == nullptr)
+                                        {
+                                            AddMissingTileCoverage(vmCoverage, workItem.alphaCutoff);
+                                            return true;
+                                        }
 
-                                        params.vmState = &vmCoverage;
+                                        uint32_t mipBegin = 0;
+                                        uint32_t mipEnd = 0;
+                                        GetSampledMips(texture, sampler, mipBegin, mipEnd);
 
-                                        auto kernel = [](int2 pixel, float3* bc, void* ctx)
+                                        for (uint32_t mipIt = mipBegin; mipIt <= mipEnd; ++mipIt)
                                         {
-                                            KernelParams* p = (KernelParams*)ctx;
+                                            const int2 rasterSize = texture->GetSize(mipIt);
+                                            KernelParams params = { nullptr, texture->GetRcpSize(mipIt), rasterSize, desc.runtimeSamplerDesc, texture, workItem.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mipIt };
 
-                                            const int2 coord = omm::GetTexCoord<eTextureAddressMode>(pixel, p->size);
+                                            params.vmState = &vmCoverage;
 
-                                            const bool isBorder = eTextureAddressMode == TextureAddressMode::Border && (coord.x == kTexCoordBorder || coord.y == kTexCoordBorder);
-                                            const float alpha = isBorder ? p->borderAlpha : p->texture->template Load<eTilingMode>(coord, p->mipIt);
+                                            auto kernel = [](int2 pixel, float3* bc, void* ctx)
+                                            {
+                                                KernelParams* p = (KernelParams*)ctx;
 
-                                            if (p->alphaCutoff < alpha) {
-                                                p->vmState->opaque++;
-                                            }
-                                            else {
-                                                p->vmState->trans++;
-                                            }
-                                        };
+                                                const int2 coord = omm::GetTexCoord<eTextureAddressMode>(pixel, p->size);
 
-                                        const Triangle subTri = omm::bird::GetMicroTriangle(workItem.uvTri, uTriIt, workItem.subdivisionLevel);
+                                                const bool isBorder = eTextureAddressMode == TextureAddressMode::Border && (coord.x == kTexCoordBorder || coord.y == kTexCoordBorder);
+                                                const float alpha = isBorder ? p->borderAlpha : p->texture->template Load<eTilingMode>(coord, p->mipIt);
 
-                                        RasterizeConservativeSerial(subTri, rasterSize, kernel, &params);
-                                        OMM_ASSERT(vmCoverage.opaque != 0 || vmCoverage.trans != 0);
+                                                if (p->alphaCutoff < alpha) {
+                                                    p->vmState->opaque++;
+                                                }
+                                                else {
+                                                    p->vmState->trans++;
+                                                }
+                                            };
 
-                                        const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
-                                        if (IsUnknown(state))
-                                            break;
-                                    }
+                                            const Triangle sampledTri = GetSampledTriangle(tileTri, texture, sampler, mipIt);
+
+                                            RasterizeConservativeSerial(sampledTri, rasterSize, kernel, &params);
+                                            OMM_ASSERT(vmCoverage.opaque != 0 || vmCoverage.trans != 0);
+
+                                            const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
+                                            if (IsUnknown(state))
+                                                return false;
+                                        }
+                                        return true;
+                                    });
                                     const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
                                     workItem.vmStates.SetState(uTriIt, state);
+                                    stateDigest.Update(uTriIt + 1);
                                 }
                             }
+
+                            stateDigest.Finalize(workItem);
+                        }
+                    }
+                }
+            }
+            return Result::SUCCESS;
+        }
+
+        // Accumulates the coverage of a micro-triangle by recursive interval refinement: the triangle is classified
+        // from the alpha bounds, and split in four while the bounds straddle the cutoff.
+        // Coverage is weighted by area, 4 units per leaf at maxDepth so ambiguous leaves can be split unevenly.
+        static void RefineProceduralCoverage(const BakeInputDesc& desc, float alphaCutoff, bool needsCoverageRatio, const Triangle& t, uint32_t depth, OmmCoverage& coverage)
+        {
+            const ProceduralAlphaDesc& procedural = desc.proceduralAlpha;
+
+            // Once both states are present the micro-triangle is unknown, only Nearest promotion cares about the ratio.
+            if (!needsCoverageRatio && coverage.opaque != 0 && coverage.trans != 0)
+                return;
+
+            const float uv[6] = { t.p0.x, t.p0.y, t.p1.x, t.p1.y, t.p2.x, t.p2.y };
+            float alphaMin = 0.f;
+            float alphaMax = 1.f;
+            procedural.EvaluateBounds(procedural.userArg, uv, &alphaMin, &alphaMax);
+            OMM_ASSERT(alphaMin <= alphaMax);
+
+            const uint32_t weight = 4u << (2 * (procedural.maxRefinementDepth - depth));
+
+            if (alphaCutoff < alphaMin)
+            {
+                coverage.opaque += weight;
+            }
+            else if (alphaMax <= alphaCutoff)
+            {
+                coverage.trans += weight;
+            }
+            else if (depth == procedural.maxRefinementDepth)
+            {
+                // Both states may be present, make sure the micro-triangle ends up unknown.
+                if (procedural.EvaluatePoint)
+                {
+                    const float2 center = (t.p0 + t.p1 + t.p2) / 3.f;
+                    const bool isOpaque = alphaCutoff < procedural.EvaluatePoint(procedural.userArg, center.x, center.y);
+                    coverage.opaque += isOpaque ? 3 : 1;
+                    coverage.trans += isOpaque ? 1 : 3;
+                }
+                else
+                {
+                    coverage.opaque += 2;
+                    coverage.trans += 2;
+                }
+            }
+            else
+            {
+                const float2 m01 = 0.5f * (t.p0 + t.p1);
+                const float2 m12 = 0.5f * (t.p1 + t.p2);
+                const float2 m20 = 0.5f * (t.p2 + t.p0);
+                RefineProceduralCoverage(desc, alphaCutoff, needsCoverageRatio, Triangle(t.p0, m01, m20), depth + 1, coverage);
+                RefineProceduralCoverage(desc, alphaCutoff, needsCoverageRatio, Triangle(m01, t.p1, m12), depth + 1, coverage);
+                RefineProceduralCoverage(desc, alphaCutoff, needsCoverageRatio, Triangle(m20, m12, t.p2), depth + 1, coverage);
+                RefineProceduralCoverage(desc, alphaCutoff, needsCoverageRatio, Triangle(m12, m20, m01), depth + 1, coverage);
+            }
+        }
+
+        static Result ResampleProcedural(const BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        {
+            const bool computeDigest = !options.disableDuplicateDetection && !options.disableFusedResampleDigest;
+            const bool needsCoverageRatio = desc.unknownStatePromotion == UnknownStatePromotion::Nearest;
+
+            const int32_t numWorkItems = (int32_t)vmWorkItems.size();
+
+            #pragma omp parallel for if(options.enableInternalThreads)
+            for (int32_t workItemIt = 0; workItemIt < numWorkItems; ++workItemIt)
+            {
+                OmmWorkItem& workItem = vmWorkItems[workItemIt];
+                workItem.vmStates.FirstTouch();
+
+                const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItem.subdivisionLevel);
+
+                OmmStateDigest stateDigest(workItem.vmStates, computeDigest);
+
+                for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
+                {
+                    const Triangle subTri = omm::bird::GetMicroTriangle(workItem.uvTri, uTriIt, workItem.subdivisionLevel);
+
+                    OmmCoverage vmCoverage = { 0, };
+                    RefineProceduralCoverage(desc, workItem.alphaCutoff, needsCoverageRatio, subTri, 0 /*depth*/, vmCoverage);
+
+                    const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
+                    workItem.vmStates.SetState(uTriIt, state);
+                    stateDigest.Update(uTriIt + 1);
+                }
+
+                stateDigest.Finalize(workItem);
+            }
+            return Result::SUCCESS;
+        }
+
+        static Result ResamplePolygonMask(StdAllocator<uint8_t>& allocator, const BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        {
+            PolygonMaskImpl polygonMask(allocator);
+            RETURN_STATUS_IF_FAILED(polygonMask.Create(desc.polygonMask));
+
+            const bool computeDigest = !options.disableDuplicateDetection && !options.disableFusedResampleDigest;
+
+            const int32_t numWorkItems = (int32_t)vmWorkItems.size();
+
+            #pragma omp parallel for if(options.enableInternalThreads)
+            for (int32_t workItemIt = 0; workItemIt < numWorkItems; ++workItemIt)
+            {
+                OmmWorkItem& workItem = vmWorkItems[workItemIt];
+                workItem.vmStates.FirstTouch();
+
+                const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItem.subdivisionLevel);
+
+                OmmStateDigest stateDigest(workItem.vmStates, computeDigest);
+
+                for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
+                {
+                    const Triangle subTri = omm::bird::GetMicroTriangle(workItem.uvTri, uTriIt, workItem.subdivisionLevel);
+                    const float2 center = (subTri.p0 + subTri.p1 + subTri.p2) / 3.f;
+
+                    // Without an edge crossing the micro-triangle the fill is constant, the center decides.
+                    // Otherwise the corners and center vote for the unknown state promotion.
+                    OmmCoverage vmCoverage = { 0, };
+                    if (!polygonMask.IntersectsBoundary(subTri))
+                    {
+                        if (polygonMask.IsInside(center))
+                            vmCoverage.opaque++;
+                        else
+                            vmCoverage.trans++;
+                    }
+                    else
+                    {
+                        vmCoverage = { 1, 1 };
+                        for (const float2& p : { subTri.p0, subTri.p1, subTri.p2, center })
+                        {
+                            if (polygonMask.IsInside(p))
+                                vmCoverage.opaque++;
+                            else
+                                vmCoverage.trans++;
                         }
                     }
+
+                    const OpacityState state = GetStateFromCoverage(desc.ommFormat, desc.unknownStatePromotion, vmCoverage);
+                    workItem.vmStates.SetState(uTriIt, state);
+                    stateDigest.Update(uTriIt + 1);
                 }
+
+                stateDigest.Finalize(workItem);
             }
             return Result::SUCCESS;
         }
 
+        // If two OMMs differ in less than this fraction of micro-triangles (treating all unknowns as equal) they are combined.
+        static constexpr float kNearDuplicateMergeThreshold = 0.1f;
+
         static Result DeduplicateExact(StdAllocator<uint8_t>& allocator, const Options& options, vector<OmmWorkItem>& vmWorkItems)
         {
             if (options.disableDuplicateDetection)
@@ -711,7 +1616,9 @@ namespace Cpu
             uint32_t dupesFound = 0;
 
             auto CalcDigest = [&allocator](const OmmWorkItem& workItem) {
-                return XXH64((const void*)workItem.vmStates.GetOmm3StateData(), workItem.vmStates.GetOmm3StateDataSize(), 42/*seed*/);
+                if (workItem.hasVmStatesDigest)
+                    return workItem.vmStatesDigest;
+                return XXH64((const void*)workItem.vmStates.GetOmm3StateData(), workItem.vmStates.GetOmm3StateDataSize(), kOmmStateDigestSeed);
             };
 
             hash_map<uint64_t, uint32_t> digestToWorkItemIndex(allocator.GetInterface());
@@ -740,6 +1647,19 @@ namespace Cpu
             return Result::SUCCESS;
         }
 
+        // Stops counting once maxDist is reached.
+        static uint32_t HammingDistance3State(const OmmWorkItem& workItemA, const OmmWorkItem& workItemB, uint32_t maxDist)
+        {
+            OMM_ASSERT(workItemA.subdivisionLevel == workItemB.subdivisionLevel);
+            const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItemA.subdivisionLevel);
+            uint32_t numDiff = 0;
+            for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles && numDiff < maxDist; ++uTriIt) {
+                if (workItemA.vmStates.Get3State(uTriIt) != workItemB.vmStates.Get3State(uTriIt))
+                    numDiff++;
+            }
+            return numDiff;
+        }
+
         static float HammingDistance3State(const OmmWorkItem& workItemA, const OmmWorkItem& workItemB)
         {
             OMM_ASSERT(workItemA.subdivisionLevel == workItemB.subdivisionLevel);
@@ -777,6 +1697,7 @@ namespace Cpu
             from.vmSpecialIndex = -1;
 
             // Merge states from A -> B.
+            to.hasVmStatesDigest = false;
             uint32_t numMatches = 0;
             const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(from.subdivisionLevel);
 
@@ -806,9 +1727,12 @@ namespace Cpu
             return Result::SUCCESS;
         }
 
-        static Result DeduplicateSimilarLSH(StdAllocator<uint8_t>& allocator, const Options& options, vector<OmmWorkItem>& vmWorkItems, uint32_t iterations)
+        static Result DeduplicateSimilarLSH(StdAllocator<uint8_t>& allocator, const Cpu::BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems, uint32_t iterations)
         {
-            if (!options.enableNearDuplicateDetection || options.enableNearDuplicateDetectionBruteForce)
+            if (!options.enableNearDuplicateDetection || options.enableNearDuplicateDetectionBruteForce || options.enableNearDuplicateDetectionMultiIndex)
+                return Result::SUCCESS;
+
+            if (UsesNearDuplicateErrorBudget(desc))
                 return Result::SUCCESS;
 
             // LHS (locality sensitive hashing) implemented via hamming bit sampling 
@@ -1024,27 +1948,528 @@ namespace Cpu
             return Result::SUCCESS;
         }
 
-        static Result DeduplicateSimilarBruteForce(StdAllocator<uint8_t>& allocator, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        // Radius search with multi-index hashing over the 4-state OMMs of one subdivision level.
+        // ref: https://www.cs.toronto.edu/~norouzi/research/papers/multi_index_hashing.pdf
+        // The 3-state vectors are split in m disjoint substrings. Two OMMs within distance R of each other, R being the
+        // largest distance that still merges, are within floor(R / m) of each other on at least one substring. A query
+        // probes every variant of its substrings within that distance, the OMMs stored under a probed key are the
+        // candidates, verified with the full distance. As in the paper m is ~bits / log2(n), so a bucket holds few
+        // unrelated OMMs. Keys are Zobrist hashes of the substrings, a probe flipping one state is a single xor.
+        // The search is bounded rather than exact:
+        // - The table never exceeds kMaxTableSizeInBytes. Batches needing more are searched in consecutive chunks, pairs
+        //   across chunks are not found.
+        // - A query verifies at most kMaxCandidatesPerQuery candidates, e.g. OMMs in a run of near uniform ones.
+        class MultiIndexTable
         {
-            if (!options.enableNearDuplicateDetection || !options.enableNearDuplicateDetectionBruteForce)
-               return Result::SUCCESS;
-
-            if (vmWorkItems.size() == 0)
-                return Result::SUCCESS;
+        public:
+            static constexpr size_t kMaxTableSizeInBytes = size_t(64) << 20;
+            static constexpr uint32_t kMaxCandidatesPerQuery = 64;
+            // Probes of a query cost at most about as much as one verification (numMicroTriangles), but no less than this.
+            static constexpr uint64_t kMinProbeBudget = 4096;
+            static constexpr uint32_t kNoNeighbour = std::numeric_limits<uint32_t>::max();
+
+            // (distance, batch position)
+            using Neighbour = std::pair<uint32_t, uint32_t>;
+
+            MultiIndexTable(StdAllocator<uint8_t>& allocator)
+                : _allocator(allocator)
+                , _entries(allocator)
+                , _visited(allocator)
+            { }
+
+            // Picks the substring split for n OMMs of subdivisionLevel. False if the level can't be searched, i.e. even
+            // a chunk of two OMMs doesn't fit in the table.
+            bool Init(uint32_t subdivisionLevel, uint32_t n)
+            {
+                _numMicroTriangles = omm::bird::GetNumMicroTriangles(subdivisionLevel);
+                _n = n;
+
+                // Largest distance passing the same test as the brute force search.
+                _radius = uint32_t(kNearDuplicateMergeThreshold * _numMicroTriangles);
+                while (_radius > 0 && !IsMergeDistance(_radius))
+                    --_radius;
+                while (IsMergeDistance(_radius + 1))
+                    ++_radius;
+
+                const double bits = _numMicroTriangles * std::log2(3.0);
+                const size_t maxEntries = kMaxTableSizeInBytes / sizeof(Entry);
+                const uint64_t probeBudget = std::max<uint64_t>(_numMicroTriangles, kMinProbeBudget);
+                for (uint32_t chunkSize = n; chunkSize >= 2; chunkSize = (chunkSize + 1) / 2)
+                {
+                    const uint32_t maxSubstringCount = (uint32_t)std::min<size_t>(_radius + 1, maxEntries / chunkSize);
+                    if (maxSubstringCount == 0)
+                        continue;
 
-            // The purpose of this pass is to identify "similar" OMMs, and then merge those.
-            // Unfortunatley the search is O(n^2) - Is this a problem? Yes. 
-            // Possible solutions:
-            // - If set is too large - don't do an exhaustive search, just sample. (Current solution).
-            // - Look in to LSH (locality senstive hashing) approaches.
+                    uint32_t substringCount = (uint32_t)std::ceil(bits / std::log2((double)chunkSize));
+                    substringCount = std::clamp(substringCount, 1u, maxSubstringCount);
+                    while (true)
+                    {
+                        if (GetProbeCount(substringCount, probeBudget) <= probeBudget)
+                        {
+                            _chunkSize = chunkSize;
+                            _substringCount = substringCount;
+                            _substringRadius = _radius / substringCount;
+                            return true;
+                        }
+                        if (substringCount == maxSubstringCount)
+                            break;
+                        substringCount = std::min(2 * substringCount, maxSubstringCount);
+                    }
 
-            static constexpr float kMergeThreshold = 0.1f; // If two OMMs differ less than kMergeThreshold % (treating all unknowns as equal) -> then we combine them.
-            static constexpr uint32_t kMaxComparsions = 2048; // Covert the O(n^2) nature of the algorithm to a -> O(kN) version...
+                }
+                return false;
+            }
 
-            set<uint32_t> mergedWorkItems(allocator);
-            for (uint32_t itA = 0; itA < vmWorkItems.size() - 1; ++itA)
+            // Upper bound of the table size for n OMMs of subdivisionLevel.
+            static size_t GetMaxTableSize(uint32_t subdivisionLevel, uint32_t n)
             {
-                OmmWorkItem& workItemA = vmWorkItems[itA];
+                const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(subdivisionLevel);
+                const size_t maxSubstringCount = size_t(kNearDuplicateMergeThreshold * numMicroTriangles) + 1;
+                return std::min<size_t>((size_t)n * maxSubstringCount * sizeof(Entry), kMaxTableSizeInBytes);
+            }
+
+            // Largest 3-state distance that passes the merge threshold.
+            uint32_t GetRadius() const { return _radius; }
+
+            uint32_t GetChunkCount() const { return (_n + _chunkSize - 1) / _chunkSize; }
+            uint32_t GetChunkBegin(uint32_t chunkIt) const { return chunkIt * _chunkSize; }
+            uint32_t GetChunkEnd(uint32_t chunkIt) const { return std::min(GetChunkBegin(chunkIt + 1), _n); }
+
+            // Indexes the batch positions of a chunk, replacing the previous one. Queries only find OMMs of this chunk.
+            void Build(const vector<OmmWorkItem>& vmWorkItems, const vector<uint32_t>& batchWorkItems, uint32_t chunkIt, bool enableThreads)
+            {
+                _chunkBegin = GetChunkBegin(chunkIt);
+                _chunkEnd = GetChunkEnd(chunkIt);
+                const uint32_t chunkLength = _chunkEnd - _chunkBegin;
+                _entries.resize((size_t)chunkLength * _substringCount);
+
+                #pragma omp parallel for if(enableThreads)
+                for (int32_t i = 0; i < (int32_t)chunkLength; ++i)
+                {
+                    const uint32_t pos = _chunkBegin + (uint32_t)i;
+                    const OmmWorkItem& workItem = vmWorkItems[batchWorkItems[pos]];
+                    for (uint32_t substringIt = 0; substringIt < _substringCount; ++substringIt)
+                        _entries[(size_t)i * _substringCount + substringIt] = std::make_pair(GetSubstringKey(workItem, substringIt), pos);
+                }
+
+                std::sort(_entries.begin(), _entries.end());
+                _visited.assign(chunkLength, kNoNeighbour);
+            }
+
+            // Up to maxNeighbours OMMs after pos in the chunk within the radius, nearest first, ties by position. Only
+            // candidates passing filter(pos) are verified. Returns the number of neighbours written.
+            template<class TFilter>
+            uint32_t Query(const vector<OmmWorkItem>& vmWorkItems, const vector<uint32_t>& batchWorkItems, uint32_t pos, uint32_t maxNeighbours, TFilter filter, Neighbour* outNeighbours)
+            {
+                return Query(vmWorkItems, batchWorkItems, pos, maxNeighbours, filter, outNeighbours, _visited);
+            }
+
+            // Query for every position of the chunk, unfiltered. maxNeighbours slots per position, unused ones are
+            // { kNoNeighbour, kNoNeighbour }.
+            void QueryChunk(const vector<OmmWorkItem>& vmWorkItems, const vector<uint32_t>& batchWorkItems, uint32_t maxNeighbours, bool enableThreads, vector<Neighbour>& outNeighbours)
+            {
+                const uint32_t chunkLength = _chunkEnd - _chunkBegin;
+                outNeighbours.assign((size_t)chunkLength * maxNeighbours, std::make_pair(kNoNeighbour, kNoNeighbour));
+
+                #pragma omp parallel if(enableThreads)
+                {
+                    vector<uint32_t> visited(_allocator);
+                    visited.assign(chunkLength, kNoNeighbour);
+
+                    #pragma omp for
+                    for (int32_t i = 0; i < (int32_t)chunkLength; ++i)
+                    {
+                        Neighbour* neighbours = outNeighbours.data() + (size_t)i * maxNeighbours;
+                        Query(vmWorkItems, batchWorkItems, _chunkBegin + (uint32_t)i, maxNeighbours, [](uint32_t) { return true; }, neighbours, visited);
+                    }
+                }
+            }
+
+        private:
+            // (substring key, batch position)
+            using Entry = std::pair<uint64_t, uint32_t>;
+
+            template<class TFilter>
+            uint32_t Query(const vector<OmmWorkItem>& vmWorkItems, const vector<uint32_t>& batchWorkItems, uint32_t pos, uint32_t maxNeighbours, const TFilter& filter, Neighbour* outNeighbours, vector<uint32_t>& visited) const
+            {
+                OMM_ASSERT(pos >= _chunkBegin && pos < _chunkEnd && maxNeighbours != 0);
+                const OmmWorkItem& workItem = vmWorkItems[batchWorkItems[pos]];
+
+                uint32_t neighbourCount = 0;
+                uint32_t candidateCount = 0;
+                auto VisitBucket = [&](uint64_t key) {
+                    auto it = std::lower_bound(_entries.begin(), _entries.end(), std::make_pair(key, pos + 1));
+                    for (uint32_t scanned = 0; it != _entries.end() && it->first == key && scanned < kMaxCandidatesPerQuery; ++it, ++scanned)
+                    {
+                        const uint32_t candidatePos = it->second;
+                        if (visited[candidatePos - _chunkBegin] == pos)
+                            continue;
+                        visited[candidatePos - _chunkBegin] = pos;
+                        if (!filter(candidatePos))
+                            continue;
+
+                        const uint32_t maxDist = neighbourCount == maxNeighbours ? outNeighbours[maxNeighbours - 1].first : _radius;
+                        const uint32_t dist = HammingDistance3State(workItem, vmWorkItems[batchWorkItems[candidatePos]], maxDist + 1);
+                        const Neighbour neighbour = std::make_pair(dist, candidatePos);
+                        if (dist <= maxDist && (neighbourCount < maxNeighbours || neighbour < outNeighbours[maxNeighbours - 1]))
+                        {
+                            neighbourCount = std::min(neighbourCount + 1, maxNeighbours);
+                            Neighbour* insertAt = std::upper_bound(outNeighbours, outNeighbours + neighbourCount - 1, neighbour);
+                            std::move_backward(insertAt, outNeighbours + neighbourCount - 1, outNeighbours + neighbourCount);
+                            *insertAt = neighbour;
+                        }
+
+                        if (++candidateCount == kMaxCandidatesPerQuery)
+                            return false;
+                    }
+                    return true;
+                };
+
+                for (uint32_t substringIt = 0; substringIt < _substringCount; ++substringIt)
+                {
+                    const uint64_t key = GetSubstringKey(workItem, substringIt);
+                    if (!ForEachProbe(workItem, GetSubstringBegin(substringIt), GetSubstringBegin(substringIt + 1), key, _substringRadius, VisitBucket))
+                        break;
+                }
+                return neighbourCount;
+            }
+
+            // Calls fn(key) for every variant of the substring [begin, end) within radius, stops when fn returns false.
+            template<class TFn>
+            static bool ForEachProbe(const OmmWorkItem& workItem, uint32_t begin, uint32_t end, uint64_t key, uint32_t radius, TFn& fn)
+            {
+                if (!fn(key))
+                    return false;
+                if (radius == 0)
+                    return true;
+
+                for (uint32_t uTriIt = begin; uTriIt < end; ++uTriIt)
+                {
+                    const OpacityState state = workItem.vmStates.Get3State(uTriIt);
+                    for (OpacityState other : { OpacityState::Transparent, OpacityState::Opaque, OpacityState::UnknownOpaque })
+                    {
+                        if (other == state)
+                            continue;
+                        const uint64_t probe = key ^ GetStateKey(uTriIt, state) ^ GetStateKey(uTriIt, other);
+                        if (!ForEachProbe(workItem, uTriIt + 1, end, probe, radius - 1, fn))
+                            return false;
+                    }
+                }
+                return true;
+            }
+
+            // Probes per query with substringCount substrings, stops counting past limit.
+            uint64_t GetProbeCount(uint32_t substringCount, uint64_t limit) const
+            {
+                const uint32_t substringLength = (_numMicroTriangles + substringCount - 1) / substringCount;
+                const uint32_t substringRadius = std::min(_radius / substringCount, substringLength);
+                double variants = 0.0;
+                double combinations = 1.0; // substringLength choose k
+                for (uint32_t k = 0; k <= substringRadius; ++k)
+                {
+                    variants += combinations * double(1ull << std::min(k, 63u));
+                    if (variants * substringCount > (double)limit)
+                        return limit + 1;
+                    combinations = combinations * (substringLength - k) / (k + 1);
+                }
+                return uint64_t(variants * substringCount);
+            }
+
+            bool IsMergeDistance(uint32_t dist) const {
+                return float(dist) / _numMicroTriangles < kNearDuplicateMergeThreshold;
+            }
+
+            uint32_t GetSubstringBegin(uint32_t substringIt) const {
+                return uint32_t((uint64_t)substringIt * _numMicroTriangles / _substringCount);
+            }
+
+            static uint64_t GetStateKey(uint32_t uTriIt, OpacityState state) {
+                // splitmix64 finalizer
+                uint64_t x = (((uint64_t)uTriIt << 2) | (uint64_t)state) + 0x9e3779b97f4a7c15ull;
+                x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+                x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+                return x ^ (x >> 31);
+            }
+
+            uint64_t GetSubstringKey(const OmmWorkItem& workItem, uint32_t substringIt) const {
+                uint64_t key = 0;
+                for (uint32_t uTriIt = GetSubstringBegin(substringIt); uTriIt < GetSubstringBegin(substringIt + 1); ++uTriIt)
+                    key ^= GetStateKey(uTriIt, workItem.vmStates.Get3State(uTriIt));
+                return key;
+            }
+
+            StdAllocator<uint8_t> _allocator;
+            uint32_t _numMicroTriangles = 0;
+            uint32_t _n = 0;
+            uint32_t _radius = 0;
+            uint32_t _chunkSize = 1;
+            uint32_t _substringCount = 0;
+            uint32_t _substringRadius = 0;
+            uint32_t _chunkBegin = 0;
+            uint32_t _chunkEnd = 0;
+            vector<Entry> _entries;
+            vector<uint32_t> _visited;
+        };
+
+        // Gathers the unmerged 4-state OMMs of a subdivision level in index order.
+        static void GatherNearDuplicateCandidates(const vector<OmmWorkItem>& vmWorkItems, uint32_t subdivisionLevel, vector<uint32_t>& batchWorkItems)
+        {
+            batchWorkItems.clear();
+            for (uint32_t i = 0; i < vmWorkItems.size(); ++i)
+            {
+                const OmmWorkItem& workItem = vmWorkItems[i];
+                if (workItem.HasSpecialIndex() || workItem.vmFormat != OMMFormat::OC1_4_State || workItem.primitiveIndices.empty())
+                    continue;
+                if (workItem.subdivisionLevel != subdivisionLevel)
+                    continue;
+                batchWorkItems.push_back(i);
+            }
+        }
+
+        // Nearest successors kept per OMM by DeduplicateSimilarMultiIndex, a new query is only needed once all of them are merged.
+        static constexpr uint32_t kMaxNeighboursPerOmm = 4;
+
+        // Merges the same pairs as DeduplicateSimilarBruteForce, without its comparison window but within the bounds of
+        // MultiIndexTable.
+        static Result DeduplicateSimilarMultiIndex(StdAllocator<uint8_t>& allocator, const Cpu::BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        {
+            if (!options.enableNearDuplicateDetection || !options.enableNearDuplicateDetectionMultiIndex || options.enableNearDuplicateDetectionBruteForce)
+                return Result::SUCCESS;
+
+            if (UsesNearDuplicateErrorBudget(desc))
+                return Result::SUCCESS;
+
+            vector<uint32_t> batchWorkItems(allocator);
+            vector<uint8_t> isMerged(allocator);
+            vector<MultiIndexTable::Neighbour> neighbours(allocator);
+            MultiIndexTable table(allocator);
+
+            for (uint32_t subdivisionLevel = 0; subdivisionLevel <= kMaxSubdivLevel; ++subdivisionLevel)
+            {
+                GatherNearDuplicateCandidates(vmWorkItems, subdivisionLevel, batchWorkItems);
+                if (batchWorkItems.size() < 2 || !table.Init(subdivisionLevel, (uint32_t)batchWorkItems.size()))
+                    continue;
+
+                isMerged.assign(batchWorkItems.size(), 0);
+                for (uint32_t chunkIt = 0; chunkIt < table.GetChunkCount(); ++chunkIt)
+                {
+                    // The queries run up front, merging only changes OMMs that are never a candidate again.
+                    table.Build(vmWorkItems, batchWorkItems, chunkIt, options.enableInternalThreads);
+                    table.QueryChunk(vmWorkItems, batchWorkItems, kMaxNeighboursPerOmm, options.enableInternalThreads, neighbours);
+
+                    // Same merge order as the brute force search: each OMM absorbs its nearest unmerged successor.
+                    const uint32_t chunkBegin = table.GetChunkBegin(chunkIt);
+                    for (uint32_t posA = chunkBegin; posA < table.GetChunkEnd(chunkIt); ++posA)
+                    {
+                        if (isMerged[posA])
+                            continue;
+
+                        const MultiIndexTable::Neighbour* nearest = neighbours.data() + (size_t)(posA - chunkBegin) * kMaxNeighboursPerOmm;
+                        uint32_t nearestPos = MultiIndexTable::kNoNeighbour;
+                        for (uint32_t it = 0; it < kMaxNeighboursPerOmm && nearest[it].second != MultiIndexTable::kNoNeighbour; ++it)
+                        {
+                            if (!isMerged[nearest[it].second])
+                            {
+                                nearestPos = nearest[it].second;
+                                break;
+                            }
+                        }
+
+                        if (nearestPos == MultiIndexTable::kNoNeighbour && nearest[kMaxNeighboursPerOmm - 1].second != MultiIndexTable::kNoNeighbour)
+                        {
+                            MultiIndexTable::Neighbour unmerged;
+                            if (table.Query(vmWorkItems, batchWorkItems, posA, 1, [&isMerged](uint32_t posB) { return !isMerged[posB]; }, &unmerged) != 0)
+                                nearestPos = unmerged.second;
+                        }
+
+                        if (nearestPos != MultiIndexTable::kNoNeighbour)
+                        {
+                            isMerged[posA] = 1;
+                            isMerged[nearestPos] = 1;
+                            MergeWorkItems(vmWorkItems[batchWorkItems[posA]] /*to*/, vmWorkItems[batchWorkItems[nearestPos]] /*from*/);
+                        }
+                    }
+                }
+            }
+
+            return Result::SUCCESS;
+        }
+
+        // Known-state area lost by MergeWorkItems(to, from), in units of the macro triangle area,
+        // summed over all primitives referencing either OMM.
+        static float GetMergeError(const OmmWorkItem& to, const OmmWorkItem& from)
+        {
+            OMM_ASSERT(to.subdivisionLevel == from.subdivisionLevel);
+            const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(to.subdivisionLevel);
+            const uint64_t refCountTo = to.primitiveIndices.size();
+            const uint64_t refCountFrom = from.primitiveIndices.size();
+
+            uint64_t weightedDowngrades = 0;
+            for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
+            {
+                if (to.vmStates.Get3State(uTriIt) == from.vmStates.Get3State(uTriIt))
+                    continue;
+                if (IsKnown(to.vmStates.GetState(uTriIt)))
+                    weightedDowngrades += refCountTo;
+                if (IsKnown(from.vmStates.GetState(uTriIt)))
+                    weightedDowngrades += refCountFrom;
+            }
+            return float(double(weightedDowngrades) / numMicroTriangles);
+        }
+
+        static constexpr uint32_t kMaxCandidatesPerOmm = 8;
+
+        struct MergeCandidate
+        {
+            float score; // Bytes saved per unit of error.
+            float error;
+            uint32_t to;
+            uint32_t from;
+            uint32_t versionTo;
+            uint32_t versionFrom;
+        };
+
+        // Greedy merging under a global error budget. Candidate pairs come from the multi-index search (within the usual
+        // merge threshold, the kMaxCandidatesPerOmm nearest of the candidates verified by a query) and are merged in order
+        // of bytes saved per unit of error until the budget is spent. Merging changes the error of the pairs involving the
+        // surviving OMM, stale pairs are re-evaluated when they reach the top of the heap.
+        static Result DeduplicateSimilarErrorBudget(StdAllocator<uint8_t>& allocator, const Cpu::BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        {
+            if (!options.enableNearDuplicateDetection || !UsesNearDuplicateErrorBudget(desc))
+                return Result::SUCCESS;
+
+            // Highest score first, ties resolved by index to stay deterministic.
+            auto IsLowerPriority = [](const MergeCandidate& a, const MergeCandidate& b) {
+                if (a.score != b.score)
+                    return a.score < b.score;
+                if (a.to != b.to)
+                    return a.to > b.to;
+                return a.from > b.from;
+            };
+
+            auto GetBytesSaved = [](uint32_t subdivisionLevel) {
+                const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(subdivisionLevel);
+                return float(std::max((numMicroTriangles * 2) >> 3u, 1u) + sizeof(Cpu::OpacityMicromapDesc));
+            };
+
+            auto GetScore = [](float bytesSaved, float error) {
+                return error > 0.f ? bytesSaved / error : std::numeric_limits<float>::max();
+            };
+
+            vector<MergeCandidate> heap(allocator);
+            vector<uint32_t> version(allocator);
+            version.assign(vmWorkItems.size(), 0);
+
+            // 1. Collect the candidate pairs, level by level.
+            {
+                vector<uint32_t> batchWorkItems(allocator);
+                vector<MultiIndexTable::Neighbour> neighbours(allocator);
+                vector<MergeCandidate> chunkCandidates(allocator);
+                MultiIndexTable table(allocator);
+
+                for (uint32_t subdivisionLevel = 0; subdivisionLevel <= kMaxSubdivLevel; ++subdivisionLevel)
+                {
+                    GatherNearDuplicateCandidates(vmWorkItems, subdivisionLevel, batchWorkItems);
+                    if (batchWorkItems.size() < 2 || !table.Init(subdivisionLevel, (uint32_t)batchWorkItems.size()))
+                        continue;
+
+                    const float bytesSaved = GetBytesSaved(subdivisionLevel);
+                    for (uint32_t chunkIt = 0; chunkIt < table.GetChunkCount(); ++chunkIt)
+                    {
+                        table.Build(vmWorkItems, batchWorkItems, chunkIt, options.enableInternalThreads);
+                        table.QueryChunk(vmWorkItems, batchWorkItems, kMaxCandidatesPerOmm, options.enableInternalThreads, neighbours);
+
+                        const uint32_t chunkBegin = table.GetChunkBegin(chunkIt);
+                        chunkCandidates.resize(neighbours.size());
+
+                        #pragma omp parallel for if(options.enableInternalThreads)
+                        for (int32_t it = 0; it < (int32_t)neighbours.size(); ++it)
+                        {
+                            MergeCandidate& candidate = chunkCandidates[it];
+                            candidate.to = MultiIndexTable::kNoNeighbour;
+                            if (neighbours[it].second == MultiIndexTable::kNoNeighbour)
+                                continue;
+
+                            const uint32_t to = batchWorkItems[chunkBegin + it / kMaxCandidatesPerOmm];
+                            const uint32_t from = batchWorkItems[neighbours[it].second];
+                            const float error = GetMergeError(vmWorkItems[to], vmWorkItems[from]);
+                            candidate = { GetScore(bytesSaved, error), error, to, from, 0, 0 };
+                        }
+
+                        for (const MergeCandidate& candidate : chunkCandidates)
+                        {
+                            if (candidate.to != MultiIndexTable::kNoNeighbour)
+                                heap.push_back(candidate);
+                        }
+                    }
+                }
+            }
+
+            // 2. Cheapest merges first until the budget is spent.
+            std::make_heap(heap.begin(), heap.end(), IsLowerPriority);
+
+            float remainingBudget = desc.nearDuplicateErrorBudget;
+            while (!heap.empty())
+            {
+                std::pop_heap(heap.begin(), heap.end(), IsLowerPriority);
+                MergeCandidate candidate = heap.back();
+                heap.pop_back();
+
+                OmmWorkItem& to = vmWorkItems[candidate.to];
+                OmmWorkItem& from = vmWorkItems[candidate.from];
+                if (to.HasSpecialIndex() || from.HasSpecialIndex())
+                    continue;
+
+                if (candidate.versionTo != version[candidate.to] || candidate.versionFrom != version[candidate.from])
+                {
+                    if (NormalizedHammingDistance3State(to, from) >= kNearDuplicateMergeThreshold)
+                        continue;
+
+                    candidate.error = GetMergeError(to, from);
+                    candidate.score = GetScore(GetBytesSaved(to.subdivisionLevel), candidate.error);
+                    candidate.versionTo = version[candidate.to];
+                    candidate.versionFrom = version[candidate.from];
+                    heap.push_back(candidate);
+                    std::push_heap(heap.begin(), heap.end(), IsLowerPriority);
+                    continue;
+                }
+
+                if (candidate.error > remainingBudget)
+                    continue;
+
+                remainingBudget -= candidate.error;
+                version[candidate.to]++;
+                MergeWorkItems(to, from);
+            }
+
+            return Result::SUCCESS;
+        }
+
+        static Result DeduplicateSimilarBruteForce(StdAllocator<uint8_t>& allocator, const Cpu::BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        {
+            if (!options.enableNearDuplicateDetection || !options.enableNearDuplicateDetectionBruteForce)
+               return Result::SUCCESS;
+
+            if (UsesNearDuplicateErrorBudget(desc))
+                return Result::SUCCESS;
+
+            if (vmWorkItems.size() == 0)
+                return Result::SUCCESS;
+
+            // The purpose of this pass is to identify "similar" OMMs, and then merge those.
+            // Unfortunatley the search is O(n^2) - Is this a problem? Yes. 
+            // Possible solutions:
+            // - If set is too large - don't do an exhaustive search, just sample. (Current solution).
+            // - Look in to LSH (locality senstive hashing) approaches.
+            // - Exact radius search via multi-index hashing, see DeduplicateSimilarMultiIndex.
+
+            static constexpr float kMergeThreshold = kNearDuplicateMergeThreshold;
+            static constexpr uint32_t kMaxComparsions = 2048; // Covert the O(n^2) nature of the algorithm to a -> O(kN) version...
+
+            set<uint32_t> mergedWorkItems(allocator);
+            for (uint32_t itA = 0; itA < vmWorkItems.size() - 1; ++itA)
+            {
+                OmmWorkItem& workItemA = vmWorkItems[itA];
 
                 if (workItemA.vmSpecialIndex != OmmWorkItem::kNoSpecialIndex)
                     continue;
@@ -1099,6 +2524,61 @@ namespace Cpu
             return Result::SUCCESS;
         }
 
+        // Estimated peak of the memory allocated by the near-duplicate pass selected by options. levelWorkItemCounts are the
+        // 4-state work items per subdivision level, an upper bound of the OMMs searched.
+        static size_t GetNearDuplicateDetectionSize(const Cpu::BakeInputDesc& desc, const Options& options, size_t workItemCount, const size_t* levelWorkItemCounts)
+        {
+            if (!options.enableNearDuplicateDetection)
+                return 0;
+
+            // Per node of the hash maps and sets: next pointer, cached hash and bucket, or the tree links and color.
+            static constexpr size_t kHashMapNodeOverhead = 3 * sizeof(void*);
+            static constexpr size_t kSetNodeOverhead = 4 * sizeof(void*);
+
+            const bool useErrorBudget = UsesNearDuplicateErrorBudget(desc);
+            if (!useErrorBudget && options.enableNearDuplicateDetectionBruteForce)
+                return workItemCount * (sizeof(uint32_t) + kSetNodeOverhead);
+
+            // Each internal thread has its own visited list in MultiIndexTable::QueryChunk.
+            const size_t threadCount = options.enableInternalThreads ? std::max(std::thread::hardware_concurrency(), 1u) : 1;
+
+            // The merge candidates of the error budget accumulate over the levels.
+            size_t candidateSize = useErrorBudget ? workItemCount * sizeof(uint32_t) : 0;
+            size_t peakSize = 0;
+            for (uint32_t subdivisionLevel = 0; subdivisionLevel <= kMaxSubdivLevel; ++subdivisionLevel)
+            {
+                const size_t n = levelWorkItemCounts[subdivisionLevel];
+                if (n < 2)
+                    continue;
+
+                size_t levelSize = n * sizeof(uint32_t);
+                if (useErrorBudget || options.enableNearDuplicateDetectionMultiIndex)
+                {
+                    const size_t neighbourCount = useErrorBudget ? kMaxCandidatesPerOmm : kMaxNeighboursPerOmm;
+                    levelSize += MultiIndexTable::GetMaxTableSize(subdivisionLevel, (uint32_t)n);
+                    levelSize += (threadCount + 1) * n * sizeof(uint32_t);
+                    levelSize += n * neighbourCount * sizeof(MultiIndexTable::Neighbour);
+                    if (useErrorBudget)
+                    {
+                        levelSize += n * kMaxCandidatesPerOmm * sizeof(MergeCandidate);
+                        candidateSize += n * kMaxCandidatesPerOmm * sizeof(MergeCandidate);
+                    }
+                    else
+                        levelSize += n * sizeof(uint8_t);
+                }
+                else
+                {
+                    // DeduplicateSimilarLSH: L tables, each with a hash per work item and a bucket entry per OMM of the level.
+                    static constexpr float kApproximationFactor = 4.f; // c in DeduplicateSimilarLSH
+                    const size_t L = (size_t)std::ceil(std::pow((float)n, 1.f / kApproximationFactor));
+                    levelSize += L * (workItemCount * sizeof(uint64_t) + n * (sizeof(uint64_t) + sizeof(vector<uint32_t>) + sizeof(uint32_t) + kHashMapNodeOverhead));
+                    levelSize += 3 * L * (sizeof(uint32_t) + kSetNodeOverhead);
+                }
+                peakSize = std::max(peakSize, levelSize + candidateSize);
+            }
+            return peakSize;
+        }
+
         static Result PromoteToSpecialIndices(const BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
         {
             // Collect raster output to a final VM state.
@@ -1109,30 +2589,35 @@ namespace Cpu
                 const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItem.subdivisionLevel);
 
                 bool allEqual = true;
+                uint32_t known = 0;
                 OpacityState commonState = workItem.vmStates.GetState(0);
-                for (uint32_t uTriIt = 1; uTriIt < numMicroTriangles; ++uTriIt) {
-                    allEqual &= commonState == workItem.vmStates.GetState(uTriIt);
+                for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt) {
+                    const OpacityState state = workItem.vmStates.GetState(uTriIt);
+                    allEqual &= commonState == state;
+                    known += IsKnown(state);
                 }
 
+                const float knownFrac = known / (float)numMicroTriangles;
+                workItem.knownFraction = knownFrac;
+                workItem.specialIndexReason = SpecialIndexReason::None;
+
+                bool isRejected = false;
                 if (!allEqual && desc.rejectionThreshold > 0.f)
                 {
                     // Reject "poor" VMs:
-                    uint32_t known = 0;
-                    for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt) {
-                        if (IsKnown(workItem.vmStates.GetState(uTriIt)))
-                            known++;
-                    }
-
-                    const float knownFrac = known / (float)numMicroTriangles;
                     if (knownFrac < desc.rejectionThreshold)
                     {
                         allEqual = true;
+                        isRejected = true;
                         commonState = OpacityState::UnknownTransparent;
                     }
                 }
 
                 if (allEqual && !options.disableSpecialIndices) {
                     workItem.vmSpecialIndex = -int32_t(commonState) - 1;
+                    workItem.specialIndexReason = isRejected ? SpecialIndexReason::Rejected : SpecialIndexReason::Uniform;
+                    if (isRejected)
+                        workItem.knownFraction = 0.f;
                 }
             }
             return Result::SUCCESS;
@@ -1167,17 +2652,22 @@ namespace Cpu
 
             static constexpr uint32_t kTargetDeviceCacheLineSize = 128;
 
-            sortKeys.resize(vmWorkItems.size());
+            const size_t vmCount = vmWorkItems.size();
+            sortKeys.resize(vmCount);
             {
+                // Keys are stored in reverse work item order. The radix sort is stable, so equal keys end up in
+                // descending vmIndex order, same as sorting the pairs with std::greater. vmIndex is the canonical work
+                // item order from SetupWorkItems, so ties resolve the same way for any thread count.
                 #pragma omp parallel for if(options.enableInternalThreads)
                 for (int32_t vmIndex = 0; vmIndex < vmWorkItems.size(); ++vmIndex) {
 
                     const OmmWorkItem& vm = vmWorkItems[vmIndex];
+                    std::pair<uint64_t, uint32_t>& sortKey = sortKeys[vmCount - 1 - vmIndex];
                     if (vm.vmSpecialIndex != OmmWorkItem::kNoSpecialIndex)
                     {
                         // For special indices, maintain original order.
                         uint64_t key = (1ull << 63) | (uint64_t)vmIndex;
-                        sortKeys[vmIndex] = std::make_pair(key, vmIndex);
+                        sortKey = std::make_pair(key, vmIndex);
                     }
                     else {
                         // For regular VMs,  Sort on Sub-div lvl and 
@@ -1195,11 +2685,15 @@ namespace Cpu
                         uint64_t key = 0;
                         key |= (uint64_t)vm.subdivisionLevel << 60;
                         key |= mCode;
-                        sortKeys[vmIndex] = std::make_pair(key, vmIndex);
+                        sortKey = std::make_pair(key, vmIndex);
                     }
                 }
 
-                std::sort(sortKeys.begin(), sortKeys.end(), std::greater<std::pair<uint64_t, uint32_t>>());
+                vector<std::pair<uint64_t, uint32_t>> scratch(allocator);
+                scratch.resize(vmCount);
+                vector<uint32_t> histograms(allocator);
+                histograms.resize(radix::kHistogramCount);
+                radix::SortDescending(sortKeys.data(), scratch.data(), histograms.data(), vmCount, options.enableInternalThreads);
             }
             return Result::SUCCESS;
         }
@@ -1302,12 +2796,25 @@ namespace Cpu
                 }
             }
 
-            const int32_t triangleCount = desc.indexCount / 3;
+            // One index per primitive and frame.
+            const int32_t triangleCount = (desc.indexCount / 3) * GetFrameCount(desc);
 
             // Set special indices...
             {
                 res.ommIndexBuffer.resize(triangleCount);
                 std::fill(res.ommIndexBuffer.begin(), res.ommIndexBuffer.end(), (int32_t)SpecialIndex::FullyUnknownOpaque);
+                if (desc.specialIndices)
+                {
+                    const uint32_t primitiveCount = desc.indexCount / 3;
+                    for (uint32_t frameIt = 0; frameIt < GetFrameCount(desc); ++frameIt)
+                    {
+                        for (uint32_t i = 0; i < primitiveCount; ++i)
+                        {
+                            if (desc.specialIndices[i] != 0)
+                                res.ommIndexBuffer[frameIt * primitiveCount + i] = desc.specialIndices[i];
+                        }
+                    }
+                }
                 for (const OmmWorkItem& vm : vmWorkItems) 
 				{
                     for (uint32_t primitiveIndex : vm.primitiveIndices)
@@ -1316,6 +2823,9 @@ namespace Cpu
                             res.ommIndexBuffer[primitiveIndex] = vm.vmSpecialIndex;
                         else
                             res.ommIndexBuffer[primitiveIndex] = vm.vmDescOffset;
+
+                        if (options.enablePrimitiveCoverage)
+                            res.primitiveCoverage[primitiveIndex] = { vm.knownFraction, (uint8_t)vm.subdivisionLevel, vm.specialIndexReason };
                     }
                 }
             }
@@ -1354,14 +2864,18 @@ namespace Cpu
 
         m_bakeInputDesc = desc;
 
-        auto impl__Resample = [](const BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems) { 
+        auto impl__Resample = [this](const BakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems) { 
+            if (IsProcedural(desc))
+                return impl::ResampleProcedural(desc, options, vmWorkItems);
+            if (IsPolygonMask(desc))
+                return impl::ResamplePolygonMask(m_stdAllocator, desc, options, vmWorkItems);
             return impl::Resample<eTilingMode, eTextureAddressMode, eFilterMode>(desc, options, vmWorkItems);
         };
 
         {
             vector<OmmWorkItem> vmWorkItems(m_stdAllocator.GetInterface());
 
-            RETURN_STATUS_IF_FAILED(impl::SetupWorkItems(m_stdAllocator, desc, options, vmWorkItems));
+            RETURN_STATUS_IF_FAILED(impl::SetupWorkItems(m_stdAllocator, desc, options, m_largeBufferFlags, vmWorkItems, m_bakeResult.primitiveCoverage));
 
             RETURN_STATUS_IF_FAILED(impl::ValidateWorkloadSize(m_stdAllocator, desc, options, vmWorkItems));
 
@@ -1371,9 +2885,13 @@ namespace Cpu
 
             RETURN_STATUS_IF_FAILED(impl::DeduplicateExact(m_stdAllocator, options, vmWorkItems));
 
-            RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarLSH(m_stdAllocator, options, vmWorkItems, 3 /*iterations*/));
+            RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarLSH(m_stdAllocator, desc, options, vmWorkItems, 3 /*iterations*/));
 
-            RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarBruteForce(m_stdAllocator, options, vmWorkItems));
+            RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarBruteForce(m_stdAllocator, desc, options, vmWorkItems));
+
+            RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarMultiIndex(m_stdAllocator, desc, options, vmWorkItems));
+
+            RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarErrorBudget(m_stdAllocator, desc, options, vmWorkItems));
 
             RETURN_STATUS_IF_FAILED(impl::PromoteToSpecialIndices(desc, options, vmWorkItems));
 
@@ -1391,5 +2909,590 @@ namespace Cpu
         return Result::SUCCESS;
     }
 
+    Result BakeOutputImpl::GetPreBakeEstimate(StdAllocator<uint8_t>& stdAllocator, const BakeInputDesc& desc, PreBakeEstimate* outPreBakeEstimate)
+    {
+        RETURN_STATUS_IF_FAILED(ValidateDesc(desc));
+
+        const Options options(desc.bakeFlags);
+        const bool usesTexture = UsesTexture(desc);
+        const AlphaTextureSet textures(desc);
+
+        // Per node of the hash maps in SetupWorkItems and DeduplicateExact: next pointer, cached hash and bucket.
+        static constexpr size_t kHashMapNodeOverhead = 3 * sizeof(void*);
+        using SortKey = std::pair<uint64_t, uint32_t>;
+
+        const uint32_t triangleCount = desc.indexCount / 3u;
+        const size_t primitiveCount = size_t(triangleCount) * GetFrameCount(desc);
+        const uint32_t resultBitCount = omm::bird::GetBitCount(desc.ommFormat);
+
+        // Same keys as SetupWorkItems, without allocating the states.
+        hash_map<impl::WorkItemKey, uint32_t, impl::WorkItemKeyHash> uniqueWorkItems(stdAllocator.GetInterface());
+        PreBakeEstimate info;
+        size_t workItemSize = 0;
+        size_t resampledPrimitiveCount = 0;
+        size_t levelWorkItemCounts[kMaxNumSubdivLevels] = {};
+
+        auto onResample = [&](uint32_t, const Triangle& uvTri, uint32_t subdivisionLevel, OMMFormat ommFormat, float alphaCutoff) {
+            resampledPrimitiveCount++;
+            if (!options.disableDuplicateDetection && !uniqueWorkItems.emplace(impl::WorkItemKey(uvTri, subdivisionLevel, (uint32_t)ommFormat, alphaCutoff), 0).second)
+                return;
+
+            const uint64_t numMicroTriangles = omm::bird::GetNumMicroTriangles(subdivisionLevel);
+            const uint64_t bitCount = std::max(resultBitCount, omm::bird::GetBitCount(ommFormat));
+            info.workItemCount++;
+            if (ommFormat == OMMFormat::OC1_4_State)
+                levelWorkItemCounts[subdivisionLevel]++;
+            info.microTriangleCount += numMicroTriangles;
+            info.workloadSize += usesTexture ? impl::GetWorkloadSize(textures, uvTri) : 0;
+            info.maxOmmArrayDataSizeInBytes += std::max<size_t>((numMicroTriangles * bitCount) >> 3ull, 1ull);
+            // 2- and 3-state copies of the states, see OmmArrayDataVector.
+            workItemSize += 2 * numMicroTriangles;
+        };
+        auto onSkip = [](uint32_t, SpecialIndexReason) { };
+
+        size_t decodedGeometrySize = 0;
+        RETURN_STATUS_IF_FAILED(impl::ForEachPrimitive(stdAllocator, desc, options, onResample, onSkip, decodedGeometrySize));
+
+        const size_t workItemCount = info.workItemCount;
+        workItemSize += std::max<size_t>(workItemCount, triangleCount) * sizeof(OmmWorkItem) + resampledPrimitiveCount * sizeof(uint32_t);
+
+        static constexpr size_t kMaxHistogramCount = ((size_t)OMMFormat::MAX_NUM - 1) * kMaxNumSubdivLevels;
+        info.maxResultSizeInBytes = sizeof(BakeOutputImpl) + info.maxOmmArrayDataSizeInBytes +
+            workItemCount * sizeof(OpacityMicromapDesc) +
+            primitiveCount * sizeof(int32_t) +
+            2 * kMaxHistogramCount * sizeof(OpacityMicromapUsageCount) +
+            (options.enablePrimitiveCoverage ? primitiveCount * sizeof(PrimitiveCoverage) : 0);
+
+        // Work items are alive from SetupWorkItems to Serialize, the passes in between peak at different points.
+        const size_t setupSize = decodedGeometrySize + workItemCount * (sizeof(impl::WorkItemKey) + sizeof(uint32_t) + kHashMapNodeOverhead);
+        const size_t deduplicateSize = options.disableDuplicateDetection ? 0 : workItemCount * (sizeof(uint64_t) + sizeof(uint32_t) + kHashMapNodeOverhead);
+        const size_t sortSize = 2 * workItemCount * sizeof(SortKey);
+        const size_t nearDuplicateSize = impl::GetNearDuplicateDetectionSize(desc, options, workItemCount, levelWorkItemCounts);
+        const size_t serializeSize = workItemCount * sizeof(SortKey) + info.maxResultSizeInBytes;
+        info.peakMemoryInBytes = workItemSize + std::max({ setupSize, deduplicateSize, nearDuplicateSize, sortSize, serializeSize });
+
+        *outPreBakeEstimate = info;
+        return Result::SUCCESS;
+    }
+
+    static constexpr uint32_t kMaxDmmSubdivLevel = 3;
+    static constexpr uint32_t kDmmBlockSize = 64;
+    static constexpr uint32_t kDmmValueBitCount = 11;
+    static constexpr uint32_t kDmmMaxValue = (1u << kDmmValueBitCount) - 1;
+    static_assert(bird::GetNumMicroVertices(kMaxDmmSubdivLevel) * kDmmValueBitCount <= kDmmBlockSize * 8);
+
+    struct DmmWorkItem
+    {
+        uint32_t subdivisionLevel;
+        Triangle uvTri;
+        // False for non-finite texture coordinates, the block is left at zero displacement.
+        bool isValid;
+        vector<uint32_t> primitiveIndices; // source primitive and identical indices
+
+        DmmWorkItem() = delete;
+
+        DmmWorkItem(StdAllocator<uint8_t>& stdAllocator, uint32_t _subdivisionLevel, uint32_t primitiveIndex, const Triangle& _uvTri, bool _isValid)
+            : subdivisionLevel(_subdivisionLevel)
+            , uvTri(_uvTri)
+            , isValid(_isValid)
+            , primitiveIndices(stdAllocator)
+        {
+            primitiveIndices.push_back(primitiveIndex);
+        }
+
+        // Outputs.
+        std::array<uint8_t, kDmmBlockSize> block = {};
+        uint32_t dmmDescOffset = 0xFFFFFFFF;
+
+        // Written by ResampleDisplacement for blocks left to DemoteUniformDisplacement.
+        bool isUniform = false;
+        uint32_t uniformValue = 0;
+    };
+
+    namespace impl
+    {
+        static bool IsFinite(const Triangle& t)
+        {
+            return !glm::any(glm::isnan(t.p0)) && !glm::any(glm::isnan(t.p1)) && !glm::any(glm::isnan(t.p2)) &&
+                   !glm::any(glm::isinf(t.p0)) && !glm::any(glm::isinf(t.p1)) && !glm::any(glm::isinf(t.p2));
+        }
+
+        // Point at k / scale along the edge. The endpoints are ordered before interpolating so that primitives sharing
+        // the edge in opposite directions sample the same points, i.e neighbouring DMMs of the same level match along the edge.
+        static float2 InterpolateEdge(const float2& a, const float2& b, uint32_t k, uint32_t scale)
+        {
+            if (k == 0)
+                return a;
+            if (k == scale)
+                return b;
+            const bool isOrdered = a.x < b.x || (a.x == b.x && a.y < b.y);
+            if (isOrdered)
+                return a + (b - a) * (float(k) / float(scale));
+            return b + (a - b) * (float(scale - k) / float(scale));
+        }
+
+        static float2 GetMicroVertexUV(const Triangle& t, const uint2& bc, uint32_t scale)
+        {
+            const uint32_t w = scale - bc.x - bc.y;
+            if (bc.y == 0)
+                return InterpolateEdge(t.p0, t.p1, bc.x, scale);
+            if (bc.x == 0)
+                return InterpolateEdge(t.p0, t.p2, bc.y, scale);
+            if (w == 0)
+                return InterpolateEdge(t.p1, t.p2, bc.y, scale);
+            return InterpolateTriangleUV(InitBarycentrics(float2(bc) / float(scale)), t);
+        }
+
+        static float SampleHeight(const TextureImpl* texture, const SamplerDesc& sampler, const float2& uv)
+        {
+            if (sampler.filter == TextureFilterMode::Linear)
+                return texture->Bilinear(sampler.addressingMode, uv, 0 /*mip*/, sampler.borderAlpha);
+
+            // Clamp before converting, UVs far outside the texture would overflow.
+            const int2 size = texture->GetSize(0 /*mip*/);
+            const float2 pixel = glm::clamp(glm::floor(uv * float2(size)), float2(-(float)(1 << 30)), float2((float)(1 << 30)));
+            const int2 coord = GetTexCoord(sampler.addressingMode, int2(pixel), size);
+            if (coord.x == kTexCoordBorder || coord.y == kTexCoordBorder)
+                return sampler.borderAlpha;
+            return texture->Load(coord, 0 /*mip*/);
+        }
+
+        static uint32_t QuantizeDisplacement(const BakeDisplacementInputDesc& desc, float height)
+        {
+            const float value = (height - desc.heightBias) / desc.heightScale;
+            if (!(value > 0.f)) // NaN -> 0
+                return 0;
+            return (uint32_t)(std::min(value, 1.f) * kDmmMaxValue + 0.5f);
+        }
+
+        static void WriteDisplacement(uint8_t* block, uint32_t index, uint32_t value)
+        {
+            const uint32_t bitOffset = index * kDmmValueBitCount;
+            uint32_t bits = value << (bitOffset & 7u);
+            for (uint32_t byteIt = bitOffset >> 3u; bits != 0; ++byteIt, bits >>= 8u)
+                block[byteIt] |= (uint8_t)bits;
+        }
+
+        // Links the edges of all primitives sharing the same two vertex indices in a ring. Edge e of primitive p is
+        // (v_e, v_(e + 1) % 3), its id 3 * p + e. edgeRing[id] is the next edge of the ring, id itself for a boundary edge.
+        static void BuildDisplacementEdgeRings(StdAllocator<uint8_t>& allocator, const vector<uint32_t>& indices, vector<uint32_t>& edgeRing)
+        {
+            const uint32_t edgeCount = (uint32_t)indices.size();
+            edgeRing.resize(edgeCount);
+
+            hash_map<uint64_t, uint32_t> vertexPairToEdge(allocator.GetInterface());
+            vertexPairToEdge.reserve(edgeCount);
+            for (uint32_t edgeIt = 0; edgeIt < edgeCount; ++edgeIt)
+            {
+                edgeRing[edgeIt] = edgeIt;
+
+                const uint32_t a = indices[edgeIt];
+                const uint32_t b = indices[edgeIt % 3 == 2 ? edgeIt - 2 : edgeIt + 1];
+                if (a == b)
+                    continue;
+
+                const uint64_t vertexPair = (uint64_t(std::min(a, b)) << 32ull) | std::max(a, b);
+                auto it = vertexPairToEdge.find(vertexPair);
+                if (it == vertexPairToEdge.end())
+                {
+                    vertexPairToEdge.insert(std::make_pair(vertexPair, edgeIt));
+                    continue;
+                }
+                edgeRing[edgeIt] = edgeRing[it->second];
+                edgeRing[it->second] = edgeIt;
+            }
+        }
+
+        // Lowers levels until primitives sharing an edge are at most one level apart, the most the runtime can decimate
+        // an edge for. A level only ever decreases, so this terminates.
+        static void LimitDisplacementLevels(const vector<uint32_t>& edgeRing, vector<uint8_t>& primitiveLevels)
+        {
+            for (bool changed = true; changed;)
+            {
+                changed = false;
+                for (uint32_t edgeIt = 0; edgeIt < edgeRing.size(); ++edgeIt)
+                {
+                    for (uint32_t neighbourIt = edgeRing[edgeIt]; neighbourIt != edgeIt; neighbourIt = edgeRing[neighbourIt])
+                    {
+                        if (primitiveLevels[edgeIt / 3] > primitiveLevels[neighbourIt / 3] + 1)
+                        {
+                            primitiveLevels[edgeIt / 3] = primitiveLevels[neighbourIt / 3] + 1;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        static Result SetupDisplacementWorkItems(StdAllocator<uint8_t>& allocator, const BakeDisplacementInputDesc& desc, const Options& options,
+            vector<DmmWorkItem>& dmmWorkItems, vector<uint32_t>& edgeRing, vector<uint8_t>& primitiveLevels)
+        {
+            const uint32_t triangleCount = desc.indexCount / 3u;
+            const uint32_t texCoordStrideInBytes = desc.texCoordStrideInBytes == 0 ? GetTexCoordFormatSize(desc.texCoordFormat) : desc.texCoordStrideInBytes;
+
+            // Work items are created in order of their first primitive, same as SetupWorkItems.
+            hash_map<WorkItemKey, uint32_t, WorkItemKeyHash> triangleIDToWorkItem(allocator.GetInterface());
+            dmmWorkItems.reserve(triangleCount);
+
+            vector<uint32_t> indices(allocator);
+            vector<float2> texCoords(allocator);
+            RETURN_STATUS_IF_FAILED(DecodeGeometry(desc.indexFormat, desc.indexBuffer, desc.indexOffset, 3 * triangleCount, desc.baseVertex,
+                desc.texCoordFormat, desc.texCoords, texCoordStrideInBytes, options.enableInternalThreads, indices, texCoords));
+
+            auto GetUVTriangle = [&](uint32_t i) {
+                const uint32_t* triangleIndices = &indices[3ull * i];
+                return TransformUVTriangle(
+                    Triangle(texCoords[triangleIndices[0]], texCoords[triangleIndices[1]], texCoords[triangleIndices[2]]), desc.texCoordTransform, nullptr);
+            };
+
+            // The levels are settled before the work items are keyed by them.
+            primitiveLevels.resize(triangleCount);
+            for (uint32_t i = 0; i < triangleCount; ++i)
+            {
+                const uint32_t subdivisionLevel = desc.subdivisionLevels && desc.subdivisionLevels[i] <= kMaxDmmSubdivLevel ? desc.subdivisionLevels[i] : desc.subdivisionLevel;
+                primitiveLevels[i] = IsFinite(GetUVTriangle(i)) ? (uint8_t)subdivisionLevel : 0;
+            }
+
+            BuildDisplacementEdgeRings(allocator, indices, edgeRing);
+            LimitDisplacementLevels(edgeRing, primitiveLevels);
+
+            for (uint32_t i = 0; i < triangleCount; ++i)
+            {
+                const Triangle uvTri = GetUVTriangle(i);
+                const bool isValid = IsFinite(uvTri);
+                const uint32_t subdivisionLevel = primitiveLevels[i];
+
+                const WorkItemKey dmmId(uvTri, subdivisionLevel, (uint32_t)desc.dmmFormat, 0.f /*alphaCutoff*/);
+
+                auto it = triangleIDToWorkItem.find(dmmId);
+                if (it == triangleIDToWorkItem.end() || options.disableDuplicateDetection)
+                {
+                    triangleIDToWorkItem.insert(std::make_pair(dmmId, (uint32_t)dmmWorkItems.size()));
+                    dmmWorkItems.emplace_back(allocator, subdivisionLevel, i, uvTri, isValid);
+                }
+                else
+                {
+                    dmmWorkItems[it->second].primitiveIndices.push_back(i);
+                }
+            }
+            return Result::SUCCESS;
+        }
+
+        static Result ResampleDisplacement(const BakeDisplacementInputDesc& desc, const Options& options, vector<DmmWorkItem>& dmmWorkItems)
+        {
+            const TextureImpl* texture = (const TextureImpl*)desc.heightTexture;
+
+            std::array<std::array<uint2, bird::GetNumMicroVertices(kMaxDmmSubdivLevel)>, kMaxDmmSubdivLevel + 1> microVertexOrder;
+            for (uint32_t level = 0; level <= kMaxDmmSubdivLevel; ++level)
+            {
+                if (desc.outputLayout)
+                {
+                    for (uint32_t vertexIt = 0; vertexIt < bird::GetNumMicroVertices(level); ++vertexIt)
+                    {
+                        const DisplacementMicroVertex& microVertex = desc.outputLayout->microVertexOrder[level][vertexIt];
+                        microVertexOrder[level][vertexIt] = uint2(microVertex.u, microVertex.v);
+                    }
+                }
+                else
+                    bird::GetMicroVertexOrder(level, microVertexOrder[level].data());
+            }
+
+            const int32_t numWorkItems = (int32_t)dmmWorkItems.size();
+            #pragma omp parallel for if(options.enableInternalThreads)
+            for (int32_t workItemIt = 0; workItemIt < numWorkItems; ++workItemIt)
+            {
+                DmmWorkItem& workItem = dmmWorkItems[workItemIt];
+                if (!workItem.isValid)
+                    continue;
+
+                const uint32_t scale = 1u << workItem.subdivisionLevel;
+                const uint32_t numMicroVertices = bird::GetNumMicroVertices(workItem.subdivisionLevel);
+
+                std::array<uint32_t, bird::GetNumMicroVertices(kMaxDmmSubdivLevel)> values;
+                bool isUniform = true;
+                for (uint32_t vertexIt = 0; vertexIt < numMicroVertices; ++vertexIt)
+                {
+                    const float2 uv = GetMicroVertexUV(workItem.uvTri, microVertexOrder[workItem.subdivisionLevel][vertexIt], scale);
+                    values[vertexIt] = QuantizeDisplacement(desc, SampleHeight(texture, desc.heightSamplerDesc, uv));
+                    isUniform &= values[vertexIt] == values[0];
+                }
+
+                // The level of a uniform displacement depends on the neighbours, DemoteUniformDisplacement writes the block.
+                if (isUniform && options.enableDisplacementLevelDemotion)
+                {
+                    workItem.isUniform = true;
+                    workItem.uniformValue = values[0];
+                    continue;
+                }
+
+                for (uint32_t vertexIt = 0; vertexIt < numMicroVertices; ++vertexIt)
+                    WriteDisplacement(workItem.block.data(), vertexIt, values[vertexIt]);
+            }
+            return Result::SUCCESS;
+        }
+
+        // A uniform displacement is represented exactly at any level. Uniform primitives drop to level 0 and are raised
+        // again until they're within one level of their neighbours. Raising never exceeds the level from
+        // SetupDisplacementWorkItems, which already satisfies that. Primitives of a work item can end up at different
+        // levels, each level gets its own work item.
+        static Result DemoteUniformDisplacement(StdAllocator<uint8_t>& allocator, const Options& options, const vector<uint32_t>& edgeRing,
+            vector<uint8_t>& primitiveLevels, vector<DmmWorkItem>& dmmWorkItems)
+        {
+            if (!options.enableDisplacementLevelDemotion)
+                return Result::SUCCESS;
+
+            for (const DmmWorkItem& workItem : dmmWorkItems)
+            {
+                if (!workItem.isUniform)
+                    continue;
+                for (uint32_t primitiveIndex : workItem.primitiveIndices)
+                    primitiveLevels[primitiveIndex] = 0;
+            }
+
+            for (bool changed = true; changed;)
+            {
+                changed = false;
+                for (uint32_t edgeIt = 0; edgeIt < edgeRing.size(); ++edgeIt)
+                {
+                    for (uint32_t neighbourIt = edgeRing[edgeIt]; neighbourIt != edgeIt; neighbourIt = edgeRing[neighbourIt])
+                    {
+                        if (primitiveLevels[edgeIt / 3] + 1 < primitiveLevels[neighbourIt / 3])
+                        {
+                            primitiveLevels[edgeIt / 3] = primitiveLevels[neighbourIt / 3] - 1;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+
+            auto WriteUniformBlock = [](DmmWorkItem& workItem, uint32_t subdivisionLevel, uint32_t value) {
+                workItem.subdivisionLevel = subdivisionLevel;
+                workItem.block = {};
+                for (uint32_t vertexIt = 0; vertexIt < bird::GetNumMicroVertices(subdivisionLevel); ++vertexIt)
+                    WriteDisplacement(workItem.block.data(), vertexIt, value);
+            };
+
+            static constexpr uint32_t kNoWorkItem = 0xFFFFFFFF;
+
+            vector<uint32_t> primitiveIndices(allocator);
+            const uint32_t workItemCount = (uint32_t)dmmWorkItems.size();
+            for (uint32_t workItemIt = 0; workItemIt < workItemCount; ++workItemIt)
+            {
+                if (!dmmWorkItems[workItemIt].isUniform)
+                    continue;
+
+                const Triangle uvTri = dmmWorkItems[workItemIt].uvTri;
+                const uint32_t value = dmmWorkItems[workItemIt].uniformValue;
+                primitiveIndices.swap(dmmWorkItems[workItemIt].primitiveIndices);
+                dmmWorkItems[workItemIt].primitiveIndices.clear();
+
+                // Work item of each level, the existing one for the level of the first primitive.
+                std::array<uint32_t, kMaxDmmSubdivLevel + 1> levelToWorkItem;
+                levelToWorkItem.fill(kNoWorkItem);
+                levelToWorkItem[primitiveLevels[primitiveIndices[0]]] = workItemIt;
+                WriteUniformBlock(dmmWorkItems[workItemIt], primitiveLevels[primitiveIndices[0]], value);
+
+                for (uint32_t primitiveIndex : primitiveIndices)
+                {
+                    const uint32_t subdivisionLevel = primitiveLevels[primitiveIndex];
+                    if (levelToWorkItem[subdivisionLevel] == kNoWorkItem)
+                    {
+                        levelToWorkItem[subdivisionLevel] = (uint32_t)dmmWorkItems.size();
+                        dmmWorkItems.emplace_back(allocator, subdivisionLevel, primitiveIndex, uvTri, true /*isValid*/);
+                        WriteUniformBlock(dmmWorkItems.back(), subdivisionLevel, value);
+                        continue;
+                    }
+                    dmmWorkItems[levelToWorkItem[subdivisionLevel]].primitiveIndices.push_back(primitiveIndex);
+                }
+            }
+            return Result::SUCCESS;
+        }
+
+        static Result DeduplicateDisplacementExact(StdAllocator<uint8_t>& allocator, const Options& options, vector<DmmWorkItem>& dmmWorkItems)
+        {
+            if (options.disableDuplicateDetection)
+                return Result::SUCCESS;
+
+            // Keyed by the digest of level and block, candidates are compared in full so that a digest collision
+            // can't merge different DMMs.
+            hash_map<uint64_t, uint32_t> digestToWorkItemIndex(allocator.GetInterface());
+            for (uint32_t i = 0; i < dmmWorkItems.size(); ++i)
+            {
+                DmmWorkItem& workItem = dmmWorkItems[i];
+                const uint64_t digest = XXH64(workItem.block.data(), workItem.block.size(), workItem.subdivisionLevel);
+                auto it = digestToWorkItemIndex.find(digest);
+                if (it == digestToWorkItemIndex.end())
+                {
+                    digestToWorkItemIndex.insert(std::make_pair(digest, i));
+                    continue;
+                }
+
+                DmmWorkItem& existingWorkItem = dmmWorkItems[it->second];
+                if (existingWorkItem.subdivisionLevel != workItem.subdivisionLevel || existingWorkItem.block != workItem.block)
+                    continue;
+
+                existingWorkItem.primitiveIndices.insert(existingWorkItem.primitiveIndices.end(), workItem.primitiveIndices.begin(), workItem.primitiveIndices.end());
+                workItem.primitiveIndices.clear();
+            }
+            return Result::SUCCESS;
+        }
+
+        static Result SerializeDisplacement(const BakeDisplacementInputDesc& desc, const vector<uint32_t>& edgeRing, const vector<uint8_t>& primitiveLevels,
+            vector<DmmWorkItem>& dmmWorkItems, DisplacementBakeResultImpl& res)
+        {
+            const uint16_t format = desc.outputLayout ? desc.outputLayout->format : (uint16_t)desc.dmmFormat;
+
+            // DMMs are laid out in order of their first primitive, blocks are all the same size so there's no alignment to sort for.
+            uint32_t arrayHistogram[kMaxDmmSubdivLevel + 1] = { 0, };
+            uint32_t indexHistogram[kMaxDmmSubdivLevel + 1] = { 0, };
+            uint32_t dmmDescArrayCount = 0;
+            for (const DmmWorkItem& workItem : dmmWorkItems)
+            {
+                if (workItem.primitiveIndices.empty())
+                    continue;
+                arrayHistogram[workItem.subdivisionLevel]++;
+                indexHistogram[workItem.subdivisionLevel] += (uint32_t)workItem.primitiveIndices.size();
+                dmmDescArrayCount++;
+            }
+
+            if (size_t(dmmDescArrayCount) * kDmmBlockSize > std::numeric_limits<uint32_t>::max())
+                return Result::FAILURE;
+
+            res.dmmArrayData.resize(size_t(dmmDescArrayCount) * kDmmBlockSize);
+            res.dmmDescArray.resize(dmmDescArrayCount);
+            uint32_t dmmDescOffset = 0;
+            for (DmmWorkItem& workItem : dmmWorkItems)
+            {
+                if (workItem.primitiveIndices.empty())
+                    continue;
+                DisplacementMicromapDesc& dmmDesc = res.dmmDescArray[dmmDescOffset];
+                dmmDesc.offset = dmmDescOffset * kDmmBlockSize;
+                dmmDesc.subdivisionLevel = (uint16_t)workItem.subdivisionLevel;
+                dmmDesc.format = format;
+                std::memcpy(res.dmmArrayData.data() + dmmDesc.offset, workItem.block.data(), kDmmBlockSize);
+                workItem.dmmDescOffset = dmmDescOffset++;
+            }
+
+            for (uint32_t subDivLvl = 0; subDivLvl <= kMaxDmmSubdivLevel; ++subDivLvl)
+            {
+                if (arrayHistogram[subDivLvl] != 0)
+                    res.dmmArrayHistogram.push_back({ arrayHistogram[subDivLvl], (uint16_t)subDivLvl, format });
+                if (indexHistogram[subDivLvl] != 0)
+                    res.dmmIndexHistogram.push_back({ indexHistogram[subDivLvl], (uint16_t)subDivLvl, format });
+            }
+
+            const uint32_t triangleCount = desc.indexCount / 3u;
+            res.dmmIndexBuffer.resize(triangleCount);
+            for (const DmmWorkItem& workItem : dmmWorkItems)
+            {
+                for (uint32_t primitiveIndex : workItem.primitiveIndices)
+                {
+                    OMM_ASSERT(primitiveLevels[primitiveIndex] == workItem.subdivisionLevel);
+                    res.dmmIndexBuffer[primitiveIndex] = workItem.dmmDescOffset;
+                }
+            }
+
+            // Levels are at most one apart across an edge, the higher side decimates.
+            res.dmmEdgeFlags.resize(triangleCount, DisplacementEdgeFlags::None);
+            for (uint32_t edgeIt = 0; edgeIt < edgeRing.size(); ++edgeIt)
+            {
+                for (uint32_t neighbourIt = edgeRing[edgeIt]; neighbourIt != edgeIt; neighbourIt = edgeRing[neighbourIt])
+                {
+                    OMM_ASSERT(primitiveLevels[edgeIt / 3] <= primitiveLevels[neighbourIt / 3] + 1);
+                    if (primitiveLevels[edgeIt / 3] == primitiveLevels[neighbourIt / 3] + 1)
+                        res.dmmEdgeFlags[edgeIt / 3] = (DisplacementEdgeFlags)((uint32_t)res.dmmEdgeFlags[edgeIt / 3] | (1u << (edgeIt % 3)));
+                }
+            }
+
+            // Compress to 16 bit indices if possible & allowed.
+            IndexFormat dmmIndexFormat = IndexFormat::I32_UINT;
+            const bool force32bit = ((uint32_t)desc.bakeFlags & (uint32_t)BakeFlags::Force32BitIndices) == (uint32_t)BakeFlags::Force32BitIndices;
+            if (dmmDescArrayCount <= std::numeric_limits<uint16_t>::max() + 1u && !force32bit)
+            {
+                uint16_t* dmmIndexBuffer16 = (uint16_t*)res.dmmIndexBuffer.data();
+                for (uint32_t i = 0; i < triangleCount; ++i)
+                    dmmIndexBuffer16[i] = (uint16_t)res.dmmIndexBuffer[i];
+                dmmIndexFormat = IndexFormat::I16_UINT;
+            }
+
+            res.Finalize(dmmIndexFormat);
+            return Result::SUCCESS;
+        }
+    } // namespace impl
+
+    DisplacementBakeOutputImpl::DisplacementBakeOutputImpl(const StdAllocator<uint8_t>& stdAllocator) :
+        m_stdAllocator(stdAllocator),
+        m_bakeResult(stdAllocator)
+    {
+    }
+
+    Result DisplacementBakeOutputImpl::ValidateDesc(const BakeDisplacementInputDesc& desc)
+    {
+        if (desc.heightTexture == 0)
+            return Result::INVALID_ARGUMENT;
+        if (desc.heightSamplerDesc.addressingMode == TextureAddressMode::MAX_NUM)
+            return Result::INVALID_ARGUMENT;
+        if (desc.heightSamplerDesc.filter == TextureFilterMode::MAX_NUM)
+            return Result::INVALID_ARGUMENT;
+        if (desc.texCoordFormat == TexCoordFormat::MAX_NUM)
+            return Result::INVALID_ARGUMENT;
+        if (desc.texCoords == nullptr)
+            return Result::INVALID_ARGUMENT;
+        if (desc.indexBuffer != nullptr && desc.indexFormat == IndexFormat::MAX_NUM)
+            return Result::INVALID_ARGUMENT;
+        if (desc.indexCount == 0)
+            return Result::INVALID_ARGUMENT;
+        if (desc.dmmFormat != DMMFormat::DC1_64_Triangles_64_Bytes_SdkOrder)
+            return Result::INVALID_ARGUMENT;
+        if (desc.subdivisionLevel > kMaxDmmSubdivLevel)
+            return Result::INVALID_ARGUMENT;
+        if (desc.outputLayout)
+        {
+            // Every micro-vertex of each level exactly once.
+            for (uint32_t level = 0; level <= kMaxDmmSubdivLevel; ++level)
+            {
+                const DisplacementMicroVertex* order = desc.outputLayout->microVertexOrder[level];
+                if (order == nullptr)
+                    return Result::INVALID_ARGUMENT;
+
+                const uint32_t scale = 1u << level;
+                std::array<bool, (1u << kMaxDmmSubdivLevel) + 1> isVisited[(1u << kMaxDmmSubdivLevel) + 1] = {};
+                for (uint32_t vertexIt = 0; vertexIt < bird::GetNumMicroVertices(level); ++vertexIt)
+                {
+                    const DisplacementMicroVertex& microVertex = order[vertexIt];
+                    if (uint32_t(microVertex.u) + microVertex.v > scale || isVisited[microVertex.u][microVertex.v])
+                        return Result::INVALID_ARGUMENT;
+                    isVisited[microVertex.u][microVertex.v] = true;
+                }
+            }
+        }
+        if (!std::isfinite(desc.heightBias) || !std::isfinite(desc.heightScale) || desc.heightScale == 0.f)
+            return Result::INVALID_ARGUMENT;
+        return Result::SUCCESS;
+    }
+
+    Result DisplacementBakeOutputImpl::Bake(const BakeDisplacementInputDesc& desc)
+    {
+        RETURN_STATUS_IF_FAILED(ValidateDesc(desc));
+
+        Options options(desc.bakeFlags);
+
+        vector<DmmWorkItem> dmmWorkItems(m_stdAllocator.GetInterface());
+        vector<uint32_t> edgeRing(m_stdAllocator.GetInterface());
+        vector<uint8_t> primitiveLevels(m_stdAllocator.GetInterface());
+
+        RETURN_STATUS_IF_FAILED(impl::SetupDisplacementWorkItems(m_stdAllocator, desc, options, dmmWorkItems, edgeRing, primitiveLevels));
+
+        RETURN_STATUS_IF_FAILED(impl::ResampleDisplacement(desc, options, dmmWorkItems));
+
+        RETURN_STATUS_IF_FAILED(impl::DemoteUniformDisplacement(m_stdAllocator, options, edgeRing, primitiveLevels, dmmWorkItems));
+
+        RETURN_STATUS_IF_FAILED(impl::DeduplicateDisplacementExact(m_stdAllocator, options, dmmWorkItems));
+
+        RETURN_STATUS_IF_FAILED(impl::SerializeDisplacement(desc, edgeRing, primitiveLevels, dmmWorkItems, m_bakeResult));
+
+        return Result::SUCCESS;
+    }
+
 } // namespace Cpu
 } // namespace omm
\ No newline at end of file
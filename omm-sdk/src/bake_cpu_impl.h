@@ -19,6 +19,7 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include <shared/texture.h>
 
 #include <map>
+#include <mutex>
 #include <set>
 
 #include "std_allocator.h"
@@ -27,12 +28,25 @@ namespace omm
 {
 namespace Cpu
 {
+    inline bool operator==(const TextureContentKey& lhs, const TextureContentKey& rhs)
+    {
+        return lhs.hash[0] == rhs.hash[0] && lhs.hash[1] == rhs.hash[1] && lhs.format == rhs.format &&
+            lhs.flags == rhs.flags && lhs.mipCount == rhs.mipCount && lhs.width == rhs.width && lhs.height == rhs.height;
+    }
+
     class BakerImpl
     {
     // Internal
     public:
         inline BakerImpl(const StdAllocator<uint8_t>& stdAllocator) :
-            m_stdAllocator(stdAllocator)
+            m_stdAllocator(stdAllocator),
+            m_largeBufferFlags(LargeBufferFlags::None),
+            m_textureCacheSizeInBytes(0),
+            m_textureCache(stdAllocator),
+            m_cachedTextures(stdAllocator),
+            m_lruHead(nullptr),
+            m_lruTail(nullptr),
+            m_unreferencedTextureSize(0)
         {}
 
         ~BakerImpl();
@@ -42,11 +56,51 @@ namespace Cpu
 
         Result Create(const BakerCreationDesc& bakeCreationDesc);
         Result BakeOpacityMicromap(const Cpu::BakeInputDesc& bakeInputDesc, Cpu::BakeResult* bakeOutput);
+        Result GetPreBakeEstimate(const Cpu::BakeInputDesc& bakeInputDesc, Cpu::PreBakeEstimate* outPreBakeEstimate);
+        Result BakeOpacityMicromapDispatch(const Gpu::BakeDispatchConfigDesc& config, const Cpu::BakeDispatchInputDesc& inputDesc, Cpu::DispatchBakeResult* bakeOutput);
+        Result BakeDisplacementMicromap(const Cpu::BakeDisplacementInputDesc& bakeInputDesc, Cpu::DisplacementBakeResult* bakeOutput);
+        Result CreateTexture(const Cpu::TextureDesc& desc, Cpu::Texture* outTexture);
+        Result DestroyTexture(Cpu::Texture texture);
+        Result AcquireCachedTexture(const Cpu::TextureContentKey& contentKey, Cpu::Texture* outTexture);
 
     private:
         Result Validate(const Cpu::BakeInputDesc& desc);
+        struct CachedTexture;
+        void AddToLru(CachedTexture* entry);
+        void RemoveFromLru(CachedTexture* entry);
+        void EvictUnreferencedTextures();
     private:
+        struct ContentKeyHash
+        {
+            size_t operator()(const Cpu::TextureContentKey& key) const
+            {
+                return (size_t)key.hash[0];
+            }
+        };
+
+        struct CachedTexture
+        {
+            Cpu::TextureContentKey contentKey;
+            TextureImpl* texture;
+            uint32_t refCount;
+            // Intrusive list of the unreferenced textures, least recently used first.
+            CachedTexture* lruPrev;
+            CachedTexture* lruNext;
+        };
+
         StdAllocator<uint8_t> m_stdAllocator;
+        LargeBufferFlags m_largeBufferFlags;
+
+        // Texture cache, see BakerCreationDesc::textureCacheSizeInBytes.
+        size_t m_textureCacheSizeInBytes;
+        std::mutex m_textureCacheMutex;
+        // Keyed by TextureImpl::GetContentKey, a 128 bit hash is trusted as the identity of the texels.
+        // Nodes of the unordered map are stable, the LRU list and m_cachedTextures point in to them.
+        hash_map<Cpu::TextureContentKey, CachedTexture, ContentKeyHash> m_textureCache;
+        hash_map<const TextureImpl*, CachedTexture*> m_cachedTextures;
+        CachedTexture* m_lruHead;
+        CachedTexture* m_lruTail;
+        size_t m_unreferencedTextureSize;
     };
 
     struct BakeResultImpl
@@ -57,13 +111,15 @@ namespace Cpu
         vector<uint8_t> ommArrayData;
         vector<OpacityMicromapUsageCount> ommArrayHistogram;
         vector<OpacityMicromapUsageCount> ommIndexHistogram;
+        vector<PrimitiveCoverage> primitiveCoverage;
 
         BakeResultImpl(const StdAllocator<uint8_t>& stdAllocator) :
             ommIndexBuffer(stdAllocator),
             ommDescArray(stdAllocator),
             ommArrayData(stdAllocator),
             ommArrayHistogram(stdAllocator),
-            ommIndexHistogram(stdAllocator)
+            ommIndexHistogram(stdAllocator),
+            primitiveCoverage(stdAllocator)
         {
         }
 
@@ -80,6 +136,8 @@ namespace Cpu
             bakeOutputDesc.ommIndexFormat               = ommIndexFormat;
             bakeOutputDesc.ommIndexHistogram            = ommIndexHistogram.data();
             bakeOutputDesc.ommIndexHistogramCount       = (uint32_t)ommIndexHistogram.size();
+            bakeOutputDesc.primitiveCoverage            = primitiveCoverage.empty() ? nullptr : primitiveCoverage.data();
+            bakeOutputDesc.primitiveCoverageCount       = (uint32_t)primitiveCoverage.size();
         }
     };
 
@@ -105,7 +163,9 @@ namespace Cpu
             return Result::SUCCESS;
         }
 
-        Result Bake(const Cpu::BakeInputDesc& desc);
+        Result Bake(const Cpu::BakeInputDesc& desc, LargeBufferFlags largeBufferFlags = LargeBufferFlags::None);
+
+        static Result GetPreBakeEstimate(StdAllocator<uint8_t>& stdAllocator, const Cpu::BakeInputDesc& desc, Cpu::PreBakeEstimate* outPreBakeEstimate);
 
     private:
         static Result ValidateDesc(const BakeInputDesc& desc);
@@ -113,14 +173,82 @@ namespace Cpu
         template<TilingMode eTextureFormat, TextureAddressMode eTextureAddressMode, TextureFilterMode eFilterMode>
         Result BakeImpl(const Cpu::BakeInputDesc& desc);
 
-        template<class... TArgs>
-        void RegisterDispatch(TArgs... args, std::function < Result(const Cpu::BakeInputDesc& desc)> fn);
-        map<std::tuple<TilingMode, TextureAddressMode, TextureFilterMode>, std::function<Result(const Cpu::BakeInputDesc& desc)>> bakeDispatchTable;
+        using BakeFn = Result(BakeOutputImpl::*)(const Cpu::BakeInputDesc& desc);
+        struct DispatchTable
+        {
+            BakeFn bake[(uint32_t)TilingMode::MAX_NUM][(uint32_t)TextureAddressMode::MAX_NUM][(uint32_t)TextureFilterMode::MAX_NUM] = {};
+        };
+        // Immutable, built on first use and shared by all bakes, bakers and threads.
+        static const DispatchTable& GetDispatchTable();
         Result InvokeDispatch(const Cpu::BakeInputDesc& desc);
     private:
         StdAllocator<uint8_t> m_stdAllocator;
         Cpu::BakeInputDesc m_bakeInputDesc;
         BakeResultImpl m_bakeResult;
+        LargeBufferFlags m_largeBufferFlags;
+    };
+
+    struct DisplacementBakeResultImpl
+    {
+        Cpu::BakeDisplacementResultDesc bakeOutputDesc;
+        vector<uint32_t> dmmIndexBuffer;
+        vector<DisplacementMicromapDesc> dmmDescArray;
+        vector<uint8_t> dmmArrayData;
+        vector<DisplacementMicromapUsageCount> dmmArrayHistogram;
+        vector<DisplacementMicromapUsageCount> dmmIndexHistogram;
+        vector<DisplacementEdgeFlags> dmmEdgeFlags;
+
+        DisplacementBakeResultImpl(const StdAllocator<uint8_t>& stdAllocator) :
+            dmmIndexBuffer(stdAllocator),
+            dmmDescArray(stdAllocator),
+            dmmArrayData(stdAllocator),
+            dmmArrayHistogram(stdAllocator),
+            dmmIndexHistogram(stdAllocator),
+            dmmEdgeFlags(stdAllocator)
+        {
+        }
+
+        void Finalize(IndexFormat dmmIndexFormat)
+        {
+            bakeOutputDesc.dmmArrayData                 = dmmArrayData.data();
+            bakeOutputDesc.dmmArrayDataSize             = (uint32_t)dmmArrayData.size();
+            bakeOutputDesc.dmmDescArray                 = dmmDescArray.data();
+            bakeOutputDesc.dmmDescArrayCount            = (uint32_t)dmmDescArray.size();
+            bakeOutputDesc.dmmDescArrayHistogram        = dmmArrayHistogram.data();
+            bakeOutputDesc.dmmDescArrayHistogramCount   = (uint32_t)dmmArrayHistogram.size();
+            bakeOutputDesc.dmmIndexBuffer               = dmmIndexBuffer.data();
+            bakeOutputDesc.dmmIndexCount                = (uint32_t)dmmIndexBuffer.size();
+            bakeOutputDesc.dmmIndexFormat               = dmmIndexFormat;
+            bakeOutputDesc.dmmIndexHistogram            = dmmIndexHistogram.data();
+            bakeOutputDesc.dmmIndexHistogramCount       = (uint32_t)dmmIndexHistogram.size();
+            bakeOutputDesc.dmmEdgeFlags                 = dmmEdgeFlags.data();
+            bakeOutputDesc.dmmEdgeFlagsCount            = (uint32_t)dmmEdgeFlags.size();
+        }
+    };
+
+    class DisplacementBakeOutputImpl
+    {
+    public:
+        DisplacementBakeOutputImpl(const StdAllocator<uint8_t>& stdAllocator);
+
+        inline StdAllocator<uint8_t>& GetStdAllocator()
+        {
+            return m_stdAllocator;
+        }
+
+        inline Result GetBakeResultDesc(const Cpu::BakeDisplacementResultDesc*& desc)
+        {
+            desc = &m_bakeResult.bakeOutputDesc;
+            return Result::SUCCESS;
+        }
+
+        Result Bake(const Cpu::BakeDisplacementInputDesc& desc);
+
+    private:
+        static Result ValidateDesc(const BakeDisplacementInputDesc& desc);
+    private:
+        StdAllocator<uint8_t> m_stdAllocator;
+        DisplacementBakeResultImpl m_bakeResult;
     };
 } // namespace Cpu
 } // namespace omm
@@ -239,7 +239,7 @@ Result PipelineImpl::Validate(const BakePipelineConfigDesc& config)
     return Result::SUCCESS;
 }
 
-Result PipelineImpl::Validate(const BakeDispatchConfigDesc& config) const
+Result PipelineImpl::Validate(const BakeDispatchConfigDesc& config)
 {
     const uint32_t MaxSubdivLevelAPI    = kMaxSubdivLevel;
     const uint32_t MaxSubdivLevel       = std::min<uint32_t>(MaxSubdivLevelAPI, OmmStaticBuffersImpl::kMaxSubdivisionLevelNum);
@@ -260,6 +260,8 @@ Result PipelineImpl::Validate(const BakeDispatchConfigDesc& config) const
         return Result::NOT_IMPLEMENTED;
     if (config.alphaTextureChannel > 3)
         return Result::INVALID_ARGUMENT;
+    if (config.runtimeSamplerDesc.maxAnisotropy != 1)
+        return Result::NOT_IMPLEMENTED;
 
     return Result::SUCCESS;
 }
@@ -619,6 +621,11 @@ Result PipelineImpl::GetPreBakeInfo(const BakeDispatchConfigDesc& config, PreBak
     outPreBuildInfo->transientPoolBufferSizeInBytes[info.indArgBuffer.indexInPool]     = info.indArgBuffer.allocator.GetCurrentReservation();
     outPreBuildInfo->transientPoolBufferSizeInBytes[info.debugBuffer.indexInPool]      = info.debugBuffer.allocator.GetCurrentReservation();
 
+    return GetOutputBufferInfo(config, outPreBuildInfo);
+}
+
+Result PipelineImpl::GetOutputBufferInfo(const BakeDispatchConfigDesc& config, PreBakeInfo* outPreBuildInfo)
+{
     const bool force32BitIndices = ((uint32_t)config.bakeFlags & (uint32_t)BakeFlags::Force32BitIndices) == (uint32_t)BakeFlags::Force32BitIndices;
 
     constexpr uint32_t kNumSpecialIndices = 4;
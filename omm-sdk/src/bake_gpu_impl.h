@@ -927,7 +927,9 @@ namespace Gpu
             return m_stdAllocator;
         }
         static Result Validate(const BakePipelineConfigDesc& config);
-        Result Validate(const BakeDispatchConfigDesc& config) const;
+        static Result Validate(const BakeDispatchConfigDesc& config);
+        // Output buffer part of the PreBakeInfo, independent of the pipeline.
+        static Result GetOutputBufferInfo(const BakeDispatchConfigDesc& config, PreBakeInfo* outPreBuildInfo);
         Result Create(const BakePipelineConfigDesc& config);
         Result GetPipelineDesc(const BakePipelineInfoDesc*& outPipelineDesc);
         Result GetPreBakeInfo(const BakeDispatchConfigDesc& config, PreBakeInfo* outPreBuildInfo);
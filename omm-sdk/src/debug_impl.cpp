@@ -25,6 +25,8 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include <filesystem>
 #include <fstream>
 #include <algorithm>
+#include <bit>
+#include <cstring>
 #include <optional>
 
 namespace omm
@@ -104,6 +106,7 @@ namespace omm
         int GetWidth() const { return _size.x; }
         int GetHeight() const { return _size.y; }
         const char* GetData() const { return (const char*)_data.data(); }
+        char* GetData() { return (char*)_data.data(); }
         size_t GetDataSize() const { return _size.x * _size.y * sizeof(T); }
 
     private:
@@ -117,6 +120,20 @@ namespace omm
         vector<T> _data;
     };
 
+    static const float3 kStateColorDefaultLUT[4] = {
+        float3{0,     0,      1.f}, // Transparent
+        float3{0,     1.f,      0}, // Opaque
+        float3{1.f,   0,      1.f}, // UnknownTransparent
+        float3{1.f,   1.f,    0.f}, // UnknownOpaque
+    };
+
+    static const float3 kStateColorMonoLUT[4] = {
+        float3{0,     0,      1.f}, // Transparent
+        float3{0,     1.f,      0}, // Opaque
+        float3{1.f,   1,      0.f}, // UnknownTransparent
+        float3{1.f,   1.f,    0.f}, // UnknownOpaque
+    };
+
     using ImageRGB = Image<uchar3>;
     using ImageRGBA = Image<uchar4>;
     using ImageAlpha = Image<uint8_t>;
@@ -144,6 +161,26 @@ namespace omm
 
         TextureImpl* texImpl = (TextureImpl*)desc.texture;
 
+        if (dumpDesc.oneFile)
+        {
+            // The whole texture in a single image, same scale as below.
+            const int2 size = texImpl->GetSize(0) * 5;
+            std::optional<ImageRGBA> target;
+            target.emplace(ImageRGBA(memoryAllocator, size, uchar4(0)));
+
+            Debug::RenderImageDesc renderDesc;
+            renderDesc.width = (uint32_t)size.x;
+            renderDesc.height = (uint32_t)size.y;
+            renderDesc.outRGBA = (uint8_t*)target->GetData();
+            renderDesc.monochromeUnknowns = dumpDesc.monochromeUnknowns;
+            RETURN_STATUS_IF_FAILED(RenderImageImpl(memoryAllocator, desc, resDesc, renderDesc));
+
+            bool res = SaveImageToFile(dumpDesc.path, std::to_string(/*meshIt*/ 0) + "_" + std::string(dumpDesc.filePostfix) + ".png", target);
+            if (!res)
+                return Result::FAILURE;
+            return Result::SUCCESS;
+        }
+
         vector<omm::OpacityState> states(memoryAllocator);
         set<int32_t> dumpedOMMs(memoryAllocator);
 
@@ -183,9 +220,12 @@ namespace omm
 
             // Construct the UV-mactro triangle from the model source data
             uint32_t triangleIndices[3];
-            GetUInt32Indices(desc.indexFormat, desc.indexBuffer, 3ull * primIt, triangleIndices);
+            GetUInt32Indices(desc.indexFormat, desc.indexBuffer, desc.indexOffset, desc.baseVertex, 3ull * primIt, triangleIndices);
 
-            omm::Triangle macroTriangle = FetchUVTriangle(desc.texCoords, texCoordStrideInBytes, desc.texCoordFormat, triangleIndices);
+            // Only the first frame is drawn.
+            const Cpu::TexCoordTransform* frameTransform = desc.frameCount == 0 ? nullptr : desc.frameTexCoordTransforms;
+            omm::Triangle macroTriangle = TransformUVTriangle(
+                FetchUVTriangle(desc.texCoords, texCoordStrideInBytes, desc.texCoordFormat, triangleIndices), desc.texCoordTransform, frameTransform);
 
             const bool ClippedViewport = dumpDesc.detailedCutout;
 
@@ -209,21 +249,7 @@ namespace omm
                 size = srcSize;// int2(float2(srcSize)* (macroTriangle.aabb_e - macroTriangle.aabb_s)) + int2{ 1,1 };
             }
 
-            static float3 kStateColorDefaultLUT[4] = {
-                float3{0,     0,      1.f}, // Transparent
-                float3{0,     1.f,      0}, // Opaque
-                float3{1.f,   0,      1.f}, // UnknownTransparent
-                float3{1.f,   1.f,    0.f}, // UnknownOpaque
-            };
-
-            static float3 kStateColorMonoLUT[4] = {
-                float3{0,     0,      1.f}, // Transparent
-                float3{0,     1.f,      0}, // Opaque
-                float3{1.f,   1,      0.f}, // UnknownTransparent
-                float3{1.f,   1.f,    0.f}, // UnknownOpaque
-            };
-
-            float3* stateColorLUT = dumpDesc.monochromeUnknowns ? kStateColorMonoLUT : kStateColorDefaultLUT;
+            const float3* stateColorLUT = dumpDesc.monochromeUnknowns ? kStateColorMonoLUT : kStateColorDefaultLUT;
 
             {
                 enum class Mode {
@@ -368,7 +394,7 @@ namespace omm
                 params.runtimeSamplerDesc = desc.runtimeSamplerDesc;
                 params.target = &target;
                 params.srcAlphaFp = alphaFps.data();
-                params.alphaCutoff = (float)desc.alphaCutoff;
+                params.alphaCutoff = desc.alphaCutoffs ? desc.alphaCutoffs[primIt] : desc.alphaCutoff;
                 params.invSrcSize = 1.f / float2(srcSize);
                 params.srcSize = srcSize;
                 params.offset = offset;
@@ -416,7 +442,6 @@ namespace omm
                     omm::RasterizeConservativeParallel(macroTriangle, srcSize, Kernel, &params);
                 }
 
-                if (!dumpDesc.oneFile || primitiveCount == primIt + 1)
                 { 
                     // Fill in the contour line(s).
                     for (uint32_t mipIt = 0; mipIt < texImpl->GetMipCount(); mipIt++)
@@ -449,7 +474,6 @@ namespace omm
                     }
                 }
 
-                if (!dumpDesc.oneFile)
                 {
                     bool res = SaveImageToFile(dumpDesc.path, std::to_string(/*meshIt*/ 0) + "_" + std::to_string(primIt) + "_" + std::string(dumpDesc.filePostfix) + ".png", target);
                     if (!res)
@@ -459,99 +483,345 @@ namespace omm
             }
         }
 
-        if (dumpDesc.oneFile)
+        return Result::SUCCESS;
+    }
+
+    static constexpr int32_t kRenderTileSize = 64;
+
+    struct RenderPrimitive
+    {
+        Triangle uvTriangle;
+        int32_t vmIdx;
+        uint32_t subdivisionLevel;
+        bool highlightReuse;
+    };
+
+    static OpacityState GetOmmState(const Cpu::BakeResultDesc& resDesc, int32_t vmIdx, uint32_t uTriIt)
+    {
+        if (vmIdx < 0)
+            return (OpacityState)~vmIdx;
+
+        const Cpu::OpacityMicromapDesc& vmDesc = resDesc.ommDescArray[vmIdx];
+        const uint8_t* ommArrayData = (const uint8_t*)resDesc.ommArrayData + vmDesc.offset;
+        if ((OMMFormat)vmDesc.format == OMMFormat::OC1_2_State)
+            return OpacityState((ommArrayData[uTriIt >> 3] >> (uTriIt & 7)) & 1);
+        return OpacityState((ommArrayData[uTriIt >> 2] >> ((uTriIt << 1) & 7)) & 3);
+    }
+
+    static float SampleAlpha(const TextureImpl* texture, const SamplerDesc& samplerDesc, const float2& uv)
+    {
+        if (samplerDesc.filter == TextureFilterMode::Linear)
+            return texture->Bilinear(samplerDesc.addressingMode, uv, 0, samplerDesc.borderAlpha);
+
+        const int2 size = texture->GetSize(0);
+        const int2 coord = GetTexCoord(samplerDesc.addressingMode, int2(glm::floor(uv * float2(size))), size);
+        if (coord.x == kTexCoordBorder || coord.y == kTexCoordBorder)
+            return samplerDesc.borderAlpha;
+        return texture->Load(coord, 0);
+    }
+
+    static Result ValidateRenderImageDesc(const Cpu::BakeInputDesc& desc, const Cpu::BakeResultDesc* resDesc, const Debug::RenderImageDesc& renderDesc)
+    {
+        if (desc.texture == 0 || resDesc == nullptr)
+            return Result::INVALID_ARGUMENT;
+        if (renderDesc.width == 0 || renderDesc.height == 0 || renderDesc.outRGBA == nullptr)
+            return Result::INVALID_ARGUMENT;
+        if (renderDesc.rowPitch != 0 && renderDesc.rowPitch < renderDesc.width * 4)
+            return Result::INVALID_ARGUMENT;
+        if (renderDesc.primitiveIndex != 0xFFFFFFFF)
         {
-            bool res = SaveImageToFile(dumpDesc.path, std::to_string(/*meshIt*/ 0) + "_" + std::string(dumpDesc.filePostfix) + ".png", target);
-            if (!res)
-                return Result::FAILURE;
+            if (renderDesc.primitiveIndex >= desc.indexCount / 3 || !(renderDesc.neighbourhoodScale > 0.f))
+                return Result::INVALID_ARGUMENT;
+        }
+        else if (!(renderDesc.uvMin[0] < renderDesc.uvMax[0]) || !(renderDesc.uvMin[1] < renderDesc.uvMax[1]))
+            return Result::INVALID_ARGUMENT;
+        return Result::SUCCESS;
+    }
+
+    Result RenderImageImpl(StdAllocator<uint8_t>& memoryAllocator, const Cpu::BakeInputDesc& desc, const Cpu::BakeResultDesc* resDesc, const Debug::RenderImageDesc& renderDesc)
+    {
+        RETURN_STATUS_IF_FAILED(ValidateRenderImageDesc(desc, resDesc, renderDesc));
+
+        const TextureImpl* texImpl = (const TextureImpl*)desc.texture;
+        const uint32_t primitiveCount = desc.indexCount / 3;
+        const uint32_t texCoordStrideInBytes = desc.texCoordStrideInBytes == 0 ? GetTexCoordFormatSize(desc.texCoordFormat) : desc.texCoordStrideInBytes;
+        // Only the first frame is drawn.
+        const Cpu::TexCoordTransform* frameTransform = desc.frameCount == 0 ? nullptr : desc.frameTexCoordTransforms;
+
+        auto GetUVTriangle = [&](uint32_t primIt) {
+            uint32_t triangleIndices[3];
+            GetUInt32Indices(desc.indexFormat, desc.indexBuffer, desc.indexOffset, desc.baseVertex, 3ull * primIt, triangleIndices);
+            return TransformUVTriangle(FetchUVTriangle(desc.texCoords, texCoordStrideInBytes, desc.texCoordFormat, triangleIndices), desc.texCoordTransform, frameTransform);
+        };
+
+        // 1. Resolve the region of interest.
+        float2 uvMin = float2(renderDesc.uvMin[0], renderDesc.uvMin[1]);
+        float2 uvMax = float2(renderDesc.uvMax[0], renderDesc.uvMax[1]);
+        if (renderDesc.primitiveIndex != 0xFFFFFFFF)
+        {
+            const Triangle t = GetUVTriangle(renderDesc.primitiveIndex);
+            const float2 center = 0.5f * (t.aabb_s + t.aabb_e);
+            const float2 halfExtent = glm::max(0.5f * renderDesc.neighbourhoodScale * (t.aabb_e - t.aabb_s), float2(1e-6f));
+            uvMin = center - halfExtent;
+            uvMax = center + halfExtent;
+        }
+
+        const int2 size = int2(renderDesc.width, renderDesc.height);
+        const float2 uvExtent = uvMax - uvMin;
+        const float2 pixelsPerUV = float2(size) / uvExtent;
+        const int2 tileCount = (size + kRenderTileSize - 1) / kRenderTileSize;
+
+        // 2. Gather the primitives overlapping the region of interest and bin them per tile.
+        // Primitives are binned in order, overlapping primitives blend the same way as in SaveAsImages.
+        vector<RenderPrimitive> primitives(memoryAllocator);
+        vector<std::pair<int2, int2>> primitiveTiles(memoryAllocator);
+        {
+            set<int32_t> drawnOMMs(memoryAllocator);
+            for (uint32_t primIt = 0; primIt < primitiveCount; ++primIt)
+            {
+                const Triangle t = GetUVTriangle(primIt);
+
+                // One pixel of slack, coverage is tested on the pixel centers.
+                const float2 pixelS = glm::floor((t.aabb_s - uvMin) * pixelsPerUV) - 1.f;
+                const float2 pixelE = glm::floor((t.aabb_e - uvMin) * pixelsPerUV) + 1.f;
+                if (pixelE.x < 0.f || pixelE.y < 0.f || pixelS.x >= (float)size.x || pixelS.y >= (float)size.y)
+                    continue;
+                if (glm::any(glm::isnan(pixelS)) || glm::any(glm::isnan(pixelE)))
+                    continue;
+
+                // Clamp before converting, UVs far outside the region would overflow.
+                const int2 tileS = int2(glm::clamp(pixelS, float2(0.f), float2(size - 1))) / kRenderTileSize;
+                const int2 tileE = int2(glm::clamp(pixelE, float2(0.f), float2(size - 1))) / kRenderTileSize;
+
+                const int32_t vmIdx = parse::GetOmmIndexForTriangleIndex(*resDesc, primIt);
+                const bool isSpecialIndex = vmIdx < 0;
+                const bool isAlreadyDrawn = !drawnOMMs.insert(vmIdx).second;
+
+                RenderPrimitive primitive;
+                primitive.uvTriangle = t;
+                primitive.vmIdx = vmIdx;
+                primitive.subdivisionLevel = isSpecialIndex ? 0 : resDesc->ommDescArray[vmIdx].subdivisionLevel;
+                primitive.highlightReuse = isAlreadyDrawn && !isSpecialIndex;
+                primitives.push_back(primitive);
+                primitiveTiles.push_back({ tileS, tileE });
+            }
+        }
+
+        vector<uint32_t> tileOffsets(memoryAllocator);
+        vector<uint32_t> tilePrimitives(memoryAllocator);
+        {
+            const size_t numTiles = size_t(tileCount.x) * tileCount.y;
+            tileOffsets.resize(numTiles + 1, 0u);
+
+            auto ForEachTile = [&tileCount](const std::pair<int2, int2>& tiles, auto fn) {
+                for (int32_t j = tiles.first.y; j <= tiles.second.y; ++j)
+                    for (int32_t i = tiles.first.x; i <= tiles.second.x; ++i)
+                        fn(uint32_t(j * tileCount.x + i));
+            };
+
+            for (const auto& tiles : primitiveTiles)
+                ForEachTile(tiles, [&tileOffsets](uint32_t tileIndex) { tileOffsets[tileIndex + 1]++; });
+
+            for (size_t tileIt = 0; tileIt < numTiles; ++tileIt)
+                tileOffsets[tileIt + 1] += tileOffsets[tileIt];
+
+            tilePrimitives.resize(tileOffsets[numTiles]);
+            vector<uint32_t> tileFill(tileOffsets.begin(), tileOffsets.end() - 1, memoryAllocator);
+            for (uint32_t primIt = 0; primIt < (uint32_t)primitives.size(); ++primIt)
+                ForEachTile(primitiveTiles[primIt], [&](uint32_t tileIndex) { tilePrimitives[tileFill[tileIndex]++] = primIt; });
+        }
+
+        // 3. Render the tiles.
+        const float3* stateColorLUT = renderDesc.monochromeUnknowns ? kStateColorMonoLUT : kStateColorDefaultLUT;
+        const size_t rowPitch = renderDesc.rowPitch == 0 ? size_t(renderDesc.width) * 4 : renderDesc.rowPitch;
+        const int32_t numTiles = tileCount.x * tileCount.y;
+
+        #pragma omp parallel for
+        for (int32_t tileIt = 0; tileIt < numTiles; ++tileIt)
+        {
+            const int2 tile = int2(tileIt % tileCount.x, tileIt / tileCount.x);
+            const int2 pixelS = tile * kRenderTileSize;
+            const int2 pixelE = glm::min(pixelS + kRenderTileSize, size);
+
+            for (int32_t y = pixelS.y; y < pixelE.y; ++y)
+            {
+                uint8_t* row = renderDesc.outRGBA + size_t(y) * rowPitch;
+                for (int32_t x = pixelS.x; x < pixelE.x; ++x)
+                {
+                    // Background, the alpha texture as seen by the runtime sampler.
+                    const float2 uv = uvMin + (float2(x, y) + 0.5f) * uvExtent / float2(size);
+                    float3 color = float3(SampleAlpha(texImpl, desc.runtimeSamplerDesc, uv));
+
+                    // Blend in the state of each micro-triangle covering the pixel center.
+                    for (uint32_t it = tileOffsets[tileIt]; it < tileOffsets[tileIt + 1]; ++it)
+                    {
+                        const RenderPrimitive& primitive = primitives[tilePrimitives[it]];
+                        const Triangle& t = primitive.uvTriangle;
+
+                        const float2 e1 = t.p1 - t.p0;
+                        const float2 e2 = t.p2 - t.p0;
+                        const float2 d = uv - t.p0;
+                        const float det = e1.x * e2.y - e1.y * e2.x;
+                        if (det == 0.f)
+                            continue;
+
+                        const float2 bc = float2(d.x * e2.y - d.y * e2.x, e1.x * d.y - e1.y * d.x) / det;
+                        if (bc.x < 0.f || bc.y < 0.f || bc.x + bc.y > 1.f)
+                            continue;
+
+                        bool isUpright = false;
+                        uint32_t uTriIt = omm::bird::bary2index(glm::saturate(bc), primitive.subdivisionLevel, isUpright);
+                        uTriIt = std::min<uint32_t>(uTriIt, omm::bird::GetNumMicroTriangles(primitive.subdivisionLevel) - 1);
+
+                        float3 vmColor = stateColorLUT[(uint32_t)GetOmmState(*resDesc, primitive.vmIdx, uTriIt)];
+                        if (isUpright)
+                            vmColor = vmColor * 0.9f;
+
+                        const float3 tint = primitive.highlightReuse ? float3(0.5f, 0.5f, 0.5f) : float3(1.f);
+                        color = tint * glm::lerp(vmColor, color, 0.5f);
+                    }
+
+                    // Contour line, the pixel corners straddle the alpha cutoff.
+                    {
+                        uint32_t opaque = 0;
+                        for (int32_t corner = 0; corner < 4; ++corner)
+                        {
+                            const float2 cornerUV = uvMin + float2(x + (corner & 1), y + (corner >> 1)) * uvExtent / float2(size);
+                            if (desc.alphaCutoff < SampleAlpha(texImpl, desc.runtimeSamplerDesc, cornerUV))
+                                opaque++;
+                        }
+                        if (opaque != 0 && opaque != 4)
+                            color = float3(1.f, 0.f, 0.f);
+                    }
+
+                    const float3 rgb = glm::saturate(color) * 255.f;
+                    uint8_t* pixel = row + size_t(x) * 4;
+                    pixel[0] = (uint8_t)rgb.r;
+                    pixel[1] = (uint8_t)rgb.g;
+                    pixel[2] = (uint8_t)rgb.b;
+                    pixel[3] = 255;
+                }
+            }
         }
 
         return Result::SUCCESS;
     }
 
+    struct OmmStateCounts
+    {
+        uint64_t opaque = 0;
+        uint64_t transparent = 0;
+        uint64_t unknownOpaque = 0;
+        uint64_t unknownTransparent = 0;
+    };
+
+    // Counts the states of a single OMM a 64-bit word at a time.
+    // 4-state encodes two bits per micro-triangle: low bit = opaque, high bit = unknown.
+    static OmmStateCounts CountOmmStates(const uint8_t* ommArrayData, uint32_t subdivisionLevel, bool is2State)
+    {
+        static constexpr uint64_t kLowBits = 0x5555555555555555ull;
+
+        const uint32_t numMicroTriangles = 1u << (subdivisionLevel << 1u);
+        const uint32_t numBits = numMicroTriangles << (is2State ? 0 : 1);
+
+        OmmStateCounts counts;
+        for (uint32_t bitIt = 0; bitIt < numBits; bitIt += 64)
+        {
+            // OMM data is only byte aligned, and the last word of small OMMs is partial.
+            const uint32_t wordBits = std::min(numBits - bitIt, 64u);
+            uint64_t word = 0;
+            std::memcpy(&word, ommArrayData + (bitIt >> 3), (wordBits + 7) >> 3);
+            if (wordBits < 64)
+                word &= (1ull << wordBits) - 1ull;
+
+            if (is2State)
+            {
+                counts.opaque += std::popcount(word);
+            }
+            else
+            {
+                const uint64_t lo = word & kLowBits;
+                const uint64_t hi = (word >> 1) & kLowBits;
+                counts.opaque += std::popcount(lo & ~hi);
+                counts.unknownTransparent += std::popcount(hi & ~lo);
+                counts.unknownOpaque += std::popcount(lo & hi);
+            }
+        }
+        counts.transparent = numMicroTriangles - counts.opaque - counts.unknownOpaque - counts.unknownTransparent;
+        return counts;
+    }
+
     static Debug::Stats CollectStats(StdAllocator<uint8_t>& memoryAllocator, const omm::Cpu::BakeResultDesc& resDesc) {
 
-        Debug::Stats stats;
+        const int32_t triangleCount = (int32_t)resDesc.ommIndexCount;
+        const int32_t descCount = (int32_t)resDesc.ommDescArrayCount;
 
-        const uint32_t triangleCount = resDesc.ommIndexCount;
+        // 1. Special indices and the reference count of each OMM in a single pass over the index buffer.
+        uint64_t totalFullyOpaque = 0;
+        uint64_t totalFullyTransparent = 0;
+        uint64_t totalFullyUnknownOpaque = 0;
+        uint64_t totalFullyUnknownTransparent = 0;
 
-        for (uint32_t i = 0; i < triangleCount; ++i) {
+        vector<uint32_t> refCounts(memoryAllocator);
+        refCounts.resize(descCount, 0u);
+
+        #pragma omp parallel for reduction(+ : totalFullyOpaque, totalFullyTransparent, totalFullyUnknownOpaque, totalFullyUnknownTransparent)
+        for (int32_t i = 0; i < triangleCount; ++i) {
 
             const int32_t vmIdx = omm::parse::GetOmmIndexForTriangleIndex(resDesc, i);
 
             if (vmIdx == (int32_t)omm::SpecialIndex::FullyTransparent) {
-                stats.totalFullyTransparent++;
+                totalFullyTransparent++;
             }
             else if (vmIdx == (int32_t)omm::SpecialIndex::FullyOpaque) {
-                stats.totalFullyOpaque++;
+                totalFullyOpaque++;
             }
             else if (vmIdx == (int32_t)omm::SpecialIndex::FullyUnknownTransparent) {
-                stats.totalFullyUnknownTransparent++;
+                totalFullyUnknownTransparent++;
             }
             else if (vmIdx == (int32_t)omm::SpecialIndex::FullyUnknownOpaque) {
-                stats.totalFullyUnknownOpaque++;
+                totalFullyUnknownOpaque++;
             }
             else {
-                OMM_ASSERT(vmIdx < (int32_t)resDesc.ommDescArrayCount);
-                // Calculate later
+                OMM_ASSERT(vmIdx < descCount);
+                #pragma omp atomic
+                refCounts[vmIdx]++;
             }
         }
 
-        struct DescStats
-        {
-            uint64_t totalOpaque = 0;
-            uint64_t totalTransparent = 0;
-            uint64_t totalUnknownOpaque = 0;
-            uint64_t totalUnknownTransparent = 0;
-        };
+        // 2. Decode each unique OMM once, weighted by the number of triangles referencing it.
+        uint64_t totalOpaque = 0;
+        uint64_t totalTransparent = 0;
+        uint64_t totalUnknownOpaque = 0;
+        uint64_t totalUnknownTransparent = 0;
 
-        vector<DescStats> descStats(memoryAllocator);
-        descStats.resize(resDesc.ommDescArrayCount);
-        for (uint32_t i = 0; i < resDesc.ommDescArrayCount; ++i)
+        #pragma omp parallel for reduction(+ : totalOpaque, totalTransparent, totalUnknownOpaque, totalUnknownTransparent)
+        for (int32_t i = 0; i < descCount; ++i)
         {
-            OMM_ASSERT(i < resDesc.ommDescArrayCount);
+            const uint64_t refCount = refCounts[i];
+            if (refCount == 0)
+                continue;
 
             const omm::Cpu::OpacityMicromapDesc& vmDesc = resDesc.ommDescArray[i];
-            const uint8_t* ommArrayData = (const uint8_t*)((const char*)resDesc.ommArrayData) + vmDesc.offset;
-            const uint32_t numMicroTriangles = 1u << (vmDesc.subdivisionLevel << 1u);
-            const uint32_t is2State = (omm::OMMFormat)vmDesc.format == omm::OMMFormat::OC1_2_State ? 1 : 0;
-            for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
-            {
-                int byteIndex = uTriIt >> (2 + is2State);
-                uint8_t v = ((uint8_t*)ommArrayData)[byteIndex];
-                omm::OpacityState state;
-                if (is2State)   state = omm::OpacityState((v >> ((uTriIt << 0) & 7)) & 1); // 2-state
-                else			state = omm::OpacityState((v >> ((uTriIt << 1) & 7)) & 3); // 4-state
-
-                OMM_ASSERT(
-                    state == omm::OpacityState::Opaque ||
-                    state == omm::OpacityState::Transparent ||
-                    state == omm::OpacityState::UnknownOpaque ||
-                    state == omm::OpacityState::UnknownTransparent);
-
-                if (state == omm::OpacityState::Opaque)
-                    descStats[i].totalOpaque++;
-                else if (state == omm::OpacityState::Transparent)
-                    descStats[i].totalTransparent++;
-                else if (state == omm::OpacityState::UnknownOpaque)
-                    descStats[i].totalUnknownOpaque++;
-                else if (state == omm::OpacityState::UnknownTransparent)
-                    descStats[i].totalUnknownTransparent++;
-            }
-        }
-
-
-        for (uint32_t i = 0; i < resDesc.ommIndexCount; ++i)
-        {
-            int32_t index = resDesc.ommIndexFormat == IndexFormat::I16_UINT ? ((int16_t*)resDesc.ommIndexBuffer)[i] : ((int32_t*)resDesc.ommIndexBuffer)[i];
-            if (index < 0)
-                continue;
-            stats.totalOpaque += descStats[index].totalOpaque;
-            stats.totalTransparent += descStats[index].totalTransparent;
-            stats.totalUnknownOpaque += descStats[index].totalUnknownOpaque;
-            stats.totalUnknownTransparent += descStats[index].totalUnknownTransparent;
+            const uint8_t* ommArrayData = (const uint8_t*)resDesc.ommArrayData + vmDesc.offset;
+            const bool is2State = (omm::OMMFormat)vmDesc.format == omm::OMMFormat::OC1_2_State;
+
+            const OmmStateCounts counts = CountOmmStates(ommArrayData, vmDesc.subdivisionLevel, is2State);
+            totalOpaque += refCount * counts.opaque;
+            totalTransparent += refCount * counts.transparent;
+            totalUnknownOpaque += refCount * counts.unknownOpaque;
+            totalUnknownTransparent += refCount * counts.unknownTransparent;
         }
 
+        Debug::Stats stats;
+        stats.totalOpaque = totalOpaque;
+        stats.totalTransparent = totalTransparent;
+        stats.totalUnknownOpaque = totalUnknownOpaque;
+        stats.totalUnknownTransparent = totalUnknownTransparent;
+        stats.totalFullyOpaque = totalFullyOpaque;
+        stats.totalFullyTransparent = totalFullyTransparent;
+        stats.totalFullyUnknownOpaque = totalFullyUnknownOpaque;
+        stats.totalFullyUnknownTransparent = totalFullyUnknownTransparent;
         return stats;
     }
 
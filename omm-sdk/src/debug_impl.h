@@ -17,5 +17,7 @@ namespace omm
 {
     OMM_API Result SaveAsImagesImpl(StdAllocator<uint8_t>& memoryAllocator, const Cpu::BakeInputDesc& bakeInputDesc, const Cpu::BakeResultDesc* res, const Debug::SaveImagesDesc& desc);
 
+    OMM_API Result RenderImageImpl(StdAllocator<uint8_t>& memoryAllocator, const Cpu::BakeInputDesc& bakeInputDesc, const Cpu::BakeResultDesc* res, const Debug::RenderImageDesc& desc);
+
     OMM_API Result GetStatsImpl(StdAllocator<uint8_t>& memoryAllocator, const Cpu::BakeResultDesc* res, Debug::Stats* out);
 }
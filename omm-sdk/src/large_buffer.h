@@ -0,0 +1,48 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "omm.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#if __linux__
+#include <sys/mman.h>
+#endif
+
+namespace omm
+{
+    // Placement of the buffers covered by LargeBufferFlags, shared by the texture data and the work item states.
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    inline bool UseHugePages(LargeBufferFlags largeBufferFlags, size_t size)
+    {
+        return !!((uint32_t)largeBufferFlags & (uint32_t)LargeBufferFlags::HugePages) && size >= kHugePageSize;
+    }
+
+    inline bool UseParallelFirstTouch(LargeBufferFlags largeBufferFlags)
+    {
+        return !!((uint32_t)largeBufferFlags & (uint32_t)LargeBufferFlags::ParallelFirstTouch);
+    }
+
+    // Advisory only, when transparent huge pages are disabled the range keeps regular pages.
+    // Must be called before the range is first touched.
+    inline void AdviseHugePages(void* data, size_t size)
+    {
+#if __linux__ && defined(MADV_HUGEPAGE)
+        madvise(data, size, MADV_HUGEPAGE);
+#else
+        (void)data;
+        (void)size;
+#endif
+    }
+}
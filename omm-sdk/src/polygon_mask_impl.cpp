@@ -0,0 +1,229 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "polygon_mask_impl.h"
+#include "defines.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace omm
+{
+    static constexpr int32_t kMaxGridSize = 1024;
+
+    static double Orient(const float2& a, const float2& b, const float2& c)
+    {
+        return ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+    }
+
+    // p is known to be collinear with [a, b].
+    static bool IsOnSegment(const float2& a, const float2& b, const float2& p)
+    {
+        return std::min(a.x, b.x) <= p.x && p.x <= std::max(a.x, b.x) &&
+               std::min(a.y, b.y) <= p.y && p.y <= std::max(a.y, b.y);
+    }
+
+    // Closed segments, touching counts as intersecting.
+    static bool SegmentsIntersect(const float2& p0, const float2& p1, const float2& q0, const float2& q1)
+    {
+        const double d0 = Orient(q0, q1, p0);
+        const double d1 = Orient(q0, q1, p1);
+        const double d2 = Orient(p0, p1, q0);
+        const double d3 = Orient(p0, p1, q1);
+
+        if (((d0 > 0 && d1 < 0) || (d0 < 0 && d1 > 0)) && ((d2 > 0 && d3 < 0) || (d2 < 0 && d3 > 0)))
+            return true;
+
+        return (d0 == 0 && IsOnSegment(q0, q1, p0)) ||
+               (d1 == 0 && IsOnSegment(q0, q1, p1)) ||
+               (d2 == 0 && IsOnSegment(p0, p1, q0)) ||
+               (d3 == 0 && IsOnSegment(p0, p1, q1));
+    }
+
+    // Closed triangle, either winding.
+    static bool IsPointInTriangle(const Triangle& t, const float2& p)
+    {
+        const double d0 = Orient(t.p0, t.p1, p);
+        const double d1 = Orient(t.p1, t.p2, p);
+        const double d2 = Orient(t.p2, t.p0, p);
+        const bool hasNeg = d0 < 0 || d1 < 0 || d2 < 0;
+        const bool hasPos = d0 > 0 || d1 > 0 || d2 > 0;
+        return !(hasNeg && hasPos);
+    }
+
+    static bool SegmentIntersectsTriangle(const Triangle& t, const float2& p0, const float2& p1)
+    {
+        const float2 aabbS = glm::min(p0, p1);
+        const float2 aabbE = glm::max(p0, p1);
+        if (aabbE.x < t.aabb_s.x || aabbE.y < t.aabb_s.y || t.aabb_e.x < aabbS.x || t.aabb_e.y < aabbS.y)
+            return false;
+
+        return IsPointInTriangle(t, p0) || IsPointInTriangle(t, p1) ||
+               SegmentsIntersect(p0, p1, t.p0, t.p1) ||
+               SegmentsIntersect(p0, p1, t.p1, t.p2) ||
+               SegmentsIntersect(p0, p1, t.p2, t.p0);
+    }
+
+    PolygonMaskImpl::PolygonMaskImpl(const StdAllocator<uint8_t>& stdAllocator) :
+        m_fillRule(Cpu::FillRule::MAX_NUM),
+        m_edges(stdAllocator),
+        m_gridOrigin(0),
+        m_rcpCellSize(0),
+        m_gridSize(0),
+        m_cellOffsets(stdAllocator),
+        m_cellEdges(stdAllocator)
+    {
+    }
+
+    Result PolygonMaskImpl::Validate(const Cpu::PolygonMaskDesc& desc)
+    {
+        if (desc.fillRule == Cpu::FillRule::MAX_NUM)
+            return Result::INVALID_ARGUMENT;
+        if (desc.vertices == nullptr || desc.contourVertexCounts == nullptr)
+            return Result::INVALID_ARGUMENT;
+        for (uint32_t contourIt = 0; contourIt < desc.contourCount; ++contourIt)
+        {
+            if (desc.contourVertexCounts[contourIt] < 3)
+                return Result::INVALID_ARGUMENT;
+        }
+        return Result::SUCCESS;
+    }
+
+    Result PolygonMaskImpl::Create(const Cpu::PolygonMaskDesc& desc)
+    {
+        RETURN_STATUS_IF_FAILED(Validate(desc));
+
+        m_fillRule = desc.fillRule;
+
+        // 1. Gather the edges, contours are implicitly closed.
+        float2 aabbS = float2(std::numeric_limits<float>::max());
+        float2 aabbE = float2(-std::numeric_limits<float>::max());
+        {
+            const float2* vertices = (const float2*)desc.vertices;
+            uint32_t vertexOffset = 0;
+            for (uint32_t contourIt = 0; contourIt < desc.contourCount; ++contourIt)
+            {
+                const uint32_t vertexCount = desc.contourVertexCounts[contourIt];
+                for (uint32_t vertexIt = 0; vertexIt < vertexCount; ++vertexIt)
+                {
+                    const float2 p0 = vertices[vertexOffset + vertexIt];
+                    const float2 p1 = vertices[vertexOffset + (vertexIt + 1) % vertexCount];
+                    if (glm::any(glm::isnan(p0)) || glm::any(glm::isinf(p0)))
+                        return Result::INVALID_ARGUMENT;
+
+                    aabbS = glm::min(aabbS, p0);
+                    aabbE = glm::max(aabbE, p0);
+                    m_edges.push_back({ p0, p1 });
+                }
+                vertexOffset += vertexCount;
+            }
+        }
+
+        // 2. Size the grid for a handful of edges per cell.
+        const int32_t gridSize = std::clamp((int32_t)std::ceil(std::sqrt((float)m_edges.size())), 1, kMaxGridSize);
+        const float2 extent = aabbE - aabbS;
+        m_gridSize = int2(gridSize);
+        m_gridOrigin = aabbS;
+        m_rcpCellSize = float2(
+            extent.x > 0.f ? gridSize / extent.x : 0.f,
+            extent.y > 0.f ? gridSize / extent.y : 0.f);
+
+        // 3. Bin the edges by their bounding box.
+        const size_t cellCount = size_t(m_gridSize.x) * m_gridSize.y;
+        m_cellOffsets.resize(cellCount + 1);
+        std::fill(m_cellOffsets.begin(), m_cellOffsets.end(), 0u);
+
+        auto ForEachCell = [this](const Edge& edge, auto fn) {
+            const int2 cellS = GetCell(glm::min(edge.p0, edge.p1));
+            const int2 cellE = GetCell(glm::max(edge.p0, edge.p1));
+            for (int32_t j = cellS.y; j <= cellE.y; ++j)
+                for (int32_t i = cellS.x; i <= cellE.x; ++i)
+                    fn(GetCellIndex(int2(i, j)));
+        };
+
+        for (const Edge& edge : m_edges)
+            ForEachCell(edge, [this](uint32_t cellIndex) { m_cellOffsets[cellIndex + 1]++; });
+
+        for (size_t cellIt = 0; cellIt < cellCount; ++cellIt)
+            m_cellOffsets[cellIt + 1] += m_cellOffsets[cellIt];
+
+        m_cellEdges.resize(m_cellOffsets[cellCount]);
+        {
+            vector<uint32_t> cellFill(m_cellOffsets.begin(), m_cellOffsets.end() - 1, m_cellOffsets.get_allocator());
+            for (uint32_t edgeIt = 0; edgeIt < (uint32_t)m_edges.size(); ++edgeIt)
+                ForEachCell(m_edges[edgeIt], [this, &cellFill, edgeIt](uint32_t cellIndex) { m_cellEdges[cellFill[cellIndex]++] = edgeIt; });
+        }
+
+        return Result::SUCCESS;
+    }
+
+    int2 PolygonMaskImpl::GetCell(const float2& p) const
+    {
+        // Clamp before converting, UVs far outside the grid would overflow.
+        const float2 cell = glm::floor((p - m_gridOrigin) * m_rcpCellSize);
+        return int2(glm::clamp(cell, float2(0.f), float2(m_gridSize - 1)));
+    }
+
+    bool PolygonMaskImpl::IntersectsBoundary(const Triangle& t) const
+    {
+        const int2 cellS = GetCell(t.aabb_s);
+        const int2 cellE = GetCell(t.aabb_e);
+        for (int32_t j = cellS.y; j <= cellE.y; ++j)
+        {
+            for (int32_t i = cellS.x; i <= cellE.x; ++i)
+            {
+                const uint32_t cellIndex = GetCellIndex(int2(i, j));
+                for (uint32_t it = m_cellOffsets[cellIndex]; it < m_cellOffsets[cellIndex + 1]; ++it)
+                {
+                    const Edge& edge = m_edges[m_cellEdges[it]];
+                    if (SegmentIntersectsTriangle(t, edge.p0, edge.p1))
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    int32_t PolygonMaskImpl::GetWindingNumber(const float2& p) const
+    {
+        // Cast a ray towards +x, only the cells of the row on the right side of p can hold crossings.
+        // Edges span several cells, a crossing is only counted in the cell it falls in.
+        const int2 cellP = GetCell(p);
+        int32_t winding = 0;
+        for (int32_t i = cellP.x; i < m_gridSize.x; ++i)
+        {
+            const uint32_t cellIndex = GetCellIndex(int2(i, cellP.y));
+            for (uint32_t it = m_cellOffsets[cellIndex]; it < m_cellOffsets[cellIndex + 1]; ++it)
+            {
+                const Edge& edge = m_edges[m_cellEdges[it]];
+                if ((edge.p0.y <= p.y) == (edge.p1.y <= p.y))
+                    continue;
+
+                const float t = (p.y - edge.p0.y) / (edge.p1.y - edge.p0.y);
+                const float x = std::clamp(edge.p0.x + t * (edge.p1.x - edge.p0.x), std::min(edge.p0.x, edge.p1.x), std::max(edge.p0.x, edge.p1.x));
+                if (x <= p.x || GetCell(float2(x, p.y)).x != i)
+                    continue;
+
+                winding += edge.p1.y > edge.p0.y ? 1 : -1;
+            }
+        }
+        return winding;
+    }
+
+    bool PolygonMaskImpl::IsInside(const float2& p) const
+    {
+        const int32_t winding = GetWindingNumber(p);
+        if (m_fillRule == Cpu::FillRule::EvenOdd)
+            return (winding & 1) != 0;
+        OMM_ASSERT(m_fillRule == Cpu::FillRule::NonZero);
+        return winding != 0;
+    }
+} // namespace omm
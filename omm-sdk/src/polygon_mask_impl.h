@@ -0,0 +1,61 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "omm.h"
+
+#include "std_containers.h"
+
+#include <shared/math.h>
+#include <shared/triangle.h>
+
+namespace omm
+{
+    // Polygon mask with a uniform UV-space grid over its edges.
+    // Each cell lists the edges whose bounding box overlaps it, so queries only visit the edges near the query.
+    class PolygonMaskImpl
+    {
+    public:
+        PolygonMaskImpl(const StdAllocator<uint8_t>& stdAllocator);
+
+        static Result Validate(const Cpu::PolygonMaskDesc& desc);
+
+        Result Create(const Cpu::PolygonMaskDesc& desc);
+
+        // True if any contour edge touches the triangle, i.e. the fill may change within it.
+        bool IntersectsBoundary(const Triangle& t) const;
+
+        // Fill rule applied to the winding number at p.
+        bool IsInside(const float2& p) const;
+
+    private:
+        struct Edge
+        {
+            float2 p0;
+            float2 p1;
+        };
+
+        int32_t GetWindingNumber(const float2& p) const;
+        int2 GetCell(const float2& p) const;
+        uint32_t GetCellIndex(const int2& cell) const {
+            return cell.x + cell.y * m_gridSize.x;
+        }
+
+        Cpu::FillRule m_fillRule;
+        vector<Edge> m_edges;
+        float2 m_gridOrigin;
+        float2 m_rcpCellSize;
+        int2 m_gridSize;
+        // Edge indices per cell, CSR layout.
+        vector<uint32_t> m_cellOffsets;
+        vector<uint32_t> m_cellEdges;
+    };
+} // namespace omm
@@ -25,8 +25,8 @@ namespace omm
     template<class TKey, class TVal>
     using hash_map_allocator = StdAllocator<std::pair<const TKey, TVal>>;
 
-    template<class TKey, class TVal>
-    using hash_map = std::unordered_map<TKey, TVal, std::hash<TKey>, std::equal_to<TKey>, hash_map_allocator<const TKey, TVal>>;
+    template<class TKey, class TVal, class THash = std::hash<TKey>>
+    using hash_map = std::unordered_map<TKey, TVal, THash, std::equal_to<TKey>, hash_map_allocator<const TKey, TVal>>;
 
     template<class TKey, class TVal>
     using map_allocator = StdAllocator<std::pair<const TKey, TVal>>;
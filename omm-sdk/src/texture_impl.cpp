@@ -11,6 +11,7 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include "texture_impl.h"
 
 #include "defines.h"
+#include "large_buffer.h"
 #include "std_containers.h"
 
 #include <shared/math.h>
@@ -18,6 +19,10 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include <shared/texture.h>
 
 #include <cstring>
+#include <bit>
+
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
 
 namespace omm
 {
@@ -25,7 +30,8 @@ namespace omm
         m_stdAllocator(stdAllocator),
         m_mips(stdAllocator),
         m_tilingMode(TilingMode::MAX_NUM),
-        m_data(nullptr)
+        m_data(nullptr),
+        m_dataSize(0)
     {
     }
 
@@ -57,7 +63,7 @@ namespace omm
         return Result::SUCCESS;
     }
 
-    Result TextureImpl::Create(const Cpu::TextureDesc& desc)
+    Result TextureImpl::Create(const Cpu::TextureDesc& desc, LargeBufferFlags largeBufferFlags)
     {
         RETURN_STATUS_IF_FAILED(Validate(desc));
 
@@ -82,8 +88,17 @@ namespace omm
                 }
                 else if (m_tilingMode == TilingMode::MortonZ)
                 {
-                    size_t maxDim = nextPow2(std::max(m_mips[mipIt].size.x, m_mips[mipIt].size.y));
-                    m_mips[mipIt].numElements = maxDim * maxDim;
+                    // Square morton tiles, no larger than the smallest side so thin strips don't get padded.
+                    // The padding is less than one tile in each dimension.
+                    const uint32_t minDim = (uint32_t)std::min(m_mips[mipIt].size.x, m_mips[mipIt].size.y);
+                    const uint32_t tileSizeLog2 = std::min<uint32_t>(std::bit_width(minDim) - 1, kMaxMortonTileSizeLog2);
+                    const uint32_t tileSize = 1u << tileSizeLog2;
+                    const uint32_t tileCountX = math::DivUp<uint32_t>(m_mips[mipIt].size.x, tileSize);
+                    const uint32_t tileCountY = math::DivUp<uint32_t>(m_mips[mipIt].size.y, tileSize);
+
+                    m_mips[mipIt].tileSizeLog2 = tileSizeLog2;
+                    m_mips[mipIt].tileCountX = tileCountX;
+                    m_mips[mipIt].numElements = (size_t(tileCountX) * tileCountY) << (2 * tileSizeLog2);
                 }
                 else
                 {
@@ -101,7 +116,17 @@ namespace omm
             totalSize = math::Align(totalSize, kAlignment);
         }
 
-        m_data = m_stdAllocator.allocate(totalSize, kAlignment);
+        // The pages must be advised before anything touches them, the fill below is the first touch.
+        const bool enableHugePages = UseHugePages(largeBufferFlags, totalSize);
+        const bool enableParallelFirstTouch = UseParallelFirstTouch(largeBufferFlags);
+        if (enableHugePages)
+            totalSize = math::Align(totalSize, kHugePageSize);
+
+        m_data = m_stdAllocator.allocate(totalSize, enableHugePages ? kHugePageSize : kAlignment);
+        m_dataSize = totalSize;
+
+        if (enableHugePages)
+            AdviseHugePages(m_data, totalSize);
 
         for (uint32_t mipIt = 0; mipIt < desc.mipCount; ++mipIt)
         {
@@ -112,7 +137,7 @@ namespace omm
                     const size_t kDefaultRowPitch = sizeof(float) * desc.mips[mipIt].width;
                     const size_t srcRowPitch = desc.mips[mipIt].rowPitch == 0 ? kDefaultRowPitch : desc.mips[mipIt].rowPitch;
 
-                    if (kDefaultRowPitch == srcRowPitch)
+                    if (kDefaultRowPitch == srcRowPitch && !enableParallelFirstTouch)
                     {
                        void* dst = m_data + m_mips[mipIt].dataOffset;
                        const float* src = (float*)(desc.mips[mipIt].textureData);
@@ -124,7 +149,9 @@ namespace omm
                         const uint8_t* srcBegin = (const uint8_t*)desc.mips[mipIt].textureData;
 
                         const size_t dstRowPitch = m_mips[mipIt].size.x * sizeof(float);
-                        for (uint32_t rowIt = 0; rowIt < desc.mips[mipIt].height; rowIt++)
+                        const int rowCount = m_mips[mipIt].size.y;
+                        #pragma omp parallel for schedule(static) if(enableParallelFirstTouch)
+                        for (int rowIt = 0; rowIt < rowCount; rowIt++)
                         {
                             uint8_t* dst = dstBegin + rowIt * dstRowPitch;
                             const uint8_t* src = srcBegin + rowIt * srcRowPitch;
@@ -135,22 +162,29 @@ namespace omm
                 else if (m_tilingMode == TilingMode::MortonZ)
                 {
                     float* dst = (float*)(m_data + m_mips[mipIt].dataOffset);
-                    const float* src = (float*)(desc.mips[mipIt].textureData);
+                    const uint8_t* srcBegin = (const uint8_t*)desc.mips[mipIt].textureData;
 
-                    const size_t rowPitch = desc.mips[mipIt].rowPitch == 0 ? desc.mips[mipIt].width : desc.mips[mipIt].rowPitch;
+                    const size_t kDefaultRowPitch = sizeof(float) * desc.mips[mipIt].width;
+                    const size_t srcRowPitch = desc.mips[mipIt].rowPitch == 0 ? kDefaultRowPitch : desc.mips[mipIt].rowPitch;
 
-                    for (int j = 0; j < m_mips[mipIt].size.y; ++j)
+                    // A row of tiles is contiguous in memory, distributing whole tile rows keeps each page with one thread.
+                    const int tileSize = 1 << m_mips[mipIt].tileSizeLog2;
+                    const int tileCountY = (int)math::DivUp<uint32_t>(m_mips[mipIt].size.y, tileSize);
+                    #pragma omp parallel for schedule(static) if(enableParallelFirstTouch)
+                    for (int tileY = 0; tileY < tileCountY; ++tileY)
                     {
-                        for (int i = 0; i < m_mips[mipIt].size.x; ++i)
+                        const int rowEnd = std::min((tileY + 1) * tileSize, m_mips[mipIt].size.y);
+                        for (int j = tileY * tileSize; j < rowEnd; ++j)
                         {
-                            const uint64_t idx = From2Dto1D<TilingMode::MortonZ>(int2(i, j), m_mips[mipIt].size);
-                            OMM_ASSERT(idx < m_mips[mipIt].numElements);
-                            dst[idx] = src[i + j * rowPitch];
+                            const float* src = (const float*)(srcBegin + j * srcRowPitch);
+                            for (int i = 0; i < m_mips[mipIt].size.x; ++i)
+                            {
+                                const uint64_t idx = From2Dto1D<TilingMode::MortonZ>(int2(i, j), m_mips[mipIt]);
+                                OMM_ASSERT(idx < m_mips[mipIt].numElements);
+                                dst[idx] = src[i];
+                            }
                         }
                     }
-
-                    size_t maxDim = nextPow2(std::max(m_mips[mipIt].size.x, m_mips[mipIt].size.y));
-                    m_mips[mipIt].numElements = maxDim * maxDim;
                 }
                 else
                 {
@@ -168,6 +202,45 @@ namespace omm
         return Result::SUCCESS;
     }
 
+    Cpu::TextureContentKey TextureImpl::GetContentKey(const Cpu::TextureDesc& desc)
+    {
+        XXH3_state_t state;
+        XXH3_128bits_reset(&state);
+        XXH3_128bits_update(&state, &desc.format, sizeof(desc.format));
+        XXH3_128bits_update(&state, &desc.flags, sizeof(desc.flags));
+        XXH3_128bits_update(&state, &desc.mipCount, sizeof(desc.mipCount));
+        for (uint32_t mipIt = 0; mipIt < desc.mipCount; ++mipIt)
+        {
+            const Cpu::TextureMipDesc& mip = desc.mips[mipIt];
+            XXH3_128bits_update(&state, &mip.width, sizeof(mip.width));
+            XXH3_128bits_update(&state, &mip.height, sizeof(mip.height));
+
+            // The row pitch is not part of the content, only the texels of each row are.
+            const size_t rowSize = sizeof(float) * mip.width;
+            const size_t rowPitch = mip.rowPitch == 0 ? rowSize : mip.rowPitch;
+            if (rowPitch == rowSize)
+            {
+                XXH3_128bits_update(&state, mip.textureData, rowSize * mip.height);
+            }
+            else
+            {
+                for (uint32_t rowIt = 0; rowIt < mip.height; ++rowIt)
+                    XXH3_128bits_update(&state, (const uint8_t*)mip.textureData + rowIt * rowPitch, rowSize);
+            }
+        }
+        const XXH128_hash_t hash = XXH3_128bits_digest(&state);
+
+        Cpu::TextureContentKey key;
+        key.hash[0] = hash.low64;
+        key.hash[1] = hash.high64;
+        key.format = desc.format;
+        key.flags = desc.flags;
+        key.mipCount = desc.mipCount;
+        key.width = desc.mips[0].width;
+        key.height = desc.mips[0].height;
+        return key;
+    }
+
     void TextureImpl::Deallocate()
     {
         if (m_data != nullptr)
@@ -176,6 +249,7 @@ namespace omm
             m_data = nullptr;
         }
         m_mips.clear();
+        m_dataSize = 0;
     }
 
     float TextureImpl::Load(const int2& texCoord, int32_t mip) const 
@@ -188,17 +262,23 @@ namespace omm
         return 0.f;
     }
 
-    float TextureImpl::Bilinear(omm::TextureAddressMode mode, const float2& p, int32_t mip) const 
+    float TextureImpl::Bilinear(omm::TextureAddressMode mode, const float2& p, int32_t mip, float borderAlpha) const 
     {
         float2 pixel = p * (float2)(m_mips[mip].size)-0.5f;
         float2 pixelFloor = glm::floor(pixel);
         int2 coords[omm::TexelOffset::MAX_NUM];
         omm::GatherTexCoord4(mode, int2(pixelFloor), m_mips[mip].size, coords);
 
-        float a = (float)Load(coords[omm::TexelOffset::I0x0], mip);
-        float b = (float)Load(coords[omm::TexelOffset::I0x1], mip);
-        float c = (float)Load(coords[omm::TexelOffset::I1x0], mip);
-        float d = (float)Load(coords[omm::TexelOffset::I1x1], mip);
+        auto LoadOrBorder = [this, mip, borderAlpha](const int2& coord) {
+            if (coord.x == kTexCoordBorder || coord.y == kTexCoordBorder)
+                return borderAlpha;
+            return (float)Load(coord, mip);
+        };
+
+        float a = LoadOrBorder(coords[omm::TexelOffset::I0x0]);
+        float b = LoadOrBorder(coords[omm::TexelOffset::I0x1]);
+        float c = LoadOrBorder(coords[omm::TexelOffset::I1x0]);
+        float d = LoadOrBorder(coords[omm::TexelOffset::I1x1]);
 
         const float2 weight = glm::fract(pixel);
         float ac = glm::lerp<float>(a, c, weight.x);
@@ -208,20 +288,24 @@ namespace omm
     }
 
     template<>
-    uint64_t TextureImpl::From2Dto1D<TilingMode::Linear>(const int2& idx, const int2& size) 
+    uint64_t TextureImpl::From2Dto1D<TilingMode::Linear>(const int2& idx, const Mips& mip) 
     {
-        return idx.x + idx.y * uint64_t(size.x);
+        return idx.x + idx.y * uint64_t(mip.size.x);
     }
 
     template<>
-    uint64_t TextureImpl::From2Dto1D<TilingMode::MortonZ>(const int2& idx, const int2& size) 
+    uint64_t TextureImpl::From2Dto1D<TilingMode::MortonZ>(const int2& idx, const Mips& mip) 
     {
         // Based on
         // "Optimizing Memory Access on GPUs using Morton Order Indexing"
         // https://www.nocentino.com/Nocentino10.pdf
         // return mortonNumberBinIntl(idx.x, idx.y);
 
+        // Morton order within square tiles, tiles in row-major order.
+        // Keeps the locality of the morton layout without padding the texture to a power of two square.
         // https://www.forceflow.be/2013/10/07/morton-encodingdecoding-through-bit-interleaving-implementations/
-        return xy_to_morton(idx.x, idx.y);
+        const uint32_t tileMask = (1u << mip.tileSizeLog2) - 1u;
+        const uint64_t tileIdx = uint64_t(idx.y >> mip.tileSizeLog2) * mip.tileCountX + uint64_t(idx.x >> mip.tileSizeLog2);
+        return (tileIdx << (2 * mip.tileSizeLog2)) | xy_to_morton(idx.x & tileMask, idx.y & tileMask);
     }
 }
\ No newline at end of file
@@ -33,14 +33,19 @@ namespace omm
         TextureImpl(const StdAllocator<uint8_t>& stdAllocator);
         ~TextureImpl();
 
-        Result Create(const Cpu::TextureDesc& desc);
+        Result Create(const Cpu::TextureDesc& desc, LargeBufferFlags largeBufferFlags = LargeBufferFlags::None);
+
+        static Result Validate(const Cpu::TextureDesc& desc);
+
+        // Identity of a texture in the baker's texture cache. Only valid for a validated desc.
+        static Cpu::TextureContentKey GetContentKey(const Cpu::TextureDesc& desc);
 
         template<TilingMode eTilingMode>
         float Load(const int2& texCoord, int32_t mip) const;
 
         float Load(const int2& texCoord, int32_t mip) const;
 
-        float Bilinear(omm::TextureAddressMode mode, const float2& p, int32_t mip) const;
+        float Bilinear(omm::TextureAddressMode mode, const float2& p, int32_t mip, float borderAlpha) const;
 
         TilingMode GetTilingMode() const {
             return m_tilingMode;
@@ -58,29 +63,37 @@ namespace omm
             return (uint32_t)m_mips.size();
         }
 
+        // Size in bytes of the internal texture data, including the padding of the tiling mode.
+        size_t GetMemoryFootprint() const {
+            return m_dataSize;
+        }
+
     private:
-        static Result Validate(const Cpu::TextureDesc& desc);
+        struct Mips
+        {
+            int2 size;
+            float2 rcpSize;
+            int2 sizeMinusOne;
+            uintptr_t dataOffset;
+            size_t numElements;
+            // MortonZ only: side of the square morton tiles (log2), number of tiles per row.
+            uint32_t tileSizeLog2;
+            uint32_t tileCountX;
+        };
+
         void Deallocate();
         template<TilingMode eTilingMode>
-        static uint64_t From2Dto1D(const int2& idx, const int2& size) {
+        static uint64_t From2Dto1D(const int2& idx, const Mips& mip) {
             OMM_ASSERT(false && "Not implemented");
             return 0;
         }
     private:
         static constexpr uint2  kMaxDim = int2(65536);
         static constexpr size_t kAlignment = 64;
+        static constexpr uint32_t kMaxMortonTileSizeLog2 = 6; // 64x64 texels, 16kb per tile.
 
         StdAllocator<uint8_t> m_stdAllocator;
 
-        struct Mips
-        {
-            int2 size;
-            float2 rcpSize;
-            int2 sizeMinusOne;
-            uintptr_t dataOffset;
-            size_t numElements;
-        };
-
         vector<Mips> m_mips;
         TilingMode m_tilingMode;
         uint8_t* m_data;
@@ -97,11 +110,11 @@ namespace omm
         OMM_ASSERT(texCoord.y < m_mips[mip].size.y);
         OMM_ASSERT(glm::all(glm::notEqual(texCoord, kTexCoordBorder2)));
         OMM_ASSERT(glm::all(glm::notEqual(texCoord, kTexCoordInvalid2)));
-        const uint64_t idx = From2Dto1D<eTilingMode>(texCoord, m_mips[mip].size);
+        const uint64_t idx = From2Dto1D<eTilingMode>(texCoord, m_mips[mip]);
         OMM_ASSERT(idx < m_mips[mip].numElements);
         return ((float*)(m_data + m_mips[mip].dataOffset))[idx];
     }
 
-   	template<> uint64_t TextureImpl::From2Dto1D<TilingMode::Linear>(const int2& idx, const int2& size);
-   	template<> uint64_t TextureImpl::From2Dto1D<TilingMode::MortonZ>(const int2& idx, const int2& size);
+   	template<> uint64_t TextureImpl::From2Dto1D<TilingMode::Linear>(const int2& idx, const Mips& mip);
+   	template<> uint64_t TextureImpl::From2Dto1D<TilingMode::MortonZ>(const int2& idx, const Mips& mip);
 }
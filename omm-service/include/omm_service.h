@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <omm.h>
+
+// Local bake service. A long running server owns a CPU baker with a texture cache (see BakerCreationDesc::
+// textureCacheSizeInBytes) and bakes on behalf of clients connected over a local socket, so short lived processes
+// (e.g. one per asset in a build pipeline) share warm textures instead of each uploading and preparing their own.
+// Clients hash textures locally and only send the texels the service doesn't have yet.
+namespace omm
+{
+namespace Service
+{
+    using Server = Handle;
+    using Client = Handle;
+
+    struct ServerDesc
+    {
+        // Path of the Unix domain socket to listen on. A stale socket file at the path is replaced.
+        const char*     socketPath                  = nullptr;
+        // Threads running uploads and bakes, shared by all clients, 0 => hardware concurrency. Bakes with
+        // BakeFlags::EnableInternalThreads are limited to hardware concurrency / threadCount internal threads each.
+        uint32_t        threadCount                 = 0;
+        size_t          textureCacheSizeInBytes     = size_t(1) << 30;
+    };
+
+    // Starts serving on a background thread. Fails if the socket can't be bound.
+    Result CreateServer(const ServerDesc& desc, Server* outServer);
+    // Stops serving, disconnects all clients and waits for running bakes to finish.
+    Result DestroyServer(Server server);
+
+    // A client mirrors the Cpu baker API. Calls on one client are serialized, use a client per thread for concurrent
+    // bakes. Textures are released by the service when their client disconnects.
+    Result Connect(const char* socketPath, Client* outClient);
+    Result Disconnect(Client client);
+
+    // Texels are only sent when the service has no texture with the same content cached.
+    Result CreateTexture(Client client, const Cpu::TextureDesc& desc, Cpu::Texture* outTexture);
+    Result DestroyTexture(Client client, Cpu::Texture texture);
+    // Same as Cpu::BakeOpacityMicromap with textures from CreateTexture. Procedural alpha can't be evaluated by the
+    // service and fails with INVALID_ARGUMENT. The result stays valid after the client disconnects.
+    Result BakeOpacityMicromap(Client client, const Cpu::BakeInputDesc& bakeInputDesc, Cpu::BakeResult* outBakeResult);
+    Result DestroyBakeResult(Cpu::BakeResult bakeResult);
+    Result GetBakeResultDesc(Cpu::BakeResult bakeResult, const Cpu::BakeResultDesc*& desc);
+} // namespace Service
+} // namespace omm
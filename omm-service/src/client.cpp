@@ -0,0 +1,191 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "omm_service.h"
+#include "protocol.h"
+
+#include <mutex>
+
+namespace omm
+{
+namespace Service
+{
+    class ClientImpl
+    {
+    public:
+        ClientImpl(Socket socket) : m_socket(socket) {}
+        ~ClientImpl() { CloseSocket(m_socket); }
+
+        // Sends a request and waits for its reply, positioned after the Result. A broken connection stays broken.
+        Result Request(MessageType type, const MessageWriter& request, std::vector<uint8_t>& reply)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_broken)
+                return Result::FAILURE;
+
+            MessageType replyType = MessageType::MAX_NUM;
+            if (!SendMessage(m_socket, type, request) || !RecvMessage(m_socket, replyType, reply) || replyType != type)
+            {
+                m_broken = true;
+                return Result::FAILURE;
+            }
+            return Result::SUCCESS;
+        }
+
+    private:
+        std::mutex m_mutex;
+        Socket m_socket;
+        bool m_broken = false;
+    };
+
+    // Owns the reply the desc points in to.
+    struct RemoteBakeResult
+    {
+        std::vector<uint8_t> message;
+        Cpu::BakeResultDesc desc;
+    };
+
+    static Result Request(Client client, MessageType type, const MessageWriter& request, std::vector<uint8_t>& reply, MessageReader& replyReader)
+    {
+        ClientImpl* impl = (ClientImpl*)client;
+        const Result res = impl->Request(type, request, reply);
+        if (res != Result::SUCCESS)
+            return res;
+
+        Result replyRes = Result::FAILURE;
+        if (!replyReader.Read(replyRes))
+            return Result::FAILURE;
+        return replyRes;
+    }
+
+    Result Connect(const char* socketPath, Client* outClient)
+    {
+        if (!socketPath || !outClient)
+            return Result::INVALID_ARGUMENT;
+
+        *outClient = kInvalidHandle;
+        const Socket socket = ConnectSocket(socketPath);
+        if (socket == kInvalidSocket)
+            return Result::FAILURE;
+
+        ClientImpl* impl = new ClientImpl(socket);
+        MessageWriter request;
+        request.Write(kProtocolMagic);
+        request.Write(kProtocolVersion);
+        std::vector<uint8_t> reply;
+        MessageReader replyReader(reply);
+        const Result res = Request((Client)impl, MessageType::Hello, request, reply, replyReader);
+        if (res != Result::SUCCESS)
+        {
+            delete impl;
+            return res;
+        }
+        *outClient = (Client)impl;
+        return Result::SUCCESS;
+    }
+
+    Result Disconnect(Client client)
+    {
+        if (client == kInvalidHandle)
+            return Result::INVALID_ARGUMENT;
+        delete (ClientImpl*)client;
+        return Result::SUCCESS;
+    }
+
+    Result CreateTexture(Client client, const Cpu::TextureDesc& desc, Cpu::Texture* outTexture)
+    {
+        if (client == kInvalidHandle || !outTexture)
+            return Result::INVALID_ARGUMENT;
+
+        *outTexture = kInvalidHandle;
+        Cpu::TextureContentKey contentKey;
+        Result res = Cpu::GetTextureContentKey(desc, &contentKey);
+        if (res != Result::SUCCESS)
+            return res;
+
+        std::vector<uint8_t> reply;
+        MessageReader replyReader(reply);
+        {
+            MessageWriter request;
+            request.Write(contentKey);
+            res = Request(client, MessageType::AcquireTexture, request, reply, replyReader);
+            if (res != Result::SUCCESS)
+                return res;
+            if (!replyReader.Read(*outTexture))
+                return Result::FAILURE;
+            if (*outTexture != kInvalidHandle)
+                return Result::SUCCESS;
+        }
+
+        MessageWriter request;
+        EncodeTexture(request, desc);
+        MessageReader uploadReader(reply);
+        res = Request(client, MessageType::UploadTexture, request, reply, uploadReader);
+        if (res != Result::SUCCESS)
+            return res;
+        if (!uploadReader.Read(*outTexture))
+            return Result::FAILURE;
+        return Result::SUCCESS;
+    }
+
+    Result DestroyTexture(Client client, Cpu::Texture texture)
+    {
+        if (client == kInvalidHandle)
+            return Result::INVALID_ARGUMENT;
+
+        MessageWriter request;
+        request.Write(texture);
+        std::vector<uint8_t> reply;
+        MessageReader replyReader(reply);
+        return Request(client, MessageType::DestroyTexture, request, reply, replyReader);
+    }
+
+    Result BakeOpacityMicromap(Client client, const Cpu::BakeInputDesc& bakeInputDesc, Cpu::BakeResult* outBakeResult)
+    {
+        if (client == kInvalidHandle || !outBakeResult)
+            return Result::INVALID_ARGUMENT;
+
+        *outBakeResult = kInvalidHandle;
+        MessageWriter request;
+        Result res = EncodeBakeInput(request, bakeInputDesc);
+        if (res != Result::SUCCESS)
+            return res;
+
+        RemoteBakeResult* result = new RemoteBakeResult();
+        MessageReader replyReader(result->message);
+        res = Request(client, MessageType::Bake, request, result->message, replyReader);
+        if (res == Result::SUCCESS && !DecodeBakeResult(replyReader, result->desc))
+            res = Result::FAILURE;
+        if (res != Result::SUCCESS)
+        {
+            delete result;
+            return res;
+        }
+        *outBakeResult = (Cpu::BakeResult)result;
+        return Result::SUCCESS;
+    }
+
+    Result DestroyBakeResult(Cpu::BakeResult bakeResult)
+    {
+        if (bakeResult == kInvalidHandle)
+            return Result::INVALID_ARGUMENT;
+        delete (RemoteBakeResult*)bakeResult;
+        return Result::SUCCESS;
+    }
+
+    Result GetBakeResultDesc(Cpu::BakeResult bakeResult, const Cpu::BakeResultDesc*& desc)
+    {
+        if (bakeResult == kInvalidHandle)
+            return Result::INVALID_ARGUMENT;
+        desc = &((RemoteBakeResult*)bakeResult)->desc;
+        return Result::SUCCESS;
+    }
+} // namespace Service
+} // namespace omm
@@ -0,0 +1,83 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// omm-bake-service: serves CPU bakes to omm::Service clients on a local socket until interrupted, keeping textures
+// warm across the short lived processes that connect to it.
+
+#include "omm_service.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace
+{
+    volatile std::sig_atomic_t g_stop = 0;
+
+    void OnSignal(int) { g_stop = 1; }
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "usage: omm-bake-service --socket <path> [options]\n"
+            "\n"
+            "  --socket <path>      Unix domain socket to listen on\n"
+            "  --threads <n>        uploads and bakes run at once (default: hardware threads)\n"
+            "  --cache <MB>         unreferenced textures kept warm (default 1024)\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    omm::Service::ServerDesc desc;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--socket" && value)
+            desc.socketPath = argv[++i];
+        else if (arg == "--threads" && value)
+            desc.threadCount = (uint32_t)std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--cache" && value)
+            desc.textureCacheSizeInBytes = size_t(std::max(0, std::atoi(argv[++i]))) << 20;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (!desc.socketPath)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    omm::Service::Server server = omm::kInvalidHandle;
+    if (omm::Service::CreateServer(desc, &server) != omm::Result::SUCCESS)
+    {
+        std::fprintf(stderr, "failed to listen on %s\n", desc.socketPath);
+        return 1;
+    }
+
+    std::fprintf(stderr, "listening on %s\n", desc.socketPath);
+    while (!g_stop)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    omm::Service::DestroyServer(server);
+    return 0;
+}
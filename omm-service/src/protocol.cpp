@@ -0,0 +1,344 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "protocol.h"
+
+#include <limits>
+
+namespace omm
+{
+namespace Service
+{
+    // Larger messages are treated as a broken stream rather than allocated.
+    static constexpr uint64_t kMaxMessageSize = 1ull << 36;
+
+    static uint32_t GetTexelSize(Cpu::TextureFormat format)
+    {
+        switch (format)
+        {
+        case Cpu::TextureFormat::FP32:
+            return sizeof(float);
+        default:
+            return 0;
+        }
+    }
+
+    static uint32_t GetTexCoordSize(TexCoordFormat format)
+    {
+        switch (format)
+        {
+        case TexCoordFormat::UV16_UNORM:
+        case TexCoordFormat::UV16_FLOAT:
+            return 2 * sizeof(uint16_t);
+        case TexCoordFormat::UV32_FLOAT:
+            return 2 * sizeof(float);
+        default:
+            return 0;
+        }
+    }
+
+    static uint32_t GetIndexSize(IndexFormat format)
+    {
+        switch (format)
+        {
+        case IndexFormat::I16_UINT:
+            return sizeof(uint16_t);
+        case IndexFormat::I32_UINT:
+            return sizeof(uint32_t);
+        default:
+            return 0;
+        }
+    }
+
+    // Reads a per-primitive (or per-frame) array, which must either be absent or hold exactly count elements.
+    template<class T>
+    static bool ReadOptionalArray(MessageReader& message, const T*& data, size_t count)
+    {
+        size_t arrayCount = 0;
+        return message.ReadArray(data, arrayCount) && (arrayCount == 0 || arrayCount == count);
+    }
+
+    void EncodeTexture(MessageWriter& message, const Cpu::TextureDesc& desc)
+    {
+        const uint32_t texelSize = GetTexelSize(desc.format);
+        message.Write(desc.format);
+        message.Write(desc.flags);
+        message.Write(desc.mipCount);
+        for (uint32_t mipIt = 0; mipIt < desc.mipCount; ++mipIt)
+        {
+            const Cpu::TextureMipDesc& mip = desc.mips[mipIt];
+            const size_t rowSize = size_t(mip.width) * texelSize;
+            const size_t rowPitch = mip.rowPitch == 0 ? rowSize : mip.rowPitch;
+            message.Write(mip.width);
+            message.Write(mip.height);
+            message.Align();
+            message.Write<uint64_t>(rowSize * mip.height);
+            for (uint32_t y = 0; y < mip.height; ++y)
+                message.WriteBytes((const uint8_t*)mip.textureData + y * rowPitch, rowSize);
+        }
+    }
+
+    bool DecodeTexture(MessageReader& message, DecodedTexture& texture)
+    {
+        texture.desc = Cpu::TextureDesc();
+        if (!message.Read(texture.desc.format) || !message.Read(texture.desc.flags) || !message.Read(texture.desc.mipCount))
+            return false;
+
+        const uint32_t texelSize = GetTexelSize(texture.desc.format);
+        if (texelSize == 0)
+            return false;
+
+        texture.mips.clear();
+        for (uint32_t mipIt = 0; mipIt < texture.desc.mipCount; ++mipIt)
+        {
+            Cpu::TextureMipDesc mip;
+            const uint8_t* texels = nullptr;
+            size_t size = 0;
+            if (!message.Read(mip.width) || !message.Read(mip.height) || !message.ReadArray(texels, size))
+                return false;
+            if (size != uint64_t(mip.width) * mip.height * texelSize)
+                return false;
+            mip.textureData = texels;
+            texture.mips.push_back(mip);
+        }
+        texture.desc.mips = texture.mips.data();
+        return true;
+    }
+
+    Result EncodeBakeInput(MessageWriter& message, const Cpu::BakeInputDesc& desc)
+    {
+        if (desc.proceduralAlpha.EvaluateBounds || desc.proceduralAlpha.EvaluatePoint)
+            return Result::INVALID_ARGUMENT;
+        if (desc.udimTileCount != 0 && !desc.udimTiles)
+            return Result::INVALID_ARGUMENT;
+        if (desc.polygonMask.contourCount != 0 && !desc.polygonMask.contourVertexCounts)
+            return Result::INVALID_ARGUMENT;
+        if (desc.frameCount != 0 && !desc.frameTexCoordTransforms)
+            return Result::INVALID_ARGUMENT;
+        if (desc.indexBuffer && GetIndexSize(desc.indexFormat) == 0)
+            return Result::INVALID_ARGUMENT;
+
+        const uint32_t texCoordSize = GetTexCoordSize(desc.texCoordFormat);
+        if (!desc.texCoords || texCoordSize == 0)
+            return Result::INVALID_ARGUMENT;
+
+        uint64_t polygonVertexCount = 0;
+        for (uint32_t contourIt = 0; contourIt < desc.polygonMask.contourCount; ++contourIt)
+            polygonVertexCount += desc.polygonMask.contourVertexCounts[contourIt];
+        if (polygonVertexCount != 0 && !desc.polygonMask.vertices)
+            return Result::INVALID_ARGUMENT;
+
+        // Resolve the index buffer the way the bake does, then send only the vertex range it references.
+        const uint32_t triangleCount = desc.indexCount / 3;
+        std::vector<uint32_t> indices(3 * size_t(triangleCount));
+        int64_t minVertex = std::numeric_limits<int64_t>::max();
+        int64_t maxVertex = std::numeric_limits<int64_t>::min();
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            const size_t index = desc.indexOffset + i;
+            uint32_t value = uint32_t(index);
+            if (desc.indexFormat == IndexFormat::I16_UINT && desc.indexBuffer)
+                value = ((const uint16_t*)desc.indexBuffer)[index];
+            else if (desc.indexBuffer)
+                value = ((const uint32_t*)desc.indexBuffer)[index];
+
+            const int64_t vertex = int64_t(value) + desc.baseVertex;
+            minVertex = std::min(minVertex, vertex);
+            maxVertex = std::max(maxVertex, vertex);
+            indices[i] = uint32_t(vertex);
+        }
+        if (!indices.empty() && (minVertex < 0 || maxVertex > (int64_t)std::numeric_limits<uint32_t>::max()))
+            return Result::INVALID_ARGUMENT;
+
+        const size_t vertexCount = indices.empty() ? 0 : size_t(maxVertex - minVertex) + 1;
+        for (uint32_t& index : indices)
+            index -= uint32_t(minVertex);
+
+        message.Write(desc.bakeFlags);
+        message.Write(desc.texture);
+        message.WriteArray(desc.udimTiles, desc.udimTileCount);
+        message.Write(desc.polygonMask.fillRule);
+        message.WriteArray(desc.polygonMask.contourVertexCounts, desc.polygonMask.contourCount);
+        message.WriteArray(desc.polygonMask.vertices, size_t(2 * polygonVertexCount));
+        message.Write(desc.runtimeSamplerDesc);
+        message.Write(desc.alphaMode);
+        message.Write(desc.texCoordFormat);
+
+        const size_t texCoordStride = desc.texCoordStrideInBytes == 0 ? texCoordSize : desc.texCoordStrideInBytes;
+        message.Align();
+        message.Write<uint64_t>(vertexCount * texCoordSize);
+        for (size_t vertexIt = 0; vertexIt < vertexCount; ++vertexIt)
+            message.WriteBytes((const uint8_t*)desc.texCoords + (size_t(minVertex) + vertexIt) * texCoordStride, texCoordSize);
+
+        message.WriteArray(indices.data(), indices.size());
+        message.Write<uint8_t>(desc.texCoordTransform != nullptr);
+        if (desc.texCoordTransform)
+            message.Write(*desc.texCoordTransform);
+        message.WriteArray(desc.frameTexCoordTransforms, desc.frameCount);
+        message.Write(desc.dynamicSubdivisionScale);
+        message.Write(desc.rejectionThreshold);
+        message.Write(desc.nearDuplicateErrorBudget);
+        message.Write(desc.alphaCutoff);
+        message.Write(desc.unknownStatePromotion);
+        message.Write(desc.ommFormat);
+        message.Write(desc.maxSubdivisionLevel);
+        message.WriteArray(desc.alphaCutoffs, triangleCount);
+        message.WriteArray(desc.ommFormats, triangleCount);
+        message.WriteArray(desc.subdivisionLevels, triangleCount);
+        message.WriteArray(desc.specialIndices, triangleCount);
+        return Result::SUCCESS;
+    }
+
+    bool DecodeBakeInput(MessageReader& message, DecodedBakeInput& input)
+    {
+        Cpu::BakeInputDesc& desc = input.desc;
+        desc = Cpu::BakeInputDesc();
+
+        size_t udimTileCount = 0;
+        size_t contourCount = 0;
+        size_t polygonVertexCount = 0;
+        if (!message.Read(desc.bakeFlags) || !message.Read(desc.texture) ||
+            !message.ReadArray(desc.udimTiles, udimTileCount) ||
+            !message.Read(desc.polygonMask.fillRule) ||
+            !message.ReadArray(desc.polygonMask.contourVertexCounts, contourCount) ||
+            !message.ReadArray(desc.polygonMask.vertices, polygonVertexCount) ||
+            !message.Read(desc.runtimeSamplerDesc) || !message.Read(desc.alphaMode) || !message.Read(desc.texCoordFormat))
+            return false;
+
+        uint64_t contourVertexCount = 0;
+        for (size_t contourIt = 0; contourIt < contourCount; ++contourIt)
+            contourVertexCount += desc.polygonMask.contourVertexCounts[contourIt];
+        if (polygonVertexCount != 2 * contourVertexCount || udimTileCount > UINT32_MAX || contourCount > UINT32_MAX)
+            return false;
+        desc.udimTileCount = uint32_t(udimTileCount);
+        desc.polygonMask.contourCount = uint32_t(contourCount);
+
+        const uint8_t* texCoords = nullptr;
+        size_t texCoordsSize = 0;
+        const uint32_t* indices = nullptr;
+        size_t indexCount = 0;
+        uint8_t hasTexCoordTransform = 0;
+        if (!message.ReadArray(texCoords, texCoordsSize) || !message.ReadArray(indices, indexCount) || !message.Read(hasTexCoordTransform))
+            return false;
+        if (indexCount % 3 != 0 || indexCount > UINT32_MAX)
+            return false;
+
+        // Indices are relative to the vertices sent, which must cover all of them.
+        const uint32_t texCoordSize = GetTexCoordSize(desc.texCoordFormat);
+        if (indexCount != 0 && (texCoordSize == 0 || texCoordsSize % texCoordSize != 0))
+            return false;
+        const size_t vertexCount = texCoordSize == 0 ? 0 : texCoordsSize / texCoordSize;
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            if (indices[i] >= vertexCount)
+                return false;
+        }
+
+        desc.texCoords = texCoords;
+        desc.texCoordStrideInBytes = 0;
+        desc.indexFormat = IndexFormat::I32_UINT;
+        desc.indexBuffer = indices;
+        desc.indexCount = uint32_t(indexCount);
+
+        if (hasTexCoordTransform)
+        {
+            if (!message.Read(input.texCoordTransform))
+                return false;
+            desc.texCoordTransform = &input.texCoordTransform;
+        }
+
+        size_t frameCount = 0;
+        if (!message.ReadArray(desc.frameTexCoordTransforms, frameCount) || frameCount > UINT32_MAX)
+            return false;
+        desc.frameCount = uint32_t(frameCount);
+
+        if (!message.Read(desc.dynamicSubdivisionScale) || !message.Read(desc.rejectionThreshold) ||
+            !message.Read(desc.nearDuplicateErrorBudget) || !message.Read(desc.alphaCutoff) ||
+            !message.Read(desc.unknownStatePromotion) || !message.Read(desc.ommFormat) || !message.Read(desc.maxSubdivisionLevel))
+            return false;
+
+        // The bake only reads the per-primitive arrays, the desc just isn't const correct for all of them.
+        const size_t triangleCount = indexCount / 3;
+        const OMMFormat* ommFormats = nullptr;
+        const uint8_t* subdivisionLevels = nullptr;
+        if (!ReadOptionalArray(message, desc.alphaCutoffs, triangleCount) ||
+            !ReadOptionalArray(message, ommFormats, triangleCount) ||
+            !ReadOptionalArray(message, subdivisionLevels, triangleCount) ||
+            !ReadOptionalArray(message, desc.specialIndices, triangleCount))
+            return false;
+        desc.ommFormats = const_cast<OMMFormat*>(ommFormats);
+        desc.subdivisionLevels = const_cast<uint8_t*>(subdivisionLevels);
+        return true;
+    }
+
+    void EncodeBakeResult(MessageWriter& message, const Cpu::BakeResultDesc& desc)
+    {
+        message.WriteArray((const uint8_t*)desc.ommArrayData, desc.ommArrayDataSize);
+        message.WriteArray(desc.ommDescArray, desc.ommDescArrayCount);
+        message.WriteArray(desc.ommDescArrayHistogram, desc.ommDescArrayHistogramCount);
+        message.Write(desc.ommIndexFormat);
+        message.Write(desc.ommIndexCount);
+        message.WriteArray((const uint8_t*)desc.ommIndexBuffer, size_t(desc.ommIndexCount) * GetIndexSize(desc.ommIndexFormat));
+        message.WriteArray(desc.ommIndexHistogram, desc.ommIndexHistogramCount);
+        message.WriteArray(desc.primitiveCoverage, desc.primitiveCoverageCount);
+    }
+
+    bool DecodeBakeResult(MessageReader& message, Cpu::BakeResultDesc& desc)
+    {
+        desc = Cpu::BakeResultDesc();
+
+        const uint8_t* ommArrayData = nullptr;
+        const uint8_t* ommIndexBuffer = nullptr;
+        size_t ommArrayDataSize = 0;
+        size_t ommDescArrayCount = 0;
+        size_t ommDescArrayHistogramCount = 0;
+        size_t ommIndexBufferSize = 0;
+        size_t ommIndexHistogramCount = 0;
+        size_t primitiveCoverageCount = 0;
+        if (!message.ReadArray(ommArrayData, ommArrayDataSize) ||
+            !message.ReadArray(desc.ommDescArray, ommDescArrayCount) ||
+            !message.ReadArray(desc.ommDescArrayHistogram, ommDescArrayHistogramCount) ||
+            !message.Read(desc.ommIndexFormat) || !message.Read(desc.ommIndexCount) ||
+            !message.ReadArray(ommIndexBuffer, ommIndexBufferSize) ||
+            !message.ReadArray(desc.ommIndexHistogram, ommIndexHistogramCount) ||
+            !message.ReadArray(desc.primitiveCoverage, primitiveCoverageCount))
+            return false;
+
+        if (ommIndexBufferSize != size_t(desc.ommIndexCount) * GetIndexSize(desc.ommIndexFormat))
+            return false;
+
+        desc.ommArrayData = ommArrayData;
+        desc.ommArrayDataSize = uint32_t(ommArrayDataSize);
+        desc.ommDescArrayCount = uint32_t(ommDescArrayCount);
+        desc.ommDescArrayHistogramCount = uint32_t(ommDescArrayHistogramCount);
+        desc.ommIndexBuffer = ommIndexBuffer;
+        desc.ommIndexHistogramCount = uint32_t(ommIndexHistogramCount);
+        desc.primitiveCoverageCount = uint32_t(primitiveCoverageCount);
+        return true;
+    }
+
+    bool SendMessage(Socket socket, MessageType type, const MessageWriter& message)
+    {
+        const MessageHeader header = { type, 0, message.GetData().size() };
+        return SendAll(socket, &header, sizeof(header)) && SendAll(socket, message.GetData().data(), message.GetData().size());
+    }
+
+    bool RecvMessage(Socket socket, MessageType& type, std::vector<uint8_t>& message)
+    {
+        MessageHeader header;
+        if (!RecvAll(socket, &header, sizeof(header)) || header.size > kMaxMessageSize)
+            return false;
+
+        type = header.type;
+        message.resize((size_t)header.size);
+        return RecvAll(socket, message.data(), message.size());
+    }
+} // namespace Service
+} // namespace omm
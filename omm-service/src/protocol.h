@@ -0,0 +1,180 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "socket.h"
+
+#include <omm.h>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Wire format between the service and its clients. Both ends run on the same host, so values are sent in their native
+// representation. Every request gets exactly one reply starting with a Result.
+namespace omm
+{
+namespace Service
+{
+    static constexpr uint32_t kProtocolMagic = 0x534D4D4F; // "OMMS"
+    static constexpr uint32_t kProtocolVersion = 2;
+
+    enum class MessageType : uint32_t
+    {
+        // u32 magic, u32 version
+        Hello,
+        // Cpu::TextureContentKey -> u64 texture, 0 when not cached
+        AcquireTexture,
+        // Texture desc and texels, see EncodeTexture -> u64 texture
+        UploadTexture,
+        // u64 texture
+        DestroyTexture,
+        // Bake input, see EncodeBakeInput -> bake result, see EncodeBakeResult
+        Bake,
+
+        MAX_NUM
+    };
+
+    struct MessageHeader
+    {
+        MessageType type;
+        uint32_t    reserved;
+        uint64_t    size;
+    };
+
+    // Arrays are 8 byte aligned in the message, so the receiver can read them in place. Scalars are packed.
+    class MessageWriter
+    {
+    public:
+        template<class T>
+        void Write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            WriteBytes(&value, sizeof(T));
+        }
+
+        // Count followed by the elements. A null array is written as empty.
+        template<class T>
+        void WriteArray(const T* data, size_t count)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            count = data ? count : 0;
+            Align();
+            Write<uint64_t>(count);
+            WriteBytes(data, count * sizeof(T));
+        }
+
+        // Pads to the alignment of an array, for arrays written piecewise.
+        void Align() { m_data.resize((m_data.size() + 7) & ~size_t(7)); }
+
+        void WriteBytes(const void* data, size_t size)
+        {
+            const size_t offset = m_data.size();
+            m_data.resize(offset + size);
+            if (size != 0)
+                std::memcpy(m_data.data() + offset, data, size);
+        }
+
+        const std::vector<uint8_t>& GetData() const { return m_data; }
+
+    private:
+        std::vector<uint8_t> m_data;
+    };
+
+    // Reads are bounds checked, the reader fails for good on the first read past the end.
+    class MessageReader
+    {
+    public:
+        MessageReader(const std::vector<uint8_t>& data) : m_data(data), m_offset(0), m_failed(false) {}
+
+        template<class T>
+        bool Read(T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const void* bytes = ReadBytes(sizeof(T));
+            if (bytes)
+                std::memcpy(&value, bytes, sizeof(T));
+            return bytes != nullptr;
+        }
+
+        // Points in to the message, null for an empty array.
+        template<class T>
+        bool ReadArray(const T*& data, size_t& count)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            uint64_t arrayCount = 0;
+            data = nullptr;
+            count = 0;
+            m_offset = std::min((m_offset + 7) & ~size_t(7), m_data.size());
+            if (!Read(arrayCount) || arrayCount > (m_data.size() - m_offset) / sizeof(T))
+                return Fail();
+
+            data = arrayCount == 0 ? nullptr : (const T*)ReadBytes(arrayCount * sizeof(T));
+            count = (size_t)arrayCount;
+            return !m_failed;
+        }
+
+        const void* ReadBytes(size_t size)
+        {
+            if (m_failed || size > m_data.size() - m_offset)
+            {
+                Fail();
+                return nullptr;
+            }
+            const void* bytes = m_data.data() + m_offset;
+            m_offset += size;
+            return bytes;
+        }
+
+        bool IsValid() const { return !m_failed; }
+
+    private:
+        bool Fail()
+        {
+            m_failed = true;
+            return false;
+        }
+
+        const std::vector<uint8_t>& m_data;
+        size_t m_offset;
+        bool m_failed;
+    };
+
+    // Decoded descs point in to the message and the storage next to them, both must outlive the desc.
+    struct DecodedTexture
+    {
+        Cpu::TextureDesc desc;
+        std::vector<Cpu::TextureMipDesc> mips;
+    };
+
+    struct DecodedBakeInput
+    {
+        Cpu::BakeInputDesc desc;
+        Cpu::TexCoordTransform texCoordTransform;
+    };
+
+    // The texels are sent tightly packed. desc must be valid, see Cpu::GetTextureContentKey.
+    void EncodeTexture(MessageWriter& message, const Cpu::TextureDesc& desc);
+    bool DecodeTexture(MessageReader& message, DecodedTexture& texture);
+
+    // Only the primitives and vertices referenced by the bake are sent, indices are rebased to the first vertex sent.
+    // Texture handles are sent as is. Fails for input that can't cross processes, i.e. procedural alpha callbacks.
+    Result EncodeBakeInput(MessageWriter& message, const Cpu::BakeInputDesc& desc);
+    bool DecodeBakeInput(MessageReader& message, DecodedBakeInput& input);
+
+    void EncodeBakeResult(MessageWriter& message, const Cpu::BakeResultDesc& desc);
+    bool DecodeBakeResult(MessageReader& message, Cpu::BakeResultDesc& desc);
+
+    bool SendMessage(Socket socket, MessageType type, const MessageWriter& message);
+    bool RecvMessage(Socket socket, MessageType& type, std::vector<uint8_t>& message);
+} // namespace Service
+} // namespace omm
@@ -0,0 +1,365 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "omm_service.h"
+#include "protocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+namespace omm
+{
+namespace Service
+{
+    class ServerImpl
+    {
+    public:
+        ~ServerImpl() { Stop(); }
+
+        Result Start(const ServerDesc& desc)
+        {
+            BakerCreationDesc bakerDesc;
+            bakerDesc.type = BakerType::CPU;
+            bakerDesc.textureCacheSizeInBytes = desc.textureCacheSizeInBytes;
+            Result res = CreateOpacityMicromapBaker(bakerDesc, &m_baker);
+            if (res != Result::SUCCESS)
+                return res;
+
+            m_socketPath = desc.socketPath;
+            m_listenSocket = ListenSocket(desc.socketPath);
+            if (m_listenSocket == kInvalidSocket)
+                return Result::FAILURE;
+
+            const uint32_t hardwareThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+            const uint32_t threadCount = desc.threadCount != 0 ? desc.threadCount : hardwareThreadCount;
+            const uint32_t internalThreadCount = std::max(hardwareThreadCount / threadCount, 1u);
+            for (uint32_t threadIt = 0; threadIt < threadCount; ++threadIt)
+                m_workers.emplace_back([this, internalThreadCount]() { RunWorker(internalThreadCount); });
+            m_acceptThread = std::thread([this]() { AcceptConnections(); });
+            return Result::SUCCESS;
+        }
+
+    private:
+        struct Connection
+        {
+            Socket socket = kInvalidSocket;
+            std::thread thread;
+            std::atomic<bool> finished = false;
+        };
+
+        struct Job
+        {
+            std::function<Result()> run;
+            Result result = Result::FAILURE;
+            bool done = false;
+            std::condition_variable doneCondition;
+        };
+
+        // Textures a connection holds references to, released when it closes.
+        using TextureRefs = std::unordered_map<Cpu::Texture, uint32_t>;
+
+        void Stop()
+        {
+            if (m_acceptThread.joinable())
+            {
+                m_stopping = true;
+                // Shutting down a listening socket doesn't unblock accept everywhere, a connection always does.
+                CloseSocket(ConnectSocket(m_socketPath.c_str()));
+                m_acceptThread.join();
+            }
+
+            for (std::unique_ptr<Connection>& connection : m_connections)
+                ShutdownSocket(connection->socket);
+            for (std::unique_ptr<Connection>& connection : m_connections)
+            {
+                connection->thread.join();
+                CloseSocket(connection->socket);
+            }
+            m_connections.clear();
+
+            // No connection is left to queue jobs.
+            {
+                std::lock_guard<std::mutex> lock(m_jobMutex);
+                m_stoppingWorkers = true;
+            }
+            m_jobAvailable.notify_all();
+            for (std::thread& worker : m_workers)
+                worker.join();
+            m_workers.clear();
+
+            if (m_listenSocket != kInvalidSocket)
+            {
+                CloseSocket(m_listenSocket);
+                RemoveSocketFile(m_socketPath.c_str());
+                m_listenSocket = kInvalidSocket;
+            }
+            if (m_baker != kInvalidHandle)
+            {
+                DestroyOpacityMicromapBaker(m_baker);
+                m_baker = kInvalidHandle;
+            }
+        }
+
+        void AcceptConnections()
+        {
+            while (!m_stopping)
+            {
+                const Socket socket = AcceptSocket(m_listenSocket);
+                ReapConnections();
+                if (socket == kInvalidSocket)
+                {
+                    // E.g. out of file descriptors, back off rather than spin until connections close.
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+                if (m_stopping)
+                {
+                    CloseSocket(socket);
+                    break;
+                }
+
+                std::unique_ptr<Connection> connection = std::make_unique<Connection>();
+                connection->socket = socket;
+                Connection* ptr = connection.get();
+                connection->thread = std::thread([this, ptr]() {
+                    Serve(ptr->socket);
+                    ptr->finished = true;
+                });
+                m_connections.push_back(std::move(connection));
+            }
+        }
+
+        // Only the accept thread adds connections, so it can join finished ones without a lock.
+        void ReapConnections()
+        {
+            for (auto it = m_connections.begin(); it != m_connections.end();)
+            {
+                if (!(*it)->finished)
+                {
+                    ++it;
+                    continue;
+                }
+                (*it)->thread.join();
+                CloseSocket((*it)->socket);
+                it = m_connections.erase(it);
+            }
+        }
+
+        // Uploads and bakes of all connections run on the shared workers, connection threads only wait on the socket.
+        void RunWorker(uint32_t internalThreadCount)
+        {
+#if defined(_OPENMP)
+            // The thread count is per calling thread, it bounds the internal threads of every bake run by this worker
+            // so concurrent bakes share the machine instead of each starting hardware concurrency threads.
+            omp_set_num_threads((int)internalThreadCount);
+#else
+            (void)internalThreadCount;
+#endif
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            while (true)
+            {
+                m_jobAvailable.wait(lock, [this]() { return m_stoppingWorkers || !m_jobs.empty(); });
+                if (m_jobs.empty())
+                    return;
+
+                Job* job = m_jobs.front();
+                m_jobs.pop_front();
+                lock.unlock();
+                const Result result = job->run();
+                lock.lock();
+                job->result = result;
+                job->done = true;
+                job->doneCondition.notify_one();
+            }
+        }
+
+        Result RunJob(std::function<Result()> run)
+        {
+            Job job;
+            job.run = std::move(run);
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            m_jobs.push_back(&job);
+            m_jobAvailable.notify_one();
+            job.doneCondition.wait(lock, [&job]() { return job.done; });
+            return job.result;
+        }
+
+        void Serve(Socket socket)
+        {
+            TextureRefs textures;
+            bool greeted = false;
+            std::vector<uint8_t> request;
+            MessageType type = MessageType::MAX_NUM;
+            while (RecvMessage(socket, type, request))
+            {
+                MessageReader reader(request);
+                MessageWriter reply;
+                Result res = Result::FAILURE;
+                if (type == MessageType::Hello)
+                {
+                    uint32_t magic = 0;
+                    uint32_t version = 0;
+                    greeted = reader.Read(magic) && reader.Read(version) && magic == kProtocolMagic && version == kProtocolVersion;
+                    res = greeted ? Result::SUCCESS : Result::FAILURE;
+                    reply.Write(res);
+                }
+                else if (greeted)
+                {
+                    HandleRequest(type, reader, textures, reply);
+                }
+                else
+                {
+                    reply.Write(res);
+                }
+
+                if (!SendMessage(socket, type, reply) || !greeted)
+                    break;
+            }
+
+            for (const auto& [texture, refCount] : textures)
+            {
+                for (uint32_t refIt = 0; refIt < refCount; ++refIt)
+                    Cpu::DestroyTexture(m_baker, texture);
+            }
+        }
+
+        void HandleRequest(MessageType type, MessageReader& request, TextureRefs& textures, MessageWriter& reply)
+        {
+            switch (type)
+            {
+            case MessageType::AcquireTexture:
+            {
+                Cpu::TextureContentKey contentKey;
+                Cpu::Texture texture = kInvalidHandle;
+                Result res = request.Read(contentKey) ? Cpu::AcquireCachedTexture(m_baker, contentKey, &texture) : Result::INVALID_ARGUMENT;
+                if (res == Result::SUCCESS && texture != kInvalidHandle)
+                    ++textures[texture];
+                reply.Write(res);
+                reply.Write(texture);
+                break;
+            }
+            case MessageType::UploadTexture:
+            {
+                DecodedTexture decoded;
+                Cpu::Texture texture = kInvalidHandle;
+                Result res = Result::INVALID_ARGUMENT;
+                if (DecodeTexture(request, decoded))
+                    res = RunJob([&]() { return Cpu::CreateTexture(m_baker, decoded.desc, &texture); });
+                if (res == Result::SUCCESS)
+                    ++textures[texture];
+                reply.Write(res);
+                reply.Write(texture);
+                break;
+            }
+            case MessageType::DestroyTexture:
+            {
+                Cpu::Texture texture = kInvalidHandle;
+                auto it = request.Read(texture) ? textures.find(texture) : textures.end();
+                Result res = Result::INVALID_ARGUMENT;
+                if (it != textures.end())
+                {
+                    res = Cpu::DestroyTexture(m_baker, texture);
+                    if (--it->second == 0)
+                        textures.erase(it);
+                }
+                reply.Write(res);
+                break;
+            }
+            case MessageType::Bake:
+            {
+                DecodedBakeInput input;
+                Result res = DecodeBakeInput(request, input) && HoldsTextures(input.desc, textures) ? Result::SUCCESS : Result::INVALID_ARGUMENT;
+                Cpu::BakeResult bakeResult = kInvalidHandle;
+                if (res == Result::SUCCESS)
+                    res = RunJob([&]() { return Cpu::BakeOpacityMicromap(m_baker, input.desc, &bakeResult); });
+
+                const Cpu::BakeResultDesc* resultDesc = nullptr;
+                if (res == Result::SUCCESS)
+                    res = Cpu::GetBakeResultDesc(bakeResult, resultDesc);
+                reply.Write(res);
+                if (res == Result::SUCCESS)
+                    EncodeBakeResult(reply, *resultDesc);
+                if (bakeResult != kInvalidHandle)
+                    Cpu::DestroyBakeResult(bakeResult);
+                break;
+            }
+            default:
+                reply.Write(Result::NOT_IMPLEMENTED);
+                break;
+            }
+        }
+
+        // Handles sent by a client are only trusted if the same connection created them.
+        static bool HoldsTextures(const Cpu::BakeInputDesc& desc, const TextureRefs& textures)
+        {
+            if (desc.texture != kInvalidHandle && textures.find(desc.texture) == textures.end())
+                return false;
+            for (uint32_t tileIt = 0; tileIt < desc.udimTileCount; ++tileIt)
+            {
+                if (textures.find(desc.udimTiles[tileIt].texture) == textures.end())
+                    return false;
+            }
+            return true;
+        }
+
+        Baker m_baker = kInvalidHandle;
+        std::string m_socketPath;
+        Socket m_listenSocket = kInvalidSocket;
+        std::vector<std::thread> m_workers;
+        std::mutex m_jobMutex;
+        std::condition_variable m_jobAvailable;
+        std::deque<Job*> m_jobs;
+        bool m_stoppingWorkers = false;
+        std::atomic<bool> m_stopping = false;
+        std::thread m_acceptThread;
+        std::list<std::unique_ptr<Connection>> m_connections;
+    };
+
+    Result CreateServer(const ServerDesc& desc, Server* outServer)
+    {
+        if (!desc.socketPath || !outServer)
+            return Result::INVALID_ARGUMENT;
+
+        *outServer = kInvalidHandle;
+        ServerImpl* impl = new ServerImpl();
+        const Result res = impl->Start(desc);
+        if (res != Result::SUCCESS)
+        {
+            delete impl;
+            return res;
+        }
+        *outServer = (Server)impl;
+        return Result::SUCCESS;
+    }
+
+    Result DestroyServer(Server server)
+    {
+        if (server == kInvalidHandle)
+            return Result::INVALID_ARGUMENT;
+        delete (ServerImpl*)server;
+        return Result::SUCCESS;
+    }
+} // namespace Service
+} // namespace omm
@@ -0,0 +1,196 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "socket.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace omm
+{
+namespace Service
+{
+#if defined(_WIN32)
+    using NativeSocket = SOCKET;
+    static constexpr int kShutdownBoth = SD_BOTH;
+
+    static bool InitSockets()
+    {
+        static const bool initialized = []() {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        return initialized;
+    }
+
+    static bool IsValid(NativeSocket socket) { return socket != INVALID_SOCKET; }
+    static bool IsInterrupted() { return WSAGetLastError() == WSAEINTR; }
+    static void CloseNative(NativeSocket socket) { closesocket(socket); }
+#else
+    using NativeSocket = int;
+    static constexpr int kShutdownBoth = SHUT_RDWR;
+
+    static bool InitSockets() { return true; }
+    static bool IsValid(NativeSocket socket) { return socket >= 0; }
+    static bool IsInterrupted() { return errno == EINTR; }
+    static void CloseNative(NativeSocket socket) { close(socket); }
+#endif
+
+    static NativeSocket ToNative(Socket socket) { return (NativeSocket)socket; }
+    static Socket FromNative(NativeSocket socket) { return IsValid(socket) ? (Socket)socket : kInvalidSocket; }
+
+    // Where sends can't opt out of SIGPIPE per call (no MSG_NOSIGNAL), opt out per socket.
+    static void DisableSigPipe(NativeSocket socket)
+    {
+#if defined(SO_NOSIGPIPE)
+        const int enable = 1;
+        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#else
+        (void)socket;
+#endif
+    }
+
+    static bool GetAddress(const char* path, sockaddr_un& address)
+    {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        const size_t length = std::strlen(path);
+        if (length == 0 || length >= sizeof(address.sun_path))
+            return false;
+        std::memcpy(address.sun_path, path, length);
+        return true;
+    }
+
+    void RemoveSocketFile(const char* path)
+    {
+#if defined(_WIN32)
+        DeleteFileA(path);
+#else
+        unlink(path);
+#endif
+    }
+
+    Socket ListenSocket(const char* path)
+    {
+        sockaddr_un address;
+        if (!InitSockets() || !GetAddress(path, address))
+            return kInvalidSocket;
+
+        NativeSocket socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (!IsValid(socket))
+            return kInvalidSocket;
+
+        RemoveSocketFile(path);
+        if (bind(socket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(socket, SOMAXCONN) != 0)
+        {
+            CloseNative(socket);
+            return kInvalidSocket;
+        }
+        return FromNative(socket);
+    }
+
+    Socket AcceptSocket(Socket listenSocket)
+    {
+        for (;;)
+        {
+            NativeSocket socket = accept(ToNative(listenSocket), nullptr, nullptr);
+            if (IsValid(socket))
+                DisableSigPipe(socket);
+            if (IsValid(socket) || !IsInterrupted())
+                return FromNative(socket);
+        }
+    }
+
+    Socket ConnectSocket(const char* path)
+    {
+        sockaddr_un address;
+        if (!InitSockets() || !GetAddress(path, address))
+            return kInvalidSocket;
+
+        NativeSocket socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (!IsValid(socket))
+            return kInvalidSocket;
+
+        DisableSigPipe(socket);
+        if (connect(socket, (const sockaddr*)&address, sizeof(address)) != 0)
+        {
+            CloseNative(socket);
+            return kInvalidSocket;
+        }
+        return FromNative(socket);
+    }
+
+    void ShutdownSocket(Socket socket)
+    {
+        if (socket != kInvalidSocket)
+            shutdown(ToNative(socket), kShutdownBoth);
+    }
+
+    void CloseSocket(Socket socket)
+    {
+        if (socket != kInvalidSocket)
+            CloseNative(ToNative(socket));
+    }
+
+    bool SendAll(Socket socket, const void* data, size_t size)
+    {
+#if defined(MSG_NOSIGNAL)
+        static constexpr int kFlags = MSG_NOSIGNAL; // A closed peer fails the call instead of raising SIGPIPE.
+#else
+        static constexpr int kFlags = 0;
+#endif
+        const char* bytes = (const char*)data;
+        while (size != 0)
+        {
+            const int chunk = (int)std::min<size_t>(size, 1 << 30);
+            const auto sent = send(ToNative(socket), bytes, chunk, kFlags);
+            if (sent <= 0)
+            {
+                if (sent < 0 && IsInterrupted())
+                    continue;
+                return false;
+            }
+            bytes += sent;
+            size -= (size_t)sent;
+        }
+        return true;
+    }
+
+    bool RecvAll(Socket socket, void* data, size_t size)
+    {
+        char* bytes = (char*)data;
+        while (size != 0)
+        {
+            const int chunk = (int)std::min<size_t>(size, 1 << 30);
+            const auto received = recv(ToNative(socket), bytes, chunk, 0);
+            if (received <= 0)
+            {
+                if (received < 0 && IsInterrupted())
+                    continue;
+                return false;
+            }
+            bytes += received;
+            size -= (size_t)received;
+        }
+        return true;
+    }
+} // namespace Service
+} // namespace omm
@@ -0,0 +1,37 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace omm
+{
+namespace Service
+{
+    // Blocking local stream sockets (AF_UNIX). Windows supports them since Windows 10 1803.
+    using Socket = intptr_t;
+    static constexpr Socket kInvalidSocket = -1;
+
+    // Binds and listens on path, replacing a stale socket file left by a previous service.
+    Socket ListenSocket(const char* path);
+    Socket AcceptSocket(Socket listenSocket);
+    Socket ConnectSocket(const char* path);
+    // Unblocks pending and future calls on the socket from other threads, the socket must still be closed.
+    void ShutdownSocket(Socket socket);
+    void CloseSocket(Socket socket);
+    // Removes the socket file of a listening socket.
+    void RemoveSocketFile(const char* path);
+
+    bool SendAll(Socket socket, const void* data, size_t size);
+    bool RecvAll(Socket socket, void* data, size_t size);
+} // namespace Service
+} // namespace omm
@@ -180,5 +180,46 @@ namespace bird // is the word
 
 		return Triangle(uP0, uP1, uP2);
 	}
+
+	static constexpr inline uint32_t GetNumMicroVertices(uint32_t numSubdivisionLevels) {
+		return ((1u << numSubdivisionLevels) + 1) * ((1u << numSubdivisionLevels) + 2) / 2;
+	}
+
+	// Hierarchical micro-vertex order of displacement micromaps. Writes GetNumMicroVertices(subdivisionLevel) discrete
+	// barycentrics (u, v), in units of 2^-subdivisionLevel: the three corners, then for each level the midpoints of the
+	// edges (v0 v1), (v1 v2), (v2 v0) of the previous level's micro-triangles in bird curve order, skipping the ones
+	// already written. The order of a level is a prefix of the order of the next level, in their respective units.
+	static void GetMicroVertexOrder(uint32_t subdivisionLevel, uint2* outVertices)
+	{
+		const uint32_t scale = 1u << subdivisionLevel;
+		uint32_t count = 0;
+		outVertices[count++] = uint2(0, 0);
+		outVertices[count++] = uint2(scale, 0);
+		outVertices[count++] = uint2(0, scale);
+
+		for (uint32_t level = 1; level <= subdivisionLevel; ++level)
+		{
+			// Midpoints added at this level have an odd coordinate, only the ones of this level can collide.
+			const uint32_t levelBegin = count;
+			for (uint32_t uTriIt = 0; uTriIt < GetNumMicroTriangles(level - 1); ++uTriIt)
+			{
+				float2 bc[3];
+				index2bary(uTriIt, level - 1, bc[0], bc[1], bc[2]);
+				for (uint32_t edgeIt = 0; edgeIt < 3; ++edgeIt)
+				{
+					const uint2 a = uint2(bc[edgeIt] * float(scale));
+					const uint2 b = uint2(bc[(edgeIt + 1) % 3] * float(scale));
+					const uint2 midpoint = (a + b) / 2u;
+
+					bool isNew = true;
+					for (uint32_t i = levelBegin; i < count && isNew; ++i)
+						isNew = outVertices[i] != midpoint;
+					if (isNew)
+						outVertices[count++] = midpoint;
+				}
+			}
+		}
+		OMM_ASSERT(count == GetNumMicroVertices(subdivisionLevel));
+	}
 } // namespace bird
 } // namespace omm
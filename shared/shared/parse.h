@@ -63,5 +63,33 @@ namespace parse
 			return vmDesc.subdivisionLevel;
 		}
 	}
+
+	static uint32_t GetDmmIndexForTriangleIndex(const omm::Cpu::BakeDisplacementResultDesc& resDesc, uint32_t i) {
+		OMM_ASSERT(resDesc.dmmIndexFormat == omm::IndexFormat::I16_UINT || resDesc.dmmIndexFormat == omm::IndexFormat::I32_UINT);
+		if (resDesc.dmmIndexFormat == omm::IndexFormat::I16_UINT)
+			return reinterpret_cast<const uint16_t*>(resDesc.dmmIndexBuffer)[i];
+		else
+			return reinterpret_cast<const uint32_t*>(resDesc.dmmIndexBuffer)[i];
+	}
+
+	// Writes the 11-bit displacement values of the triangle in the block's micro-vertex order, bird::GetMicroVertexOrder
+	// unless baked with an outputLayout, returns the subdivision level.
+	static int32_t GetTriangleDisplacements(uint32_t triangleIdx, const omm::Cpu::BakeDisplacementResultDesc& resDesc, uint16_t* outValues) {
+
+		const uint32_t dmmIdx = GetDmmIndexForTriangleIndex(resDesc, triangleIdx);
+		const omm::Cpu::DisplacementMicromapDesc& dmmDesc = resDesc.dmmDescArray[dmmIdx];
+
+		const uint8_t* block = (const uint8_t*)resDesc.dmmArrayData + dmmDesc.offset;
+		if (outValues) {
+			const uint32_t numMicroVertices = omm::bird::GetNumMicroVertices(dmmDesc.subdivisionLevel);
+			for (uint32_t vertexIt = 0; vertexIt < numMicroVertices; ++vertexIt)
+			{
+				const uint32_t bitOffset = vertexIt * 11;
+				const uint32_t bits = block[bitOffset >> 3] | (block[(bitOffset >> 3) + 1] << 8) | (block[(bitOffset >> 3) + 2] << 16);
+				outValues[vertexIt] = (uint16_t)((bits >> (bitOffset & 7)) & 0x7FF);
+			}
+		}
+		return dmmDesc.subdivisionLevel;
+	}
 } // namespace parse
 } // namespace omm
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "assert.h"
+
+#include <stdint.h>
+#include <array>
+#include <algorithm>
+#include <utility>
+
+namespace omm
+{
+namespace radix
+{
+    // LSD radix sort specialised for the micromap spatial sort keys:
+    //  - bits [0, 32):  26-bit morton code, or the work item index for special index micromaps.
+    //  - bits [60, 64): subdivision level, bit 63 flags special index micromaps.
+    // Bits [32, 60) are always zero and are never visited.
+    struct Digit
+    {
+        uint32_t shift;
+        uint32_t mask;
+    };
+
+    static constexpr std::array<Digit, 5> kSpatialSortKeyDigits =
+    {{
+        { 0,  0xFF },
+        { 8,  0xFF },
+        { 16, 0xFF },
+        { 24, 0xFF },
+        { 60, 0xF },
+    }};
+
+    static constexpr uint64_t kSpatialSortKeyUnusedBits = 0x0FFFFFFF00000000ull;
+
+    static constexpr uint32_t kBucketCount = 256;
+    static constexpr uint32_t kMaxBlockCount = 64;
+    static constexpr size_t kMinBlockSize = 16 * 1024;
+
+    // Size (in elements) of the histogram scratch buffer expected by SortDescending.
+    static constexpr size_t kHistogramCount = kMaxBlockCount * kBucketCount;
+
+    // Stable descending sort on the key, equal keys keep their input order.
+    // scratch must hold count elements, histograms must hold kHistogramCount elements.
+    // The input is split in contiguous blocks, each block is histogrammed and scattered independently,
+    // which keeps the result independent of the number of threads.
+    inline void SortDescending(std::pair<uint64_t, uint32_t>* keys, std::pair<uint64_t, uint32_t>* scratch, uint32_t* histograms, size_t count, bool enableThreads)
+    {
+        using KeyValue = std::pair<uint64_t, uint32_t>;
+
+        if (count <= 1)
+            return;
+
+        const size_t blockCount = enableThreads ? std::clamp<size_t>((count + kMinBlockSize - 1) / kMinBlockSize, 1, kMaxBlockCount) : 1;
+        const size_t blockSize = (count + blockCount - 1) / blockCount;
+
+        KeyValue* src = keys;
+        KeyValue* dst = scratch;
+
+        for (const Digit& digit : kSpatialSortKeyDigits)
+        {
+            #pragma omp parallel for if(enableThreads)
+            for (int32_t blockIt = 0; blockIt < (int32_t)blockCount; ++blockIt)
+            {
+                uint32_t* hist = histograms + blockIt * kBucketCount;
+                std::fill(hist, hist + kBucketCount, 0u);
+
+                const size_t begin = std::min(blockIt * blockSize, count);
+                const size_t end = std::min(begin + blockSize, count);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    OMM_ASSERT((src[i].first & kSpatialSortKeyUnusedBits) == 0);
+                    hist[(src[i].first >> digit.shift) & digit.mask]++;
+                }
+            }
+
+            // All keys share this digit, the pass would be an identity permutation.
+            const uint32_t firstBucket = (src[0].first >> digit.shift) & digit.mask;
+            size_t firstBucketCount = 0;
+            for (size_t blockIt = 0; blockIt < blockCount; ++blockIt)
+                firstBucketCount += histograms[blockIt * kBucketCount + firstBucket];
+            if (firstBucketCount == count)
+                continue;
+
+            // Exclusive prefix sum, largest digit first. Within a bucket, lower blocks go first to keep the sort stable.
+            uint32_t offset = 0;
+            for (int32_t bucket = (int32_t)digit.mask; bucket >= 0; --bucket)
+            {
+                for (size_t blockIt = 0; blockIt < blockCount; ++blockIt)
+                {
+                    uint32_t& h = histograms[blockIt * kBucketCount + bucket];
+                    const uint32_t bucketCount = h;
+                    h = offset;
+                    offset += bucketCount;
+                }
+            }
+
+            #pragma omp parallel for if(enableThreads)
+            for (int32_t blockIt = 0; blockIt < (int32_t)blockCount; ++blockIt)
+            {
+                uint32_t* hist = histograms + blockIt * kBucketCount;
+
+                const size_t begin = std::min(blockIt * blockSize, count);
+                const size_t end = std::min(begin + blockSize, count);
+                for (size_t i = begin; i < end; ++i)
+                    dst[hist[(src[i].first >> digit.shift) & digit.mask]++] = src[i];
+            }
+
+            std::swap(src, dst);
+        }
+
+        if (src != keys)
+            std::copy(src, src + count, keys);
+    }
+
+} // namespace radix
+} // namespace omm
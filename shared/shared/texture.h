@@ -34,7 +34,9 @@ namespace omm
         switch (eAddressMode)
         {
         case TextureAddressMode::Wrap: {
-            return int2(uint2(texCoord) % uint2(texSize));
+            // The remainder is negative for negative coordinates, wrapping through uint only works for power of two sizes.
+            const int2 rem = { texCoord.x % texSize.x, texCoord.y % texSize.y };
+            return { rem.x < 0 ? rem.x + texSize.x : rem.x, rem.y < 0 ? rem.y + texSize.y : rem.y };
         }
         case TextureAddressMode::Mirror: {
             const int2 texCoordAbs = (int2)glm::abs((float2)texCoord + 0.5f);
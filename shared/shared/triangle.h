@@ -14,6 +14,10 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include "omm.h"
 #include "assert.h"
 
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
 namespace omm
 {
     enum class WindingOrder : uint8_t {
@@ -163,6 +167,31 @@ namespace omm
         return t;
     }
 
+    static float2 TransformUV(const Cpu::TexCoordTransform& transform, const float2& uv)
+    {
+        return {
+            transform.m[0][0] * uv.x + transform.m[0][1] * uv.y + transform.m[0][2],
+            transform.m[1][0] * uv.x + transform.m[1][1] * uv.y + transform.m[1][2]
+        };
+    }
+
+    // Applies the (optional) global transform followed by the (optional) frame transform.
+    static Triangle TransformUVTriangle(const Triangle& t, const Cpu::TexCoordTransform* transform, const Cpu::TexCoordTransform* frameTransform)
+    {
+        if (!transform && !frameTransform)
+            return t;
+
+        float2 p[3] = { t.p0, t.p1, t.p2 };
+        for (float2& uv : p)
+        {
+            if (transform)
+                uv = TransformUV(*transform, uv);
+            if (frameTransform)
+                uv = TransformUV(*frameTransform, uv);
+        }
+        return Triangle(p[0], p[1], p[2]);
+    }
+
     static void GetUInt32Indices(IndexFormat indexFormat, const void* indices, size_t triIndexIndex, uint32_t outIndices[3])
     {
         if (indexFormat == IndexFormat::I16_UINT)
@@ -179,6 +208,110 @@ namespace omm
         }
     }
 
+    // Indices of a triangle in an index buffer sub-range starting at indexOffset, with baseVertex added.
+    // A null index buffer is a non-indexed triangle list.
+    static void GetUInt32Indices(IndexFormat indexFormat, const void* indices, uint32_t indexOffset, int32_t baseVertex, size_t triIndexIndex, uint32_t outIndices[3])
+    {
+        if (indices)
+            GetUInt32Indices(indexFormat, indices, indexOffset + triIndexIndex, outIndices);
+        else
+            for (uint32_t i = 0; i < 3; ++i)
+                outIndices[i] = uint32_t(indexOffset + triIndexIndex + i);
+
+        for (uint32_t i = 0; i < 3; ++i)
+            outIndices[i] += (uint32_t)baseVertex;
+    }
+
+    // Bulk variants of GetUInt32Indices and FetchUV for decoding whole buffers ahead of the bake. Format and stride
+    // are resolved once per call and the inner loops are branchless, so they vectorize at the baseline ISA.
+    // The results are bit identical to the per vertex functions.
+    static void GetUInt32IndicesBulk(IndexFormat indexFormat, const void* indices, size_t first, size_t count, uint32_t* outIndices, uint32_t& outMinIndex, uint32_t& outMaxIndex)
+    {
+        uint32_t minIndex = 0xFFFFFFFF;
+        uint32_t maxIndex = 0;
+        if (indexFormat == IndexFormat::I16_UINT)
+        {
+            const uint16_t* src = (const uint16_t*)indices + first;
+            for (size_t i = 0; i < count; ++i)
+            {
+                outIndices[i] = src[i];
+                minIndex = std::min<uint32_t>(minIndex, src[i]);
+                maxIndex = std::max<uint32_t>(maxIndex, src[i]);
+            }
+        }
+        else
+        {
+            const uint32_t* src = (const uint32_t*)indices + first;
+            for (size_t i = 0; i < count; ++i)
+            {
+                outIndices[i] = src[i];
+                minIndex = std::min(minIndex, src[i]);
+                maxIndex = std::max(maxIndex, src[i]);
+            }
+        }
+        outMinIndex = minIndex;
+        outMaxIndex = maxIndex;
+    }
+
+    // Same conversion as float16ToFloat32 written as a select, +-0 map to +0.
+    static inline uint32_t float16ToFloat32Bits(uint16_t fp16)
+    {
+        const uint32_t h = fp16;
+        const uint32_t bits = ((((h & 0x7c00) >> 10) + 127 - 15) << 23) | ((h & 0x03ff) << 13) | ((h & 0x8000) << 16);
+        return (h & 0x7fff) == 0 ? 0u : bits;
+    }
+
+    template<TexCoordFormat texCoordFormat>
+    static void FetchUVBulk(const void* texCoords, uint32_t texCoordStrideInBytes, size_t first, size_t count, float2* outUVs)
+    {
+        using StorageType = std::conditional_t<texCoordFormat == TexCoordFormat::UV32_FLOAT, float, uint16_t>;
+        const uint8_t* src = (const uint8_t*)texCoords + texCoordStrideInBytes * first;
+        float* dst = (float*)outUVs;
+
+        // Tightly packed texcoords are converted as one flat array of components.
+        const bool isPacked = texCoordStrideInBytes == 2 * sizeof(StorageType);
+        const size_t componentCount = isPacked ? 2 * count : 2;
+        const size_t vertexCount = isPacked ? 1 : count;
+
+        for (size_t vertexIt = 0; vertexIt < vertexCount; ++vertexIt)
+        {
+            const StorageType* in = (const StorageType*)(src + texCoordStrideInBytes * vertexIt);
+            float* out = dst + 2 * vertexIt;
+            for (size_t i = 0; i < componentCount; ++i)
+            {
+                if constexpr (texCoordFormat == TexCoordFormat::UV16_UNORM)
+                {
+                    out[i] = (float)in[i] * (1.f / 65535.f);
+                }
+                else if constexpr (texCoordFormat == TexCoordFormat::UV16_FLOAT)
+                {
+                    const uint32_t bits = float16ToFloat32Bits(in[i]);
+                    std::memcpy(&out[i], &bits, sizeof(float));
+                }
+                else
+                {
+                    out[i] = in[i];
+                }
+            }
+        }
+    }
+
+    static void FetchUVBulk(const void* texCoords, uint32_t texCoordStrideInBytes, TexCoordFormat texCoordFormat, size_t first, size_t count, float2* outUVs)
+    {
+        switch (texCoordFormat)
+        {
+        case TexCoordFormat::UV16_UNORM:
+            return FetchUVBulk<TexCoordFormat::UV16_UNORM>(texCoords, texCoordStrideInBytes, first, count, outUVs);
+        case TexCoordFormat::UV16_FLOAT:
+            return FetchUVBulk<TexCoordFormat::UV16_FLOAT>(texCoords, texCoordStrideInBytes, first, count, outUVs);
+        case TexCoordFormat::UV32_FLOAT:
+            return FetchUVBulk<TexCoordFormat::UV32_FLOAT>(texCoords, texCoordStrideInBytes, first, count, outUVs);
+        default:
+            std::fill(outUVs, outUVs + count, float2(0, 0));
+            return;
+        }
+    }
+
     static float2 InterpolateTriangleUV(const float3& bc, const Triangle& triangleUVs)
     {
         return triangleUVs.p0 * bc.x + triangleUVs.p1 * bc.y + triangleUVs.p2 * bc.z;
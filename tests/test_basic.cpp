@@ -165,6 +165,57 @@ namespace {
 		EXPECT_EQ(omm::Cpu::CreateTexture(_baker, tex.GetDesc(), &outTexture), omm::Result::SUCCESS);
 	}
 
+	TEST_F(TextureTest, Create65536x1ZOrder) {
+		vmtest::Texture tex(65536, 1, 1, true /*enableZorder*/, [](int i, int j, int w, int h, int mip)->float {return 0.f; });
+
+		omm::Cpu::Texture outTexture = 0;
+		EXPECT_EQ(omm::Cpu::CreateTexture(_baker, tex.GetDesc(), &outTexture), omm::Result::SUCCESS);
+
+		size_t byteSize = 0;
+		EXPECT_EQ(omm::Cpu::GetTextureMemoryFootprint(_baker, outTexture, byteSize), omm::Result::SUCCESS);
+		EXPECT_EQ(byteSize, 65536 * sizeof(float));
+		EXPECT_EQ(omm::Cpu::DestroyTexture(_baker, outTexture), omm::Result::SUCCESS);
+	}
+
+	TEST_F(TextureTest, MemoryFootprintNull) {
+		size_t byteSize = 0;
+		EXPECT_EQ(omm::Cpu::GetTextureMemoryFootprint(_baker, 0, byteSize), omm::Result::INVALID_ARGUMENT);
+	}
+
+	TEST_F(TextureTest, MemoryFootprint4096x64) {
+		for (bool enableZorder : { false, true })
+		{
+			vmtest::Texture tex(4096, 64, 1, enableZorder, [](int i, int j, int w, int h, int mip)->float {return 0.f; });
+
+			omm::Cpu::Texture outTexture = 0;
+			EXPECT_EQ(omm::Cpu::CreateTexture(_baker, tex.GetDesc(), &outTexture), omm::Result::SUCCESS);
+
+			// No padding, the z-order layout used to pad this to 4096x4096.
+			size_t byteSize = 0;
+			EXPECT_EQ(omm::Cpu::GetTextureMemoryFootprint(_baker, outTexture, byteSize), omm::Result::SUCCESS);
+			EXPECT_EQ(byteSize, 4096 * 64 * sizeof(float));
+			EXPECT_EQ(omm::Cpu::DestroyTexture(_baker, outTexture), omm::Result::SUCCESS);
+		}
+	}
+
+	TEST_F(TextureTest, MemoryFootprint100x30) {
+		auto GetFootprint = [this](bool enableZorder)->size_t {
+			vmtest::Texture tex(100, 30, 1, enableZorder, [](int i, int j, int w, int h, int mip)->float {return 0.f; });
+
+			omm::Cpu::Texture outTexture = 0;
+			EXPECT_EQ(omm::Cpu::CreateTexture(_baker, tex.GetDesc(), &outTexture), omm::Result::SUCCESS);
+			size_t byteSize = 0;
+			EXPECT_EQ(omm::Cpu::GetTextureMemoryFootprint(_baker, outTexture, byteSize), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::Cpu::DestroyTexture(_baker, outTexture), omm::Result::SUCCESS);
+			return byteSize;
+		};
+
+		// Linear: 100x30 texels, 64 byte aligned.
+		EXPECT_EQ(GetFootprint(false), 12032);
+		// Z-order: 16x16 tiles, padded to 112x32 (was 128x128).
+		EXPECT_EQ(GetFootprint(true), 112 * 32 * sizeof(float));
+	}
+
 	TEST_F(TextureTest, Create65537x0) {
 		vmtest::Texture tex(65537, 1, 1, false /*enableZorder*/, [](int i, int j, int w, int h, int mip)->float {return 0.f; });
 
@@ -0,0 +1,519 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include <gtest/gtest.h>
+#include "util/omm.h"
+
+#include <omm.h>
+#include <shared/bird.h>
+#include <shared/parse.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+
+namespace {
+
+	static constexpr uint32_t kMaxValue = 2047;
+
+	void AddFlags(omm::Cpu::BakeDisplacementInputDesc& desc, omm::Cpu::BakeFlags flags) {
+		desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)flags);
+	}
+
+	// Value of the triangle at micro-vertex bc, SDK order.
+	uint16_t GetDisplacement(const omm::Cpu::BakeDisplacementResultDesc& resDesc, uint32_t triangleIdx, const uint2& bc) {
+		uint16_t values[45];
+		const int32_t level = omm::parse::GetTriangleDisplacements(triangleIdx, resDesc, values);
+		uint2 order[45];
+		omm::bird::GetMicroVertexOrder(level, order);
+		for (uint32_t vertexIt = 0; vertexIt < omm::bird::GetNumMicroVertices(level); ++vertexIt)
+		{
+			if (order[vertexIt] == bc)
+				return values[vertexIt];
+		}
+		ADD_FAILURE() << "no micro-vertex " << bc.x << ", " << bc.y << " at level " << level;
+		return 0;
+	}
+
+	omm::Cpu::DisplacementEdgeFlags GetEdgeFlags(const omm::Cpu::BakeDisplacementResultDesc& resDesc, uint32_t triangleIdx) {
+		return resDesc.dmmEdgeFlags[triangleIdx];
+	}
+
+	class DmmBakeTestCPU : public ::testing::TestWithParam<bool> {
+	protected:
+		void SetUp() override {
+			EXPECT_EQ(omm::CreateOpacityMicromapBaker({ .type = omm::BakerType::CPU }, &_baker), omm::Result::SUCCESS);
+		}
+
+		void TearDown() override {
+			for (omm::Cpu::Texture texture : _textures)
+				EXPECT_EQ(omm::Cpu::DestroyTexture(_baker, texture), omm::Result::SUCCESS);
+			for (omm::Cpu::DisplacementBakeResult res : _results)
+				EXPECT_EQ(omm::Cpu::DestroyDisplacementBakeResult(res), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::DestroyOpacityMicromapBaker(_baker), omm::Result::SUCCESS);
+		}
+
+		omm::Cpu::Texture CreateTexture(const omm::Cpu::TextureDesc& desc) {
+			omm::Cpu::Texture texture = 0;
+			EXPECT_EQ(omm::Cpu::CreateTexture(_baker, desc, &texture), omm::Result::SUCCESS);
+			_textures.push_back(texture);
+			return texture;
+		}
+
+		omm::Cpu::BakeDisplacementInputDesc GetDesc(omm::Cpu::Texture texture, const std::vector<float>& texCoords, const std::vector<uint32_t>& indices) {
+			omm::Cpu::BakeDisplacementInputDesc desc;
+			desc.bakeFlags = GetParam() ? omm::Cpu::BakeFlags::EnableInternalThreads : omm::Cpu::BakeFlags::None;
+			desc.heightTexture = texture;
+			desc.heightSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+			desc.heightSamplerDesc.filter = omm::TextureFilterMode::Linear;
+			desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+			desc.texCoords = texCoords.data();
+			desc.indexFormat = omm::IndexFormat::I32_UINT;
+			desc.indexBuffer = indices.data();
+			desc.indexCount = (uint32_t)indices.size();
+			return desc;
+		}
+
+		const omm::Cpu::BakeDisplacementResultDesc* Bake(const omm::Cpu::BakeDisplacementInputDesc& desc) {
+			omm::Cpu::DisplacementBakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeDisplacementMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+			if (res == 0)
+				return nullptr;
+			_results.push_back(res);
+
+			const omm::Cpu::BakeDisplacementResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetDisplacementBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+			ValidateHistograms(desc, *resDesc);
+			return resDesc;
+		}
+
+		static void ValidateHistograms(const omm::Cpu::BakeDisplacementInputDesc& desc, const omm::Cpu::BakeDisplacementResultDesc& resDesc) {
+			ASSERT_EQ(resDesc.dmmIndexCount, desc.indexCount / 3);
+			ASSERT_EQ(resDesc.dmmEdgeFlagsCount, resDesc.dmmIndexCount);
+			ASSERT_EQ(resDesc.dmmArrayDataSize, resDesc.dmmDescArrayCount * 64);
+
+			std::map<uint16_t, uint32_t> arrayCounts;
+			std::map<uint16_t, uint32_t> indexCounts;
+			for (uint32_t i = 0; i < resDesc.dmmDescArrayCount; ++i)
+				arrayCounts[resDesc.dmmDescArray[i].subdivisionLevel]++;
+			for (uint32_t i = 0; i < resDesc.dmmIndexCount; ++i)
+				indexCounts[resDesc.dmmDescArray[omm::parse::GetDmmIndexForTriangleIndex(resDesc, i)].subdivisionLevel]++;
+
+			std::map<uint16_t, uint32_t> arrayHistogram;
+			std::map<uint16_t, uint32_t> indexHistogram;
+			for (uint32_t i = 0; i < resDesc.dmmDescArrayHistogramCount; ++i)
+				arrayHistogram[resDesc.dmmDescArrayHistogram[i].subdivisionLevel] += resDesc.dmmDescArrayHistogram[i].count;
+			for (uint32_t i = 0; i < resDesc.dmmIndexHistogramCount; ++i)
+				indexHistogram[resDesc.dmmIndexHistogram[i].subdivisionLevel] += resDesc.dmmIndexHistogram[i].count;
+
+			EXPECT_EQ(arrayCounts, arrayHistogram);
+			EXPECT_EQ(indexCounts, indexHistogram);
+		}
+
+		omm::Baker _baker = 0;
+		std::vector<omm::Cpu::Texture> _textures;
+		std::vector<omm::Cpu::DisplacementBakeResult> _results;
+	};
+
+	TEST(DmmMicroVertexOrder, UniqueAndHierarchical) {
+
+		std::vector<uint2> prevOrder;
+		for (uint32_t level = 0; level <= 5; ++level)
+		{
+			const uint32_t scale = 1u << level;
+			std::vector<uint2> order(omm::bird::GetNumMicroVertices(level));
+			omm::bird::GetMicroVertexOrder(level, order.data());
+
+			std::set<std::pair<uint32_t, uint32_t>> unique;
+			for (const uint2& v : order)
+			{
+				EXPECT_LE(v.x + v.y, scale);
+				unique.insert({ v.x, v.y });
+			}
+			EXPECT_EQ(unique.size(), order.size());
+
+			for (size_t i = 0; i < prevOrder.size(); ++i)
+				EXPECT_EQ(order[i], prevOrder[i] * 2u);
+			prevOrder = order;
+		}
+	}
+
+	// The order callers remap from, see DMMFormat::DC1_64_Triangles_64_Bytes_SdkOrder. Changing it breaks their remap tables.
+	TEST(DmmMicroVertexOrder, Levels1And2) {
+
+		const uint2 level1[] = { { 0, 0 }, { 2, 0 }, { 0, 2 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+		const uint2 level2[] = {
+			{ 0, 0 }, { 4, 0 }, { 0, 4 },
+			{ 2, 0 }, { 2, 2 }, { 0, 2 },
+			{ 1, 0 }, { 1, 1 }, { 0, 1 }, { 1, 2 }, { 2, 1 }, { 3, 0 }, { 3, 1 }, { 1, 3 }, { 0, 3 },
+		};
+
+		uint2 order[15];
+		omm::bird::GetMicroVertexOrder(1, order);
+		for (uint32_t i = 0; i < 6; ++i)
+			EXPECT_EQ(order[i], level1[i]) << i;
+
+		omm::bird::GetMicroVertexOrder(2, order);
+		for (uint32_t i = 0; i < 15; ++i)
+			EXPECT_EQ(order[i], level2[i]) << i;
+	}
+
+	TEST_P(DmmBakeTestCPU, LinearRamp) {
+
+		// Bilinear interpolation of texel centers i + 0.5 reproduces height = u inside the texture.
+		vmtest::Texture tex(64, 64, 1, [](int i, int j, int w, int h, int mip)->float {
+			return (i + 0.5f) / w;
+		});
+
+		std::vector<float> texCoords = { 0.1f, 0.1f, 0.9f, 0.2f, 0.3f, 0.9f };
+		std::vector<uint32_t> indices = { 0, 1, 2 };
+
+		omm::Cpu::BakeDisplacementInputDesc desc = GetDesc(CreateTexture(tex.GetDesc()), texCoords, indices);
+		desc.heightBias = 0.1f;
+		desc.heightScale = 0.8f;
+		const omm::Cpu::BakeDisplacementResultDesc* resDesc = Bake(desc);
+		ASSERT_NE(resDesc, nullptr);
+
+		ASSERT_EQ(resDesc->dmmDescArrayCount, 1);
+		EXPECT_EQ((omm::DMMFormat)resDesc->dmmDescArray[0].format, omm::DMMFormat::DC1_64_Triangles_64_Bytes_SdkOrder);
+		// Must not be mistaken for the spec's DC1_64_TRIANGLES_64_BYTES (1), the micro-vertex order differs.
+		EXPECT_NE(resDesc->dmmDescArray[0].format, 1);
+		EXPECT_EQ(resDesc->dmmIndexFormat, omm::IndexFormat::I16_UINT);
+
+		uint16_t values[45];
+		ASSERT_EQ(omm::parse::GetTriangleDisplacements(0, *resDesc, values), 3);
+
+		uint2 order[45];
+		omm::bird::GetMicroVertexOrder(3, order);
+		for (uint32_t vertexIt = 0; vertexIt < 45; ++vertexIt)
+		{
+			const float2 bc = float2(order[vertexIt]) / 8.f;
+			const float u = texCoords[0] * (1.f - bc.x - bc.y) + texCoords[2] * bc.x + texCoords[4] * bc.y;
+			const float expected = std::clamp((u - desc.heightBias) / desc.heightScale, 0.f, 1.f) * kMaxValue;
+			EXPECT_NEAR(values[vertexIt], expected, 1.f) << "vertex " << vertexIt;
+		}
+
+		// Unused bits of the block are zero.
+		const uint8_t* block = (const uint8_t*)resDesc->dmmArrayData;
+		EXPECT_EQ(block[62], 0);
+		EXPECT_EQ(block[63], 0);
+		EXPECT_EQ(block[61] & 0x80, 0);
+	}
+
+	TEST_P(DmmBakeTestCPU, UniformDisplacementIsShared) {
+
+		vmtest::Texture tex(32, 32, 1, [](int i, int j, int w, int h, int mip)->float {
+			return 0.25f;
+		});
+		const omm::Cpu::Texture texture = CreateTexture(tex.GetDesc());
+
+		std::vector<float> texCoords = { 0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f };
+		std::vector<uint32_t> indices = { 0, 1, 2, 3, 2, 1 };
+		std::vector<uint8_t> subdivisionLevels = { 2, 3 };
+
+		omm::Cpu::BakeDisplacementInputDesc desc = GetDesc(texture, texCoords, indices);
+		desc.subdivisionLevels = subdivisionLevels.data();
+
+		// Primitives keep their level by default.
+		{
+			const omm::Cpu::BakeDisplacementResultDesc* resDesc = Bake(desc);
+			ASSERT_NE(resDesc, nullptr);
+			ASSERT_EQ(resDesc->dmmDescArrayCount, 2);
+			EXPECT_EQ(omm::parse::GetTriangleDisplacements(0, *resDesc, nullptr), 2);
+			EXPECT_EQ(omm::parse::GetTriangleDisplacements(1, *resDesc, nullptr), 3);
+		}
+
+		// The opacity special index flag has no say in it.
+		AddFlags(desc, omm::Cpu::BakeFlags::EnableDisplacementLevelDemotion);
+		AddFlags(desc, omm::Cpu::BakeFlags::DisableSpecialIndices);
+		{
+			const omm::Cpu::BakeDisplacementResultDesc* resDesc = Bake(desc);
+			ASSERT_NE(resDesc, nullptr);
+			ASSERT_EQ(resDesc->dmmDescArrayCount, 1);
+
+			uint16_t values[3];
+			EXPECT_EQ(omm::parse::GetTriangleDisplacements(0, *resDesc, values), 0);
+			EXPECT_EQ(omm::parse::GetTriangleDisplacements(1, *resDesc, values), 0);
+			for (uint16_t value : values)
+				EXPECT_EQ(value, 512);
+		}
+
+		{
+			AddFlags(desc, omm::Cpu::BakeFlags::Force32BitIndices);
+			desc.subdivisionLevels = nullptr;
+			const omm::Cpu::BakeDisplacementResultDesc* resDesc = Bake(desc);
+			ASSERT_NE(resDesc, nullptr);
+			EXPECT_EQ(resDesc->dmmDescArrayCount, 1);
+			EXPECT_EQ(resDesc->dmmIndexFormat, omm::IndexFormat::I32_UINT);
+		}
+	}
+
+	TEST_P(DmmBakeTestCPU, SharedEdgeMatches) {
+
+		std::mt19937 eng(7);
+		std::uniform_real_distribution<float> dist(0.f, 1.f);
+		vmtest::Texture tex(37, 23, 1, [&](int i, int j, int w, int h, int mip)->float {
+			return dist(eng);
+		});
+
+		// Two quads of triangles sharing the diagonal in opposite directions: (p0, p1, p2) and (p2, p1, p3).
+		std::vector<float> texCoords = { 0.13f, 0.07f, 0.91f, 0.17f, 0.03f, 0.83f, 0.77f, 0.97f };
+		std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+
+		for (omm::TextureFilterMode filter : { omm::TextureFilterMode::Nearest, omm::TextureFilterMode::Linear })
+		{
+			omm::Cpu::BakeDisplacementInputDesc desc = GetDesc(CreateTexture(tex.GetDesc()), texCoords, indices);
+			desc.heightSamplerDesc.filter = filter;
+			const omm::Cpu::BakeDisplacementResultDesc* resDesc = Bake(desc);
+			ASSERT_NE(resDesc, nullptr);
+
+			uint16_t valuesA[45];
+			uint16_t valuesB[45];
+			ASSERT_EQ(omm::parse::GetTriangleDisplacements(0, *resDesc, valuesA), 3);
+			ASSERT_EQ(omm::parse::GetTriangleDisplacements(1, *resDesc, valuesB), 3);
+
+			uint2 order[45];
+			omm::bird::GetMicroVertexOrder(3, order);
+
+			// Edge (v1 v2) of A at v = k is edge (v0 v1) of B at u = 8 - k.
+			uint32_t matched = 0;
+			for (uint32_t a = 0; a < 45; ++a)
+			{
+				if (order[a].x + order[a].y != 8)
+					continue;
+				for (uint32_t b = 0; b < 45; ++b)
+				{
+					if (order[b].y == 0 && order[b].x == 8 - order[a].y)
+					{
+						EXPECT_EQ(valuesA[a], valuesB[b]);
+						matched++;
+					}
+				}
+			}
+			EXPECT_EQ(matched, 9);
+		}
+	}
+
+	TEST_P(DmmBakeTestCPU, NeighbourLevelsAreLimited) {
+
+		std::mt19937 eng(11);
+		std::uniform_real_distribution<float> dist(0.f, 1.f);
+		vmtest::Texture tex(29, 31, 1, [&](int i, int j, int w, int h, int mip)->float {
+			return dist(eng);
+		});
+
+		// A strip of three triangles, (0 1 2) (2 1 3) (2 3 4), and a disconnected one.
+		std::vector<float> texCoords = { 0.1f, 0.1f, 0.5f, 0.05f, 0.2f, 0.6f, 0.7f, 0.5f, 0.4f, 0.95f, 0.8f, 0.8f, 0.9f, 0.8f, 0.9f, 0.9f };
+		std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3, 2, 3, 4, 5, 6, 7 };
+		std::vector<uint8_t> subdivisionLevels = { 0, 3, 3, 3 };
+
+		omm::Cpu::BakeDisplacementInputDesc desc = GetDesc(CreateTexture(tex.GetDesc()), texCoords, indices);
+		desc.heightSamplerDesc.filter = omm::TextureFilterMode::Nearest;
+		desc.subdivisionLevels = subdivisionLevels.data();
+		const omm::Cpu::BakeDisplacementResultDesc* resDesc = Bake(desc);
+		ASSERT_NE(resDesc, nullptr);
+
+		EXPECT_EQ(omm::parse::GetTriangleDisplacements(0, *resDesc, nullptr), 0);
+		EXPECT_EQ(omm::parse::GetTriangleDisplacements(1, *resDesc, nullptr), 1);
+		EXPECT_EQ(omm::parse::GetTriangleDisplacements(2, *resDesc, nullptr), 2);
+		EXPECT_EQ(omm::parse::GetTriangleDisplacements(3, *resDesc, nullptr), 3);
+
+		// The higher side of an edge decimates it: edge (v0 v1) of triangle 1 is (1 2), of triangle 2 (2 3).
+		EXPECT_EQ(GetEdgeFlags(*resDesc, 0), omm::Cpu::DisplacementEdgeFlags::None);
+		EXPECT_EQ(GetEdgeFlags(*resDesc, 1), omm::Cpu::DisplacementEdgeFlags::DecimateEdge01);
+		EXPECT_EQ(GetEdgeFlags(*resDesc, 2), omm::Cpu::DisplacementEdgeFlags::DecimateEdge01);
+		EXPECT_EQ(GetEdgeFlags(*resDesc, 3), omm::Cpu::DisplacementEdgeFlags::None);
+
+		// Every other micro-vertex of the decimated edge (v0 v1) of triangle 2 at u = 2k is the micro-vertex of the
+		// edge (v2 v0) of triangle 1 at v = k.
+		for (uint32_t k = 0; k <= 2; ++k)
+			EXPECT_EQ(GetDisplacement(*resDesc, 2, uint2(2 * k, 0)), GetDisplacement(*resDesc, 1, uint2(0, k))) << k;
+
+		// Without per primitive levels nothing is decimated.
+		desc.subdivisionLevels = nullptr;
+		resDesc = Bake(desc);
+		ASSERT_NE(resDesc, nullptr);
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			EXPECT_EQ(omm::parse::GetTriangleDisplacements(i, *resDesc, nullptr), 3);
+			EXPECT_EQ(GetEdgeFlags(*resDesc, i), omm::Cpu::DisplacementEdgeFlags::None);
+		}
+	}
+
+	TEST_P(DmmBakeTestCPU, DemotionKeepsNeighboursCompatible) {
+
+		// Uniform for u < 0.5, a ramp above.
+		vmtest::Texture tex(64, 64, 1, [](int i, int j, int w, int h, int mip)->float {
+			const float u = (i + 0.5f) / w;
+			return u < 0.5f ? 0.25f : u;
+		});
+
+		// A (0 1 2) is in the uniform half, B (2 1 3) shares A's edge (1 2) and reaches into the ramp, C (4 5 6) is
+		// uniform and on its own.
+		std::vector<float> texCoords = { 0.05f, 0.05f, 0.45f, 0.05f, 0.45f, 0.95f, 0.95f, 0.5f, 0.1f, 0.1f, 0.3f, 0.1f, 0.1f, 0.3f };
+		std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3, 4, 5, 6 };
+
+		omm::Cpu::BakeDisplacementInputDesc desc = GetDesc(CreateTexture(tex.GetDesc()), texCoords, indices);
+		desc.heightSamplerDesc.filter = omm::TextureFilterMode::Nearest;
+		AddFlags(desc, omm::Cpu::BakeFlags::EnableDisplacementLevelDemotion);
+		const omm::Cpu::BakeDisplacementResultDesc* resDesc = Bake(desc);
+		ASSERT_NE(resDesc, nullptr);
+
+		uint16_t valuesA[45];
+		EXPECT_EQ(omm::parse::GetTriangleDisplacements(0, *resDesc, valuesA), 2);
+		EXPECT_EQ(omm::parse::GetTriangleDisplacements(1, *resDesc, nullptr), 3);
+		EXPECT_EQ(omm::parse::GetTriangleDisplacements(2, *resDesc, nullptr), 0);
+		for (uint32_t vertexIt = 0; vertexIt < 15; ++vertexIt)
+			EXPECT_EQ(valuesA[vertexIt], 512);
+
+		EXPECT_EQ(GetEdgeFlags(*resDesc, 0), omm::Cpu::DisplacementEdgeFlags::None);
+		EXPECT_EQ(GetEdgeFlags(*resDesc, 1), omm::Cpu::DisplacementEdgeFlags::DecimateEdge01);
+		EXPECT_EQ(GetEdgeFlags(*resDesc, 2), omm::Cpu::DisplacementEdgeFlags::None);
+
+		// B's decimated edge (2 1) lines up with A's.
+		for (uint32_t k = 0; k <= 4; ++k)
+			EXPECT_EQ(GetDisplacement(*resDesc, 1, uint2(2 * k, 0)), 512) << k;
+	}
+
+	TEST_P(DmmBakeTestCPU, OutputLayout) {
+
+		std::mt19937 eng(5);
+		std::uniform_real_distribution<float> dist(0.f, 1.f);
+		vmtest::Texture tex(19, 17, 1, [&](int i, int j, int w, int h, int mip)->float {
+			return dist(eng);
+		});
+
+		std::vector<float> texCoords = { 0.13f, 0.07f, 0.91f, 0.17f, 0.03f, 0.83f, 0.77f, 0.97f };
+		std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+		std::vector<uint8_t> subdivisionLevels = { 2, 3 };
+
+		omm::Cpu::BakeDisplacementInputDesc desc = GetDesc(CreateTexture(tex.GetDesc()), texCoords, indices);
+		desc.subdivisionLevels = subdivisionLevels.data();
+		const omm::Cpu::BakeDisplacementResultDesc* sdkOrder = Bake(desc);
+		ASSERT_NE(sdkOrder, nullptr);
+
+		// The SDK order reversed, any permutation goes.
+		std::vector<omm::Cpu::DisplacementMicroVertex> orders[4];
+		omm::Cpu::DisplacementMicromapLayoutDesc layout;
+		layout.format = 1;
+		for (uint32_t level = 0; level <= 3; ++level)
+		{
+			uint2 order[45];
+			omm::bird::GetMicroVertexOrder(level, order);
+			for (uint32_t vertexIt = omm::bird::GetNumMicroVertices(level); vertexIt-- > 0;)
+				orders[level].push_back({ (uint8_t)order[vertexIt].x, (uint8_t)order[vertexIt].y });
+			layout.microVertexOrder[level] = orders[level].data();
+		}
+
+		desc.outputLayout = &layout;
+		const omm::Cpu::BakeDisplacementResultDesc* resDesc = Bake(desc);
+		ASSERT_NE(resDesc, nullptr);
+		ASSERT_EQ(resDesc->dmmDescArrayCount, sdkOrder->dmmDescArrayCount);
+
+		for (uint32_t i = 0; i < resDesc->dmmDescArrayCount; ++i)
+			EXPECT_EQ(resDesc->dmmDescArray[i].format, 1);
+		for (uint32_t i = 0; i < resDesc->dmmDescArrayHistogramCount; ++i)
+			EXPECT_EQ(resDesc->dmmDescArrayHistogram[i].format, 1);
+		for (uint32_t i = 0; i < resDesc->dmmIndexHistogramCount; ++i)
+			EXPECT_EQ(resDesc->dmmIndexHistogram[i].format, 1);
+
+		for (uint32_t triangleIdx = 0; triangleIdx < 2; ++triangleIdx)
+		{
+			uint16_t expected[45];
+			uint16_t values[45];
+			const int32_t level = omm::parse::GetTriangleDisplacements(triangleIdx, *sdkOrder, expected);
+			ASSERT_EQ(omm::parse::GetTriangleDisplacements(triangleIdx, *resDesc, values), level);
+
+			const uint32_t numMicroVertices = omm::bird::GetNumMicroVertices(level);
+			for (uint32_t vertexIt = 0; vertexIt < numMicroVertices; ++vertexIt)
+				EXPECT_EQ(values[vertexIt], expected[numMicroVertices - 1 - vertexIt]) << "triangle " << triangleIdx << " vertex " << vertexIt;
+		}
+	}
+
+	TEST_P(DmmBakeTestCPU, DuplicateUVsAreShared) {
+
+		vmtest::Texture tex(16, 16, 1, [](int i, int j, int w, int h, int mip)->float {
+			return float(i ^ j) / 16.f;
+		});
+
+		std::vector<float> texCoords = { 0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 0.5f, 0.5f };
+		std::vector<uint32_t> indices = { 0, 1, 2, 0, 1, 3, 0, 1, 2 };
+
+		omm::Cpu::BakeDisplacementInputDesc desc = GetDesc(CreateTexture(tex.GetDesc()), texCoords, indices);
+		const omm::Cpu::BakeDisplacementResultDesc* resDesc = Bake(desc);
+		ASSERT_NE(resDesc, nullptr);
+		EXPECT_EQ(resDesc->dmmDescArrayCount, 2);
+		EXPECT_EQ(omm::parse::GetDmmIndexForTriangleIndex(*resDesc, 0), omm::parse::GetDmmIndexForTriangleIndex(*resDesc, 2));
+		EXPECT_NE(omm::parse::GetDmmIndexForTriangleIndex(*resDesc, 0), omm::parse::GetDmmIndexForTriangleIndex(*resDesc, 1));
+
+		AddFlags(desc, omm::Cpu::BakeFlags::DisableDuplicateDetection);
+		resDesc = Bake(desc);
+		ASSERT_NE(resDesc, nullptr);
+		EXPECT_EQ(resDesc->dmmDescArrayCount, 3);
+	}
+
+	TEST_P(DmmBakeTestCPU, InvalidArguments) {
+
+		vmtest::Texture tex(4, 4, 1, [](int i, int j, int w, int h, int mip)->float {
+			return 0.f;
+		});
+
+		std::vector<float> texCoords = { 0.f, 0.f, 1.f, 0.f, 0.f, 1.f };
+		std::vector<uint32_t> indices = { 0, 1, 2 };
+		const omm::Cpu::BakeDisplacementInputDesc valid = GetDesc(CreateTexture(tex.GetDesc()), texCoords, indices);
+
+		auto ExpectInvalid = [this](const omm::Cpu::BakeDisplacementInputDesc& desc) {
+			omm::Cpu::DisplacementBakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeDisplacementMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+			EXPECT_EQ(res, 0);
+		};
+
+		{ auto desc = valid; desc.heightTexture = 0; ExpectInvalid(desc); }
+		{ auto desc = valid; desc.heightSamplerDesc.filter = omm::TextureFilterMode::MAX_NUM; ExpectInvalid(desc); }
+		{ auto desc = valid; desc.indexCount = 0; ExpectInvalid(desc); }
+		{ auto desc = valid; desc.subdivisionLevel = 4; ExpectInvalid(desc); }
+		{ auto desc = valid; desc.dmmFormat = omm::DMMFormat::INVALID; ExpectInvalid(desc); }
+		{ auto desc = valid; desc.heightScale = 0.f; ExpectInvalid(desc); }
+
+		omm::Cpu::DisplacementMicroVertex level0[] = { { 0, 0 }, { 1, 0 }, { 0, 1 } };
+		omm::Cpu::DisplacementMicroVertex level1[] = { { 0, 0 }, { 2, 0 }, { 0, 2 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+		std::vector<omm::Cpu::DisplacementMicroVertex> levels2And3[2];
+		for (uint32_t level = 2; level <= 3; ++level)
+		{
+			for (uint8_t u = 0; u <= (1u << level); ++u)
+				for (uint8_t v = 0; u + v <= (1u << level); ++v)
+					levels2And3[level - 2].push_back({ u, v });
+		}
+		omm::Cpu::DisplacementMicromapLayoutDesc layout;
+		layout.microVertexOrder[0] = level0;
+		layout.microVertexOrder[1] = level1;
+		layout.microVertexOrder[2] = levels2And3[0].data();
+		layout.microVertexOrder[3] = levels2And3[1].data();
+		{
+			auto desc = valid;
+			desc.outputLayout = &layout;
+			omm::Cpu::DisplacementBakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeDisplacementMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::Cpu::DestroyDisplacementBakeResult(res), omm::Result::SUCCESS);
+		}
+
+		{ auto layoutCopy = layout; layoutCopy.microVertexOrder[2] = nullptr; auto desc = valid; desc.outputLayout = &layoutCopy; ExpectInvalid(desc); }
+		level1[5] = { 1, 1 };
+		{ auto desc = valid; desc.outputLayout = &layout; ExpectInvalid(desc); }
+		level1[5] = { 2, 1 };
+		{ auto desc = valid; desc.outputLayout = &layout; ExpectInvalid(desc); }
+	}
+
+	INSTANTIATE_TEST_SUITE_P(DmmBakeTestCPU, DmmBakeTestCPU, ::testing::Bool(), [](const ::testing::TestParamInfo<bool>& info) {
+		return info.param ? "InternalThreads" : "SingleThread";
+	});
+
+}  // namespace
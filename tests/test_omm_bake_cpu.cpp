@@ -17,9 +17,16 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include <omm.h>
 #include <shared/bird.h>
+#include <shared/parse.h>
 
 #include <math.h>
 #include <cmath>
+#include <random>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <omp.h>
 
 namespace {
 
@@ -28,6 +35,7 @@ namespace {
 		Default,
 		TextureDisableZOrder,
 		Force32BitIndices,
+		CompareThreadCounts = 4,
 	};
 
 	struct Options
@@ -40,6 +48,34 @@ namespace {
 		bool oneFile = true;
 		bool detailedCutout = false;
 		bool monochromeUnknowns = false;
+		const omm::Cpu::TexCoordTransform* texCoordTransform = nullptr;
+		omm::Cpu::BakeFlags extraBakeFlags = omm::Cpu::BakeFlags::None;
+		float nearDuplicateErrorBudget = 0.f;
+	};
+
+	// Opaque inside a circle centered in the UV square.
+	struct ProceduralCircle
+	{
+		static constexpr float kRadius = 0.4f;
+
+		static float Distance(float2 uv) {
+			return glm::length(uv - 0.5f);
+		}
+
+		// Bounds the distance to the center over the bounding box of the triangle.
+		static void EvaluateBounds(void* userArg, const float uv[6], float* outMin, float* outMax) {
+			const float2 aabbMin = glm::min(glm::min(float2(uv[0], uv[1]), float2(uv[2], uv[3])), float2(uv[4], uv[5]));
+			const float2 aabbMax = glm::max(glm::max(float2(uv[0], uv[1]), float2(uv[2], uv[3])), float2(uv[4], uv[5]));
+			const float distanceMin = Distance(glm::clamp(float2(0.5f), aabbMin, aabbMax));
+			const float distanceMax = glm::length(glm::max(glm::abs(aabbMin - 0.5f), glm::abs(aabbMax - 0.5f)));
+
+			*outMin = distanceMax < kRadius ? 1.f : 0.f;
+			*outMax = distanceMin < kRadius ? 1.f : 0.f;
+		}
+
+		static float EvaluatePoint(void* userArg, float u, float v) {
+			return Distance(float2(u, v)) < kRadius ? 1.f : 0.f;
+		}
 	};
 
 	class OMMBakeTestCPU : public ::testing::TestWithParam<TestSuiteConfig> {
@@ -58,6 +94,51 @@ namespace {
 
 		bool EnableZOrder() const { return !((GetParam() & TestSuiteConfig::TextureDisableZOrder) == TestSuiteConfig::TextureDisableZOrder); }
 		bool Force32BitIndices() const { return (GetParam() & TestSuiteConfig::Force32BitIndices) == TestSuiteConfig::Force32BitIndices; }
+		bool CompareThreadCounts() const { return (GetParam() & TestSuiteConfig::CompareThreadCounts) == TestSuiteConfig::CompareThreadCounts; }
+
+		// Everything BakeResultDesc references, as raw bytes.
+		static std::vector<uint8_t> GetBakeResultBytes(const omm::Cpu::BakeResultDesc& resDesc) {
+			std::vector<uint8_t> bytes;
+			auto Append = [&bytes](const void* data, size_t size) {
+				if (size != 0)
+					bytes.insert(bytes.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+			};
+			const size_t indexSize = resDesc.ommIndexFormat == omm::IndexFormat::I16_UINT ? 2 : 4;
+			Append(resDesc.ommArrayData, resDesc.ommArrayDataSize);
+			Append(resDesc.ommDescArray, resDesc.ommDescArrayCount * sizeof(omm::Cpu::OpacityMicromapDesc));
+			Append(resDesc.ommDescArrayHistogram, resDesc.ommDescArrayHistogramCount * sizeof(omm::Cpu::OpacityMicromapUsageCount));
+			Append(resDesc.ommIndexBuffer, resDesc.ommIndexCount * indexSize);
+			Append(&resDesc.ommIndexFormat, sizeof(resDesc.ommIndexFormat));
+			Append(resDesc.ommIndexHistogram, resDesc.ommIndexHistogramCount * sizeof(omm::Cpu::OpacityMicromapUsageCount));
+			return bytes;
+		}
+
+		// The bake result must be byte-identical with 1, 2 and the default number of threads.
+		void ExpectThreadCountIndependent(const omm::Cpu::BakeInputDesc& desc) {
+			const int defaultThreadCount = omp_get_max_threads();
+
+			std::vector<uint8_t> reference;
+			for (int threadCount : { defaultThreadCount, 1, 2 })
+			{
+				omp_set_num_threads(threadCount);
+
+				omm::Cpu::BakeResult res = 0;
+				ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+
+				const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+				ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+
+				const std::vector<uint8_t> bytes = GetBakeResultBytes(*resDesc);
+				if (reference.empty())
+					reference = bytes;
+				else
+					EXPECT_TRUE(bytes == reference) << "Bake result differs with " << threadCount << " threads";
+
+				EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			}
+
+			omp_set_num_threads(defaultThreadCount);
+		}
 
 		omm::Cpu::Texture CreateTexture(const omm::Cpu::TextureDesc& desc) {
 			omm::Cpu::Texture tex = 0;
@@ -77,6 +158,41 @@ namespace {
 			EXPECT_EQ(stats.totalFullyUnknownTransparent, expectedStats.totalFullyUnknownTransparent);
 		}
 
+		// Per-triangle, per-state reference for Debug::GetStats.
+		static omm::Debug::Stats GetParsedStats(const omm::Cpu::BakeResultDesc& resDesc) {
+			omm::Debug::Stats stats = omm::Debug::Stats{};
+			std::vector<omm::OpacityState> states;
+			for (uint32_t primIt = 0; primIt < resDesc.ommIndexCount; ++primIt)
+			{
+				const int32_t vmIdx = omm::parse::GetOmmIndexForTriangleIndex(resDesc, primIt);
+				if (vmIdx < 0)
+				{
+					switch ((omm::OpacityState)~vmIdx)
+					{
+					case omm::OpacityState::Opaque:				stats.totalFullyOpaque++; break;
+					case omm::OpacityState::Transparent:		stats.totalFullyTransparent++; break;
+					case omm::OpacityState::UnknownOpaque:		stats.totalFullyUnknownOpaque++; break;
+					case omm::OpacityState::UnknownTransparent:	stats.totalFullyUnknownTransparent++; break;
+					}
+					continue;
+				}
+
+				states.resize(omm::bird::GetNumMicroTriangles(resDesc.ommDescArray[vmIdx].subdivisionLevel));
+				omm::parse::GetTriangleStates(primIt, resDesc, states.data());
+				for (omm::OpacityState state : states)
+				{
+					switch (state)
+					{
+					case omm::OpacityState::Opaque:				stats.totalOpaque++; break;
+					case omm::OpacityState::Transparent:		stats.totalTransparent++; break;
+					case omm::OpacityState::UnknownOpaque:		stats.totalUnknownOpaque++; break;
+					case omm::OpacityState::UnknownTransparent:	stats.totalUnknownTransparent++; break;
+					}
+				}
+			}
+			return stats;
+		}
+
 		omm::Debug::Stats RunVmBake(
 			float alphaCutoff,
 			uint32_t subdivisionLevel,
@@ -108,6 +224,8 @@ namespace {
 			desc.maxSubdivisionLevel = subdivisionLevel;
 			desc.alphaCutoff = alphaCutoff;
 			desc.unknownStatePromotion = opt.unknownStatePromotion;
+			desc.texCoordTransform = opt.texCoordTransform;
+			desc.nearDuplicateErrorBudget = opt.nearDuplicateErrorBudget;
 			desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads);
 			if (opt.mergeSimilar)
 				desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection);
@@ -115,9 +233,13 @@ namespace {
 				desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::Force32BitIndices);
 			if (!opt.enableSpecialIndices)
 				desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::DisableSpecialIndices);
+			desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)opt.extraBakeFlags);
 
 			desc.dynamicSubdivisionScale = 0.f;
 
+			if (CompareThreadCounts())
+				ExpectThreadCountIndependent(desc);
+
 			omm::Cpu::BakeResult res = 0;
 
 			EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
@@ -149,6 +271,7 @@ namespace {
 			if (resDesc)
 			{
 				EXPECT_EQ(omm::Debug::GetStats(_baker, resDesc, &stats), omm::Result::SUCCESS);
+				ExpectEqual(stats, GetParsedStats(*resDesc));
 			}
 
 			omm::Test::ValidateHistograms(resDesc);
@@ -170,6 +293,97 @@ namespace {
 			return RunVmBake(alphaCutoff, subdivisionLevel, texSize, 6, triangleIndices, texCoords, tex, opt);
 		}
 
+		static constexpr uint32_t kJitteredCirclesSubdivisionLevel = 4;
+
+		// cellCount x cellCount cells with a circle each, one triangle per cell with slightly jittered UVs.
+		// Gives plenty of near-duplicate OMMs.
+		omm::Debug::Stats RunJitteredCirclesBake(const Options opt, uint32_t cellCount = 16) {
+			std::vector<uint32_t> triangleIndices;
+			std::vector<float> texCoords;
+			std::default_random_engine eng(42);
+			std::uniform_real_distribution<float> jitter(-0.01f, 0.01f);
+			for (uint32_t j = 0; j < cellCount; ++j)
+			{
+				for (uint32_t i = 0; i < cellCount; ++i)
+				{
+					for (float2 p : { float2(0.1f, 0.1f), float2(0.9f, 0.1f), float2(0.1f, 0.9f) })
+					{
+						triangleIndices.push_back((uint32_t)triangleIndices.size());
+						texCoords.push_back((i + p.x + jitter(eng)) / cellCount);
+						texCoords.push_back((j + p.y + jitter(eng)) / cellCount);
+					}
+				}
+			}
+
+			return RunVmBake(0.5f, kJitteredCirclesSubdivisionLevel, { 1024, 1024 }, (uint32_t)triangleIndices.size(), triangleIndices.data(), texCoords.data(), [cellCount](int i, int j, int w, int h, int mip)->float {
+				const int2 cellSize = int2(w / cellCount, h / cellCount);
+				const float2 uv = float2(int2(i % cellSize.x, j % cellSize.y)) / float2(cellSize);
+				return glm::length(uv - 0.5f) < 0.35f ? 1.f : 0.f;
+				}, opt);
+		}
+
+		static uint64_t GetTotalUnknown(const omm::Debug::Stats& stats) {
+			return stats.totalUnknownOpaque + stats.totalUnknownTransparent;
+		}
+
+		omm::Debug::Stats RunProceduralBake(
+			uint32_t subdivisionLevel,
+			const omm::Cpu::ProceduralAlphaDesc& proceduralAlpha,
+			std::function<void(const omm::Cpu::BakeResultDesc& resDesc)> validate = {}) {
+			return RunTexturelessBake(subdivisionLevel, [&proceduralAlpha](omm::Cpu::BakeInputDesc& desc) { desc.proceduralAlpha = proceduralAlpha; }, validate);
+		}
+
+		omm::Debug::Stats RunPolygonMaskBake(
+			uint32_t subdivisionLevel,
+			const omm::Cpu::PolygonMaskDesc& polygonMask,
+			std::function<void(const omm::Cpu::BakeResultDesc& resDesc)> validate = {}) {
+			return RunTexturelessBake(subdivisionLevel, [&polygonMask](omm::Cpu::BakeInputDesc& desc) { desc.polygonMask = polygonMask; }, validate);
+		}
+
+		omm::Debug::Stats RunTexturelessBake(
+			uint32_t subdivisionLevel,
+			std::function<void(omm::Cpu::BakeInputDesc& desc)> setAlphaSource,
+			std::function<void(const omm::Cpu::BakeResultDesc& resDesc)> validate) {
+
+			uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+			float texCoords[8] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f };
+
+			omm::Cpu::BakeInputDesc desc;
+			setAlphaSource(desc);
+			desc.alphaMode = omm::AlphaMode::Test;
+			desc.indexFormat = omm::IndexFormat::I32_UINT;
+			desc.indexBuffer = triangleIndices;
+			desc.texCoords = texCoords;
+			desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+			desc.indexCount = 6;
+			desc.maxSubdivisionLevel = subdivisionLevel;
+			desc.unknownStatePromotion = omm::UnknownStatePromotion::Nearest;
+			desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads | (uint32_t)omm::Cpu::BakeFlags::DisableSpecialIndices);
+			if (Force32BitIndices())
+				desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::Force32BitIndices);
+			desc.dynamicSubdivisionScale = 0.f;
+
+			if (CompareThreadCounts())
+				ExpectThreadCountIndependent(desc);
+
+			omm::Cpu::BakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+
+			omm::Debug::Stats stats = omm::Debug::Stats{};
+			EXPECT_EQ(omm::Debug::GetStats(_baker, resDesc, &stats), omm::Result::SUCCESS);
+			ExpectEqual(stats, GetParsedStats(*resDesc));
+
+			omm::Test::ValidateHistograms(resDesc);
+			if (validate)
+				validate(*resDesc);
+
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			return stats;
+		}
+
 		omm::Debug::Stats LeafletMipN(uint32_t mipStart, uint32_t NumMip)
 		{
 			uint32_t subdivisionLevel = 6;
@@ -498,6 +712,60 @@ namespace {
 			});
 	}
 
+	TEST_P(OMMBakeTestCPU, CircleMergeSimilarMultiIndex) {
+
+		// Internal flags, see BakeFlagsInternal.
+		const omm::Cpu::BakeFlags kEnableNearDuplicateDetectionBruteForce = (omm::Cpu::BakeFlags)(1u << 9);
+		const omm::Cpu::BakeFlags kEnableNearDuplicateDetectionMultiIndex = (omm::Cpu::BakeFlags)(1u << 11);
+
+		const omm::Debug::Stats statsUnmerged = RunJitteredCirclesBake({});
+		const omm::Debug::Stats statsBruteForce = RunJitteredCirclesBake({ .mergeSimilar = true, .extraBakeFlags = kEnableNearDuplicateDetectionBruteForce });
+		const omm::Debug::Stats statsMultiIndex = RunJitteredCirclesBake({ .mergeSimilar = true, .extraBakeFlags = kEnableNearDuplicateDetectionMultiIndex });
+
+		// The set fits in the brute force comparison window, both searches must merge the same pairs.
+		ExpectEqual(statsMultiIndex, statsBruteForce);
+		EXPECT_GT(GetTotalUnknown(statsMultiIndex), GetTotalUnknown(statsUnmerged));
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleMergeSimilarMultiIndexLarge) {
+
+		const omm::Cpu::BakeFlags kEnableNearDuplicateDetectionMultiIndex = (omm::Cpu::BakeFlags)(1u << 11);
+		const uint32_t numMicroTris = omm::bird::GetNumMicroTriangles(kJitteredCirclesSubdivisionLevel);
+
+		// Runs of near identical OMMs, far more than the candidates a query verifies.
+		const uint32_t kCellCount = 32;
+		const uint64_t unknownUnmerged = GetTotalUnknown(RunJitteredCirclesBake({}, kCellCount));
+		const omm::Cpu::BakeFlags flags = (omm::Cpu::BakeFlags)((uint32_t)kEnableNearDuplicateDetectionMultiIndex | (uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads);
+		EXPECT_GT(GetTotalUnknown(RunJitteredCirclesBake({ .mergeSimilar = true, .extraBakeFlags = flags }, kCellCount)), unknownUnmerged);
+
+		const float kBudget = 8.f;
+		const uint64_t unknown = GetTotalUnknown(RunJitteredCirclesBake({ .mergeSimilar = true, .extraBakeFlags = omm::Cpu::BakeFlags::EnableInternalThreads, .nearDuplicateErrorBudget = kBudget }, kCellCount));
+		EXPECT_GT(unknown, unknownUnmerged);
+		EXPECT_LE(unknown - unknownUnmerged, uint64_t(kBudget * numMicroTris));
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleMergeSimilarErrorBudget) {
+
+		const uint32_t numMicroTris = omm::bird::GetNumMicroTriangles(kJitteredCirclesSubdivisionLevel);
+
+		const omm::Debug::Stats statsUnmerged = RunJitteredCirclesBake({});
+		const uint64_t unknownUnmerged = GetTotalUnknown(statsUnmerged);
+
+		// Too small for any merge.
+		ExpectEqual(RunJitteredCirclesBake({ .mergeSimilar = true, .nearDuplicateErrorBudget = 1e-6f }), statsUnmerged);
+
+		// The downgraded area never exceeds the budget, and grows with it.
+		uint64_t prevUnknown = unknownUnmerged;
+		for (float budget : { 0.5f, 2.f, 8.f })
+		{
+			const uint64_t unknown = GetTotalUnknown(RunJitteredCirclesBake({ .mergeSimilar = true, .nearDuplicateErrorBudget = budget }));
+			EXPECT_LE(unknown - unknownUnmerged, uint64_t(budget * numMicroTris));
+			EXPECT_GE(unknown, prevUnknown);
+			prevUnknown = unknown;
+		}
+		EXPECT_GT(prevUnknown, unknownUnmerged);
+	}
+
 	TEST_P(OMMBakeTestCPU, CircleOC2) {
 
 		uint32_t subdivisionLevel = 4;
@@ -1383,6 +1651,1463 @@ namespace {
 			});
 	}
 
+	TEST_P(OMMBakeTestCPU, TexCoordTransform) {
+
+		uint32_t subdivisionLevel = 4;
+
+		// Left half opaque, right half transparent. Scaling u by 0.25 keeps the quad within the opaque half.
+		omm::Cpu::TexCoordTransform transform;
+		transform.m[0][0] = 0.25f;
+
+		omm::Debug::Stats stats = RunVmBake(0.5f, subdivisionLevel, { 1024, 1024 }, [](int i, int j, int w, int h, int mip)->float {
+			return i < w / 2 ? 1.f : 0.f;
+			}, { .texCoordTransform = &transform });
+
+		ExpectEqual(stats, {
+			.totalFullyOpaque = 2,
+			});
+	}
+
+	TEST_P(OMMBakeTestCPU, TexCoordTransformFramesNull) {
+
+		uint32_t triangleIndices[3] = { 0, 1, 2 };
+		float texCoords[6] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f };
+
+		vmtest::Texture texture(64, 64, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float { return 1.f; });
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = CreateTexture(texture.GetDesc());
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 3;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.frameCount = 4;
+
+		omm::Cpu::BakeResult res = 0;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+		EXPECT_EQ(res, 0);
+	}
+
+	TEST_P(OMMBakeTestCPU, GeometrySubRange) {
+
+		// Two triangles sharing an edge, as a standalone indexed mesh and as a submesh of shared pools.
+		const std::vector<uint32_t> indices = { 0, 1, 2, 3, 1, 2 };
+		const std::vector<float> texCoords = { 0.1f, 0.1f,	0.2f, 0.9f,	0.9f, 0.2f,	0.8f, 0.95f };
+
+		const uint32_t kIndexOffset = 5;
+		const int32_t kBaseVertex = 7;
+		std::vector<uint32_t> indexPool(kIndexOffset, 1000);
+		for (uint32_t index : indices)
+			indexPool.push_back(index + 2); // Rebased by kBaseVertex - 2 at bake time.
+		indexPool.push_back(1000);
+
+		std::vector<float> texCoordPool(2 * (kBaseVertex + 2), -5.f);
+		texCoordPool.insert(texCoordPool.end(), texCoords.begin(), texCoords.end());
+		texCoordPool.insert(texCoordPool.end(), 4, -5.f);
+
+		// Non-indexed, the vertices of each triangle in order.
+		std::vector<float> texCoordsNonIndexed(2, -5.f);
+		for (uint32_t index : indices)
+			texCoordsNonIndexed.insert(texCoordsNonIndexed.end(), { texCoords[2 * index], texCoords[2 * index + 1] });
+
+		vmtest::Texture texture(256, 256, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float {
+			return glm::length(float2(i, j) / float2(w, h) - 0.5f) < 0.3f ? 1.f : 0.f;
+			});
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = CreateTexture(texture.GetDesc());
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexCount = (uint32_t)indices.size();
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = 5;
+		desc.dynamicSubdivisionScale = 0.f;
+		desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)omm::Cpu::BakeFlags::DisableDuplicateDetection | (uint32_t)(Force32BitIndices() ? omm::Cpu::BakeFlags::Force32BitIndices : omm::Cpu::BakeFlags::None));
+
+		auto Bake = [this](const omm::Cpu::BakeInputDesc& desc) {
+			omm::Cpu::BakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+			std::vector<uint8_t> bytes;
+			if (resDesc)
+				bytes = GetBakeResultBytes(*resDesc);
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			return bytes;
+		};
+
+		omm::Cpu::BakeInputDesc plainDesc = desc;
+		plainDesc.indexBuffer = indices.data();
+		plainDesc.texCoords = texCoords.data();
+		const std::vector<uint8_t> expected = Bake(plainDesc);
+		ASSERT_FALSE(expected.empty());
+
+		omm::Cpu::BakeInputDesc subRangeDesc = desc;
+		subRangeDesc.indexBuffer = indexPool.data();
+		subRangeDesc.indexOffset = kIndexOffset;
+		subRangeDesc.baseVertex = kBaseVertex;
+		subRangeDesc.texCoords = texCoordPool.data();
+		EXPECT_EQ(Bake(subRangeDesc), expected);
+
+		omm::Cpu::BakeInputDesc nonIndexedDesc = desc;
+		nonIndexedDesc.indexFormat = omm::IndexFormat::MAX_NUM;
+		nonIndexedDesc.indexOffset = 1;
+		nonIndexedDesc.texCoords = texCoordsNonIndexed.data();
+		EXPECT_EQ(Bake(nonIndexedDesc), expected);
+
+		// Indices moved below zero by the base vertex.
+		omm::Cpu::BakeResult res = 0;
+		subRangeDesc.baseVertex = -3;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, subRangeDesc, &res), omm::Result::INVALID_ARGUMENT);
+		EXPECT_EQ(res, 0);
+	}
+
+	TEST_P(OMMBakeTestCPU, PerPrimitiveCutoffAndSpecialIndices) {
+
+		// The same triangle four times over a horizontal gradient.
+		const uint32_t kPrimitiveCount = 4;
+		std::vector<uint32_t> triangleIndices;
+		for (uint32_t primIt = 0; primIt < kPrimitiveCount; ++primIt)
+			triangleIndices.insert(triangleIndices.end(), { 0, 1, 2 });
+		float texCoords[6] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f };
+
+		vmtest::Texture texture(256, 256, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float {
+			return (i + 0.5f) / w;
+			});
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = CreateTexture(texture.GetDesc());
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices.data();
+		desc.indexCount = (uint32_t)triangleIndices.size();
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = 4;
+		desc.dynamicSubdivisionScale = 0.f;
+		desc.bakeFlags = omm::Cpu::BakeFlags::DisableSpecialIndices;
+
+		const float alphaCutoffs[kPrimitiveCount] = { 0.25f, 0.75f, 0.25f, 0.5f };
+		const int32_t specialIndices[kPrimitiveCount] = { 0, 0, 0, (int32_t)omm::SpecialIndex::FullyOpaque };
+		desc.alphaCutoffs = alphaCutoffs;
+		desc.specialIndices = specialIndices;
+
+		omm::Cpu::BakeResult res = 0;
+		ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+		const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+		ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+
+		// Identical uvs only share an OMM when the cutoffs match, the forced primitive isn't baked.
+		EXPECT_EQ(resDesc->ommDescArrayCount, 2u);
+		EXPECT_EQ(omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 0), omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 2));
+		EXPECT_NE(omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 0), omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 1));
+		EXPECT_EQ(omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 3), (int32_t)omm::SpecialIndex::FullyOpaque);
+
+		// Each baked primitive matches a bake with its cutoff as the global one.
+		const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(4);
+		for (uint32_t primIt = 0; primIt < 2; ++primIt)
+		{
+			omm::Cpu::BakeInputDesc globalDesc = desc;
+			globalDesc.indexCount = 3;
+			globalDesc.alphaCutoff = alphaCutoffs[primIt];
+			globalDesc.alphaCutoffs = nullptr;
+			globalDesc.specialIndices = nullptr;
+
+			omm::Cpu::BakeResult globalRes = 0;
+			ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, globalDesc, &globalRes), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* globalResDesc = nullptr;
+			ASSERT_EQ(omm::Cpu::GetBakeResultDesc(globalRes, globalResDesc), omm::Result::SUCCESS);
+
+			std::vector<omm::OpacityState> states(numMicroTriangles);
+			std::vector<omm::OpacityState> expectedStates(numMicroTriangles);
+			omm::parse::GetTriangleStates(primIt, *resDesc, states.data());
+			omm::parse::GetTriangleStates(0, *globalResDesc, expectedStates.data());
+			EXPECT_EQ(states, expectedStates) << "primitive " << primIt;
+
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(globalRes), omm::Result::SUCCESS);
+		}
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+
+		const int32_t invalidSpecialIndices[kPrimitiveCount] = { 0, -5, 0, 0 };
+		desc.specialIndices = invalidSpecialIndices;
+		res = 0;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+		EXPECT_EQ(res, 0);
+	}
+
+	TEST_P(OMMBakeTestCPU, PrimitiveCoverage) {
+
+		// Uniform, mixed, degenerate and forced primitives over a vertical edge at u = 0.5.
+		const uint32_t kPrimitiveCount = 4;
+		uint32_t triangleIndices[3 * kPrimitiveCount] = { 0, 1, 2,	3, 4, 5,	6, 7, 8,	9, 10, 11 };
+		float texCoords[6 * kPrimitiveCount] = {
+			0.05f, 0.05f,	0.05f, 0.4f,	0.4f, 0.05f,
+			0.f, 0.f,		0.f, 1.f,		1.f, 0.f,
+			0.2f, 0.2f,		0.2f, 0.2f,		0.2f, 0.2f,
+			0.f, 0.f,		0.f, 1.f,		1.f, 0.f,
+		};
+		const int32_t specialIndices[kPrimitiveCount] = { 0, 0, 0, (int32_t)omm::SpecialIndex::FullyUnknownTransparent };
+
+		vmtest::Texture texture(64, 64, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float {
+			return i < w / 2 ? 0.f : 1.f;
+			});
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = CreateTexture(texture.GetDesc());
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 3 * kPrimitiveCount;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = 4;
+		desc.dynamicSubdivisionScale = 0.f;
+		desc.alphaCutoff = 0.5f;
+		desc.specialIndices = specialIndices;
+
+		// Not written unless requested.
+		{
+			omm::Cpu::BakeResult res = 0;
+			ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+			EXPECT_EQ(resDesc->primitiveCoverage, nullptr);
+			EXPECT_EQ(resDesc->primitiveCoverageCount, 0u);
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+		}
+
+		desc.bakeFlags = omm::Cpu::BakeFlags::EnablePrimitiveCoverage;
+
+		omm::Cpu::BakeResult res = 0;
+		ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+		const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+		ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+		ASSERT_EQ(resDesc->primitiveCoverageCount, kPrimitiveCount);
+		const omm::Cpu::PrimitiveCoverage* coverage = resDesc->primitiveCoverage;
+
+		EXPECT_EQ(coverage[0].specialIndexReason, omm::Cpu::SpecialIndexReason::Uniform);
+		EXPECT_EQ(coverage[0].knownFraction, 1.f);
+		EXPECT_EQ(coverage[0].subdivisionLevel, 4);
+
+		// Matches the states of the OMM.
+		const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(4);
+		std::vector<omm::OpacityState> states(numMicroTriangles);
+		ASSERT_EQ(omm::parse::GetTriangleStates(1, *resDesc, states.data()), 4);
+		const size_t knownCount = std::count_if(states.begin(), states.end(), [](omm::OpacityState state) {
+			return state == omm::OpacityState::Opaque || state == omm::OpacityState::Transparent;
+			});
+		EXPECT_EQ(coverage[1].specialIndexReason, omm::Cpu::SpecialIndexReason::None);
+		EXPECT_EQ(coverage[1].knownFraction, knownCount / (float)numMicroTriangles);
+		EXPECT_GT(coverage[1].knownFraction, 0.f);
+		EXPECT_LT(coverage[1].knownFraction, 1.f);
+		EXPECT_EQ(coverage[1].subdivisionLevel, 4);
+
+		EXPECT_EQ(coverage[2].specialIndexReason, omm::Cpu::SpecialIndexReason::Degenerate);
+		EXPECT_EQ(coverage[2].knownFraction, 0.f);
+
+		EXPECT_EQ(coverage[3].specialIndexReason, omm::Cpu::SpecialIndexReason::Forced);
+		EXPECT_EQ(coverage[3].knownFraction, 0.f);
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+
+		// The mixed primitive doesn't reach the threshold.
+		desc.rejectionThreshold = coverage[1].knownFraction + 0.01f;
+		res = 0;
+		ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+		ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+		ASSERT_EQ(resDesc->primitiveCoverageCount, kPrimitiveCount);
+		EXPECT_EQ(resDesc->primitiveCoverage[1].specialIndexReason, omm::Cpu::SpecialIndexReason::Rejected);
+		EXPECT_EQ(resDesc->primitiveCoverage[1].knownFraction, 0.f);
+		EXPECT_EQ(omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 1), (int32_t)omm::SpecialIndex::FullyUnknownTransparent);
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+	}
+
+	// Records the current and peak bytes allocated through a baker.
+	struct TrackingAllocator
+	{
+		std::mutex mutex;
+		std::unordered_map<void*, std::pair<size_t, size_t>> allocations; // size, alignment
+		size_t currentSize = 0;
+		size_t peakSize = 0;
+
+		static void* Allocate(void* userArg, size_t size, size_t alignment) {
+			TrackingAllocator* self = (TrackingAllocator*)userArg;
+			void* memory = ::operator new(size, std::align_val_t(alignment));
+			std::lock_guard<std::mutex> lock(self->mutex);
+			self->allocations[memory] = { size, alignment };
+			self->currentSize += size;
+			self->peakSize = std::max(self->peakSize, self->currentSize);
+			return memory;
+		}
+
+		static void Free(void* userArg, void* memory) {
+			if (!memory)
+				return;
+			TrackingAllocator* self = (TrackingAllocator*)userArg;
+			size_t alignment = 0;
+			{
+				std::lock_guard<std::mutex> lock(self->mutex);
+				auto it = self->allocations.find(memory);
+				self->currentSize -= it->second.first;
+				alignment = it->second.second;
+				self->allocations.erase(it);
+			}
+			::operator delete(memory, std::align_val_t(alignment));
+		}
+
+		static void* Reallocate(void* userArg, void* memory, size_t size, size_t alignment) {
+			TrackingAllocator* self = (TrackingAllocator*)userArg;
+			void* newMemory = Allocate(userArg, size, alignment);
+			if (memory)
+			{
+				size_t oldSize = 0;
+				{
+					std::lock_guard<std::mutex> lock(self->mutex);
+					oldSize = self->allocations[memory].first;
+				}
+				std::memcpy(newMemory, memory, std::min(oldSize, size));
+				Free(userArg, memory);
+			}
+			return newMemory;
+		}
+	};
+
+	TEST_P(OMMBakeTestCPU, PreBakeEstimate) {
+
+		TrackingAllocator allocator;
+		omm::BakerCreationDesc bakerDesc = { .type = omm::BakerType::CPU };
+		bakerDesc.memoryAllocatorInterface = { &TrackingAllocator::Allocate, &TrackingAllocator::Reallocate, &TrackingAllocator::Free, &allocator };
+		omm::Baker baker = 0;
+		ASSERT_EQ(omm::CreateOpacityMicromapBaker(bakerDesc, &baker), omm::Result::SUCCESS);
+
+		vmtest::Texture texture(256, 256, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float {
+			return 0.5f + 0.5f * std::sin(i * 0.1f) * std::cos(j * 0.07f);
+			});
+		omm::Cpu::Texture tex = 0;
+		ASSERT_EQ(omm::Cpu::CreateTexture(baker, texture.GetDesc(), &tex), omm::Result::SUCCESS);
+
+		// Small triangles, every one twice, and a degenerate one.
+		const uint32_t kUniqueTriangleCount = 128;
+		std::default_random_engine eng(7);
+		std::uniform_real_distribution<float> distr(0.f, 1.f);
+		std::vector<float> texCoords;
+		for (uint32_t triIt = 0; triIt < kUniqueTriangleCount; ++triIt)
+		{
+			const float u = 0.9f * distr(eng);
+			const float v = 0.9f * distr(eng);
+			for (uint32_t vertexIt = 0; vertexIt < 3; ++vertexIt)
+				texCoords.insert(texCoords.end(), { u + 0.1f * distr(eng), v + 0.1f * distr(eng) });
+		}
+		texCoords.insert(texCoords.end(), { 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f });
+
+		std::vector<uint32_t> triangleIndices;
+		for (uint32_t i = 0; i < 3 * kUniqueTriangleCount; ++i)
+			triangleIndices.push_back(i);
+		for (uint32_t i = 0; i < 3 * kUniqueTriangleCount; ++i)
+			triangleIndices.push_back(i);
+		triangleIndices.insert(triangleIndices.end(), { 3 * kUniqueTriangleCount, 3 * kUniqueTriangleCount + 1, 3 * kUniqueTriangleCount + 2 });
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = tex;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices.data();
+		desc.indexCount = (uint32_t)triangleIndices.size();
+		desc.texCoords = texCoords.data();
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = 5;
+		desc.dynamicSubdivisionScale = 0.f;
+		desc.alphaCutoff = 0.5f;
+
+		struct Config
+		{
+			bool disableDuplicateDetection = false;
+			bool enableNearDuplicateDetection = false;
+			float nearDuplicateErrorBudget = 0.f;
+		};
+
+		// The near-duplicate passes are included, for LSH and the multi-index search of the error budget.
+		for (const Config config : { Config{}, Config{ .disableDuplicateDetection = true }, Config{ .enableNearDuplicateDetection = true }, Config{ .enableNearDuplicateDetection = true, .nearDuplicateErrorBudget = 4.f } })
+		{
+			const bool disableDuplicateDetection = config.disableDuplicateDetection;
+			desc.bakeFlags = disableDuplicateDetection ?
+				(omm::Cpu::BakeFlags)((uint32_t)omm::Cpu::BakeFlags::DisableDuplicateDetection | (uint32_t)omm::Cpu::BakeFlags::DisableSpecialIndices) :
+				omm::Cpu::BakeFlags::None;
+			if (config.enableNearDuplicateDetection)
+				desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection);
+			desc.nearDuplicateErrorBudget = config.nearDuplicateErrorBudget;
+
+			omm::Cpu::PreBakeEstimate info;
+			ASSERT_EQ(omm::Cpu::GetPreBakeEstimate(baker, desc, &info), omm::Result::SUCCESS);
+			EXPECT_EQ(info.workItemCount, disableDuplicateDetection ? 2 * kUniqueTriangleCount : kUniqueTriangleCount);
+			EXPECT_EQ(info.microTriangleCount, info.workItemCount * omm::bird::GetNumMicroTriangles(5));
+			EXPECT_GT(info.workloadSize, 0u);
+
+			const size_t baseSize = allocator.currentSize;
+			allocator.peakSize = baseSize;
+
+			omm::Cpu::BakeResult res = 0;
+			ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+
+			EXPECT_LE(resDesc->ommArrayDataSize, info.maxOmmArrayDataSizeInBytes);
+			if (disableDuplicateDetection)
+				EXPECT_EQ(resDesc->ommArrayDataSize, info.maxOmmArrayDataSizeInBytes);
+			EXPECT_LE(allocator.currentSize - baseSize, info.maxResultSizeInBytes);
+
+			// An estimate, but within a small factor of the real peak.
+			const size_t peakSize = allocator.peakSize - baseSize;
+			EXPECT_GT(info.peakMemoryInBytes, peakSize / 2) << peakSize << " near-duplicate budget " << config.nearDuplicateErrorBudget;
+			EXPECT_LT(info.peakMemoryInBytes, peakSize * 2) << peakSize << " near-duplicate budget " << config.nearDuplicateErrorBudget;
+
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+		}
+
+		omm::Cpu::PreBakeEstimate info;
+		desc.indexCount = 0;
+		EXPECT_EQ(omm::Cpu::GetPreBakeEstimate(baker, desc, &info), omm::Result::INVALID_ARGUMENT);
+
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, tex), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::DestroyOpacityMicromapBaker(baker), omm::Result::SUCCESS);
+	}
+
+	TEST_P(OMMBakeTestCPU, ConcurrentBakes) {
+
+		vmtest::Texture texture(512, 512, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float {
+			return 0.5f + 0.5f * std::sin(i * 0.05f) * std::cos(j * 0.03f);
+			});
+		const omm::Cpu::Texture sharedTexture = CreateTexture(texture.GetDesc());
+
+		// One mesh per job, two triangles at a job dependent offset.
+		const uint32_t kJobCount = 16;
+		uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+		std::vector<std::vector<float>> texCoords(kJobCount);
+		for (uint32_t jobIt = 0; jobIt < kJobCount; ++jobIt)
+		{
+			const float o = 0.05f * jobIt;
+			texCoords[jobIt] = { o, o,	o, o + 0.5f,	o + 0.5f, o,	o + 0.5f, o + 0.5f };
+		}
+
+		auto Bake = [&](uint32_t jobIt, bool enableInternalThreads) {
+			omm::Cpu::BakeInputDesc desc;
+			desc.texture = sharedTexture;
+			desc.alphaMode = omm::AlphaMode::Test;
+			desc.runtimeSamplerDesc.addressingMode = jobIt % 2 ? omm::TextureAddressMode::Clamp : omm::TextureAddressMode::Wrap;
+			desc.runtimeSamplerDesc.filter = jobIt % 3 ? omm::TextureFilterMode::Linear : omm::TextureFilterMode::Nearest;
+			desc.indexFormat = omm::IndexFormat::I32_UINT;
+			desc.indexBuffer = triangleIndices;
+			desc.indexCount = 6;
+			desc.texCoords = texCoords[jobIt].data();
+			desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+			desc.maxSubdivisionLevel = 5;
+			desc.dynamicSubdivisionScale = 0.f;
+			desc.bakeFlags = enableInternalThreads ? omm::Cpu::BakeFlags::EnableInternalThreads : omm::Cpu::BakeFlags::None;
+
+			omm::Cpu::BakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+			std::vector<uint8_t> bytes;
+			if (resDesc)
+				bytes = GetBakeResultBytes(*resDesc);
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			return bytes;
+		};
+
+		std::vector<std::vector<uint8_t>> expected(kJobCount);
+		for (uint32_t jobIt = 0; jobIt < kJobCount; ++jobIt)
+			expected[jobIt] = Bake(jobIt, false);
+
+		// Each thread bakes every job against the shared texture, while creating and destroying textures of its own.
+		const uint32_t kThreadCount = 8;
+		std::vector<std::vector<std::vector<uint8_t>>> results(kThreadCount, std::vector<std::vector<uint8_t>>(kJobCount));
+		std::vector<std::thread> threads;
+		for (uint32_t threadIt = 0; threadIt < kThreadCount; ++threadIt)
+		{
+			threads.emplace_back([&, threadIt]() {
+				for (uint32_t i = 0; i < kJobCount; ++i)
+				{
+					const uint32_t jobIt = (i + threadIt) % kJobCount;
+					omm::Cpu::Texture scratch = 0;
+					EXPECT_EQ(omm::Cpu::CreateTexture(_baker, texture.GetDesc(), &scratch), omm::Result::SUCCESS);
+					results[threadIt][jobIt] = Bake(jobIt, threadIt % 2 == 0);
+					EXPECT_EQ(omm::Cpu::DestroyTexture(_baker, scratch), omm::Result::SUCCESS);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+
+		for (uint32_t threadIt = 0; threadIt < kThreadCount; ++threadIt)
+			for (uint32_t jobIt = 0; jobIt < kJobCount; ++jobIt)
+				EXPECT_TRUE(results[threadIt][jobIt] == expected[jobIt]) << "thread " << threadIt << " job " << jobIt;
+	}
+
+	TEST_P(OMMBakeTestCPU, BakeDispatchConfig) {
+
+		const uint32_t kSize = 64;
+		const uint32_t kMaxSubdivisionLevel = 3;
+		auto Alpha = [](uint32_t i, uint32_t j) { return 0.5f + 0.5f * std::sin(i * 0.3f) * std::cos(j * 0.2f); };
+
+		// RGBA texture with alpha in the last channel, as IN_ALPHA_TEXTURE.
+		std::vector<float> rgba(4 * kSize * kSize, 0.f);
+		for (uint32_t j = 0; j < kSize; ++j)
+			for (uint32_t i = 0; i < kSize; ++i)
+				rgba[4 * (j * kSize + i) + 3] = Alpha(i, j);
+
+		vmtest::Texture texture(kSize, kSize, 1, EnableZOrder(), [&](int i, int j, int w, int h, int mip)->float {
+			return Alpha(i, j);
+			});
+		const omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		// Texcoords after a 16 byte header, 16 bit indices interleaved with padding.
+		std::vector<float> texCoordBuffer = { -1.f, -1.f, -1.f, -1.f };
+		std::vector<uint32_t> indices;
+		std::vector<uint16_t> stridedIndices;
+		std::default_random_engine eng(13);
+		std::uniform_real_distribution<float> distr(0.f, 1.f);
+		for (uint32_t vertexIt = 0; vertexIt < 3 * 32; ++vertexIt)
+		{
+			texCoordBuffer.insert(texCoordBuffer.end(), { distr(eng), distr(eng) });
+			indices.push_back(vertexIt);
+			stridedIndices.insert(stridedIndices.end(), { (uint16_t)vertexIt, 0xFFFF });
+		}
+		// A duplicate of the first triangle.
+		indices.insert(indices.end(), { 0, 1, 2 });
+		stridedIndices.insert(stridedIndices.end(), { 0, 0xFFFF, 1, 0xFFFF, 2, 0xFFFF });
+
+		omm::Gpu::BakeDispatchConfigDesc config;
+		config.bakeFlags = omm::Gpu::BakeFlags::EnablePostBuildInfo;
+		config.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		config.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		config.alphaMode = omm::AlphaMode::Test;
+		config.alphaTextureWidth = kSize;
+		config.alphaTextureHeight = kSize;
+		config.alphaTextureChannel = 3;
+		config.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		config.texCoordOffsetInBytes = 4 * sizeof(float);
+		config.indexFormat = omm::IndexFormat::I16_UINT;
+		config.indexCount = (uint32_t)indices.size();
+		config.indexStrideInBytes = 2 * sizeof(uint16_t);
+		config.globalOMMFormat = omm::OMMFormat::OC1_4_State;
+		config.supportedOMMFormats[0] = omm::OMMFormat::OC1_4_State;
+		config.numSupportedOMMFormats = 1;
+		config.globalSubdivisionLevel = kMaxSubdivisionLevel;
+		config.maxSubdivisionLevel = kMaxSubdivisionLevel;
+		config.dynamicSubdivisionScale = 0.f;
+
+		omm::Cpu::BakeDispatchInputDesc input;
+		input.alphaTexture = rgba.data();
+		input.texCoordBuffer = texCoordBuffer.data();
+		input.indexBuffer = stridedIndices.data();
+
+		omm::Cpu::DispatchBakeResult dispatchRes = 0;
+		ASSERT_EQ(omm::Cpu::BakeOpacityMicromapDispatch(_baker, config, input, &dispatchRes), omm::Result::SUCCESS);
+		const omm::Cpu::BakeDispatchResultDesc* dispatchDesc = nullptr;
+		ASSERT_EQ(omm::Cpu::GetDispatchBakeResultDesc(dispatchRes, dispatchDesc), omm::Result::SUCCESS);
+
+		// The same bake through the CPU API.
+		omm::Cpu::BakeInputDesc desc;
+		desc.bakeFlags = omm::Cpu::BakeFlags::Force32BitIndices;
+		desc.texture = tex;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc = config.runtimeSamplerDesc;
+		desc.unknownStatePromotion = omm::UnknownStatePromotion::Nearest;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = indices.data();
+		desc.indexCount = (uint32_t)indices.size();
+		desc.texCoords = texCoordBuffer.data() + 4;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = kMaxSubdivisionLevel;
+		desc.dynamicSubdivisionScale = 0.f;
+
+		omm::Cpu::BakeResult res = 0;
+		ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+		const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+		ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+
+		ASSERT_GT(resDesc->ommDescArrayCount, 0u);
+		ASSERT_EQ(dispatchDesc->ommArrayDataSizeInBytes, resDesc->ommArrayDataSize);
+		EXPECT_EQ(memcmp(dispatchDesc->ommArrayData, resDesc->ommArrayData, resDesc->ommArrayDataSize), 0);
+		ASSERT_EQ(dispatchDesc->ommDescArraySizeInBytes, resDesc->ommDescArrayCount * sizeof(omm::Cpu::OpacityMicromapDesc));
+		EXPECT_EQ(memcmp(dispatchDesc->ommDescArray, resDesc->ommDescArray, dispatchDesc->ommDescArraySizeInBytes), 0);
+		EXPECT_EQ(dispatchDesc->postBakeInfo.outOmmArraySizeInBytes, resDesc->ommArrayDataSize);
+		EXPECT_EQ(dispatchDesc->postBakeInfo.outOmmDescSizeInBytes, dispatchDesc->ommDescArraySizeInBytes);
+
+		// 16 bit indices below 65535 - 4 primitives, padded to 4 bytes.
+		const uint32_t primitiveCount = (uint32_t)indices.size() / 3;
+		ASSERT_EQ(dispatchDesc->ommIndexFormat, omm::IndexFormat::I16_UINT);
+		ASSERT_EQ(dispatchDesc->ommIndexCount, primitiveCount);
+		EXPECT_EQ(dispatchDesc->ommIndexBufferSizeInBytes, (primitiveCount * sizeof(int16_t) + 3) & ~3u);
+		for (uint32_t primIt = 0; primIt < primitiveCount; ++primIt)
+			EXPECT_EQ(((const int16_t*)dispatchDesc->ommIndexBuffer)[primIt], ((const int32_t*)resDesc->ommIndexBuffer)[primIt]);
+
+		// A slot per level and format, [OC1_2_State, OC1_4_State] per level.
+		const uint32_t kSlotCount = 2 * (kMaxSubdivisionLevel + 1);
+		ASSERT_EQ(dispatchDesc->ommDescArrayHistogramSizeInBytes, kSlotCount * sizeof(omm::Cpu::OpacityMicromapUsageCount));
+		ASSERT_EQ(dispatchDesc->ommIndexHistogramSizeInBytes, kSlotCount * sizeof(omm::Cpu::OpacityMicromapUsageCount));
+		const auto* arrayHistogram = (const omm::Cpu::OpacityMicromapUsageCount*)dispatchDesc->ommDescArrayHistogram;
+		const auto* indexHistogram = (const omm::Cpu::OpacityMicromapUsageCount*)dispatchDesc->ommIndexHistogram;
+		for (uint32_t slotIt = 0; slotIt < kSlotCount; ++slotIt)
+		{
+			EXPECT_EQ(arrayHistogram[slotIt].subdivisionLevel, slotIt / 2);
+			EXPECT_EQ(arrayHistogram[slotIt].format, slotIt % 2 + 1);
+			EXPECT_EQ(indexHistogram[slotIt].subdivisionLevel, slotIt / 2);
+			EXPECT_EQ(indexHistogram[slotIt].format, slotIt % 2 + 1);
+		}
+		uint32_t arrayCount = 0;
+		for (uint32_t slotIt = 0; slotIt < kSlotCount; ++slotIt)
+			arrayCount += arrayHistogram[slotIt].count;
+		EXPECT_EQ(arrayCount, resDesc->ommDescArrayCount);
+		for (uint32_t i = 0; i < resDesc->ommIndexHistogramCount; ++i)
+		{
+			const omm::Cpu::OpacityMicromapUsageCount& usage = resDesc->ommIndexHistogram[i];
+			EXPECT_EQ(indexHistogram[2 * usage.subdivisionLevel + usage.format - 1].count, usage.count);
+		}
+
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyDispatchBakeResult(dispatchRes), omm::Result::SUCCESS);
+
+		// Same restrictions as the GPU baker.
+		config.enableSubdivisionLevelBuffer = true;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromapDispatch(_baker, config, input, &dispatchRes), omm::Result::NOT_IMPLEMENTED);
+		config.enableSubdivisionLevelBuffer = false;
+		config.alphaTextureChannel = 0;
+		input.alphaTextureChannelCount = 1;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromapDispatch(_baker, config, input, &dispatchRes), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyDispatchBakeResult(dispatchRes), omm::Result::SUCCESS);
+		config.alphaTextureChannel = 1;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromapDispatch(_baker, config, input, &dispatchRes), omm::Result::INVALID_ARGUMENT);
+	}
+
+	TEST_P(OMMBakeTestCPU, SamplerLodRange) {
+
+		// Mip 1 is transparent, mips 0 and 2 opaque.
+		vmtest::Texture texture(64, 64, 3, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float {
+			return mip == 1 ? 0.f : 1.f;
+			});
+		const omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		uint32_t triangleIndices[3] = { 0, 1, 2 };
+		float texCoords[6] = { 0.1f, 0.1f, 0.9f, 0.1f, 0.1f, 0.9f };
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = tex;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 3;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = 3;
+		desc.dynamicSubdivisionScale = 0.f;
+
+		// Fully opaque unless the LOD range reaches mip 1.
+		auto IsFullyOpaque = [&](float minLod, float maxLod) {
+			desc.runtimeSamplerDesc.minLod = minLod;
+			desc.runtimeSamplerDesc.maxLod = maxLod;
+			omm::Cpu::BakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+			const omm::Debug::Stats stats = GetParsedStats(*resDesc);
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			return stats.totalFullyOpaque == 1;
+		};
+
+		EXPECT_FALSE(IsFullyOpaque(0.f, 1000.f)); // Default, every mip.
+		EXPECT_TRUE(IsFullyOpaque(0.f, 0.f));
+		EXPECT_TRUE(IsFullyOpaque(-2.f, 0.f));
+		EXPECT_FALSE(IsFullyOpaque(0.f, 0.5f)); // Trilinear between mip 0 and 1.
+		EXPECT_FALSE(IsFullyOpaque(1.2f, 1.8f));
+		EXPECT_TRUE(IsFullyOpaque(2.f, 2.f));
+		EXPECT_TRUE(IsFullyOpaque(4.f, 8.f)); // Clamped to the last mip.
+
+		desc.runtimeSamplerDesc.minLod = 2.f;
+		desc.runtimeSamplerDesc.maxLod = 1.f;
+		omm::Cpu::BakeResult res = 0;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+	}
+
+	TEST_P(OMMBakeTestCPU, SamplerAnisotropy) {
+
+		// A transparent column at texel 40, the triangle ends at texel 36.
+		vmtest::Texture texture(64, 64, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float {
+			return i == 40 ? 0.f : 1.f;
+			});
+		const omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		uint32_t triangleIndices[3] = { 0, 1, 2 };
+		float texCoords[6] = { 0.1f, 0.1f, 36.f / 64.f, 0.1f, 0.1f, 0.9f };
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = tex;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 3;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = 3;
+		desc.dynamicSubdivisionScale = 0.f;
+
+		for (omm::TextureFilterMode filter : { omm::TextureFilterMode::Nearest, omm::TextureFilterMode::Linear })
+		{
+			desc.runtimeSamplerDesc.filter = filter;
+			for (uint32_t maxAnisotropy : { 1u, 2u, 16u })
+			{
+				desc.runtimeSamplerDesc.maxAnisotropy = maxAnisotropy;
+				omm::Cpu::BakeResult res = 0;
+				ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+				const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+				ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+				const omm::Debug::Stats stats = GetParsedStats(*resDesc);
+
+				// A footprint of 16 texels reaches the column from the micro-triangles next to it only.
+				if (maxAnisotropy == 16)
+				{
+					EXPECT_EQ(stats.totalFullyOpaque, 0u);
+					EXPECT_GT(stats.totalOpaque, 0u);
+					EXPECT_GT(stats.totalUnknownOpaque + stats.totalUnknownTransparent, 0u);
+				}
+				else
+					EXPECT_EQ(stats.totalFullyOpaque, 1u) << maxAnisotropy;
+
+				EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			}
+		}
+
+		for (uint32_t maxAnisotropy : { 0u, 17u })
+		{
+			desc.runtimeSamplerDesc.maxAnisotropy = maxAnisotropy;
+			omm::Cpu::BakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+		}
+	}
+
+	TEST_P(OMMBakeTestCPU, UdimTiles) {
+
+		vmtest::Texture opaque(32, 32, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float { return 1.f; });
+		vmtest::Texture transparent(32, 32, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float { return 0.f; });
+		vmtest::Texture halfOpaque(32, 32, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float { return i < w / 2 ? 1.f : 0.f; });
+
+		const omm::Cpu::UdimTileDesc tiles[3] = {
+			{ 1001, CreateTexture(opaque.GetDesc()) },
+			{ 1002, CreateTexture(transparent.GetDesc()) },
+			{ 1011, CreateTexture(halfOpaque.GetDesc()) },
+		};
+
+		// Inside 1001, inside 1002, straddling 1001 and 1002, inside the missing tile 1003 and inside 1011.
+		uint32_t triangleIndices[15] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 };
+		float texCoords[30] = {
+			0.1f, 0.1f, 0.9f, 0.1f, 0.1f, 0.9f,
+			1.1f, 0.1f, 1.9f, 0.1f, 1.1f, 0.9f,
+			0.45f, 0.1f, 1.45f, 0.1f, 0.45f, 0.9f,
+			2.1f, 0.1f, 2.9f, 0.1f, 2.1f, 0.9f,
+			0.1f, 1.1f, 0.9f, 1.1f, 0.1f, 1.9f,
+		};
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.udimTiles = tiles;
+		desc.udimTileCount = 3;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.alphaCutoff = 0.5f;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.borderAlpha = 0.f;
+		desc.unknownStatePromotion = omm::UnknownStatePromotion::Nearest;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 15;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = 4;
+		desc.dynamicSubdivisionScale = 0.f;
+
+		// The triangle inside 1011 must match a bake of that tile alone.
+		omm::Cpu::BakeInputDesc singleDesc = desc;
+		singleDesc.udimTiles = nullptr;
+		singleDesc.udimTileCount = 0;
+		singleDesc.texture = tiles[2].texture;
+		singleDesc.indexCount = 3;
+		float singleTexCoords[6] = { 0.1f, 0.1f, 0.9f, 0.1f, 0.1f, 0.9f };
+		singleDesc.texCoords = singleTexCoords;
+
+		for (omm::TextureFilterMode filter : { omm::TextureFilterMode::Nearest, omm::TextureFilterMode::Linear })
+		{
+			desc.runtimeSamplerDesc.filter = filter;
+			singleDesc.runtimeSamplerDesc.filter = filter;
+
+			omm::Cpu::BakeResult res = 0;
+			ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+
+			EXPECT_EQ(omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 0), (int32_t)omm::SpecialIndex::FullyOpaque);
+			EXPECT_EQ(omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 1), (int32_t)omm::SpecialIndex::FullyTransparent);
+			EXPECT_EQ(omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 3), (int32_t)omm::SpecialIndex::FullyTransparent);
+
+			// The straddling triangle sees both tiles, with unknowns along the boundary.
+			std::vector<omm::OpacityState> states(omm::bird::GetNumMicroTriangles(desc.maxSubdivisionLevel));
+			ASSERT_GE(omm::parse::GetOmmIndexForTriangleIndex(*resDesc, 2), 0);
+			omm::parse::GetTriangleStates(2, *resDesc, states.data());
+			EXPECT_NE(std::count(states.begin(), states.end(), omm::OpacityState::Opaque), 0);
+			EXPECT_NE(std::count(states.begin(), states.end(), omm::OpacityState::Transparent), 0);
+			EXPECT_NE(std::count(states.begin(), states.end(), omm::OpacityState::UnknownOpaque) +
+				std::count(states.begin(), states.end(), omm::OpacityState::UnknownTransparent), 0);
+
+			omm::Cpu::BakeResult singleRes = 0;
+			ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, singleDesc, &singleRes), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* singleResDesc = nullptr;
+			ASSERT_EQ(omm::Cpu::GetBakeResultDesc(singleRes, singleResDesc), omm::Result::SUCCESS);
+
+			std::vector<omm::OpacityState> singleStates(states.size());
+			omm::parse::GetTriangleStates(4, *resDesc, states.data());
+			omm::parse::GetTriangleStates(0, *singleResDesc, singleStates.data());
+			EXPECT_EQ(states, singleStates) << (uint32_t)filter;
+
+			omm::Test::ValidateHistograms(resDesc);
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(singleRes), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+		}
+
+		// A tile outside of the grid, duplicate tiles and a second alpha source are rejected.
+		omm::Cpu::UdimTileDesc invalidTiles[2] = { tiles[0], tiles[1] };
+		desc.udimTiles = invalidTiles;
+		desc.udimTileCount = 2;
+		for (uint32_t tile : { 1000u, 2001u, 1001u })
+		{
+			invalidTiles[1].tile = tile;
+			omm::Cpu::BakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT) << tile;
+		}
+
+		desc.udimTiles = tiles;
+		desc.udimTileCount = 3;
+		desc.texture = tiles[0].texture;
+		omm::Cpu::BakeResult res = 0;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+	}
+
+	TEST_P(OMMBakeTestCPU, TexCoordTransformFlipbook) {
+
+		uint32_t subdivisionLevel = 4;
+
+		uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+		float texCoords[8] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f };
+		const uint32_t primitiveCount = 2;
+
+		// 2x2 atlas, the same circle in each cell.
+		vmtest::Texture texture(1024, 1024, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float {
+			const int2 cellSize = int2(w / 2, h / 2);
+			const float2 uv = float2(int2(i % cellSize.x, j % cellSize.y)) / float2(cellSize);
+			return glm::length(uv - 0.5f) < 0.4f ? 1.f : 0.f;
+			});
+
+		omm::Cpu::TexCoordTransform frames[4];
+		for (uint32_t frameIt = 0; frameIt < 4; ++frameIt)
+		{
+			frames[frameIt].m[0][0] = 0.5f;
+			frames[frameIt].m[1][1] = 0.5f;
+			frames[frameIt].m[0][2] = 0.5f * (frameIt % 2);
+			frames[frameIt].m[1][2] = 0.5f * (frameIt / 2);
+		}
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = CreateTexture(texture.GetDesc());
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 3 * primitiveCount;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = subdivisionLevel;
+		desc.dynamicSubdivisionScale = 0.f;
+		desc.bakeFlags = omm::Cpu::BakeFlags::EnableInternalThreads;
+		if (Force32BitIndices())
+			desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::Force32BitIndices);
+		desc.frameTexCoordTransforms = frames;
+		desc.frameCount = 4;
+
+		if (CompareThreadCounts())
+			ExpectThreadCountIndependent(desc);
+
+		omm::Cpu::BakeResult res = 0;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+
+		const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+		EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+
+		// One index buffer per frame, all frames reference the OMMs of the first frame.
+		EXPECT_EQ(resDesc->ommIndexCount, 4 * primitiveCount);
+		EXPECT_EQ(resDesc->ommDescArrayCount, primitiveCount);
+		for (uint32_t frameIt = 1; frameIt < 4; ++frameIt)
+		{
+			for (uint32_t primIt = 0; primIt < primitiveCount; ++primIt)
+			{
+				EXPECT_EQ(omm::parse::GetOmmIndexForTriangleIndex(*resDesc, frameIt * primitiveCount + primIt),
+						  omm::parse::GetOmmIndexForTriangleIndex(*resDesc, primIt));
+			}
+		}
+
+		omm::Test::ValidateHistograms(resDesc);
+
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+	}
+
+	TEST_P(OMMBakeTestCPU, DebugRenderImage) {
+
+		uint32_t subdivisionLevel = 4;
+
+		uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+		float texCoords[8] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f };
+
+		vmtest::Texture texture(64, 64, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float {
+			const float2 uv = float2(i, j) / float2(w, h);
+			return glm::length(uv - 0.5f) < 0.4f ? 1.f : 0.f;
+			});
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = CreateTexture(texture.GetDesc());
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 6;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = subdivisionLevel;
+		desc.dynamicSubdivisionScale = 0.f;
+		desc.bakeFlags = omm::Cpu::BakeFlags::EnableInternalThreads;
+
+		omm::Cpu::BakeResult res = 0;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS);
+
+		const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+		EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+
+		const uint32_t kSize = 256;
+		std::vector<uint8_t> full(kSize * kSize * 4);
+		omm::Debug::RenderImageDesc renderDesc;
+		renderDesc.width = kSize;
+		renderDesc.height = kSize;
+		renderDesc.outRGBA = full.data();
+		EXPECT_EQ(omm::Debug::RenderImage(_baker, desc, resDesc, renderDesc), omm::Result::SUCCESS);
+
+		// The state colors are blended in, the image can't be the plain texture.
+		std::set<uint32_t> colors;
+		for (size_t i = 0; i < full.size(); i += 4)
+			colors.insert(full[i] | (full[i + 1] << 8) | (full[i + 2] << 16));
+		EXPECT_GT(colors.size(), 4u);
+
+		// A region of interest at the same pixel density is a crop of the full image, also with a padded row pitch.
+		const uint32_t kRoiSize = 64;
+		const uint32_t kRoiPitch = kRoiSize * 4 + 16;
+		const uint2 kRoiOffset = uint2(64, 128);
+		std::vector<uint8_t> roi(kRoiSize * kRoiPitch);
+		renderDesc.uvMin[0] = 0.25f;
+		renderDesc.uvMin[1] = 0.5f;
+		renderDesc.uvMax[0] = 0.5f;
+		renderDesc.uvMax[1] = 0.75f;
+		renderDesc.width = kRoiSize;
+		renderDesc.height = kRoiSize;
+		renderDesc.outRGBA = roi.data();
+		renderDesc.rowPitch = kRoiPitch;
+		EXPECT_EQ(omm::Debug::RenderImage(_baker, desc, resDesc, renderDesc), omm::Result::SUCCESS);
+
+		for (uint32_t j = 0; j < kRoiSize; ++j)
+		{
+			const uint8_t* roiRow = roi.data() + j * kRoiPitch;
+			const uint8_t* fullRow = full.data() + ((j + kRoiOffset.y) * kSize + kRoiOffset.x) * 4;
+			EXPECT_TRUE(std::equal(roiRow, roiRow + kRoiSize * 4, fullRow)) << "row " << j;
+		}
+
+		// The neighbourhood of a single primitive.
+		renderDesc.primitiveIndex = 1;
+		EXPECT_EQ(omm::Debug::RenderImage(_baker, desc, resDesc, renderDesc), omm::Result::SUCCESS);
+
+		renderDesc.primitiveIndex = 2;
+		EXPECT_EQ(omm::Debug::RenderImage(_baker, desc, resDesc, renderDesc), omm::Result::INVALID_ARGUMENT);
+
+		renderDesc.primitiveIndex = 0xFFFFFFFF;
+		renderDesc.rowPitch = kRoiSize;
+		EXPECT_EQ(omm::Debug::RenderImage(_baker, desc, resDesc, renderDesc), omm::Result::INVALID_ARGUMENT);
+
+		renderDesc.rowPitch = 0;
+		renderDesc.uvMax[0] = renderDesc.uvMin[0];
+		EXPECT_EQ(omm::Debug::RenderImage(_baker, desc, resDesc, renderDesc), omm::Result::INVALID_ARGUMENT);
+
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+	}
+
+	TEST_P(OMMBakeTestCPU, TextureCache) {
+
+		omm::Baker baker = 0;
+		EXPECT_EQ(omm::CreateOpacityMicromapBaker({ .type = omm::BakerType::CPU, .textureCacheSizeInBytes = 64 * 1024 * 1024 }, &baker), omm::Result::SUCCESS);
+
+		const int kSize = 128;
+		std::vector<float> texels(kSize * kSize);
+		for (int j = 0; j < kSize; ++j)
+			for (int i = 0; i < kSize; ++i)
+				texels[j * kSize + i] = glm::length(float2(i, j) / float(kSize) - 0.5f) < 0.4f ? 1.f : 0.f;
+
+		// Same texels with a padded row pitch.
+		const int kPaddedPitch = kSize + 3;
+		std::vector<float> paddedTexels(kPaddedPitch * kSize, -1.f);
+		for (int j = 0; j < kSize; ++j)
+			std::copy(texels.begin() + j * kSize, texels.begin() + (j + 1) * kSize, paddedTexels.begin() + j * kPaddedPitch);
+
+		auto Create = [baker](const std::vector<float>& data, uint32_t rowPitch, omm::Cpu::TextureFlags flags) {
+			omm::Cpu::TextureMipDesc mip;
+			mip.width = kSize;
+			mip.height = kSize;
+			mip.rowPitch = rowPitch;
+			mip.textureData = data.data();
+			omm::Cpu::TextureDesc desc;
+			desc.format = omm::Cpu::TextureFormat::FP32;
+			desc.flags = flags;
+			desc.mips = &mip;
+			desc.mipCount = 1;
+			omm::Cpu::Texture texture = 0;
+			EXPECT_EQ(omm::Cpu::CreateTexture(baker, desc, &texture), omm::Result::SUCCESS);
+			return texture;
+		};
+
+		const omm::Cpu::TextureFlags flags = EnableZOrder() ? omm::Cpu::TextureFlags::None : omm::Cpu::TextureFlags::DisableZOrder;
+		const omm::Cpu::TextureFlags otherFlags = EnableZOrder() ? omm::Cpu::TextureFlags::DisableZOrder : omm::Cpu::TextureFlags::None;
+
+		const omm::Cpu::Texture texture = Create(texels, 0, flags);
+		EXPECT_EQ(Create(paddedTexels, kPaddedPitch * sizeof(float), flags), texture);
+
+		const omm::Cpu::Texture otherLayout = Create(texels, 0, otherFlags);
+		EXPECT_NE(otherLayout, texture);
+
+		std::vector<float> modifiedTexels = texels;
+		modifiedTexels[kSize * kSize / 2] = 0.5f;
+		const omm::Cpu::Texture modified = Create(modifiedTexels, 0, flags);
+		EXPECT_NE(modified, texture);
+
+		// A hit needs the full key, not only the hash.
+		{
+			omm::Cpu::TextureMipDesc mip;
+			mip.width = kSize;
+			mip.height = kSize;
+			mip.textureData = texels.data();
+			omm::Cpu::TextureDesc texDesc;
+			texDesc.format = omm::Cpu::TextureFormat::FP32;
+			texDesc.flags = flags;
+			texDesc.mips = &mip;
+			texDesc.mipCount = 1;
+			omm::Cpu::TextureContentKey key;
+			EXPECT_EQ(omm::Cpu::GetTextureContentKey(texDesc, &key), omm::Result::SUCCESS);
+
+			omm::Cpu::TextureContentKey otherSize = key;
+			otherSize.width = kSize / 2;
+			omm::Cpu::Texture cached = 0;
+			EXPECT_EQ(omm::Cpu::AcquireCachedTexture(baker, otherSize, &cached), omm::Result::SUCCESS);
+			EXPECT_EQ(cached, omm::Cpu::Texture(0));
+
+			omm::Cpu::TextureContentKey otherHash = key;
+			otherHash.hash[1] ^= 1;
+			EXPECT_EQ(omm::Cpu::AcquireCachedTexture(baker, otherHash, &cached), omm::Result::SUCCESS);
+			EXPECT_EQ(cached, omm::Cpu::Texture(0));
+
+			EXPECT_EQ(omm::Cpu::AcquireCachedTexture(baker, key, &cached), omm::Result::SUCCESS);
+			EXPECT_EQ(cached, texture);
+			EXPECT_EQ(omm::Cpu::DestroyTexture(baker, cached), omm::Result::SUCCESS);
+		}
+
+		// Two references, the first destroy keeps the texture alive.
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, texture), omm::Result::SUCCESS);
+
+		uint32_t triangleIndices[3] = { 0, 1, 2 };
+		float texCoords[6] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f };
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = texture;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 3;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = 4;
+		desc.dynamicSubdivisionScale = 0.f;
+
+		omm::Cpu::BakeResult res = 0;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(baker, desc, &res), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+
+		// Unreferenced, but kept within the cache budget.
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, texture), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, texture), omm::Result::INVALID_ARGUMENT);
+		EXPECT_EQ(Create(texels, 0, flags), texture);
+
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, texture), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, otherLayout), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, modified), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::DestroyOpacityMicromapBaker(baker), omm::Result::SUCCESS);
+	}
+
+	TEST_P(OMMBakeTestCPU, LargeBufferFlags) {
+
+		// Above the huge page size, odd sizes so the last tile row and column are partial.
+		const int kWidth = 1031;
+		const int kHeight = 777;
+		const int kPitch = kWidth + 5;
+		std::vector<float> texels(kPitch * kHeight, -1.f);
+		for (int j = 0; j < kHeight; ++j)
+			for (int i = 0; i < kWidth; ++i)
+				texels[j * kPitch + i] = 0.5f + 0.5f * std::sin(i * 0.05f) * std::cos(j * 0.07f);
+
+		uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+		float texCoords[8] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	1.f, 1.f };
+
+		auto Bake = [&](omm::LargeBufferFlags largeBufferFlags, uint32_t subdivisionLevel) {
+			omm::Baker baker = 0;
+			EXPECT_EQ(omm::CreateOpacityMicromapBaker({ .type = omm::BakerType::CPU, .largeBufferFlags = largeBufferFlags }, &baker), omm::Result::SUCCESS);
+
+			omm::Cpu::TextureMipDesc mip;
+			mip.width = kWidth;
+			mip.height = kHeight;
+			mip.rowPitch = kPitch * sizeof(float);
+			mip.textureData = texels.data();
+			omm::Cpu::TextureDesc texDesc;
+			texDesc.format = omm::Cpu::TextureFormat::FP32;
+			texDesc.flags = EnableZOrder() ? omm::Cpu::TextureFlags::None : omm::Cpu::TextureFlags::DisableZOrder;
+			texDesc.mips = &mip;
+			texDesc.mipCount = 1;
+			omm::Cpu::Texture texture = 0;
+			EXPECT_EQ(omm::Cpu::CreateTexture(baker, texDesc, &texture), omm::Result::SUCCESS);
+
+			omm::Cpu::BakeInputDesc desc;
+			desc.texture = texture;
+			desc.alphaMode = omm::AlphaMode::Test;
+			desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+			desc.runtimeSamplerDesc.filter = subdivisionLevel > 6 ? omm::TextureFilterMode::Nearest : omm::TextureFilterMode::Linear;
+			desc.indexFormat = omm::IndexFormat::I32_UINT;
+			desc.indexBuffer = triangleIndices;
+			desc.indexCount = 6;
+			desc.texCoords = texCoords;
+			desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+			desc.maxSubdivisionLevel = subdivisionLevel;
+			desc.dynamicSubdivisionScale = 0.f;
+			desc.alphaCutoff = 0.5f;
+			desc.bakeFlags = omm::Cpu::BakeFlags::EnableInternalThreads;
+
+			omm::Cpu::BakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+			std::vector<uint8_t> bytes;
+			if (resDesc)
+				bytes = GetBakeResultBytes(*resDesc);
+
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::Cpu::DestroyTexture(baker, texture), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::DestroyOpacityMicromapBaker(baker), omm::Result::SUCCESS);
+			return bytes;
+		};
+
+		// Placement only, the baked data is identical.
+		const std::vector<uint8_t> expected = Bake(omm::LargeBufferFlags::None, 6);
+		ASSERT_FALSE(expected.empty());
+
+		for (uint32_t flags : { 1u, 2u, 3u })
+			EXPECT_EQ(Bake((omm::LargeBufferFlags)flags, 6), expected) << "largeBufferFlags " << flags;
+
+		// The work item states reach the huge page size at level 10.
+		const omm::LargeBufferFlags allFlags = (omm::LargeBufferFlags)((uint32_t)omm::LargeBufferFlags::ParallelFirstTouch | (uint32_t)omm::LargeBufferFlags::HugePages);
+		EXPECT_EQ(Bake(allFlags, 10), Bake(omm::LargeBufferFlags::None, 10));
+	}
+
+	TEST_P(OMMBakeTestCPU, TextureCacheEviction) {
+
+		vmtest::Texture textureA(64, 64, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float { return 1.f; });
+		vmtest::Texture textureB(64, 64, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float { return 0.f; });
+
+		// The budget fits a single unreferenced texture.
+		size_t footprint = 0;
+		const omm::Cpu::Texture measured = CreateTexture(textureA.GetDesc());
+		EXPECT_EQ(omm::Cpu::GetTextureMemoryFootprint(_baker, measured, footprint), omm::Result::SUCCESS);
+
+		omm::Baker baker = 0;
+		EXPECT_EQ(omm::CreateOpacityMicromapBaker({ .type = omm::BakerType::CPU, .textureCacheSizeInBytes = footprint }, &baker), omm::Result::SUCCESS);
+
+		omm::Cpu::Texture a = 0;
+		omm::Cpu::Texture b = 0;
+		EXPECT_EQ(omm::Cpu::CreateTexture(baker, textureA.GetDesc(), &a), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::CreateTexture(baker, textureB.GetDesc(), &b), omm::Result::SUCCESS);
+		EXPECT_NE(a, b);
+
+		// a is the least recently used and evicted when b becomes unreferenced.
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, a), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, b), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, a), omm::Result::INVALID_ARGUMENT);
+
+		omm::Cpu::Texture b2 = 0;
+		EXPECT_EQ(omm::Cpu::CreateTexture(baker, textureB.GetDesc(), &b2), omm::Result::SUCCESS);
+		EXPECT_EQ(b2, b);
+
+		// Re-created after eviction, b stays referenced and is kept.
+		omm::Cpu::Texture a2 = 0;
+		EXPECT_EQ(omm::Cpu::CreateTexture(baker, textureA.GetDesc(), &a2), omm::Result::SUCCESS);
+		EXPECT_NE(a2, b);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, a2), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, b2), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, a2), omm::Result::INVALID_ARGUMENT);
+
+		omm::Cpu::Texture b3 = 0;
+		EXPECT_EQ(omm::Cpu::CreateTexture(baker, textureB.GetDesc(), &b3), omm::Result::SUCCESS);
+		EXPECT_EQ(b3, b);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, b3), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::DestroyOpacityMicromapBaker(baker), omm::Result::SUCCESS);
+	}
+
+	TEST_P(OMMBakeTestCPU, ProceduralAllOpaque) {
+
+		uint32_t subdivisionLevel = 4;
+
+		omm::Cpu::ProceduralAlphaDesc procedural;
+		procedural.EvaluateBounds = [](void* userArg, const float uv[6], float* outMin, float* outMax) {
+			*outMin = 0.9f;
+			*outMax = 1.f;
+		};
+
+		omm::Debug::Stats stats = RunProceduralBake(subdivisionLevel, procedural);
+
+		ExpectEqual(stats, {
+			.totalOpaque = 2 * omm::bird::GetNumMicroTriangles(subdivisionLevel),
+			});
+	}
+
+	TEST_P(OMMBakeTestCPU, ProceduralCircle) {
+
+		uint32_t subdivisionLevel = 5;
+		uint32_t numMicroTris = omm::bird::GetNumMicroTriangles(subdivisionLevel);
+
+		omm::Cpu::ProceduralAlphaDesc procedural;
+		procedural.EvaluateBounds = &ProceduralCircle::EvaluateBounds;
+		procedural.EvaluatePoint = &ProceduralCircle::EvaluatePoint;
+
+		omm::Debug::Stats stats = RunProceduralBake(subdivisionLevel, procedural, [numMicroTris, subdivisionLevel](const omm::Cpu::BakeResultDesc& resDesc) {
+
+			const omm::Triangle macroTriangles[2] = {
+				omm::Triangle({ 0.f, 0.f }, { 0.f, 1.f }, { 1.f, 0.f }),
+				omm::Triangle({ 1.f, 1.f }, { 0.f, 1.f }, { 1.f, 0.f }),
+			};
+
+			// Known states must hold over the entire micro-triangle.
+			std::vector<omm::OpacityState> states(numMicroTris);
+			for (uint32_t primIt = 0; primIt < 2; ++primIt)
+			{
+				EXPECT_EQ(omm::parse::GetTriangleStates(primIt, resDesc, states.data()), subdivisionLevel);
+				for (uint32_t uTriIt = 0; uTriIt < numMicroTris; ++uTriIt)
+				{
+					const omm::Triangle t = omm::bird::GetMicroTriangle(macroTriangles[primIt], uTriIt, subdivisionLevel);
+					const float2 center = (t.p0 + t.p1 + t.p2) / 3.f;
+					for (float2 p : { t.p0, t.p1, t.p2, center })
+					{
+						if (states[uTriIt] == omm::OpacityState::Opaque)
+							EXPECT_LT(ProceduralCircle::Distance(p), ProceduralCircle::kRadius);
+						else if (states[uTriIt] == omm::OpacityState::Transparent)
+							EXPECT_GE(ProceduralCircle::Distance(p), ProceduralCircle::kRadius);
+					}
+				}
+			}
+		});
+
+		EXPECT_GT(stats.totalOpaque, 0);
+		EXPECT_GT(stats.totalTransparent, 0);
+		EXPECT_GT(stats.totalUnknownOpaque + stats.totalUnknownTransparent, 0);
+		EXPECT_EQ(stats.totalOpaque + stats.totalTransparent + stats.totalUnknownOpaque + stats.totalUnknownTransparent, 2 * numMicroTris);
+	}
+
+	TEST_P(OMMBakeTestCPU, ProceduralRefinementDepth) {
+
+		uint32_t subdivisionLevel = 3;
+
+		omm::Cpu::ProceduralAlphaDesc procedural;
+		procedural.EvaluateBounds = &ProceduralCircle::EvaluateBounds;
+
+		// The box bound is loose, refinement recovers known states that a single evaluation can't prove.
+		procedural.maxRefinementDepth = 0;
+		omm::Debug::Stats coarse = RunProceduralBake(subdivisionLevel, procedural);
+
+		procedural.maxRefinementDepth = 8;
+		omm::Debug::Stats refined = RunProceduralBake(subdivisionLevel, procedural);
+
+		EXPECT_GT(refined.totalOpaque + refined.totalTransparent, coarse.totalOpaque + coarse.totalTransparent);
+		EXPECT_GE(refined.totalOpaque, coarse.totalOpaque);
+		EXPECT_GE(refined.totalTransparent, coarse.totalTransparent);
+	}
+
+	TEST_P(OMMBakeTestCPU, ProceduralInvalidArgs) {
+
+		uint32_t triangleIndices[3] = { 0, 1, 2 };
+		float texCoords[6] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f };
+
+		vmtest::Texture texture(64, 64, 1, EnableZOrder(), [](int i, int j, int w, int h, int mip)->float { return 1.f; });
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+		desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 3;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.proceduralAlpha.EvaluateBounds = &ProceduralCircle::EvaluateBounds;
+
+		omm::Cpu::BakeResult res = 0;
+
+		// Texture and procedural alpha are mutually exclusive.
+		desc.texture = CreateTexture(texture.GetDesc());
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+
+		desc.texture = 0;
+		desc.proceduralAlpha.maxRefinementDepth = 13;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+		EXPECT_EQ(res, 0);
+	}
+
+	TEST_P(OMMBakeTestCPU, PolygonMaskCircle) {
+
+		uint32_t subdivisionLevel = 5;
+		uint32_t numMicroTris = omm::bird::GetNumMicroTriangles(subdivisionLevel);
+
+		// 64-gon approximating a circle.
+		std::vector<float2> vertices;
+		for (uint32_t i = 0; i < 64; ++i)
+		{
+			const float angle = 2.f * 3.14159265f * i / 64.f;
+			vertices.push_back(float2(0.5f) + 0.4f * float2(std::cos(angle), std::sin(angle)));
+		}
+		const uint32_t vertexCount = (uint32_t)vertices.size();
+
+		omm::Cpu::PolygonMaskDesc polygonMask;
+		polygonMask.vertices = (const float*)vertices.data();
+		polygonMask.contourVertexCounts = &vertexCount;
+		polygonMask.contourCount = 1;
+
+		auto IsInside = [&vertices](float2 p) {
+			bool inside = false;
+			for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+			{
+				const float2 a = vertices[i];
+				const float2 b = vertices[j];
+				if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+					inside = !inside;
+			}
+			return inside;
+		};
+
+		omm::Debug::Stats stats = RunPolygonMaskBake(subdivisionLevel, polygonMask, [&](const omm::Cpu::BakeResultDesc& resDesc) {
+
+			const omm::Triangle macroTriangles[2] = {
+				omm::Triangle({ 0.f, 0.f }, { 0.f, 1.f }, { 1.f, 0.f }),
+				omm::Triangle({ 1.f, 1.f }, { 0.f, 1.f }, { 1.f, 0.f }),
+			};
+
+			// Known states must match the polygon over the entire micro-triangle.
+			std::vector<omm::OpacityState> states(numMicroTris);
+			for (uint32_t primIt = 0; primIt < 2; ++primIt)
+			{
+				EXPECT_EQ(omm::parse::GetTriangleStates(primIt, resDesc, states.data()), subdivisionLevel);
+				for (uint32_t uTriIt = 0; uTriIt < numMicroTris; ++uTriIt)
+				{
+					const omm::Triangle t = omm::bird::GetMicroTriangle(macroTriangles[primIt], uTriIt, subdivisionLevel);
+					const float2 center = (t.p0 + t.p1 + t.p2) / 3.f;
+					for (float2 p : { t.p0, t.p1, t.p2, center })
+					{
+						if (states[uTriIt] == omm::OpacityState::Opaque)
+							EXPECT_TRUE(IsInside(p));
+						else if (states[uTriIt] == omm::OpacityState::Transparent)
+							EXPECT_FALSE(IsInside(p));
+					}
+				}
+			}
+		});
+
+		EXPECT_GT(stats.totalOpaque, 0);
+		EXPECT_GT(stats.totalTransparent, 0);
+		EXPECT_GT(stats.totalUnknownOpaque + stats.totalUnknownTransparent, 0);
+		EXPECT_EQ(stats.totalOpaque + stats.totalTransparent + stats.totalUnknownOpaque + stats.totalUnknownTransparent, 2 * numMicroTris);
+	}
+
+	TEST_P(OMMBakeTestCPU, PolygonMaskFillRule) {
+
+		uint32_t subdivisionLevel = 3;
+		uint32_t numMicroTris = omm::bird::GetNumMicroTriangles(subdivisionLevel);
+
+		// Two nested squares with the same orientation, both enclosing the UV square.
+		const float vertices[16] = {
+			-1.f, -1.f,		2.f, -1.f,		2.f, 2.f,		-1.f, 2.f,
+			-0.5f, -0.5f,	1.5f, -0.5f,	1.5f, 1.5f,		-0.5f, 1.5f,
+		};
+		const uint32_t contourVertexCounts[2] = { 4, 4 };
+
+		omm::Cpu::PolygonMaskDesc polygonMask;
+		polygonMask.vertices = vertices;
+		polygonMask.contourVertexCounts = contourVertexCounts;
+		polygonMask.contourCount = 2;
+
+		// Winding number 2 within the inner square.
+		polygonMask.fillRule = omm::Cpu::FillRule::NonZero;
+		ExpectEqual(RunPolygonMaskBake(subdivisionLevel, polygonMask), {
+			.totalOpaque = 2 * numMicroTris,
+			});
+
+		polygonMask.fillRule = omm::Cpu::FillRule::EvenOdd;
+		ExpectEqual(RunPolygonMaskBake(subdivisionLevel, polygonMask), {
+			.totalTransparent = 2 * numMicroTris,
+			});
+	}
+
+	TEST_P(OMMBakeTestCPU, PolygonMaskInvalidArgs) {
+
+		uint32_t triangleIndices[3] = { 0, 1, 2 };
+		float texCoords[6] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f };
+
+		const float vertices[4] = { 0.f, 0.f,	1.f, 1.f };
+		const uint32_t vertexCount = 2;
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = triangleIndices;
+		desc.indexCount = 3;
+		desc.texCoords = texCoords;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.polygonMask.vertices = vertices;
+		desc.polygonMask.contourVertexCounts = &vertexCount;
+		desc.polygonMask.contourCount = 1;
+
+		// A contour needs at least three vertices.
+		omm::Cpu::BakeResult res = 0;
+		EXPECT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+		EXPECT_EQ(res, 0);
+	}
+
 	TEST_P(OMMBakeTestCPU, DestroyOpacityMicromapBaker) {
 	}
 
@@ -1399,6 +3124,7 @@ namespace {
 		TestSuiteConfig::Default
 		, TestSuiteConfig::TextureDisableZOrder
 		, TestSuiteConfig::Force32BitIndices
+		, TestSuiteConfig::CompareThreadCounts
 	));
 
 }  // namespace
\ No newline at end of file
@@ -0,0 +1,229 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include <gtest/gtest.h>
+#include "util/omm_reference.h"
+#include "util/omm_histogram.h"
+
+#include <omm.h>
+#include <shared/bird.h>
+#include <shared/parse.h>
+
+#include <random>
+#include <sstream>
+
+namespace {
+
+	// Internal flags selecting the other resampling kernels, see BakeFlagsInternal.
+	static constexpr uint32_t kEnableAABBTesting = 1u << 6;
+	static constexpr uint32_t kDisableLevelLineIntersection = 1u << 8;
+
+	static constexpr uint32_t kMaxPrimitiveCount = 4;
+
+	// Known states may only disagree with the reference by this much around the cutoff.
+	static constexpr float kEpsilon = 1e-4f;
+
+	struct Scenario
+	{
+		omm::Test::ReferenceTexture texture;
+		bool enableZOrder;
+		float alphaCutoff;
+		uint32_t subdivisionLevel;
+		omm::UnknownStatePromotion unknownStatePromotion;
+		uint32_t bakeFlags;
+		std::vector<float> texCoords;
+		std::vector<uint32_t> indices;
+
+		std::string ToString() const {
+			std::stringstream ss;
+			ss << "size:" << texture.size.x << "x" << texture.size.y
+				<< " addressMode:" << (uint32_t)texture.addressMode
+				<< " filterMode:" << (uint32_t)texture.filterMode
+				<< " borderAlpha:" << texture.borderAlpha
+				<< " zorder:" << enableZOrder
+				<< " alphaCutoff:" << alphaCutoff
+				<< " level:" << subdivisionLevel
+				<< " promotion:" << (uint32_t)unknownStatePromotion
+				<< " bakeFlags:0x" << std::hex << bakeFlags;
+			return ss.str();
+		}
+	};
+
+	Scenario GenerateScenario(uint32_t seed)
+	{
+		std::mt19937 eng(seed);
+		auto RandomInt = [&eng](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(eng); };
+		auto RandomFloat = [&eng](float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(eng); };
+
+		Scenario s;
+		s.texture.size = int2(RandomInt(1, 48), RandomInt(1, 48));
+		s.texture.addressMode = (omm::TextureAddressMode)RandomInt(0, (int)omm::TextureAddressMode::MAX_NUM - 1);
+		s.texture.filterMode = (omm::TextureFilterMode)RandomInt(0, (int)omm::TextureFilterMode::MAX_NUM - 1);
+		s.texture.borderAlpha = RandomInt(0, 1) ? RandomFloat(0.f, 1.f) : 0.f;
+		s.enableZOrder = RandomInt(0, 1) != 0;
+		s.alphaCutoff = RandomFloat(0.1f, 0.9f);
+		s.subdivisionLevel = RandomInt(0, 5);
+		s.unknownStatePromotion = (omm::UnknownStatePromotion)RandomInt(0, 2);
+
+		const uint32_t kernels[3] = { 0, kDisableLevelLineIntersection, kEnableAABBTesting | kDisableLevelLineIntersection };
+		s.bakeFlags = kernels[RandomInt(0, 2)];
+		if (RandomInt(0, 1))
+			s.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads;
+		if (RandomInt(0, 3) == 0)
+			s.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection; // Merging only ever adds unknowns.
+
+		// Noise, binary noise or a smooth pattern, so that both known and unknown states show up.
+		const int pattern = RandomInt(0, 2);
+		const float2 center = float2(RandomFloat(0.f, 1.f), RandomFloat(0.f, 1.f));
+		const float frequency = RandomFloat(1.f, 12.f);
+		s.texture.texels.resize(size_t(s.texture.size.x) * s.texture.size.y);
+		for (int j = 0; j < s.texture.size.y; ++j)
+		{
+			for (int i = 0; i < s.texture.size.x; ++i)
+			{
+				const float2 uv = (float2(i, j) + 0.5f) / float2(s.texture.size);
+				float alpha = 0.f;
+				if (pattern == 0)
+					alpha = RandomFloat(0.f, 1.f);
+				else if (pattern == 1)
+					alpha = RandomInt(0, 1) ? 1.f : 0.f;
+				else
+					alpha = 0.5f + 0.5f * std::cos(frequency * glm::length(uv - center));
+				s.texture.texels[size_t(j) * s.texture.size.x + i] = alpha;
+			}
+		}
+
+		// Triangles mostly inside the texture, some reaching out to exercise the addressing.
+		const uint32_t primitiveCount = RandomInt(1, kMaxPrimitiveCount);
+		for (uint32_t primIt = 0; primIt < primitiveCount; ++primIt)
+		{
+			const float2 origin = float2(RandomFloat(-1.f, 1.5f), RandomFloat(-1.f, 1.5f));
+			const float extent = RandomFloat(0.05f, 1.f);
+			for (uint32_t vertexIt = 0; vertexIt < 3; ++vertexIt)
+			{
+				s.indices.push_back((uint32_t)s.indices.size());
+				s.texCoords.push_back(origin.x + extent * RandomFloat(0.f, 1.f));
+				s.texCoords.push_back(origin.y + extent * RandomFloat(0.f, 1.f));
+			}
+		}
+		return s;
+	}
+
+	class DifferentialTest : public ::testing::TestWithParam<uint32_t> {
+	protected:
+		void SetUp() override {
+			EXPECT_EQ(omm::CreateOpacityMicromapBaker({ .type = omm::BakerType::CPU }, &_baker), omm::Result::SUCCESS);
+		}
+
+		void TearDown() override {
+			EXPECT_EQ(omm::DestroyOpacityMicromapBaker(_baker), omm::Result::SUCCESS);
+		}
+
+		// Every known state must hold over the whole micro-triangle according to the reference.
+		// Stops at the first diverging micro-triangle.
+		void ValidateAgainstReference(const Scenario& s, const omm::Cpu::BakeResultDesc& resDesc) {
+
+			const uint32_t primitiveCount = (uint32_t)s.indices.size() / 3;
+			std::vector<omm::OpacityState> states(omm::bird::GetNumMicroTriangles(s.subdivisionLevel));
+			for (uint32_t primIt = 0; primIt < primitiveCount; ++primIt)
+			{
+				const float* uv = &s.texCoords[6 * primIt];
+				const omm::Triangle macroTriangle(float2(uv[0], uv[1]), float2(uv[2], uv[3]), float2(uv[4], uv[5]));
+
+				// Special indices cover the whole primitive.
+				const bool isSpecialIndex = omm::parse::GetOmmIndexForTriangleIndex(resDesc, primIt) < 0;
+				const uint32_t level = (uint32_t)omm::parse::GetTriangleStates(primIt, resDesc, states.data());
+				const uint32_t numMicroTriangles = isSpecialIndex ? 1 : omm::bird::GetNumMicroTriangles(level);
+
+				for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
+				{
+					const omm::OpacityState state = states[uTriIt];
+					if (state != omm::OpacityState::Opaque && state != omm::OpacityState::Transparent)
+						continue;
+
+					const omm::Triangle microTriangle = isSpecialIndex ? macroTriangle : omm::bird::GetMicroTriangle(macroTriangle, uTriIt, level);
+					const omm::Test::ReferenceRange range = omm::Test::GetReferenceRange(s.texture, microTriangle);
+
+					const bool isOpaque = state == omm::OpacityState::Opaque;
+					const bool diverges = isOpaque ? range.min <= s.alphaCutoff - kEpsilon : range.max > s.alphaCutoff + kEpsilon;
+					if (!diverges)
+						continue;
+
+					std::stringstream ss;
+					ss << "primitive:" << primIt << " microTriangle:" << uTriIt << (isSpecialIndex ? " (special index)" : "")
+						<< " state:" << (isOpaque ? "Opaque" : "Transparent")
+						<< " reference range:[" << range.min << ", " << range.max << "]";
+
+					float2 witness;
+					if (omm::Test::FindReferenceSample(s.texture, microTriangle, s.alphaCutoff, !isOpaque, witness))
+						ss << " sample at (" << witness.x << ", " << witness.y << ") = " << omm::Test::ReferenceSample(s.texture, witness);
+
+					ADD_FAILURE() << "Diverges from the reference: " << ss.str() << "\n" << s.ToString();
+					return;
+				}
+			}
+		}
+
+		omm::Baker _baker = 0;
+	};
+
+	TEST_P(DifferentialTest, ConservativeToReference) {
+
+		const Scenario s = GenerateScenario(GetParam());
+
+		omm::Cpu::TextureMipDesc mip;
+		mip.width = s.texture.size.x;
+		mip.height = s.texture.size.y;
+		mip.textureData = s.texture.texels.data();
+
+		omm::Cpu::TextureDesc texDesc;
+		texDesc.format = omm::Cpu::TextureFormat::FP32;
+		texDesc.mipCount = 1;
+		texDesc.mips = &mip;
+		if (!s.enableZOrder)
+			texDesc.flags = omm::Cpu::TextureFlags::DisableZOrder;
+
+		omm::Cpu::Texture texture = 0;
+		ASSERT_EQ(omm::Cpu::CreateTexture(_baker, texDesc, &texture), omm::Result::SUCCESS);
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.texture = texture;
+		desc.runtimeSamplerDesc.addressingMode = s.texture.addressMode;
+		desc.runtimeSamplerDesc.filter = s.texture.filterMode;
+		desc.runtimeSamplerDesc.borderAlpha = s.texture.borderAlpha;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.alphaCutoff = s.alphaCutoff;
+		desc.ommFormat = omm::OMMFormat::OC1_4_State;
+		desc.unknownStatePromotion = s.unknownStatePromotion;
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = s.indices.data();
+		desc.indexCount = (uint32_t)s.indices.size();
+		desc.texCoords = s.texCoords.data();
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.maxSubdivisionLevel = (uint8_t)s.subdivisionLevel;
+		desc.dynamicSubdivisionScale = 0.f;
+		desc.bakeFlags = (omm::Cpu::BakeFlags)s.bakeFlags;
+
+		omm::Cpu::BakeResult res = 0;
+		ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, desc, &res), omm::Result::SUCCESS) << s.ToString();
+
+		const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+		ASSERT_EQ(omm::Cpu::GetBakeResultDesc(res, resDesc), omm::Result::SUCCESS);
+
+		omm::Test::ValidateHistograms(resDesc);
+		ValidateAgainstReference(s, *resDesc);
+
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(_baker, texture), omm::Result::SUCCESS);
+	}
+
+	INSTANTIATE_TEST_SUITE_P(RandomScenarios, DifferentialTest, ::testing::Range(0u, 256u));
+
+}  // namespace
@@ -0,0 +1,235 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include <gtest/gtest.h>
+#include <omm.h>
+#include <omm_service.h>
+
+#include "util/omm.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	class ServiceTest : public ::testing::Test {
+	protected:
+		void SetUp() override {
+			_socketPath = (std::filesystem::temp_directory_path() / ("omm-service-" + std::to_string(std::random_device()()))).string();
+			ASSERT_EQ(omm::Service::CreateServer({ .socketPath = _socketPath.c_str(), .threadCount = 2, .textureCacheSizeInBytes = size_t(64) << 20 }, &_server), omm::Result::SUCCESS);
+			ASSERT_EQ(omm::CreateOpacityMicromapBaker({ .type = omm::BakerType::CPU }, &_baker), omm::Result::SUCCESS);
+		}
+
+		void TearDown() override {
+			EXPECT_EQ(omm::DestroyOpacityMicromapBaker(_baker), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::Service::DestroyServer(_server), omm::Result::SUCCESS);
+			EXPECT_FALSE(std::filesystem::exists(_socketPath));
+		}
+
+		omm::Service::Client Connect() {
+			omm::Service::Client client = 0;
+			EXPECT_EQ(omm::Service::Connect(_socketPath.c_str(), &client), omm::Result::SUCCESS);
+			return client;
+		}
+
+		std::string _socketPath;
+		omm::Service::Server _server = 0;
+		omm::Baker _baker = 0;
+	};
+
+	struct Mesh {
+		// Two quads sharing vertices, offset in to a larger vertex pool to exercise the vertex range the client sends.
+		std::vector<float> texCoords = { 9.f, 9.f, 9.f, 9.f,  0.f, 0.f, 1.f, 0.f, 1.f, 1.f, 0.f, 1.f,  0.2f, 0.2f };
+		std::vector<uint16_t> indices = { 7, 7, 2, 3, 4, 2, 4, 5, 2, 3, 6 };
+
+		omm::Cpu::BakeInputDesc GetDesc(omm::Cpu::Texture texture) const {
+			omm::Cpu::BakeInputDesc desc;
+			desc.bakeFlags = omm::Cpu::BakeFlags::None;
+			desc.texture = texture;
+			desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+			desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+			desc.alphaMode = omm::AlphaMode::Test;
+			desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+			desc.texCoords = texCoords.data();
+			desc.indexFormat = omm::IndexFormat::I16_UINT;
+			desc.indexBuffer = indices.data();
+			desc.indexOffset = 2;
+			desc.indexCount = 9;
+			desc.baseVertex = -1;
+			desc.maxSubdivisionLevel = 5;
+			desc.dynamicSubdivisionScale = 0.f;
+			desc.unknownStatePromotion = omm::UnknownStatePromotion::Nearest;
+			return desc;
+		}
+	};
+
+	template<class T>
+	void ExpectEqualArrays(const T* a, uint32_t aCount, const T* b, uint32_t bCount) {
+		ASSERT_EQ(aCount, bCount);
+		if (aCount != 0)
+			EXPECT_EQ(std::memcmp(a, b, sizeof(T) * aCount), 0);
+	}
+
+	TEST_F(ServiceTest, ConnectInvalid) {
+		omm::Service::Client client = 0;
+		EXPECT_EQ(omm::Service::Connect((_socketPath + "-missing").c_str(), &client), omm::Result::FAILURE);
+		EXPECT_EQ(client, 0);
+		EXPECT_EQ(omm::Service::Disconnect(client), omm::Result::INVALID_ARGUMENT);
+	}
+
+	TEST_F(ServiceTest, TextureSharedAcrossClients) {
+		vmtest::Texture texture(64, 64, 1, [](int i, int j, int w, int h, int mip)->float { return i < w / 2 ? 1.f : 0.f; });
+
+		omm::Service::Client a = Connect();
+		omm::Service::Client b = Connect();
+
+		omm::Cpu::Texture textureA = 0;
+		omm::Cpu::Texture textureB = 0;
+		EXPECT_EQ(omm::Service::CreateTexture(a, texture.GetDesc(), &textureA), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Service::CreateTexture(b, texture.GetDesc(), &textureB), omm::Result::SUCCESS);
+		EXPECT_NE(textureA, 0);
+		EXPECT_EQ(textureA, textureB);
+
+		// Handles are checked per client, b holds only its own reference.
+		EXPECT_EQ(omm::Service::DestroyTexture(b, textureB), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Service::DestroyTexture(b, textureB), omm::Result::INVALID_ARGUMENT);
+		EXPECT_EQ(omm::Service::Disconnect(b), omm::Result::SUCCESS);
+
+		// Textures of a disconnected client stay cached for the next one.
+		EXPECT_EQ(omm::Service::Disconnect(a), omm::Result::SUCCESS);
+		omm::Service::Client c = Connect();
+		omm::Cpu::Texture textureC = 0;
+		EXPECT_EQ(omm::Service::CreateTexture(c, texture.GetDesc(), &textureC), omm::Result::SUCCESS);
+		EXPECT_EQ(textureC, textureA);
+		EXPECT_EQ(omm::Service::Disconnect(c), omm::Result::SUCCESS);
+	}
+
+	TEST_F(ServiceTest, BakeMatchesLocalBake) {
+		vmtest::Texture texture(128, 128, 1, [](int i, int j, int w, int h, int mip)->float {
+			const float x = (i + 0.5f) / w - 0.5f;
+			const float y = (j + 0.5f) / h - 0.5f;
+			return std::sqrt(x * x + y * y) < 0.35f ? 1.f : 0.f;
+		});
+		const Mesh mesh;
+
+		omm::Cpu::Texture localTexture = 0;
+		omm::Cpu::BakeResult localResult = 0;
+		const omm::Cpu::BakeResultDesc* localDesc = nullptr;
+		ASSERT_EQ(omm::Cpu::CreateTexture(_baker, texture.GetDesc(), &localTexture), omm::Result::SUCCESS);
+		ASSERT_EQ(omm::Cpu::BakeOpacityMicromap(_baker, mesh.GetDesc(localTexture), &localResult), omm::Result::SUCCESS);
+		ASSERT_EQ(omm::Cpu::GetBakeResultDesc(localResult, localDesc), omm::Result::SUCCESS);
+
+		omm::Service::Client client = Connect();
+		omm::Cpu::Texture remoteTexture = 0;
+		omm::Cpu::BakeResult remoteResult = 0;
+		const omm::Cpu::BakeResultDesc* remoteDesc = nullptr;
+		ASSERT_EQ(omm::Service::CreateTexture(client, texture.GetDesc(), &remoteTexture), omm::Result::SUCCESS);
+		ASSERT_EQ(omm::Service::BakeOpacityMicromap(client, mesh.GetDesc(remoteTexture), &remoteResult), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Service::Disconnect(client), omm::Result::SUCCESS);
+
+		// The result doesn't depend on the connection.
+		ASSERT_EQ(omm::Service::GetBakeResultDesc(remoteResult, remoteDesc), omm::Result::SUCCESS);
+		EXPECT_GT(localDesc->ommDescArrayCount, 0u);
+		ExpectEqualArrays((const uint8_t*)localDesc->ommArrayData, localDesc->ommArrayDataSize, (const uint8_t*)remoteDesc->ommArrayData, remoteDesc->ommArrayDataSize);
+		ExpectEqualArrays(localDesc->ommDescArray, localDesc->ommDescArrayCount, remoteDesc->ommDescArray, remoteDesc->ommDescArrayCount);
+		ExpectEqualArrays(localDesc->ommDescArrayHistogram, localDesc->ommDescArrayHistogramCount, remoteDesc->ommDescArrayHistogram, remoteDesc->ommDescArrayHistogramCount);
+		ExpectEqualArrays(localDesc->ommIndexHistogram, localDesc->ommIndexHistogramCount, remoteDesc->ommIndexHistogram, remoteDesc->ommIndexHistogramCount);
+		ExpectEqualArrays(localDesc->primitiveCoverage, localDesc->primitiveCoverageCount, remoteDesc->primitiveCoverage, remoteDesc->primitiveCoverageCount);
+		EXPECT_EQ(localDesc->ommIndexFormat, remoteDesc->ommIndexFormat);
+		const uint32_t indexSize = localDesc->ommIndexFormat == omm::IndexFormat::I16_UINT ? 2 : 4;
+		ExpectEqualArrays((const uint8_t*)localDesc->ommIndexBuffer, localDesc->ommIndexCount * indexSize, (const uint8_t*)remoteDesc->ommIndexBuffer, remoteDesc->ommIndexCount * indexSize);
+
+		EXPECT_EQ(omm::Service::DestroyBakeResult(remoteResult), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(localResult), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(_baker, localTexture), omm::Result::SUCCESS);
+	}
+
+	TEST_F(ServiceTest, ConcurrentClients) {
+		vmtest::Texture texture(128, 128, 1, [](int i, int j, int w, int h, int mip)->float {
+			return ((i / 8) + (j / 8)) % 2 == 0 ? 1.f : 0.f;
+		});
+		const Mesh mesh;
+
+		// More clients than pool threads, bakes queue up on the shared workers.
+		const uint32_t kClientCount = 6;
+		std::vector<std::vector<uint8_t>> ommArrayData(kClientCount);
+		std::vector<std::thread> threads;
+		for (uint32_t clientIt = 0; clientIt < kClientCount; ++clientIt)
+		{
+			threads.emplace_back([&, clientIt]() {
+				omm::Service::Client client = Connect();
+				omm::Cpu::Texture remoteTexture = 0;
+				EXPECT_EQ(omm::Service::CreateTexture(client, texture.GetDesc(), &remoteTexture), omm::Result::SUCCESS);
+
+				omm::Cpu::BakeInputDesc desc = mesh.GetDesc(remoteTexture);
+				desc.bakeFlags = omm::Cpu::BakeFlags::EnableInternalThreads;
+				omm::Cpu::BakeResult result = 0;
+				const omm::Cpu::BakeResultDesc* resultDesc = nullptr;
+				EXPECT_EQ(omm::Service::BakeOpacityMicromap(client, desc, &result), omm::Result::SUCCESS);
+				EXPECT_EQ(omm::Service::GetBakeResultDesc(result, resultDesc), omm::Result::SUCCESS);
+				if (resultDesc)
+				{
+					const uint8_t* data = (const uint8_t*)resultDesc->ommArrayData;
+					ommArrayData[clientIt].assign(data, data + resultDesc->ommArrayDataSize);
+				}
+				EXPECT_EQ(omm::Service::DestroyBakeResult(result), omm::Result::SUCCESS);
+				EXPECT_EQ(omm::Service::Disconnect(client), omm::Result::SUCCESS);
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+
+		EXPECT_FALSE(ommArrayData[0].empty());
+		for (uint32_t clientIt = 1; clientIt < kClientCount; ++clientIt)
+			EXPECT_EQ(ommArrayData[clientIt], ommArrayData[0]);
+	}
+
+	TEST_F(ServiceTest, BakeInvalid) {
+		vmtest::Texture texture(64, 64, 1, [](int i, int j, int w, int h, int mip)->float { return 1.f; });
+		const Mesh mesh;
+
+		omm::Service::Client a = Connect();
+		omm::Service::Client b = Connect();
+		omm::Cpu::Texture textureA = 0;
+		ASSERT_EQ(omm::Service::CreateTexture(a, texture.GetDesc(), &textureA), omm::Result::SUCCESS);
+
+		omm::Cpu::BakeResult result = 0;
+
+		// Textures must be created by the same client.
+		EXPECT_EQ(omm::Service::BakeOpacityMicromap(b, mesh.GetDesc(textureA), &result), omm::Result::INVALID_ARGUMENT);
+
+		// Procedural alpha can't cross processes.
+		omm::Cpu::BakeInputDesc procedural = mesh.GetDesc(omm::kInvalidHandle);
+		procedural.proceduralAlpha.EvaluatePoint = [](void* userArg, float u, float v) { return 1.f; };
+		EXPECT_EQ(omm::Service::BakeOpacityMicromap(a, procedural, &result), omm::Result::INVALID_ARGUMENT);
+
+		omm::Cpu::BakeInputDesc noTexCoords = mesh.GetDesc(textureA);
+		noTexCoords.texCoords = nullptr;
+		EXPECT_EQ(omm::Service::BakeOpacityMicromap(a, noTexCoords, &result), omm::Result::INVALID_ARGUMENT);
+
+		// Rejected by the baker, the connection stays usable.
+		omm::Cpu::BakeInputDesc invalidFormat = mesh.GetDesc(textureA);
+		invalidFormat.alphaMode = omm::AlphaMode::MAX_NUM;
+		EXPECT_EQ(omm::Service::BakeOpacityMicromap(a, invalidFormat, &result), omm::Result::INVALID_ARGUMENT);
+		EXPECT_EQ(result, 0);
+
+		EXPECT_EQ(omm::Service::BakeOpacityMicromap(a, mesh.GetDesc(textureA), &result), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Service::DestroyBakeResult(result), omm::Result::SUCCESS);
+
+		EXPECT_EQ(omm::Service::Disconnect(a), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Service::Disconnect(b), omm::Result::SUCCESS);
+	}
+
+}  // namespace
@@ -10,6 +10,14 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include <gtest/gtest.h>
 #include <shared/bit_tricks.h>
+#include <shared/radix_sort.h>
+#include <shared/triangle.h>
+
+#include <cstring>
+
+#include <random>
+#include <vector>
+#include <functional>
 
 namespace {
 
@@ -25,4 +33,110 @@ namespace {
 		}
 	}
 
-}  // namespace
\ No newline at end of file
+	static void RunRadixSortTest(uint32_t keyCount, bool enableThreads) {
+
+		std::default_random_engine eng(42);
+		std::uniform_int_distribution<uint32_t> subdivLvl(0, 12);
+		std::uniform_int_distribution<uint32_t> morton(0, 255); // Narrow range to produce plenty of duplicate keys.
+		std::uniform_int_distribution<uint32_t> special(0, 7);
+
+		std::vector<std::pair<uint64_t, uint32_t>> keys(keyCount);
+		for (uint32_t i = 0; i < keyCount; ++i) {
+			uint64_t key = 0;
+			if (special(eng) == 0)
+				key = (1ull << 63) | (uint64_t)i;
+			else
+				key = ((uint64_t)subdivLvl(eng) << 60) | (uint64_t)(morton(eng) << (i & 0xF));
+			keys[i] = std::make_pair(key, i);
+		}
+
+		std::vector<std::pair<uint64_t, uint32_t>> expected = keys;
+		std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+		std::vector<std::pair<uint64_t, uint32_t>> scratch(keyCount);
+		std::vector<uint32_t> histograms(omm::radix::kHistogramCount);
+		omm::radix::SortDescending(keys.data(), scratch.data(), histograms.data(), keyCount, enableThreads);
+
+		ASSERT_EQ(keys.size(), expected.size());
+		for (uint32_t i = 0; i < keyCount; ++i) {
+			EXPECT_EQ(keys[i], expected[i]);
+		}
+	}
+
+	TEST(BitFunc, RadixSortSerial) {
+		RunRadixSortTest(1, false);
+		RunRadixSortTest(1000, false);
+		RunRadixSortTest(100000, false);
+	}
+
+	TEST(BitFunc, RadixSortParallel) {
+		RunRadixSortTest(1000, true);
+		RunRadixSortTest(1000000, true);
+	}
+
+	// Bulk decoding must match FetchUV bit for bit, every half precision value included.
+	static void RunFetchUVBulkTest(omm::TexCoordFormat format, uint32_t componentSize, uint32_t strideInBytes) {
+
+		const uint32_t vertexCount = 65536;
+		std::vector<uint8_t> texCoords(size_t(strideInBytes) * vertexCount);
+		std::default_random_engine eng(42);
+		std::uniform_real_distribution<float> distr(-4.f, 4.f);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			uint8_t* vertex = texCoords.data() + size_t(strideInBytes) * i;
+			if (componentSize == sizeof(uint16_t))
+			{
+				const uint16_t uv[2] = { (uint16_t)i, (uint16_t)(vertexCount - 1 - i) };
+				std::memcpy(vertex, uv, sizeof(uv));
+			}
+			else
+			{
+				const float uv[2] = { distr(eng), distr(eng) };
+				std::memcpy(vertex, uv, sizeof(uv));
+			}
+		}
+
+		const uint32_t first = 3;
+		std::vector<float2> uvs(vertexCount - first);
+		omm::FetchUVBulk(texCoords.data(), strideInBytes, format, first, uvs.size(), uvs.data());
+		for (uint32_t i = first; i < vertexCount; ++i)
+		{
+			const float2 expected = omm::FetchUV(texCoords.data(), strideInBytes, format, i);
+			ASSERT_EQ(std::memcmp(&expected, &uvs[i - first], sizeof(float2)), 0) << "vertex " << i << " stride " << strideInBytes;
+		}
+	}
+
+	TEST(BitFunc, FetchUVBulk) {
+		RunFetchUVBulkTest(omm::TexCoordFormat::UV16_UNORM, 2, 4);
+		RunFetchUVBulkTest(omm::TexCoordFormat::UV16_UNORM, 2, 12);
+		RunFetchUVBulkTest(omm::TexCoordFormat::UV16_FLOAT, 2, 4);
+		RunFetchUVBulkTest(omm::TexCoordFormat::UV16_FLOAT, 2, 12);
+		RunFetchUVBulkTest(omm::TexCoordFormat::UV32_FLOAT, 4, 8);
+		RunFetchUVBulkTest(omm::TexCoordFormat::UV32_FLOAT, 4, 20);
+	}
+
+	TEST(BitFunc, GetUInt32IndicesBulk) {
+
+		const std::vector<uint16_t> indices16 = { 0, 7, 65535, 3, 2, 1 };
+		const std::vector<uint32_t> indices32 = { 0, 7, 100000, 3, 2, 1 };
+
+		std::vector<uint32_t> out(5);
+		uint32_t minIndex = 0, maxIndex = 0;
+		omm::GetUInt32IndicesBulk(omm::IndexFormat::I16_UINT, indices16.data(), 1, out.size(), out.data(), minIndex, maxIndex);
+		EXPECT_EQ(out, std::vector<uint32_t>({ 7, 65535, 3, 2, 1 }));
+		EXPECT_EQ(minIndex, 1u);
+		EXPECT_EQ(maxIndex, 65535u);
+		omm::GetUInt32IndicesBulk(omm::IndexFormat::I32_UINT, indices32.data(), 1, out.size(), out.data(), minIndex, maxIndex);
+		EXPECT_EQ(out, std::vector<uint32_t>({ 7, 100000, 3, 2, 1 }));
+		EXPECT_EQ(minIndex, 1u);
+		EXPECT_EQ(maxIndex, 100000u);
+
+		// Sub-range with a base vertex, and the non-indexed equivalent.
+		uint32_t triangle[3];
+		omm::GetUInt32Indices(omm::IndexFormat::I32_UINT, indices32.data(), 3, -1, 0, triangle);
+		EXPECT_EQ(std::vector<uint32_t>(triangle, triangle + 3), std::vector<uint32_t>({ 2, 1, 0 }));
+		omm::GetUInt32Indices(omm::IndexFormat::I32_UINT, nullptr, 3, 10, 3, triangle);
+		EXPECT_EQ(std::vector<uint32_t>(triangle, triangle + 3), std::vector<uint32_t>({ 16, 17, 18 }));
+	}
+
+}  // namespace
@@ -0,0 +1,211 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "omm_reference.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace omm
+{
+	namespace Test
+	{
+		namespace
+		{
+			struct Point
+			{
+				double x;
+				double y;
+			};
+
+			// Returns -1 for the border.
+			int AddressCoord(omm::TextureAddressMode mode, int x, int n)
+			{
+				switch (mode)
+				{
+				case omm::TextureAddressMode::Wrap:
+					return ((x % n) + n) % n;
+				case omm::TextureAddressMode::Mirror: {
+					const int m = ((x % (2 * n)) + 2 * n) % (2 * n);
+					return m < n ? m : 2 * n - 1 - m;
+				}
+				case omm::TextureAddressMode::Clamp:
+					return std::clamp(x, 0, n - 1);
+				case omm::TextureAddressMode::Border:
+					return x < 0 || x >= n ? -1 : x;
+				case omm::TextureAddressMode::MirrorOnce:
+					return std::clamp(x < 0 ? -x - 1 : x, 0, n - 1);
+				default:
+					return -1;
+				}
+			}
+
+			float Fetch(const ReferenceTexture& texture, int x, int y)
+			{
+				const int ax = AddressCoord(texture.addressMode, x, texture.size.x);
+				const int ay = AddressCoord(texture.addressMode, y, texture.size.y);
+				if (ax < 0 || ay < 0)
+					return texture.borderAlpha;
+				return texture.texels[size_t(ay) * texture.size.x + ax];
+			}
+
+			// Sutherland-Hodgman against the closed square [x0, x0 + 1] x [y0, y0 + 1].
+			std::vector<Point> ClipToCell(const std::vector<Point>& polygon, double x0, double y0)
+			{
+				std::vector<Point> out = polygon;
+				auto ClipAxis = [&out](bool isX, double bound, bool keepGreater) {
+					std::vector<Point> in;
+					in.swap(out);
+					auto Inside = [&](const Point& p) {
+						const double v = isX ? p.x : p.y;
+						return keepGreater ? v >= bound : v <= bound;
+					};
+					for (size_t i = 0; i < in.size(); ++i)
+					{
+						const Point& a = in[i];
+						const Point& b = in[(i + 1) % in.size()];
+						const bool insideA = Inside(a);
+						const bool insideB = Inside(b);
+						if (insideA)
+							out.push_back(a);
+						if (insideA != insideB)
+						{
+							const double va = isX ? a.x : a.y;
+							const double vb = isX ? b.x : b.y;
+							const double t = (bound - va) / (vb - va);
+							Point p = { a.x + t * (b.x - a.x), a.y + t * (b.y - a.y) };
+							if (isX) p.x = bound; else p.y = bound;
+							out.push_back(p);
+						}
+					}
+				};
+				ClipAxis(true, x0, true);
+				ClipAxis(true, x0 + 1, false);
+				ClipAxis(false, y0, true);
+				ClipAxis(false, y0 + 1, false);
+				return out;
+			}
+
+			void Include(ReferenceRange& range, double v)
+			{
+				range.min = std::min(range.min, (float)v);
+				range.max = std::max(range.max, (float)v);
+			}
+		}
+
+		float ReferenceSample(const ReferenceTexture& texture, const float2& uv)
+		{
+			if (texture.filterMode == omm::TextureFilterMode::Nearest)
+			{
+				const int x = (int)std::floor((double)uv.x * texture.size.x);
+				const int y = (int)std::floor((double)uv.y * texture.size.y);
+				return Fetch(texture, x, y);
+			}
+
+			const double px = (double)uv.x * texture.size.x - 0.5;
+			const double py = (double)uv.y * texture.size.y - 0.5;
+			const int x = (int)std::floor(px);
+			const int y = (int)std::floor(py);
+			const double s = px - x;
+			const double t = py - y;
+			return (float)(
+				Fetch(texture, x, y) * (1 - s) * (1 - t) + Fetch(texture, x + 1, y) * s * (1 - t) +
+				Fetch(texture, x, y + 1) * (1 - s) * t + Fetch(texture, x + 1, y + 1) * s * t);
+		}
+
+		ReferenceRange GetReferenceRange(const ReferenceTexture& texture, const Triangle& t)
+		{
+			ReferenceRange range = { std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+
+			// Texel space, for Linear shifted such that the cell [i, i + 1] interpolates texels i and i + 1.
+			const double offset = texture.filterMode == omm::TextureFilterMode::Linear ? 0.5 : 0.0;
+			std::vector<Point> triangle;
+			for (const float2& p : { t.p0, t.p1, t.p2 })
+				triangle.push_back({ (double)p.x * texture.size.x - offset, (double)p.y * texture.size.y - offset });
+
+			double minX = triangle[0].x, maxX = triangle[0].x, minY = triangle[0].y, maxY = triangle[0].y;
+			for (const Point& p : triangle)
+			{
+				minX = std::min(minX, p.x); maxX = std::max(maxX, p.x);
+				minY = std::min(minY, p.y); maxY = std::max(maxY, p.y);
+			}
+
+			for (int y = (int)std::floor(minY); y <= (int)std::floor(maxY); ++y)
+			{
+				for (int x = (int)std::floor(minX); x <= (int)std::floor(maxX); ++x)
+				{
+					const std::vector<Point> polygon = ClipToCell(triangle, x, y);
+					if (polygon.empty())
+						continue;
+
+					if (texture.filterMode == omm::TextureFilterMode::Nearest)
+					{
+						Include(range, Fetch(texture, x, y));
+						continue;
+					}
+
+					const double v00 = Fetch(texture, x, y);
+					const double v10 = Fetch(texture, x + 1, y);
+					const double v01 = Fetch(texture, x, y + 1);
+					const double v11 = Fetch(texture, x + 1, y + 1);
+
+					// f(s, t) = a + b s + c t + d s t
+					const double a = v00;
+					const double b = v10 - v00;
+					const double c = v01 - v00;
+					const double d = v00 - v10 - v01 + v11;
+					auto Eval = [&](double s, double t) { return a + b * s + c * t + d * s * t; };
+
+					for (size_t i = 0; i < polygon.size(); ++i)
+					{
+						const Point p0 = { polygon[i].x - x, polygon[i].y - y };
+						const Point p1 = { polygon[(i + 1) % polygon.size()].x - x, polygon[(i + 1) % polygon.size()].y - y };
+						Include(range, Eval(p0.x, p0.y));
+
+						// f along the edge is quadratic in the edge parameter u.
+						const double ds = p1.x - p0.x;
+						const double dt = p1.y - p0.y;
+						const double quadratic = d * ds * dt;
+						const double linear = b * ds + c * dt + d * (p0.x * dt + p0.y * ds);
+						if (quadratic != 0.0)
+						{
+							const double u = -linear / (2.0 * quadratic);
+							if (u > 0.0 && u < 1.0)
+								Include(range, Eval(p0.x + u * ds, p0.y + u * dt));
+						}
+					}
+				}
+			}
+			return range;
+		}
+
+		bool FindReferenceSample(const ReferenceTexture& texture, const Triangle& t, float alphaCutoff, bool opaque, float2& outUV)
+		{
+			static constexpr int kSamplesPerEdge = 32;
+			for (int j = 0; j <= kSamplesPerEdge; ++j)
+			{
+				for (int i = 0; i <= kSamplesPerEdge - j; ++i)
+				{
+					const float b1 = float(i) / kSamplesPerEdge;
+					const float b2 = float(j) / kSamplesPerEdge;
+					const float2 uv = t.p0 * (1.f - b1 - b2) + t.p1 * b1 + t.p2 * b2;
+					const float alpha = ReferenceSample(texture, uv);
+					if ((alpha > alphaCutoff) == opaque)
+					{
+						outUV = uv;
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+	}
+}
@@ -0,0 +1,51 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+#include <omm.h>
+#include <shared/math.h>
+#include <shared/triangle.h>
+
+#include <vector>
+
+namespace omm
+{
+	namespace Test
+	{
+		// Slow reference for the CPU baker, written independently of the SDK sampling code.
+		// Texels are row major, addressing follows the D3D sampler rules.
+		struct ReferenceTexture
+		{
+			int2 size;
+			std::vector<float> texels;
+			omm::TextureAddressMode addressMode;
+			omm::TextureFilterMode filterMode;
+			float borderAlpha;
+		};
+
+		struct ReferenceRange
+		{
+			float min;
+			float max;
+		};
+
+		// Alpha the runtime sampler returns at uv.
+		float ReferenceSample(const ReferenceTexture& texture, const float2& uv);
+
+		// Exact alpha range over the closed triangle (in uv). Nearest takes every texel the triangle touches,
+		// Linear takes the bilinear extrema over each texel quad the triangle overlaps, which lie on the boundary
+		// of the clipped polygon: at its vertices or at the extremum of the quadratic along an edge.
+		ReferenceRange GetReferenceRange(const ReferenceTexture& texture, const Triangle& t);
+
+		// Dense supersampling of the triangle, returns a point where the sampled alpha is on the given side of
+		// alphaCutoff (opaque: alpha > alphaCutoff). Used to report a concrete witness for a diverging micro-triangle.
+		bool FindReferenceSample(const ReferenceTexture& texture, const Triangle& t, float alphaCutoff, bool opaque, float2& outUV);
+	}
+}
@@ -0,0 +1,215 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "asset.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace ommbake
+{
+	namespace
+	{
+		std::string ToLower(std::string s)
+		{
+			std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+			return s;
+		}
+
+		// The remainder of the line after the keyword, file names may contain spaces.
+		std::string GetArgument(const std::string& line, size_t keywordLength)
+		{
+			const size_t begin = line.find_first_not_of(" \t", keywordLength);
+			if (begin == std::string::npos)
+				return {};
+			const size_t end = line.find_last_not_of(" \t\r");
+			return line.substr(begin, end - begin + 1);
+		}
+
+		std::filesystem::path FindMaterialTexture(const std::filesystem::path& mtlPath)
+		{
+			std::ifstream file(mtlPath);
+			std::string line;
+			std::string mapD;
+			std::string mapKd;
+			while (std::getline(file, line))
+			{
+				std::istringstream ss(line);
+				std::string keyword;
+				ss >> keyword;
+				// Only the first material is considered.
+				if (keyword == "newmtl" && (!mapD.empty() || !mapKd.empty()))
+					break;
+				if (keyword == "map_d" && mapD.empty())
+					mapD = GetArgument(line, line.find("map_d") + 5);
+				else if (keyword == "map_Kd" && mapKd.empty())
+					mapKd = GetArgument(line, line.find("map_Kd") + 6);
+			}
+
+			const std::string& map = mapD.empty() ? mapKd : mapD;
+			if (map.empty())
+				return {};
+			return mtlPath.parent_path() / map;
+		}
+
+		std::filesystem::path FindTexture(const std::filesystem::path& meshPath)
+		{
+			std::ifstream file(meshPath);
+			std::string line;
+			while (std::getline(file, line))
+			{
+				if (line.rfind("mtllib", 0) != 0)
+					continue;
+				const std::filesystem::path texture = FindMaterialTexture(meshPath.parent_path() / GetArgument(line, 6));
+				if (!texture.empty() && std::filesystem::exists(texture))
+					return texture;
+			}
+
+			for (const char* extension : { ".png", ".tga", ".jpg", ".bmp" })
+			{
+				std::filesystem::path texture = meshPath;
+				texture.replace_extension(extension);
+				if (std::filesystem::exists(texture))
+					return texture;
+			}
+			return {};
+		}
+
+		Asset MakeAsset(const std::filesystem::path& meshPath, const std::filesystem::path& root)
+		{
+			Asset asset;
+			asset.meshPath = meshPath;
+			asset.texturePath = FindTexture(meshPath);
+			// Names the output files. Flattening the relative path can map different meshes to the same name, the caller
+			// has to make names unique across all assets it bakes.
+			std::filesystem::path relative = root.empty() ? meshPath.filename() : std::filesystem::relative(meshPath, root);
+			relative.replace_extension();
+			asset.name = relative.generic_string();
+			std::replace(asset.name.begin(), asset.name.end(), '/', '_');
+			return asset;
+		}
+	}
+
+	std::vector<Asset> FindAssets(const std::filesystem::path& path)
+	{
+		std::vector<Asset> assets;
+		if (std::filesystem::is_directory(path))
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
+			{
+				if (entry.is_regular_file() && ToLower(entry.path().extension().string()) == ".obj")
+					assets.push_back(MakeAsset(entry.path(), path));
+			}
+			// Directory iteration order is unspecified.
+			std::sort(assets.begin(), assets.end(), [](const Asset& a, const Asset& b) { return a.meshPath < b.meshPath; });
+		}
+		else if (std::filesystem::is_regular_file(path))
+		{
+			assets.push_back(MakeAsset(path, {}));
+		}
+		return assets;
+	}
+
+	bool LoadObj(const std::filesystem::path& path, bool flipV, Mesh& outMesh, std::string& outError)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			outError = "failed to open " + path.string();
+			return false;
+		}
+
+		outMesh = {};
+		std::string line;
+		std::vector<uint32_t> polygon;
+		uint32_t lineIt = 0;
+		while (std::getline(file, line))
+		{
+			++lineIt;
+			std::istringstream ss(line);
+			std::string keyword;
+			ss >> keyword;
+
+			if (keyword == "vt")
+			{
+				float u = 0.f;
+				float v = 0.f;
+				if (!(ss >> u >> v))
+				{
+					outError = path.string() + ":" + std::to_string(lineIt) + ": invalid texture coordinate";
+					return false;
+				}
+				outMesh.texCoords.push_back(u);
+				outMesh.texCoords.push_back(flipV ? 1.f - v : v);
+			}
+			else if (keyword == "f")
+			{
+				// v/vt/vn, v/vt or v//vn. Indices are 1-based, negative indices are relative to the end.
+				polygon.clear();
+				std::string vertex;
+				while (ss >> vertex)
+				{
+					const size_t slash = vertex.find('/');
+					const std::string vt = slash == std::string::npos ? std::string() : vertex.substr(slash + 1, vertex.find('/', slash + 1) - slash - 1);
+					const int64_t texCoordCount = (int64_t)outMesh.texCoords.size() / 2;
+					const int64_t index = vt.empty() ? 0 : std::strtoll(vt.c_str(), nullptr, 10);
+					const int64_t resolved = index < 0 ? texCoordCount + index : index - 1;
+					if (index == 0 || resolved < 0 || resolved >= texCoordCount)
+					{
+						outError = path.string() + ":" + std::to_string(lineIt) + ": face without a valid texture coordinate";
+						return false;
+					}
+					polygon.push_back((uint32_t)resolved);
+				}
+
+				for (size_t vertexIt = 2; vertexIt < polygon.size(); ++vertexIt)
+				{
+					outMesh.indices.push_back(polygon[0]);
+					outMesh.indices.push_back(polygon[vertexIt - 1]);
+					outMesh.indices.push_back(polygon[vertexIt]);
+				}
+			}
+		}
+
+		if (outMesh.indices.empty())
+		{
+			outError = path.string() + ": no faces";
+			return false;
+		}
+		return true;
+	}
+
+	bool LoadAlphaTexture(const std::filesystem::path& path, AlphaTexture& outTexture, std::string& outError)
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		uint8_t* data = stbi_load(path.string().c_str(), &width, &height, &channels, 0);
+		if (data == nullptr)
+		{
+			outError = "failed to load " + path.string() + ": " + stbi_failure_reason();
+			return false;
+		}
+
+		// Grey+alpha and RGBA carry alpha in the last channel.
+		const int alphaChannel = channels == 2 || channels == 4 ? channels - 1 : 0;
+		outTexture.width = (uint32_t)width;
+		outTexture.height = (uint32_t)height;
+		outTexture.alpha.resize(size_t(width) * height);
+		for (size_t i = 0; i < outTexture.alpha.size(); ++i)
+			outTexture.alpha[i] = data[i * channels + alphaChannel] / 255.f;
+
+		stbi_image_free(data);
+		return true;
+	}
+}
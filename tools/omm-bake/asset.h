@@ -0,0 +1,56 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace ommbake
+{
+	// Only the texture coordinates of a mesh are relevant for baking.
+	struct Mesh
+	{
+		// UV pairs, one per OBJ 'vt' entry.
+		std::vector<float> texCoords;
+		// Three per triangle, indexing texCoords. Polygons are triangulated as fans.
+		std::vector<uint32_t> indices;
+	};
+
+	struct AlphaTexture
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// Row major, top row first, [0, 1].
+		std::vector<float> alpha;
+	};
+
+	struct Asset
+	{
+		// Path relative to the input directory (or the file name) without extension, '/' replaced by '_'. Not unique.
+		std::string name;
+		std::filesystem::path meshPath;
+		// Empty if no alpha texture was found.
+		std::filesystem::path texturePath;
+	};
+
+	// path is an OBJ file or a directory searched recursively for OBJ files.
+	// The alpha texture of a mesh is the map_d (or else map_Kd) of the first material in its mtllib,
+	// otherwise an image next to the mesh with the same name.
+	std::vector<Asset> FindAssets(const std::filesystem::path& path);
+
+	// flipV: OBJ has v = 0 at the bottom of the image, the baker at the top row.
+	bool LoadObj(const std::filesystem::path& path, bool flipV, Mesh& outMesh, std::string& outError);
+
+	// PNG, TGA, JPG, BMP... anything stb_image decodes. The alpha channel is used if present, otherwise the first channel.
+	bool LoadAlphaTexture(const std::filesystem::path& path, AlphaTexture& outTexture, std::string& outError);
+}
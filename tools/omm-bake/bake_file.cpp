@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "bake_file.h"
+
+#include <fstream>
+#include <vector>
+
+namespace ommbake
+{
+	namespace
+	{
+		class Writer
+		{
+		public:
+			void U16(uint16_t v) { Bytes(v, 2); }
+			void U32(uint32_t v) { Bytes(v, 4); }
+			void Raw(const void* data, size_t size) {
+				if (size != 0)
+					_data.insert(_data.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+			}
+
+			void UsageCounts(const omm::Cpu::OpacityMicromapUsageCount* counts, uint32_t count) {
+				U32(count);
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					U32(counts[i].count);
+					U16(counts[i].subdivisionLevel);
+					U16(counts[i].format);
+				}
+			}
+
+			const std::vector<uint8_t>& GetData() const { return _data; }
+
+		private:
+			void Bytes(uint32_t v, uint32_t byteCount) {
+				for (uint32_t i = 0; i < byteCount; ++i)
+					_data.push_back(uint8_t(v >> (8 * i)));
+			}
+
+			std::vector<uint8_t> _data;
+		};
+	}
+
+	size_t WriteBakeFile(const std::filesystem::path& path, const omm::Cpu::BakeResultDesc& resDesc)
+	{
+		Writer w;
+		w.Raw("OMMB", 4);
+		w.U32(kBakeFileVersion);
+		w.U32((uint32_t)resDesc.ommIndexFormat);
+
+		w.U32(resDesc.ommIndexCount);
+		for (uint32_t i = 0; i < resDesc.ommIndexCount; ++i)
+		{
+			if (resDesc.ommIndexFormat == omm::IndexFormat::I16_UINT)
+				w.U16(((const uint16_t*)resDesc.ommIndexBuffer)[i]);
+			else
+				w.U32(((const uint32_t*)resDesc.ommIndexBuffer)[i]);
+		}
+
+		w.U32(resDesc.ommDescArrayCount);
+		for (uint32_t i = 0; i < resDesc.ommDescArrayCount; ++i)
+		{
+			w.U32(resDesc.ommDescArray[i].offset);
+			w.U16(resDesc.ommDescArray[i].subdivisionLevel);
+			w.U16(resDesc.ommDescArray[i].format);
+		}
+
+		w.U32(resDesc.ommArrayDataSize);
+		w.Raw(resDesc.ommArrayData, resDesc.ommArrayDataSize);
+
+		w.UsageCounts(resDesc.ommDescArrayHistogram, resDesc.ommDescArrayHistogramCount);
+		w.UsageCounts(resDesc.ommIndexHistogram, resDesc.ommIndexHistogramCount);
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+			return 0;
+		file.write((const char*)w.GetData().data(), (std::streamsize)w.GetData().size());
+		return file ? w.GetData().size() : 0;
+	}
+}
@@ -0,0 +1,33 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <omm.h>
+
+#include <filesystem>
+
+namespace ommbake
+{
+	// Bake result file (.omm). Little endian, independent of the compiler struct layout:
+	//
+	//   char[4]   magic "OMMB"
+	//   uint32    version, kBakeFileVersion
+	//   uint32    ommIndexFormat (omm::IndexFormat)
+	//   uint32    ommIndexCount               followed by the index buffer, 2 or 4 bytes per index
+	//   uint32    ommDescArrayCount           followed by { uint32 offset, uint16 subdivisionLevel, uint16 format } per OMM
+	//   uint32    ommArrayDataSize            followed by the OMM array data
+	//   uint32    ommDescArrayHistogramCount  followed by { uint32 count, uint16 subdivisionLevel, uint16 format } per entry
+	//   uint32    ommIndexHistogramCount      followed by { uint32 count, uint16 subdivisionLevel, uint16 format } per entry
+	static constexpr uint32_t kBakeFileVersion = 1;
+
+	// Returns the number of bytes written, 0 on failure.
+	size_t WriteBakeFile(const std::filesystem::path& path, const omm::Cpu::BakeResultDesc& resDesc);
+}
@@ -0,0 +1,498 @@
+/*
+Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+// omm-bake: bakes OBJ meshes with their alpha textures on the CPU baker and reports timing, size and coverage per asset.
+// Assets are baked in parallel, the report is printed in asset order once all bakes are done.
+
+#include "asset.h"
+#include "bake_file.h"
+
+#include <omm.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		std::vector<std::filesystem::path> inputs;
+		std::filesystem::path outputDir;
+		uint32_t jobs = std::max(1u, std::thread::hardware_concurrency());
+		bool json = false;
+		bool flipV = true;
+		size_t textureCacheSizeInBytes = 0;
+
+		uint32_t maxSubdivisionLevel = 8;
+		float dynamicSubdivisionScale = 2.f;
+		float alphaCutoff = 0.5f;
+		float rejectionThreshold = 0.f;
+		float nearDuplicateErrorBudget = 0.f;
+		omm::OMMFormat format = omm::OMMFormat::OC1_4_State;
+		omm::UnknownStatePromotion unknownStatePromotion = omm::UnknownStatePromotion::ForceOpaque;
+		omm::TextureFilterMode filter = omm::TextureFilterMode::Linear;
+		omm::TextureAddressMode addressMode = omm::TextureAddressMode::Clamp;
+		uint32_t bakeFlags = (uint32_t)omm::Cpu::BakeFlags::None;
+	};
+
+	struct AssetResult
+	{
+		std::string error;
+		uint32_t triangleCount = 0;
+		uint32_t textureWidth = 0;
+		uint32_t textureHeight = 0;
+		double loadMs = 0.0;
+		double bakeMs = 0.0;
+		uint32_t ommCount = 0;
+		uint32_t ommArrayDataSize = 0;
+		size_t ommIndexBufferSize = 0;
+		size_t fileSize = 0;
+		omm::Debug::Stats stats;
+	};
+
+	void PrintUsage()
+	{
+		std::fprintf(stderr,
+			"usage: omm-bake [options] <mesh.obj | directory>...\n"
+			"\n"
+			"Directories are searched recursively for .obj files. The alpha texture of a mesh is the map_d (or map_Kd)\n"
+			"of its first material, otherwise an image with the same name next to the mesh.\n"
+			"\n"
+			"  -o, --output <dir>             write <asset>.omm bake results to dir\n"
+			"  -j, --jobs <n>                 assets baked in parallel (default: hardware threads)\n"
+			"      --json                     report as JSON instead of CSV\n"
+			"      --level <n>                max subdivision level [0, 12] (default 8)\n"
+			"      --dynamic-scale <f>        dynamic subdivision scale, <= 0 for a fixed level (default 2)\n"
+			"      --format <2|4>             OMM format, 2 or 4 state (default 4)\n"
+			"      --cutoff <f>               alpha cutoff (default 0.5)\n"
+			"      --promotion <mode>         nearest | opaque | transparent (default opaque)\n"
+			"      --filter <mode>            nearest | linear (default linear)\n"
+			"      --address <mode>           wrap | mirror | clamp | border | mirroronce (default clamp)\n"
+			"      --rejection-threshold <f>  discard OMMs with fewer known states (default 0)\n"
+			"      --near-dup                 enable near-duplicate detection\n"
+			"      --error-budget <f>         near-duplicate error budget, implies --near-dup (default 0)\n"
+			"      --no-special-indices       disable special indices\n"
+			"      --no-dedup                 disable exact duplicate detection\n"
+			"      --force-32bit-indices      always output 32-bit indices\n"
+			"      --internal-threads         also parallelize within each bake\n"
+			"      --texture-cache <MB>       share textures with identical content across assets (default 0, off)\n"
+			"      --no-flip-v                keep OBJ v as is, by default v is flipped to put the first image row at v = 0\n");
+	}
+
+	bool ParseArgs(int argc, char** argv, Options& o)
+	{
+		auto Next = [&](int& i) -> const char* {
+			if (i + 1 >= argc)
+			{
+				std::fprintf(stderr, "missing value for %s\n", argv[i]);
+				return nullptr;
+			}
+			return argv[++i];
+		};
+
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const char* value = nullptr;
+			if (arg == "-h" || arg == "--help")
+				return false;
+			else if (arg == "-o" || arg == "--output")
+			{
+				if (!(value = Next(i))) return false;
+				o.outputDir = value;
+			}
+			else if (arg == "-j" || arg == "--jobs")
+			{
+				if (!(value = Next(i))) return false;
+				o.jobs = std::max(1, std::atoi(value));
+			}
+			else if (arg == "--json")
+				o.json = true;
+			else if (arg == "--level")
+			{
+				if (!(value = Next(i))) return false;
+				o.maxSubdivisionLevel = (uint32_t)std::atoi(value);
+			}
+			else if (arg == "--dynamic-scale")
+			{
+				if (!(value = Next(i))) return false;
+				o.dynamicSubdivisionScale = (float)std::atof(value);
+			}
+			else if (arg == "--format")
+			{
+				if (!(value = Next(i))) return false;
+				if (std::strcmp(value, "2") == 0) o.format = omm::OMMFormat::OC1_2_State;
+				else if (std::strcmp(value, "4") == 0) o.format = omm::OMMFormat::OC1_4_State;
+				else { std::fprintf(stderr, "invalid format %s\n", value); return false; }
+			}
+			else if (arg == "--cutoff")
+			{
+				if (!(value = Next(i))) return false;
+				o.alphaCutoff = (float)std::atof(value);
+			}
+			else if (arg == "--promotion")
+			{
+				if (!(value = Next(i))) return false;
+				if (std::strcmp(value, "nearest") == 0) o.unknownStatePromotion = omm::UnknownStatePromotion::Nearest;
+				else if (std::strcmp(value, "opaque") == 0) o.unknownStatePromotion = omm::UnknownStatePromotion::ForceOpaque;
+				else if (std::strcmp(value, "transparent") == 0) o.unknownStatePromotion = omm::UnknownStatePromotion::ForceTransparent;
+				else { std::fprintf(stderr, "invalid promotion %s\n", value); return false; }
+			}
+			else if (arg == "--filter")
+			{
+				if (!(value = Next(i))) return false;
+				if (std::strcmp(value, "nearest") == 0) o.filter = omm::TextureFilterMode::Nearest;
+				else if (std::strcmp(value, "linear") == 0) o.filter = omm::TextureFilterMode::Linear;
+				else { std::fprintf(stderr, "invalid filter %s\n", value); return false; }
+			}
+			else if (arg == "--address")
+			{
+				if (!(value = Next(i))) return false;
+				const char* modes[] = { "wrap", "mirror", "clamp", "border", "mirroronce" };
+				uint32_t modeIt = 0;
+				while (modeIt < (uint32_t)omm::TextureAddressMode::MAX_NUM && std::strcmp(value, modes[modeIt]) != 0)
+					++modeIt;
+				if (modeIt == (uint32_t)omm::TextureAddressMode::MAX_NUM) { std::fprintf(stderr, "invalid address mode %s\n", value); return false; }
+				o.addressMode = (omm::TextureAddressMode)modeIt;
+			}
+			else if (arg == "--rejection-threshold")
+			{
+				if (!(value = Next(i))) return false;
+				o.rejectionThreshold = (float)std::atof(value);
+			}
+			else if (arg == "--near-dup")
+				o.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection;
+			else if (arg == "--error-budget")
+			{
+				if (!(value = Next(i))) return false;
+				o.nearDuplicateErrorBudget = (float)std::atof(value);
+				o.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection;
+			}
+			else if (arg == "--no-special-indices")
+				o.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::DisableSpecialIndices;
+			else if (arg == "--no-dedup")
+				o.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::DisableDuplicateDetection;
+			else if (arg == "--force-32bit-indices")
+				o.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::Force32BitIndices;
+			else if (arg == "--internal-threads")
+				o.bakeFlags |= (uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads;
+			else if (arg == "--texture-cache")
+			{
+				if (!(value = Next(i))) return false;
+				o.textureCacheSizeInBytes = size_t(std::max(0, std::atoi(value))) << 20;
+			}
+			else if (arg == "--no-flip-v")
+				o.flipV = false;
+			else if (!arg.empty() && arg[0] == '-')
+			{
+				std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+				return false;
+			}
+			else
+				o.inputs.push_back(arg);
+		}
+		return !o.inputs.empty();
+	}
+
+	const char* ResultToString(omm::Result result)
+	{
+		switch (result)
+		{
+		case omm::Result::SUCCESS: return "SUCCESS";
+		case omm::Result::FAILURE: return "FAILURE";
+		case omm::Result::INVALID_ARGUMENT: return "INVALID_ARGUMENT";
+		case omm::Result::INSUFFICIENT_SCRATCH_MEMORY: return "INSUFFICIENT_SCRATCH_MEMORY";
+		case omm::Result::NOT_IMPLEMENTED: return "NOT_IMPLEMENTED";
+		case omm::Result::WORKLOAD_TOO_BIG: return "WORKLOAD_TOO_BIG";
+		default: return "UNKNOWN";
+		}
+	}
+
+	double MsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	AssetResult BakeAsset(omm::Baker baker, const Options& o, const ommbake::Asset& asset)
+	{
+		AssetResult r;
+		if (asset.texturePath.empty())
+		{
+			r.error = "no alpha texture found";
+			return r;
+		}
+
+		const auto loadStart = std::chrono::steady_clock::now();
+		ommbake::Mesh mesh;
+		ommbake::AlphaTexture alpha;
+		if (!ommbake::LoadObj(asset.meshPath, o.flipV, mesh, r.error) || !ommbake::LoadAlphaTexture(asset.texturePath, alpha, r.error))
+			return r;
+		r.triangleCount = (uint32_t)mesh.indices.size() / 3;
+		r.textureWidth = alpha.width;
+		r.textureHeight = alpha.height;
+
+		omm::Cpu::TextureMipDesc mip;
+		mip.width = alpha.width;
+		mip.height = alpha.height;
+		mip.textureData = alpha.alpha.data();
+
+		omm::Cpu::TextureDesc texDesc;
+		texDesc.format = omm::Cpu::TextureFormat::FP32;
+		texDesc.mips = &mip;
+		texDesc.mipCount = 1;
+
+		omm::Cpu::Texture texture = 0;
+		omm::Result result = omm::Cpu::CreateTexture(baker, texDesc, &texture);
+		if (result != omm::Result::SUCCESS)
+		{
+			r.error = std::string("CreateTexture failed: ") + ResultToString(result);
+			return r;
+		}
+		r.loadMs = MsSince(loadStart);
+
+		omm::Cpu::BakeInputDesc desc;
+		desc.bakeFlags = (omm::Cpu::BakeFlags)o.bakeFlags;
+		desc.texture = texture;
+		desc.runtimeSamplerDesc.addressingMode = o.addressMode;
+		desc.runtimeSamplerDesc.filter = o.filter;
+		desc.alphaMode = omm::AlphaMode::Test;
+		desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+		desc.texCoords = mesh.texCoords.data();
+		desc.indexFormat = omm::IndexFormat::I32_UINT;
+		desc.indexBuffer = mesh.indices.data();
+		desc.indexCount = (uint32_t)mesh.indices.size();
+		desc.dynamicSubdivisionScale = o.dynamicSubdivisionScale;
+		desc.rejectionThreshold = o.rejectionThreshold;
+		desc.nearDuplicateErrorBudget = o.nearDuplicateErrorBudget;
+		desc.alphaCutoff = o.alphaCutoff;
+		desc.unknownStatePromotion = o.unknownStatePromotion;
+		desc.ommFormat = o.format;
+		desc.maxSubdivisionLevel = (uint8_t)o.maxSubdivisionLevel;
+
+		const auto bakeStart = std::chrono::steady_clock::now();
+		omm::Cpu::BakeResult res = 0;
+		result = omm::Cpu::BakeOpacityMicromap(baker, desc, &res);
+		r.bakeMs = MsSince(bakeStart);
+
+		if (result == omm::Result::SUCCESS)
+		{
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			omm::Cpu::GetBakeResultDesc(res, resDesc);
+
+			r.ommCount = resDesc->ommDescArrayCount;
+			r.ommArrayDataSize = resDesc->ommArrayDataSize;
+			r.ommIndexBufferSize = size_t(resDesc->ommIndexCount) * (resDesc->ommIndexFormat == omm::IndexFormat::I16_UINT ? 2 : 4);
+			omm::Debug::GetStats(baker, resDesc, &r.stats);
+
+			if (!o.outputDir.empty())
+			{
+				const std::filesystem::path path = o.outputDir / (asset.name + ".omm");
+				r.fileSize = ommbake::WriteBakeFile(path, *resDesc);
+				if (r.fileSize == 0)
+					r.error = "failed to write " + path.string();
+			}
+			omm::Cpu::DestroyBakeResult(res);
+		}
+		else
+		{
+			r.error = std::string("BakeOpacityMicromap failed: ") + ResultToString(result);
+		}
+
+		omm::Cpu::DestroyTexture(baker, texture);
+		return r;
+	}
+
+	std::string Escape(const std::string& s, bool json)
+	{
+		std::string out;
+		for (char c : s)
+		{
+			if (c == '"')
+				out += json ? "\\\"" : "\"\"";
+			else if (c == '\\' && json)
+				out += "\\\\";
+			else if ((unsigned char)c < 0x20 && json)
+			{
+				// JSON strings can't hold raw control characters, file names can.
+				char hex[8];
+				std::snprintf(hex, sizeof(hex), "\\u%04x", (unsigned char)c);
+				out += hex;
+			}
+			else if (c == '\n')
+				out += ' ';
+			else
+				out += c;
+		}
+		return out;
+	}
+
+	// Asset names flatten the path relative to their input and name the output files, so different meshes can end up
+	// with the same name (a_b/c.obj and a/b_c.obj, or the same file name under two inputs). Every asset after the first
+	// with a name gets a numbered suffix. Names are compared case-insensitively, the output may be on a file system
+	// that is.
+	void MakeNamesUnique(std::vector<ommbake::Asset>& assets)
+	{
+		auto ToLower = [](std::string s) {
+			std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+			return s;
+		};
+
+		std::unordered_set<std::string> names;
+		for (const ommbake::Asset& asset : assets)
+			names.insert(ToLower(asset.name));
+
+		std::unordered_set<std::string> used;
+		for (ommbake::Asset& asset : assets)
+		{
+			if (used.insert(ToLower(asset.name)).second)
+				continue;
+
+			// Skip suffixed names taken by other assets as well, so renaming never causes a collision of its own.
+			std::string name;
+			for (uint32_t suffix = 2; name.empty() || names.count(ToLower(name)) != 0 || used.count(ToLower(name)) != 0; ++suffix)
+				name = asset.name + "-" + std::to_string(suffix);
+
+			std::fprintf(stderr, "warning: asset name %s is taken, %s is baked as %s\n", asset.name.c_str(), asset.meshPath.string().c_str(), name.c_str());
+			used.insert(ToLower(name));
+			asset.name = name;
+		}
+	}
+
+	void PrintReport(const Options& o, const std::vector<ommbake::Asset>& assets, const std::vector<AssetResult>& results)
+	{
+		struct Column
+		{
+			const char* name;
+			std::string (*value)(const AssetResult&);
+		};
+
+		// Numeric columns, shared by the CSV and JSON output.
+		static const Column kColumns[] = {
+			{ "triangles",						[](const AssetResult& r) { return std::to_string(r.triangleCount); } },
+			{ "texture_width",					[](const AssetResult& r) { return std::to_string(r.textureWidth); } },
+			{ "texture_height",					[](const AssetResult& r) { return std::to_string(r.textureHeight); } },
+			{ "load_ms",						[](const AssetResult& r) { return std::to_string(r.loadMs); } },
+			{ "bake_ms",						[](const AssetResult& r) { return std::to_string(r.bakeMs); } },
+			{ "omm_count",						[](const AssetResult& r) { return std::to_string(r.ommCount); } },
+			{ "omm_array_bytes",				[](const AssetResult& r) { return std::to_string(r.ommArrayDataSize); } },
+			{ "omm_index_bytes",				[](const AssetResult& r) { return std::to_string(r.ommIndexBufferSize); } },
+			{ "file_bytes",						[](const AssetResult& r) { return std::to_string(r.fileSize); } },
+			{ "opaque",							[](const AssetResult& r) { return std::to_string(r.stats.totalOpaque); } },
+			{ "transparent",					[](const AssetResult& r) { return std::to_string(r.stats.totalTransparent); } },
+			{ "unknown_opaque",					[](const AssetResult& r) { return std::to_string(r.stats.totalUnknownOpaque); } },
+			{ "unknown_transparent",			[](const AssetResult& r) { return std::to_string(r.stats.totalUnknownTransparent); } },
+			{ "fully_opaque",					[](const AssetResult& r) { return std::to_string(r.stats.totalFullyOpaque); } },
+			{ "fully_transparent",				[](const AssetResult& r) { return std::to_string(r.stats.totalFullyTransparent); } },
+			{ "fully_unknown_opaque",			[](const AssetResult& r) { return std::to_string(r.stats.totalFullyUnknownOpaque); } },
+			{ "fully_unknown_transparent",		[](const AssetResult& r) { return std::to_string(r.stats.totalFullyUnknownTransparent); } },
+		};
+
+		if (o.json)
+		{
+			std::printf("[\n");
+			for (size_t i = 0; i < assets.size(); ++i)
+			{
+				std::printf("  { \"asset\": \"%s\", \"error\": \"%s\"", Escape(assets[i].name, true).c_str(), Escape(results[i].error, true).c_str());
+				for (const Column& column : kColumns)
+					std::printf(", \"%s\": %s", column.name, column.value(results[i]).c_str());
+				std::printf(" }%s\n", i + 1 == assets.size() ? "" : ",");
+			}
+			std::printf("]\n");
+		}
+		else
+		{
+			std::printf("asset,error");
+			for (const Column& column : kColumns)
+				std::printf(",%s", column.name);
+			std::printf("\n");
+			for (size_t i = 0; i < assets.size(); ++i)
+			{
+				std::printf("\"%s\",\"%s\"", Escape(assets[i].name, false).c_str(), Escape(results[i].error, false).c_str());
+				for (const Column& column : kColumns)
+					std::printf(",%s", column.value(results[i]).c_str());
+				std::printf("\n");
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options o;
+	if (!ParseArgs(argc, argv, o))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<ommbake::Asset> assets;
+	for (const std::filesystem::path& input : o.inputs)
+	{
+		const std::vector<ommbake::Asset> found = ommbake::FindAssets(input);
+		if (found.empty())
+			std::fprintf(stderr, "warning: no .obj found at %s\n", input.string().c_str());
+		assets.insert(assets.end(), found.begin(), found.end());
+	}
+	MakeNamesUnique(assets);
+
+	if (!o.outputDir.empty())
+		std::filesystem::create_directories(o.outputDir);
+
+	omm::BakerCreationDesc bakerDesc;
+	bakerDesc.type = omm::BakerType::CPU;
+	bakerDesc.textureCacheSizeInBytes = o.textureCacheSizeInBytes;
+	omm::Baker baker = 0;
+	if (omm::CreateOpacityMicromapBaker(bakerDesc, &baker) != omm::Result::SUCCESS)
+	{
+		std::fprintf(stderr, "failed to create the baker\n");
+		return 1;
+	}
+
+	// A single baker is safe to use for concurrent bakes.
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<AssetResult> results(assets.size());
+	std::atomic<size_t> nextAsset = 0;
+	std::vector<std::thread> workers;
+	for (uint32_t workerIt = 0; workerIt < std::min<size_t>(o.jobs, assets.size()); ++workerIt)
+	{
+		workers.emplace_back([&]() {
+			for (size_t assetIt = nextAsset++; assetIt < assets.size(); assetIt = nextAsset++)
+				results[assetIt] = BakeAsset(baker, o, assets[assetIt]);
+		});
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+	const double totalMs = MsSince(start);
+
+	omm::DestroyOpacityMicromapBaker(baker);
+
+	PrintReport(o, assets, results);
+
+	uint64_t triangleCount = 0;
+	uint32_t failedCount = 0;
+	for (const AssetResult& r : results)
+	{
+		triangleCount += r.triangleCount;
+		failedCount += r.error.empty() ? 0 : 1;
+	}
+	std::fprintf(stderr, "%zu assets (%u failed), %llu triangles in %.1f ms, %.0f triangles/s\n",
+		assets.size(), failedCount, (unsigned long long)triangleCount, totalMs, totalMs > 0.0 ? 1000.0 * triangleCount / totalMs : 0.0);
+
+	return failedCount == 0 ? 0 : 2;
+}